@@ -1,48 +1,368 @@
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <random>
 #include <string>
+#include <thread>
+#include <type_traits>
 
+#include "binary_scene.hpp"
 #include "camera.hpp"
 #include "dielectric.hpp"
 #include "different_dielectrics_scene.hpp"
+#include "distributed_render.hpp"
+#include "file_scene.hpp"
 #include "hittable_list.hpp"
 #include "image.hpp"
 #include "lambertian.hpp"
 #include "metal.hpp"
+#include "profiler.hpp"
 #include "rand_engine.hpp"
 #include "random_spheres_scene.hpp"
+#include "ray_statistics.hpp"
+#include "render_service.hpp"
 #include "renderer.hpp"
 #include "sphere.hpp"
 #include "two_spheres_scene.hpp"
 
-int main()
+namespace {
+
+#if defined(GLANCY_ENABLE_PROFILER)
+// Prints the report of the profiler when glancy is done, and writes its
+// trace to the file in GLANCY_PROFILE_TRACE, if set
+class ProfilerOutput
+{
+  public:
+    ProfilerOutput() : trace_path_(std::getenv("GLANCY_PROFILE_TRACE"))
+    {
+        plemma::profiler::EnableTrace(trace_path_ != nullptr);
+    }
+    ~ProfilerOutput()
+    {
+        std::cout << std::endl;
+        plemma::profiler::WriteReport(std::cout);
+        if (trace_path_ && !plemma::profiler::WriteChromeTrace(trace_path_))
+            std::cerr << "Trace could not be written to " << trace_path_ << std::endl;
+    }
+    ProfilerOutput(ProfilerOutput const&) = delete;
+    ProfilerOutput& operator=(ProfilerOutput const&) = delete;
+
+  private:
+    char const* trace_path_;
+};
+#endif
+
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+// Prints the ray statistics of all the images rendered, once they are done
+class RayStatisticsOutput
+{
+  public:
+    RayStatisticsOutput() = default;
+    ~RayStatisticsOutput()
+    {
+        std::cout << "Ray statistics:" << std::endl;
+        plemma::glancy::WriteRayStatistics(std::cout, plemma::glancy::TotalRayStatistics());
+        std::cout << std::endl;
+    }
+    RayStatisticsOutput(RayStatisticsOutput const&) = delete;
+    RayStatisticsOutput& operator=(RayStatisticsOutput const&) = delete;
+};
+#endif
+
+using plemma::glancy::Camera;
+using plemma::glancy::Image;
+using plemma::glancy::RealNum;
+using plemma::glancy::RenderMode;
+using plemma::glancy::RenderSettings;
+using plemma::glancy::Scene;
+
+// Renders 'scene' to 'output_path'. Returns false if the image could not
+// be saved.
+bool Render(Scene const& scene,
+            Camera const& camera,
+            RenderSettings const& settings,
+            std::string const& output_path,
+            RenderMode mode = RenderMode::kBeauty)
+{
+    Image image(settings.width, settings.height);
+    auto gamma_correction = [](RealNum x) { return plemma::glancy::Real(std::sqrt(x)); };
+    plemma::glancy::Renderer rend(gamma_correction,
+                                  settings.width,
+                                  settings.height,
+                                  settings.samples_per_pixel,
+                                  settings.max_depth);
+    plemma::glancy::ApplyEnvironmentSettings(rend);
+    rend.SetMode(mode);
+
+    std::cout << "Please, wait patiently while Glancy is enlightened" << std::endl;
+    std::cout << std::endl;
+
+    rend.ProcessScene(scene, camera, image);
+    if (!image.Save(output_path)) {
+        std::cerr << "Image could not be saved in '" << output_path << "'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Path of frame 'frame' of an animation rendered to 'output_path', which
+// gets the number of the frame before its extension: out.ppm -> out_0007.ppm
+std::string FramePath(std::string const& output_path, std::size_t frame)
+{
+    std::string number = std::to_string(frame);
+    number.insert(0U, number.size() < 4U ? 4U - number.size() : 0U, '0');
+    std::size_t const extension = output_path.rfind('.');
+    std::size_t const directory_end = output_path.rfind('/');
+    if (extension == std::string::npos ||
+        (directory_end != std::string::npos && extension < directory_end))
+        return output_path + "_" + number;
+    return output_path.substr(0U, extension) + "_" + number + output_path.substr(extension);
+}
+
+// Renders the frames of the animation of 'scene', saving each of them as
+// soon as it is done. The world is prepared once for the whole animation
+// and only refitted to the shutter interval of each frame. Returns false,
+// stopping there, if a frame could not be saved.
+bool RenderAnimation(plemma::glancy::FileScene const& scene,
+                     std::string const& output_path,
+                     RenderMode mode)
+{
+    RenderSettings const& settings = scene.Settings();
+    plemma::glancy::AnimationSettings const& animation = *scene.Animation();
+    auto gamma_correction = [](RealNum x) { return plemma::glancy::Real(std::sqrt(x)); };
+    plemma::glancy::Renderer rend(gamma_correction,
+                                  settings.width,
+                                  settings.height,
+                                  settings.samples_per_pixel,
+                                  settings.max_depth);
+    plemma::glancy::ApplyEnvironmentSettings(rend);
+    rend.SetMode(mode);
+    rend.Prepare(scene, animation.time_from, animation.time_to);
+
+    Image image(settings.width, settings.height);
+    for (std::size_t frame = 0; frame < animation.frame_count; ++frame) {
+        Camera const camera = scene.MakeFrameCamera(frame);
+        std::cout << "Rendering frame " << frame + 1U << " of " << animation.frame_count
+                  << std::endl;
+        rend.Refit(camera.TimeShutterOpens(), camera.TimeShutterCloses());
+        rend.Render(scene, camera, image);
+        std::string const frame_path = FramePath(output_path, frame);
+        if (!image.Save(frame_path)) {
+            std::cerr << "Frame could not be saved in '" << frame_path << "'." << std::endl;
+            return false;
+        }
+        std::cout << "Frame saved in '" << frame_path << "'." << std::endl << std::endl;
+    }
+    return true;
+}
+
+// Loads the scene stored in 'scene_path' and renders it to 'output_path'
+template <typename SceneFromFile>
+int RenderSceneFile(std::string const& scene_path,
+                    std::string const& output_path,
+                    RenderMode mode)
+{
+    std::cout << "Loading scene from " << scene_path << std::endl;
+    std::cout << std::endl;
+    SceneFromFile scene(scene_path);
+    scene.LoadWorld();
+    if (!scene.IsLoaded()) {
+        std::cerr << "Scene could not be loaded: " << scene.Error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if constexpr (std::is_same_v<SceneFromFile, plemma::glancy::FileScene>) {
+        if (scene.Animation()) {
+            if (!RenderAnimation(scene, output_path, mode))
+                return EXIT_FAILURE;
+            std::cout << "---- Glancy finished its job ----" << std::endl;
+            return EXIT_SUCCESS;
+        }
+    }
+    if (!Render(scene, scene.MakeCamera(), scene.Settings(), output_path, mode))
+        return EXIT_FAILURE;
+    std::cout << "---- Glancy finished its job ----" << std::endl;
+    std::cout << "Results can be seen in '" << output_path << "'." << std::endl << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// Converts the text scene file 'scene_path' to a binary one
+int PackSceneFile(std::string const& scene_path, std::string const& output_path)
+{
+    plemma::glancy::FileScene scene(scene_path);
+    scene.LoadWorld();
+    std::string error = scene.Error();
+    if (scene.IsLoaded() && plemma::glancy::SaveBinaryScene(output_path,
+                                                            scene.World(),
+                                                            scene.Settings(),
+                                                            scene.CameraSetup(),
+                                                            scene.BackgroundColor(),
+                                                            error)) {
+        std::cout << "Scene packed into '" << output_path << "'." << std::endl;
+        return EXIT_SUCCESS;
+    }
+    std::cerr << "Scene could not be packed: " << error << std::endl;
+    return EXIT_FAILURE;
+}
+
+// Reads the whole of 'text' as a decimal number, as scene files do
+bool ParseCount(char const* text, std::uint64_t& value)
+{
+    return plemma::glancy::scene_file_detail::ParseUnsigned(text, value);
+}
+
+// Renders a shard of a scene for DistributeRender, as described by the
+// arguments following '--worker'
+int RunWorker(char* argv[])
+{
+    plemma::glancy::ShardSplit split;
+    std::uint64_t shard = 0U;
+    std::uint64_t number_shards = 0U;
+    std::uint64_t seed = 0U;
+    std::string error;
+    if (!plemma::glancy::ParseShardSplit(argv[1], split))
+        error = "invalid split";
+    else if (!ParseCount(argv[2], shard) || !ParseCount(argv[3], number_shards))
+        error = "invalid shard";
+    else if (!ParseCount(argv[4], seed))
+        error = "invalid seed";
+    else if (plemma::glancy::RunRenderWorker(argv[0], split, shard, number_shards, seed, error))
+        return EXIT_SUCCESS;
+    std::cerr << "Worker failed: " << error << std::endl;
+    return EXIT_FAILURE;
+}
+
+// Serves render jobs from a spool directory, as described by the arguments
+// following '--serve'
+int Serve(int argc, char* argv[])
+{
+    std::uint64_t number_workers = std::thread::hardware_concurrency();
+    if (argc > 1 && (!ParseCount(argv[1], number_workers) || number_workers == 0U)) {
+        std::cerr << "Invalid number of workers '" << argv[1] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    plemma::glancy::RenderService service(argv[0], number_workers);
+    return service.Run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Renders a scene in worker processes, as described by the arguments
+// following '--distribute'. Workers are started with the command in
+// GLANCY_WORKER_COMMAND, or with this same executable if it is not set.
+int Distribute(int argc, char* argv[], char const* executable)
 {
+    plemma::glancy::ShardSplit split;
+    if (!plemma::glancy::ParseShardSplit(argv[1], split)) {
+        std::cerr << "Unknown split '" << argv[1] << "', use 'tiles' or 'samples'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::uint64_t number_shards = 0U;
+    if (!ParseCount(argv[0], number_shards)) {
+        std::cerr << "Invalid number of workers '" << argv[0] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::uint64_t seed = 0U;
+    if (argc <= 4)
+        seed = plemma::glancy::RandomSeed();
+    else if (!ParseCount(argv[4], seed)) {
+        std::cerr << "Invalid seed '" << argv[4] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    char const* worker_command = std::getenv("GLANCY_WORKER_COMMAND");
+    std::string error;
+    if (!plemma::glancy::DistributeRender(worker_command ? worker_command : executable,
+                                          argv[2],
+                                          number_shards,
+                                          split,
+                                          seed,
+                                          argv[3],
+                                          error)) {
+        std::cerr << "Distributed render failed: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Results can be seen in '" << argv[3] << "'." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
 
-    using plemma::glancy::Camera;
-    using plemma::glancy::DifferentDielectricsScene;
-    using plemma::glancy::Image;
+// Usage: glancy [scene_file [output_file [beauty|nodes|primitives|paths|time]]]
+//        glancy --pack text_scene_file binary_scene_file
+//        glancy --serve spool_directory [number_workers]
+//        glancy --distribute shards tiles|samples scene_file output_file [seed]
+//        glancy --worker scene_file tiles|samples shard shards seed
+// Scene files can be either text (see FileScene) or binary (see
+// BinaryScene) ones. Animations of text scenes are saved one file per
+// frame, numbered before the extension of 'output_file'. Modes other than
+// 'beauty' render heatmaps of the cost of each pixel (see RenderMode).
+// Progress is reported every GLANCY_PROGRESS_INTERVAL_MS milliseconds (a
+// second by default, 0 to be silent). Images are rendered in at most
+// GLANCY_TIME_BUDGET_S seconds, if set (see Renderer::SetTimeBudget).
+// Distributed renders (see DistributeRender) run one worker process per
+// shard and give the same image for the same seed, whatever the number of
+// shards. Builds with GLANCY_ENABLE_PROFILER print where time went when
+// done (and write a Chrome trace to the file in GLANCY_PROFILE_TRACE, if
+// set). Builds with GLANCY_ENABLE_RAY_STATISTICS print the work done per
+// ray over all the images rendered. Without arguments, a scene with random
+// spheres is rendered to 'myimage.ppm', in the root of this repo.
+int main(int argc, char* argv[])
+{
+    using plemma::glancy::BinaryScene;
+    using plemma::glancy::FileScene;
     using plemma::glancy::RandomSpheresScene;
     using plemma::glancy::Real;
-    using plemma::glancy::RealNum;
-    using plemma::glancy::Scene;
-    using plemma::glancy::TwoSpheresScene;
     using plemma::glancy::Vec3;
 
+#if defined(GLANCY_ENABLE_PROFILER)
+    ProfilerOutput const profiler_output;
+#endif
+    if (argc == 4 && std::string(argv[1]) == "--pack")
+        return PackSceneFile(argv[2], argv[3]);
+    // Render service (see RenderService), one worker per core by default
+    if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--serve") {
+        return Serve(argc - 2, argv + 2);
+    }
+    if (argc == 7 && std::string(argv[1]) == "--worker")
+        return RunWorker(argv + 2);
+    if ((argc == 6 || argc == 7) && std::string(argv[1]) == "--distribute")
+        return Distribute(argc - 2, argv + 2, argv[0]);
+
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+    RayStatisticsOutput const ray_statistics_output;
+#endif
     plemma::glancy::my_engine();
 
     std::cout << "------ Welcome to Glancy ------" << std::endl;
+    std::cout << "Computing with " << plemma::glancy::kPrecisionName << " precision" << std::endl;
     std::cout << std::endl << std::endl;
-    std::cout << "Creating scene with two spheres" << std::endl;
+
+    if (argc > 1) {
+        std::string const output_path = argc > 2 ? argv[2] : "myimage.ppm";
+        RenderMode mode = RenderMode::kBeauty;
+        if (argc > 3 && !plemma::glancy::ParseRenderMode(argv[3], mode)) {
+            std::cerr << "Unknown render mode '" << argv[3] << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!plemma::glancy::IsRenderModeAvailable(mode)) {
+            std::cerr << "Render mode '" << argv[3]
+                      << "' needs a build with GLANCY_ENABLE_RAY_STATISTICS" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (plemma::glancy::IsBinarySceneFile(argv[1]))
+            return RenderSceneFile<BinaryScene>(argv[1], output_path, mode);
+        return RenderSceneFile<FileScene>(argv[1], output_path, mode);
+    }
+
+    std::cout << "Creating scene with random spheres" << std::endl;
     std::cout << std::endl;
 
     RandomSpheresScene scene;
     scene.LoadWorld();
 
-    size_t nx = 2000;
-    size_t ny = 1500;
-    Image image(nx, ny);
+    RenderSettings settings;
+    settings.width = 2000;
+    settings.height = 1500;
+    settings.samples_per_pixel = 100;
+    settings.max_depth = 50;
 
     Vec3 look_from(Real(10), Real(1.4), Real(2));
     Vec3 look_at(Real(3.5), Real(0.6), Real(0.5));
@@ -50,7 +370,7 @@ int main()
     RealNum vertical_fov_deg{Real(30)};
     RealNum dist_to_focus = (look_from - look_at).Norm();
     RealNum aperture = Real(0.1);
-    RealNum aspect = Real(nx) / Real(ny);
+    RealNum aspect = Real(settings.width) / Real(settings.height);
     RealNum t0{Real(0)};
     RealNum t1{Real(0.1)};
 
@@ -64,16 +384,8 @@ int main()
                   t0,
                   t1);
 
-    size_t n_rays_per_pixel = 100;
-    uint16_t max_depth = 50;
-    auto gamma_correction = [](RealNum x) { return Real(std::sqrt(x)); };
-    plemma::glancy::Renderer rend(gamma_correction, nx, ny, n_rays_per_pixel, max_depth);
-
-    std::cout << "Please, wait patiently while Glancy is enlightened" << std::endl;
-    std::cout << std::endl;
-
-    rend.ProcessScene(scene, camera, image);
-    image.Save("../myimage.ppm");
+    if (!Render(scene, camera, settings, "../myimage.ppm"))
+        return EXIT_FAILURE;
 
     std::cout << "---- Glancy finished its job ----" << std::endl;
     std::cout << "Results can be seen in 'myimage.ppm', in the root of this repo." << std::endl
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include "point3.hpp"
 #include "ray.hpp"
+#include "ray_statistics.hpp"
 #include "vec3.hpp"
 
 namespace plemma::glancy {
@@ -16,18 +18,20 @@ class AxesAlignedBoundingBox
     AxesAlignedBoundingBox() = default;
     // Constructor with minima(m) and maxima(M) as parameters.
     // Resulting box will be [m[0], M[0]]x[m[1], M[1]]x[m[2], M[2]]
-    AxesAlignedBoundingBox(Vec3 const& m, Vec3 const& M) : minima_(m), maxima_(M) {}
+    AxesAlignedBoundingBox(Vec3 const& m, Vec3 const& M) : bounds_{m, M} {}
 
-    [[nodiscard]] constexpr Vec3 const& Minima() const noexcept { return minima_; }
-    [[nodiscard]] constexpr Vec3 const& Maxima() const noexcept { return maxima_; }
+    [[nodiscard]] constexpr Vec3 const& Minima() const noexcept { return bounds_[0]; }
+    [[nodiscard]] constexpr Vec3 const& Maxima() const noexcept { return bounds_[1]; }
 
     // Returns true if the ray 'r' intersects with the box for some value
     // of the parameter of the ray in [param_min, param_max]
     [[nodiscard]] bool Hit(Ray const& r, RealNum param_min, RealNum param_max) const noexcept;
 
   private:
-    Vec3 minima_;
-    Vec3 maxima_;
+    // Minima and maxima, in this order (which is the layout boxes are
+    // written to disk with), indexed by the sign of the direction of rays
+    // in Hit
+    Vec3 bounds_[2];
 };
 
 inline std::ostream& operator<<(std::ostream& os, AxesAlignedBoundingBox const& b) noexcept
@@ -41,26 +45,31 @@ inline std::ostream& operator<<(std::ostream& os, AxesAlignedBoundingBox const&
 inline bool AxesAlignedBoundingBox::Hit(Ray const& r, RealNum param_min, RealNum param_max) const
     noexcept
 {
+    GLANCY_COUNT_RAY_STATISTIC(box_tests, 1U);
+    Vec3 const& inverse_direction = r.InverseDirection();
+    Point3 const& origin = r.Origin();
+    // Leaving parameters are widened by the bound of the error of the
+    // ones computed below (Pharr, Jakob and Humphreys, "Physically Based
+    // Rendering", section 3.9.2), so that rays grazing a box, or crossing
+    // a flat one, are not missed because of rounding
+    constexpr RealNum kLeaveScale = Real(1) + Real(2) * RoundingErrorBound<RealNum>(3);
     for (int i = 0; i < 3; ++i) {
-        RealNum const inv_direction_comp = Real(1) / r.Direction()[i];
-        // Calculate parameters lambda0, lambda1 such that component i of
-        // r(lambda) belongs to [minima_[i], maxima_[i]] for all
-        // lambda in [lambda_0, lambda_1] contained in [param_min, param_max]
-        RealNum lambda_0 = (minima_[i] - r.Origin()[i]) * inv_direction_comp;
-        RealNum lambda_1 = (maxima_[i] - r.Origin()[i]) * inv_direction_comp;
-        if (inv_direction_comp < Real(0))
-            std::swap(lambda_0, lambda_1);
-
-        // Calculate the intersection of the already calculated intervals
-        // for the parameters with the one we just calculated
-        param_min = lambda_0 > param_min ? lambda_0 : param_min;
-        param_max = lambda_1 < param_max ? lambda_1 : param_max;
-
-        // If the interval is empty, the ray doesn't hit the bounding box
-        if (param_min > param_max)
-            return false;
+        // The ray enters the slab of axis i through the plane of the
+        // minima if it goes in the positive direction, and through the
+        // plane of the maxima otherwise. Intersecting the intervals of the
+        // three slabs without returning early keeps the loop free of
+        // branches. Bounds are subtracted from the origin before scaling
+        // them, which would cancel the digits of the difference when both
+        // are far from the origin of the world, and with the precision of
+        // the origin, which the difference is then rounded from.
+        RealNum const enter =
+            Real(bounds_[r.DirectionIsNegative(i)][i] - origin[i]) * inverse_direction[i];
+        RealNum const leave = Real(bounds_[1 - r.DirectionIsNegative(i)][i] - origin[i]) *
+                              inverse_direction[i] * kLeaveScale;
+        param_min = std::max(param_min, enter);
+        param_max = std::min(param_max, leave);
     }
-    return true;
+    return param_min <= param_max;
 }
 
 // Returns the union of two AABBs (i.e. the smallest AABB containing bbox1 and bbox2)
@@ -82,4 +91,15 @@ inline AxesAlignedBoundingBox UnionOfAABBs(AxesAlignedBoundingBox const& bbox1,
     return AxesAlignedBoundingBox(minima, maxima);
 }
 
+// Returns true if both AABBs have some point in common
+inline bool DoAABBsOverlap(AxesAlignedBoundingBox const& bbox1,
+                           AxesAlignedBoundingBox const& bbox2) noexcept
+{
+    for (int i = 0; i < 3; ++i) {
+        if (bbox1.Maxima()[i] < bbox2.Minima()[i] || bbox2.Maxima()[i] < bbox1.Minima()[i])
+            return false;
+    }
+    return true;
+}
+
 }  // namespace plemma::glancy
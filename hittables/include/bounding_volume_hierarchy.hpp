@@ -5,9 +5,11 @@
 #include <memory>
 #include <utility>
 #include <vector>
+#include "arena.hpp"
 #include "axes_aligned_bounding_box.hpp"
 #include "constants.hpp"
 #include "hittable.hpp"
+#include "ray_statistics.hpp"
 
 namespace plemma::glancy {
 
@@ -31,13 +33,19 @@ std::array<std::function<bool(HittableInABox const& a, HittableInABox const& b)>
 // contains both children volumes/hittables as parent.
 // It requires to have pre-computed AABBs for each
 // hittable to avoid repeating the calculations.
+// Interior nodes are allocated in 'arena' when one is given, which keeps
+// the nodes of the tree contiguous in memory. The arena must then outlive
+// the tree.
 class BoundingVolumeHierarchy : public Hittable
 {
   public:
     BoundingVolumeHierarchy() = default;
     // Constructor that builds the BVH tree from all hittables
-    BoundingVolumeHierarchy(std::vector<HittableInABox>& boxed_hittables, RealNum t0, RealNum t1)
-        : BoundingVolumeHierarchy(boxed_hittables, 0, boxed_hittables.size(), t0, t1)
+    BoundingVolumeHierarchy(std::vector<HittableInABox>& boxed_hittables,
+                            RealNum t0,
+                            RealNum t1,
+                            Arena* arena = nullptr)
+        : BoundingVolumeHierarchy(boxed_hittables, 0, boxed_hittables.size(), t0, t1, arena)
     {}
 
     // Constructor that builds the BVH tree from the hittables from
@@ -47,12 +55,56 @@ class BoundingVolumeHierarchy : public Hittable
                             size_t from,
                             size_t to,
                             RealNum t0,
-                            RealNum t1);
+                            RealNum t1,
+                            Arena* arena = nullptr);
+
+    // Constructor that rebuilds a BVH tree that was previously built
+    // from the same hittables, without sorting them nor computing any
+    // bounding box. 'boxed_hittables' must already be in the order the
+    // original tree left them and 'node_boxes' must point to the boxes
+    // of the nodes in pre-order (see AppendNodeBoxes). It is advanced
+    // past the boxes used by this node and its descendants.
+    BoundingVolumeHierarchy(std::vector<HittableInABox> const& boxed_hittables,
+                            size_t from,
+                            size_t to,
+                            AxesAlignedBoundingBox const*& node_boxes,
+                            Arena* arena = nullptr);
 
     // Check if ray hits the parent, in the case it does, recursively
     // call hit until reaching a leaf (where actual hittables are)
     bool Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const override;
 
+    // Check if ray hits the parent, in the case it does, look for any
+    // hit in the children, stopping at the first one found
+    bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const override;
+
+    // Same as Hit and Occluded, but never testing the hittable 'excluded'
+    // (if not null), e.g. the one a ray leaves from when it can not hit it
+    // again (see Hittable::IsConvex). HitExcluding sets 'rec.object' to the
+    // hittable hit. Children are searched only up to the closest hit found
+    // so far, and nodes are told apart from hittables by the number of
+    // hittables under them, so that only hittables are called virtually.
+    // 'number_elements' must be the number of hittables the tree was built
+    // from.
+    bool HitExcluding(Ray const& r,
+                      RealNum t_min,
+                      RealNum t_max,
+                      size_t number_elements,
+                      Hittable const* excluded,
+                      HitRecord& rec) const;
+    bool OccludedExcluding(Ray const& r,
+                           RealNum t_min,
+                           RealNum t_max,
+                           size_t number_elements,
+                           Hittable const* excluded) const;
+
+    void BindMaterials(MaterialTable& table) override
+    {
+        left_child_->BindMaterials(table);
+        if (right_child_ != left_child_)
+            right_child_->BindMaterials(table);
+    }
+
     // Computes AxesAlignedBoundingBox if possible and returns
     // whether it was possible or not.
     bool ComputeBoundingBox([[maybe_unused]] RealNum time_from,
@@ -63,7 +115,39 @@ class BoundingVolumeHierarchy : public Hittable
         return true;
     }
 
+    // Recomputes the bounding boxes of the tree for the interval [t0, t1],
+    // keeping its shape, e.g. to tighten the boxes of a tree built for a
+    // whole animation around the hittables moving during one of its
+    // frames. 'number_elements' must be the number of hittables the tree
+    // was built from.
+    void Refit(size_t number_elements, RealNum t0, RealNum t1);
+
+    // Appends to 'node_boxes' the bounding boxes of this node and all its
+    // descendant nodes in pre-order. 'number_elements' must be the number
+    // of hittables the tree was built from.
+    void AppendNodeBoxes(size_t number_elements,
+                         std::vector<AxesAlignedBoundingBox>& node_boxes) const;
+
+    // Returns the number of nodes of a tree built from 'number_elements'
+    // hittables. Given that each node splits its hittables in halves, the
+    // shape of the tree only depends on the number of hittables.
+    [[nodiscard]] static constexpr size_t NumberOfNodes(size_t number_elements) noexcept
+    {
+        if (number_elements <= 2)
+            return 1;
+        return 1 + NumberOfNodes(number_elements / 2) +
+               NumberOfNodes(number_elements - number_elements / 2);
+    }
+
   private:
+    template <typename... Args>
+    [[nodiscard]] static std::shared_ptr<Hittable> MakeNode(Arena* arena, Args&&... args)
+    {
+        if (arena)
+            return arena->Make<BoundingVolumeHierarchy>(std::forward<Args>(args)...);
+        return std::make_shared<BoundingVolumeHierarchy>(std::forward<Args>(args)...);
+    }
+
     int ChooseOrderingAxis([[maybe_unused]] std::vector<HittableInABox>& boxed_hittables,
                            [[maybe_unused]] size_t from,
                            [[maybe_unused]] size_t to) const;
@@ -78,6 +162,7 @@ inline bool BoundingVolumeHierarchy::Hit(Ray const& r,
                                          RealNum t_max,
                                          HitRecord& rec) const
 {
+    GLANCY_COUNT_RAY_STATISTIC(node_visits, 1U);
     if (!bbox_.Hit(r, t_min, t_max)) {
         return false;
     }
@@ -105,12 +190,95 @@ inline bool BoundingVolumeHierarchy::Hit(Ray const& r,
         return false;
 }
 
+inline bool BoundingVolumeHierarchy::Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+{
+    GLANCY_COUNT_RAY_STATISTIC(node_visits, 1U);
+    if (!bbox_.Hit(r, t_min, t_max)) {
+        return false;
+    }
+    if (left_child_->Occluded(r, t_min, t_max))
+        return true;
+    // Leaves with a single hittable have it as both children
+    return right_child_ != left_child_ && right_child_->Occluded(r, t_min, t_max);
+}
+
+inline bool BoundingVolumeHierarchy::HitExcluding(Ray const& r,
+                                                  RealNum t_min,
+                                                  RealNum t_max,
+                                                  size_t number_elements,
+                                                  Hittable const* excluded,
+                                                  HitRecord& rec) const
+{
+    GLANCY_COUNT_RAY_STATISTIC(node_visits, 1U);
+    if (!bbox_.Hit(r, t_min, t_max)) {
+        return false;
+    }
+
+    if (number_elements > 2) {
+        bool const hits_left_child =
+            static_cast<BoundingVolumeHierarchy const&>(*left_child_)
+                .HitExcluding(r, t_min, t_max, number_elements / 2, excluded, rec);
+        HitRecord right_rec;
+        if (static_cast<BoundingVolumeHierarchy const&>(*right_child_)
+                .HitExcluding(r,
+                              t_min,
+                              hits_left_child ? rec.t : t_max,
+                              number_elements - number_elements / 2,
+                              excluded,
+                              right_rec)) {
+            rec = right_rec;
+            return true;
+        }
+        return hits_left_child;
+    }
+
+    bool hit = false;
+    if (left_child_.get() != excluded && left_child_->Hit(r, t_min, t_max, rec)) {
+        rec.object = left_child_.get();
+        hit = true;
+    }
+    // Leaves with a single hittable have it as both children
+    if (number_elements == 2 && right_child_.get() != excluded) {
+        HitRecord right_rec;
+        if (right_child_->Hit(r, t_min, hit ? rec.t : t_max, right_rec)) {
+            rec = right_rec;
+            rec.object = right_child_.get();
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+inline bool BoundingVolumeHierarchy::OccludedExcluding(Ray const& r,
+                                                       RealNum t_min,
+                                                       RealNum t_max,
+                                                       size_t number_elements,
+                                                       Hittable const* excluded) const
+{
+    GLANCY_COUNT_RAY_STATISTIC(node_visits, 1U);
+    if (!bbox_.Hit(r, t_min, t_max)) {
+        return false;
+    }
+    if (number_elements > 2) {
+        return static_cast<BoundingVolumeHierarchy const&>(*left_child_)
+                   .OccludedExcluding(r, t_min, t_max, number_elements / 2, excluded) ||
+               static_cast<BoundingVolumeHierarchy const&>(*right_child_)
+                   .OccludedExcluding(
+                       r, t_min, t_max, number_elements - number_elements / 2, excluded);
+    }
+    if (left_child_.get() != excluded && left_child_->Occluded(r, t_min, t_max))
+        return true;
+    return number_elements == 2 && right_child_.get() != excluded &&
+           right_child_->Occluded(r, t_min, t_max);
+}
+
 inline BoundingVolumeHierarchy::BoundingVolumeHierarchy(
     std::vector<HittableInABox>& boxed_hittables,
     size_t from,
     size_t to,
     RealNum t0,
-    RealNum t1)
+    RealNum t1,
+    Arena* arena)
 {
     AxesAlignedBoundingBox bbox_left, bbox_right;
     size_t const number_elements = to - from;
@@ -133,16 +301,69 @@ inline BoundingVolumeHierarchy::BoundingVolumeHierarchy(
                  boxed_hittables.begin() + to,
                  OrderWithRespectToAxis[ordering_axis]);
         }
-        left_child_ = std::make_shared<BoundingVolumeHierarchy>(
-            boxed_hittables, from, from + number_elements / 2, t0, t1);
+        left_child_ =
+            MakeNode(arena, boxed_hittables, from, from + number_elements / 2, t0, t1, arena);
         left_child_->ComputeBoundingBox(t0, t1, bbox_left);
-        right_child_ = std::make_shared<BoundingVolumeHierarchy>(
-            boxed_hittables, from + number_elements / 2, to, t0, t1);
+        right_child_ =
+            MakeNode(arena, boxed_hittables, from + number_elements / 2, to, t0, t1, arena);
         right_child_->ComputeBoundingBox(t0, t1, bbox_right);
     }
     bbox_ = UnionOfAABBs(bbox_left, bbox_right);
 }
 
+inline BoundingVolumeHierarchy::BoundingVolumeHierarchy(
+    std::vector<HittableInABox> const& boxed_hittables,
+    size_t from,
+    size_t to,
+    AxesAlignedBoundingBox const*& node_boxes,
+    Arena* arena)
+    : bbox_(*node_boxes++)
+{
+    size_t const number_elements = to - from;
+    if (number_elements == 1) {
+        left_child_ = boxed_hittables[from].second;
+        right_child_ = boxed_hittables[from].second;
+    }
+    else if (number_elements == 2) {
+        left_child_ = boxed_hittables[from].second;
+        right_child_ = boxed_hittables[from + 1].second;
+    }
+    else {
+        left_child_ =
+            MakeNode(arena, boxed_hittables, from, from + number_elements / 2, node_boxes, arena);
+        right_child_ =
+            MakeNode(arena, boxed_hittables, from + number_elements / 2, to, node_boxes, arena);
+    }
+}
+
+inline void BoundingVolumeHierarchy::Refit(size_t number_elements, RealNum t0, RealNum t1)
+{
+    if (number_elements > 2) {
+        static_cast<BoundingVolumeHierarchy&>(*left_child_).Refit(number_elements / 2, t0, t1);
+        static_cast<BoundingVolumeHierarchy&>(*right_child_)
+            .Refit(number_elements - number_elements / 2, t0, t1);
+    }
+    AxesAlignedBoundingBox bbox_left, bbox_right;
+    left_child_->ComputeBoundingBox(t0, t1, bbox_left);
+    right_child_->ComputeBoundingBox(t0, t1, bbox_right);
+    bbox_ = UnionOfAABBs(bbox_left, bbox_right);
+}
+
+inline void BoundingVolumeHierarchy::AppendNodeBoxes(
+    size_t number_elements,
+    std::vector<AxesAlignedBoundingBox>& node_boxes) const
+{
+    node_boxes.push_back(bbox_);
+    if (number_elements > 2) {
+        // Children are only nodes (and not the actual hittables) when
+        // there were more than two elements in this node
+        static_cast<BoundingVolumeHierarchy const&>(*left_child_)
+            .AppendNodeBoxes(number_elements / 2, node_boxes);
+        static_cast<BoundingVolumeHierarchy const&>(*right_child_)
+            .AppendNodeBoxes(number_elements - number_elements / 2, node_boxes);
+    }
+}
+
 inline int BoundingVolumeHierarchy::ChooseOrderingAxis(
     [[maybe_unused]] std::vector<HittableInABox>& boxed_hittables,
     [[maybe_unused]] size_t from,
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+namespace plemma::glancy {
+
+// On-disk cache of built BoundingVolumeHierarchy trees.
+//
+// A cache file stores what is needed to rebuild a tree without
+// sorting the hittables or computing any bounding box: the order in
+// which the builder left the hittables and the boxes of all nodes in
+// pre-order. Files are keyed by a hash of the bounding boxes of the
+// hittables, the shutter interval and the version of the builder, so
+// a cached tree is only reused for the very same geometry.
+//
+// Layout of a cache file (native endianness):
+//   BVHCacheHeader
+//   std::uint32_t hittable_order[hittable_count]  (padded to 8 bytes)
+//   RealNum node_boxes[node_count][6]             (minima, then maxima)
+
+// Has to be increased every time the way BVHs are built changes
+constexpr std::uint32_t kBVHBuilderVersion = 1U;
+constexpr std::uint32_t kBVHCacheFormatVersion = 1U;
+constexpr char kBVHCacheMagic[8] = {'G', 'L', 'N', 'C', 'Y', 'B', 'V', 'H'};
+
+struct BVHCacheHeader
+{
+    char magic[8];
+    std::uint32_t format_version;
+    std::uint32_t real_num_size;
+    std::uint64_t key;
+    std::uint64_t hittable_count;
+    std::uint64_t node_count;
+};
+
+namespace bvh_cache_detail {
+
+constexpr std::size_t PaddedToEightBytes(std::size_t size) noexcept
+{
+    return (size + 7U) & ~std::size_t(7U);
+}
+
+constexpr std::size_t OrderOffset() noexcept
+{
+    return PaddedToEightBytes(sizeof(BVHCacheHeader));
+}
+
+constexpr std::size_t NodeBoxesOffset(std::size_t hittable_count) noexcept
+{
+    return OrderOffset() + PaddedToEightBytes(hittable_count * sizeof(std::uint32_t));
+}
+
+// Writes 'contents' to 'file_path' through a new file next to it, which
+// then replaces it, so that a reader (another process rendering the same
+// scene) never maps a partially written cache file.
+inline bool WriteAtomically(std::string const& file_path, std::vector<char> const& contents)
+{
+    std::random_device random;
+    std::string temporary_path;
+    std::FILE* file = nullptr;
+    // "x" fails if the file already exists, so that two writers never share it
+    for (int attempt = 0; attempt < 8 && file == nullptr; ++attempt) {
+        temporary_path = file_path + ".tmp" + std::to_string(random());
+        file = std::fopen(temporary_path.c_str(), "wbx");
+    }
+    if (file == nullptr)
+        return false;
+
+    bool const written = std::fwrite(contents.data(), 1U, contents.size(), file) ==
+                         contents.size();
+    bool const closed = std::fclose(file) == 0;
+    std::error_code error;
+    if (written && closed)
+        std::filesystem::rename(temporary_path, file_path, error);
+    if (!written || !closed || error) {
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace bvh_cache_detail
+
+// Computes the key identifying the tree that would be built from
+// 'boxed_hittables' (in the order they are in the world) for the
+// shutter interval [t0, t1].
+inline std::uint64_t ComputeBVHCacheKey(std::vector<HittableInABox> const& boxed_hittables,
+                                        RealNum t0,
+                                        RealNum t1) noexcept
+{
+    Fnv1aHasher hasher;
+    hasher.Add(kBVHBuilderVersion);
+    hasher.Add(static_cast<std::uint64_t>(boxed_hittables.size()));
+    hasher.Add(t0);
+    hasher.Add(t1);
+    for (auto const& boxed_hittable : boxed_hittables) {
+        for (int i = 0; i < 3; ++i)
+            hasher.Add(boxed_hittable.first.Minima()[i]);
+        for (int i = 0; i < 3; ++i)
+            hasher.Add(boxed_hittable.first.Maxima()[i]);
+    }
+    return hasher.Value();
+}
+
+// Returns the name of the cache file corresponding to 'key'
+inline std::string BVHCacheFileName(std::uint64_t key)
+{
+    static constexpr char kHexDigits[] = "0123456789abcdef";
+    std::string name(16U, '0');
+    for (std::size_t i = 0; i < 16U; ++i) {
+        name[15U - i] = kHexDigits[key & 0xFU];
+        key >>= 4U;
+    }
+    return name + ".bvh";
+}
+
+// Writes 'bvh' to 'file_path'. 'world_order' are the hittables in the
+// order they were before building the tree, and 'ordered_hittables'
+// the same hittables in the order the builder left them. The file is
+// replaced at once, never left partially written.
+// Returns whether the file could be written.
+inline bool SaveBVHCache(std::string const& file_path,
+                         std::uint64_t key,
+                         BoundingVolumeHierarchy const& bvh,
+                         std::vector<Hittable const*> const& world_order,
+                         std::vector<HittableInABox> const& ordered_hittables)
+{
+    std::size_t const hittable_count = ordered_hittables.size();
+    if (hittable_count == 0U || hittable_count != world_order.size())
+        return false;
+
+    std::unordered_map<Hittable const*, std::uint32_t> index_in_world;
+    index_in_world.reserve(hittable_count);
+    for (std::size_t i = 0; i < hittable_count; ++i)
+        index_in_world.emplace(world_order[i], static_cast<std::uint32_t>(i));
+
+    std::vector<std::uint32_t> hittable_order(hittable_count);
+    for (std::size_t i = 0; i < hittable_count; ++i) {
+        auto const it = index_in_world.find(ordered_hittables[i].second.get());
+        if (it == index_in_world.end())
+            return false;
+        hittable_order[i] = it->second;
+    }
+
+    std::vector<AxesAlignedBoundingBox> node_boxes;
+    node_boxes.reserve(BoundingVolumeHierarchy::NumberOfNodes(hittable_count));
+    bvh.AppendNodeBoxes(hittable_count, node_boxes);
+
+    BVHCacheHeader header{};
+    std::memcpy(header.magic, kBVHCacheMagic, sizeof(header.magic));
+    header.format_version = kBVHCacheFormatVersion;
+    header.real_num_size = static_cast<std::uint32_t>(sizeof(RealNum));
+    header.key = key;
+    header.hittable_count = hittable_count;
+    header.node_count = node_boxes.size();
+
+    std::vector<char> contents(bvh_cache_detail::NodeBoxesOffset(hittable_count) +
+                               node_boxes.size() * 6U * sizeof(RealNum));
+    std::memcpy(contents.data(), &header, sizeof(header));
+    std::memcpy(contents.data() + bvh_cache_detail::OrderOffset(),
+                hittable_order.data(),
+                hittable_count * sizeof(std::uint32_t));
+    char* box_data = contents.data() + bvh_cache_detail::NodeBoxesOffset(hittable_count);
+    for (auto const& box : node_boxes) {
+        RealNum const limits[6] = {box.Minima()[0],
+                                   box.Minima()[1],
+                                   box.Minima()[2],
+                                   box.Maxima()[0],
+                                   box.Maxima()[1],
+                                   box.Maxima()[2]};
+        std::memcpy(box_data, limits, sizeof(limits));
+        box_data += sizeof(limits);
+    }
+
+    return bvh_cache_detail::WriteAtomically(file_path, contents);
+}
+
+// Rebuilds in 'bvh' the tree stored in 'file_path' if it exists and
+// its key matches 'key'. 'boxed_hittables' must be the hittables in
+// the order they are in the world; their boxes are not used.
+// Returns whether the tree could be loaded. Nodes are allocated in
+// 'arena' if given (see BoundingVolumeHierarchy).
+inline bool LoadBVHCache(std::string const& file_path,
+                         std::uint64_t key,
+                         std::vector<HittableInABox> const& boxed_hittables,
+                         BoundingVolumeHierarchy& bvh,
+                         Arena* arena = nullptr)
+{
+    MappedFile const cache_file(file_path);
+    if (!cache_file.IsOpen() || cache_file.Size() < sizeof(BVHCacheHeader))
+        return false;
+
+    BVHCacheHeader header;
+    std::memcpy(&header, cache_file.Data(), sizeof(header));
+    std::size_t const hittable_count = boxed_hittables.size();
+    if (std::memcmp(header.magic, kBVHCacheMagic, sizeof(header.magic)) != 0 ||
+        header.format_version != kBVHCacheFormatVersion ||
+        header.real_num_size != sizeof(RealNum) || header.key != key ||
+        header.hittable_count != hittable_count ||
+        header.node_count != BoundingVolumeHierarchy::NumberOfNodes(hittable_count) ||
+        cache_file.Size() < bvh_cache_detail::NodeBoxesOffset(hittable_count) +
+                                header.node_count * 6U * sizeof(RealNum)) {
+        return false;
+    }
+
+    auto const* order_data = cache_file.Data() + bvh_cache_detail::OrderOffset();
+    std::vector<HittableInABox> ordered_hittables;
+    ordered_hittables.reserve(hittable_count);
+    for (std::size_t i = 0; i < hittable_count; ++i) {
+        std::uint32_t index;
+        std::memcpy(&index, order_data + i * sizeof(std::uint32_t), sizeof(index));
+        if (index >= hittable_count)
+            return false;
+        ordered_hittables.push_back(boxed_hittables[index]);
+    }
+
+    // Mapped memory is page aligned and offsets are multiple of 8 bytes,
+    // so the limits of the boxes can be read in place
+    auto const* limits = reinterpret_cast<RealNum const*>(
+        cache_file.Data() + bvh_cache_detail::NodeBoxesOffset(hittable_count));
+    std::vector<AxesAlignedBoundingBox> node_boxes;
+    node_boxes.reserve(header.node_count);
+    for (std::size_t i = 0; i < header.node_count; ++i, limits += 6) {
+        node_boxes.emplace_back(Vec3(limits[0], limits[1], limits[2]),
+                                Vec3(limits[3], limits[4], limits[5]));
+    }
+
+    AxesAlignedBoundingBox const* next_node_box = node_boxes.data();
+    bvh = BoundingVolumeHierarchy(ordered_hittables, 0, hittable_count, next_node_box, arena);
+    return true;
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "ray.hpp"
+#include "ray_statistics.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Node of a bounding volume hierarchy stored in a flat array in depth
+// first order: the first child of an interior node is the node right
+// after it. Primitives are referred to by their position, so a whole tree
+// is a single trivially copyable array that can be written to disk and
+// used in place (e.g. memory mapped) without any fix-up.
+struct FlatBVHNode
+{
+    AxesAlignedBoundingBox box;
+    // Leaves: position of their first primitive.
+    // Interior nodes: position of their second child.
+    std::uint32_t offset;
+    // Number of primitives of leaves, 0 for interior nodes
+    std::uint32_t count;
+};
+
+namespace flat_bvh_detail {
+
+inline std::uint32_t Build(std::vector<AxesAlignedBoundingBox> const& boxes,
+                           std::vector<Vec3> const& centroids,
+                           std::size_t max_leaf_size,
+                           std::uint32_t* first,
+                           std::uint32_t* last,
+                           std::uint32_t const* order_begin,
+                           std::vector<FlatBVHNode>& nodes)
+{
+    auto const node_index = static_cast<std::uint32_t>(nodes.size());
+    nodes.emplace_back();
+    AxesAlignedBoundingBox box = boxes[*first];
+    Vec3 centroid_min = centroids[*first];
+    Vec3 centroid_max = centroids[*first];
+    for (auto const* it = first + 1; it != last; ++it) {
+        box = UnionOfAABBs(box, boxes[*it]);
+        for (int i = 0; i < 3; ++i) {
+            centroid_min[i] = std::min(centroid_min[i], centroids[*it][i]);
+            centroid_max[i] = std::max(centroid_max[i], centroids[*it][i]);
+        }
+    }
+    nodes[node_index].box = box;
+
+    auto const count = static_cast<std::size_t>(last - first);
+    Vec3 const extent = centroid_max - centroid_min;
+    int const axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2)
+                                           : (extent[1] > extent[2] ? 1 : 2);
+    if (count <= max_leaf_size || !(extent[axis] > Real(0))) {
+        nodes[node_index].offset = static_cast<std::uint32_t>(first - order_begin);
+        nodes[node_index].count = static_cast<std::uint32_t>(count);
+        return node_index;
+    }
+
+    // Split in halves along the axis in which centroids are most spread
+    std::uint32_t* const middle = first + count / 2;
+    std::nth_element(first, middle, last, [&](std::uint32_t a, std::uint32_t b) {
+        return centroids[a][axis] < centroids[b][axis];
+    });
+    Build(boxes, centroids, max_leaf_size, first, middle, order_begin, nodes);
+    std::uint32_t const second_child =
+        Build(boxes, centroids, max_leaf_size, middle, last, order_begin, nodes);
+    nodes[node_index].offset = second_child;
+    nodes[node_index].count = 0U;
+    return node_index;
+}
+
+}  // namespace flat_bvh_detail
+
+// Builds a BVH over the primitives with bounding boxes 'boxes', with at
+// most 'max_leaf_size' primitives per leaf. Leaves refer to ranges of
+// 'order', which is filled with the positions of the primitives in
+// 'boxes', so primitives should be stored in that order afterwards.
+inline void BuildFlatBVH(std::vector<AxesAlignedBoundingBox> const& boxes,
+                         std::size_t max_leaf_size,
+                         std::vector<FlatBVHNode>& nodes,
+                         std::vector<std::uint32_t>& order)
+{
+    nodes.clear();
+    order.resize(boxes.size());
+    std::iota(order.begin(), order.end(), 0U);
+    if (boxes.empty())
+        return;
+
+    std::vector<Vec3> centroids;
+    centroids.reserve(boxes.size());
+    for (auto const& box : boxes)
+        centroids.push_back(Real(0.5) * (box.Minima() + box.Maxima()));
+    nodes.reserve(2U * boxes.size() / std::max<std::size_t>(max_leaf_size, 1U) + 1U);
+    flat_bvh_detail::Build(boxes,
+                           centroids,
+                           std::max<std::size_t>(max_leaf_size, 1U),
+                           order.data(),
+                           order.data() + order.size(),
+                           order.data(),
+                           nodes);
+}
+
+// Traverses the BVH stored in 'nodes' (which must not be empty) calling
+// 'intersect_leaf(first, count, t_max)' for every leaf whose box is hit
+// by 'r' in (t_min, t_max). It must return whether any of the 'count'
+// primitives starting at 'first' is hit and, if so, shrink 't_max' to the
+// parameter of the closest hit. If 'any_hit' is true, traversal stops at
+// the first hit found. Returns whether anything was hit.
+template <typename LeafIntersector>
+bool TraverseFlatBVH(FlatBVHNode const* nodes,
+                     Ray const& r,
+                     RealNum t_min,
+                     RealNum t_max,
+                     bool any_hit,
+                     LeafIntersector&& intersect_leaf)
+{
+    // Depth is logarithmic in the number of primitives for median splits
+    constexpr std::size_t kMaxDepth = 64U;
+    std::uint32_t stack[kMaxDepth];
+    std::size_t stack_size = 0U;
+    std::uint32_t current = 0U;
+    bool hit_anything = false;
+    while (true) {
+        FlatBVHNode const& node = nodes[current];
+        GLANCY_COUNT_RAY_STATISTIC(node_visits, 1U);
+        if (node.box.Hit(r, t_min, t_max)) {
+            if (node.count > 0U) {
+                if (intersect_leaf(node.offset, node.count, t_max)) {
+                    hit_anything = true;
+                    if (any_hit)
+                        return true;
+                }
+            }
+            else {
+                stack[stack_size++] = node.offset;
+                current = current + 1U;
+                continue;
+            }
+        }
+        if (stack_size == 0U)
+            return hit_anything;
+        current = stack[--stack_size];
+    }
+}
+
+}  // namespace plemma::glancy
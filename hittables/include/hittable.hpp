@@ -1,28 +1,91 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
+#include <limits>
 #include "axes_aligned_bounding_box.hpp"
+#include "point3.hpp"
 #include "ray.hpp"
 
 namespace plemma::glancy {
 
-class Material;
+class Hittable;
+class MaterialTable;
+
+// Position of a material in the MaterialTable the hittable was bound to
+using MaterialId = std::uint32_t;
+constexpr MaterialId kUnboundMaterialId = std::numeric_limits<MaterialId>::max();
 
 struct HitRecord
 {
     RealNum t;
-    Vec3 p;
+    // Stored with PreciseRealNum, as it was computed (see Point3)
+    Point3 p;
+    // Bound of the absolute error of each component of 'p', to start rays
+    // leaving 'p' off the surface (see OffsetRayOrigin)
+    RealNum p_error = Real(0);
+    // Unit normal of the surface at 'p', on the side the ray came from
     Vec3 normal;
-    std::shared_ptr<Material> mat;
+    // Whether the ray hit the side the surface faces, i.e. the outside of
+    // closed surfaces (see SetFaceNormal)
+    bool front_face = true;
+    // Material of the hit in the MaterialTable the hittable was bound to
+    // (see Hittable::BindMaterials)
+    MaterialId material_id = kUnboundMaterialId;
+    // Hittable of the world that was hit, if the traversal that found the
+    // hit sets it (see BoundingVolumeHierarchy::HitExcluding)
+    Hittable const* object = nullptr;
 };
 
+// Sets the normal of 'rec' from 'outward_normal', the unit normal of the
+// surface on the side it faces, turning it towards the origin of 'r' if
+// the ray hit the other side
+inline void SetFaceNormal(Ray const& r, Vec3 const& outward_normal, HitRecord& rec) noexcept
+{
+    rec.front_face = Dot(r.Direction(), outward_normal) < Real(0);
+    rec.normal = rec.front_face ? outward_normal : -outward_normal;
+}
+
 class Hittable
 {
   public:
     virtual bool Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const = 0;
+    // Any-hit query: returns whether the ray hits the hittable for some value
+    // of its parameter in (t_min, t_max). Unlike Hit, it can return as soon as
+    // any intersection is found and it does not compute a HitRecord, which
+    // makes it the cheap choice for shadow rays. Default implementation falls
+    // back to Hit, so hittables should override it when they can do better.
+    virtual bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+    {
+        HitRecord rec;
+        return Hit(r, t_min, t_max, rec);
+    }
     virtual bool ComputeBoundingBox(RealNum time_from,
                                     RealNum time_to,
                                     AxesAlignedBoundingBox& bbox) const = 0;
+    // Probability density (w.r.t. solid angle) with which RandomDirection
+    // would choose 'direction' from 'origin' at instant 'time'. Hittables
+    // that can not be sampled (default) return 0.
+    [[nodiscard]] virtual RealNum PdfValue([[maybe_unused]] Point3 const& origin,
+                                           [[maybe_unused]] Vec3 const& direction,
+                                           [[maybe_unused]] RealNum time) const
+    {
+        return Real(0);
+    }
+    // Returns a random direction from 'origin' towards the hittable at
+    // instant 'time'. Used to explicitly sample lights.
+    [[nodiscard]] virtual Vec3 RandomDirection([[maybe_unused]] Point3 const& origin,
+                                               [[maybe_unused]] RealNum time) const
+    {
+        return Vec3(Real(1), Real(0), Real(0));
+    }
+    // Adds the materials of the hittable to 'table', so that hit records
+    // computed afterwards carry their id in it. Hittables that are not
+    // bound (default) leave it as kUnboundMaterialId.
+    virtual void BindMaterials([[maybe_unused]] MaterialTable& table) {}
+    // Whether the hittable is a single convex surface facing outwards, so
+    // that rays leaving any of its points to the outside never hit it
+    // again. False by default.
+    [[nodiscard]] virtual bool IsConvex() const { return false; }
     virtual ~Hittable() = default;
 };
 
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <memory>
+#include <random>
 #include <utility>
 #include <vector>
 #include "hittable.hpp"
+#include "rand_engine.hpp"
 #include "ray.hpp"
+#include "spatial_hash_grid.hpp"
 
 namespace plemma::glancy {
 
@@ -14,10 +17,35 @@ class HittableList : public Hittable
     HittableList() = default;
     HittableList(std::vector<std::shared_ptr<Hittable> >&& data) : hittables_(data) {}
     bool Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const override;
+    bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const override;
     bool ComputeBoundingBox(RealNum time_from,
                             RealNum time_to,
                             AxesAlignedBoundingBox& bbox) const override;
+    // Mixture of the densities of all hittables, each one being chosen
+    // with the same probability by RandomDirection
+    [[nodiscard]] RealNum PdfValue(Point3 const& origin,
+                                   Vec3 const& direction,
+                                   RealNum time) const override;
+    [[nodiscard]] Vec3 RandomDirection(Point3 const& origin, RealNum time) const override;
+    void BindMaterials(MaterialTable& table) override
+    {
+        for (auto& item : hittables_) {
+            if (item)
+                item->BindMaterials(table);
+        }
+    }
+    [[nodiscard]] bool Empty() const noexcept { return hittables_.empty(); }
     void Add(std::shared_ptr<Hittable>&& hittable) { hittables_.push_back(hittable); }
+    void Clear() noexcept { hittables_.clear(); }
+    // Adds 'hittable' only if its bounding box in [time_from, time_to]
+    // does not overlap any of the boxes in 'grid', in which case its box
+    // is added to 'grid'. Hittables without bounding box are always added.
+    // Returns whether it was added. Boxes make the check conservative:
+    // hittables whose boxes overlap are rejected even if they do not.
+    bool AddIfNotOverlapping(std::shared_ptr<Hittable>&& hittable,
+                             SpatialHashGrid& grid,
+                             RealNum time_from = Real(0),
+                             RealNum time_to = Real(0));
     [[nodiscard]] auto begin() noexcept { return hittables_.begin(); }
     [[nodiscard]] auto end() noexcept { return hittables_.end(); }
     [[nodiscard]] auto begin() const noexcept { return hittables_.begin(); }
@@ -27,6 +55,21 @@ class HittableList : public Hittable
     std::vector<std::shared_ptr<Hittable> > hittables_;
 };
 
+inline bool HittableList::AddIfNotOverlapping(std::shared_ptr<Hittable>&& hittable,
+                                              SpatialHashGrid& grid,
+                                              RealNum time_from,
+                                              RealNum time_to)
+{
+    AxesAlignedBoundingBox box;
+    if (hittable && hittable->ComputeBoundingBox(time_from, time_to, box)) {
+        if (grid.AnyOverlapping(box))
+            return false;
+        grid.Insert(box);
+    }
+    Add(std::move(hittable));
+    return true;
+}
+
 inline bool HittableList::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const
 {
     HitRecord temp_rec;
@@ -44,6 +87,38 @@ inline bool HittableList::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRec
     return hit_anything;
 }
 
+inline bool HittableList::Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+{
+    for (auto const& item : hittables_) {
+        if (item && item->Occluded(r, t_min, t_max))
+            return true;
+    }
+    return false;
+}
+
+inline RealNum HittableList::PdfValue(Point3 const& origin,
+                                      Vec3 const& direction,
+                                      RealNum time) const
+{
+    if (hittables_.empty())
+        return Real(0);
+    RealNum sum = Real(0);
+    for (auto const& item : hittables_) {
+        if (item)
+            sum += item->PdfValue(origin, direction, time);
+    }
+    return sum / Real(hittables_.size());
+}
+
+inline Vec3 HittableList::RandomDirection(Point3 const& origin, RealNum time) const
+{
+    if (hittables_.empty())
+        return Hittable::RandomDirection(origin, time);
+    std::uniform_int_distribution<size_t> choose_hittable(0, hittables_.size() - 1);
+    auto const& chosen = hittables_[choose_hittable(my_engine())];
+    return chosen ? chosen->RandomDirection(origin, time) : Hittable::RandomDirection(origin, time);
+}
+
 inline bool HittableList::ComputeBoundingBox(RealNum time_from,
                                              RealNum time_to,
                                              AxesAlignedBoundingBox& bbox) const
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include "affine_transform.hpp"
+#include "axes_aligned_bounding_box.hpp"
+#include "hittable.hpp"
+#include "material_table.hpp"
+#include "ray.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Copy of a hittable placed in the world through an affine
+// transformation. The hittable (e.g. a TriangleMesh or a
+// BoundingVolumeHierarchy over some hittables) is shared by all its
+// instances, so a scene costs memory proportional to its unique geometry
+// however many times it is repeated. The world BVH built by the renderer
+// is then a top level over instances, each one pointing to the bottom
+// level of its hittable, and rays are only moved to object space when
+// they reach an instance.
+class Instance : public Hittable
+{
+  public:
+    // 'object_to_world' must be invertible. If 'material' is given, it
+    // replaces the materials of the hittable for this instance.
+    Instance(std::shared_ptr<Hittable> object,
+             AffineTransform const& object_to_world,
+             std::shared_ptr<Material> material = nullptr)
+        : object_(std::move(object)),
+          object_to_world_(object_to_world),
+          world_to_object_(object_to_world.Inverse()),
+          material_(std::move(material))
+    {}
+
+    bool Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const override;
+    bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const override
+    {
+        return object_ && object_->Occluded(ToObjectSpace(r), t_min, t_max);
+    }
+    bool ComputeBoundingBox(RealNum time_from,
+                            RealNum time_to,
+                            AxesAlignedBoundingBox& bbox) const override;
+    void BindMaterials(MaterialTable& table) override
+    {
+        // Binding is idempotent, so shared hittables can be bound once
+        // per instance
+        if (object_)
+            object_->BindMaterials(table);
+        material_id_ = material_ ? table.Add(*material_) : kUnboundMaterialId;
+    }
+    // Affine transformations keep convex hittables convex, and normals
+    // are transformed so that they keep their side
+    [[nodiscard]] bool IsConvex() const override { return object_ && object_->IsConvex(); }
+
+    [[nodiscard]] AffineTransform const& ObjectToWorld() const noexcept { return object_to_world_; }
+
+  private:
+    // Directions are not normalized, so that the parameter of the hits is
+    // the same in both spaces
+    [[nodiscard]] Ray ToObjectSpace(Ray const& r) const noexcept
+    {
+        return Ray(world_to_object_.TransformPoint(r.Origin()),
+                   world_to_object_.TransformVector(r.Direction()),
+                   r.Time());
+    }
+
+    std::shared_ptr<Hittable> object_;
+    AffineTransform object_to_world_;
+    AffineTransform world_to_object_;
+    std::shared_ptr<Material> material_;
+    MaterialId material_id_ = kUnboundMaterialId;
+};
+
+inline bool Instance::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const
+{
+    if (!object_ || !object_->Hit(ToObjectSpace(r), t_min, t_max, rec))
+        return false;
+    // The point is transformed rather than found again along 'r', so that
+    // its error stays bounded
+    rec.p_error = object_to_world_.TransformPointError(rec.p, rec.p_error);
+    rec.p = object_to_world_.TransformPoint(rec.p);
+    rec.normal = UnitVector(world_to_object_.TransposeTransformVector(rec.normal));
+    if (material_)
+        rec.material_id = material_id_;
+    return true;
+}
+
+inline bool Instance::ComputeBoundingBox(RealNum time_from,
+                                         RealNum time_to,
+                                         AxesAlignedBoundingBox& bbox) const
+{
+    AxesAlignedBoundingBox object_box;
+    if (!object_ || !object_->ComputeBoundingBox(time_from, time_to, object_box))
+        return false;
+    // Box of the transformed corners of the box in object space
+    Vec3 minima = object_to_world_.TransformPoint(object_box.Minima());
+    Vec3 maxima = minima;
+    for (int corner = 1; corner < 8; ++corner) {
+        Vec3 const object_corner((corner & 1) ? object_box.Maxima().X() : object_box.Minima().X(),
+                                 (corner & 2) ? object_box.Maxima().Y() : object_box.Minima().Y(),
+                                 (corner & 4) ? object_box.Maxima().Z() : object_box.Minima().Z());
+        Vec3 const world_corner = object_to_world_.TransformPoint(object_corner);
+        for (int axis = 0; axis < 3; ++axis) {
+            minima[axis] = std::min(minima[axis], world_corner[axis]);
+            maxima[axis] = std::max(maxima[axis], world_corner[axis]);
+        }
+    }
+    bbox = AxesAlignedBoundingBox(minima, maxima);
+    return true;
+}
+
+}  // namespace plemma::glancy
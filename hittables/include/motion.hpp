@@ -0,0 +1,36 @@
+#pragma once
+
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Functors describing how the parameters of a hittable change in time,
+// for hittables that are not known at compile time (e.g. when read from
+// a scene file) and therefore can not be described with lambdas.
+
+// Position moving with constant velocity. It is at 'from' at instant
+// 'time_from'.
+struct LinearMotion
+{
+    [[nodiscard]] constexpr Vec3 operator()(RealNum t) const noexcept
+    {
+        return from + (t - time_from) * velocity;
+    }
+
+    Vec3 from;
+    Vec3 velocity;
+    RealNum time_from;
+};
+
+// Magnitude that does not change in time
+struct ConstantMagnitude
+{
+    [[nodiscard]] constexpr RealNum operator()([[maybe_unused]] RealNum t) const noexcept
+    {
+        return value;
+    }
+
+    RealNum value;
+};
+
+}  // namespace plemma::glancy
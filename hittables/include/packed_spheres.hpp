@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "flat_bvh.hpp"
+#include "hittable.hpp"
+#include "material_table.hpp"
+#include "quantized_bvh.hpp"
+#include "ray.hpp"
+#include "sphere.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Spheres stored as a structure of arrays, in the order of the leaves of
+// the flat BVH built over them. Material indices refer to the materials
+// given to PackedSpheres. Centers are the ones at time 0 and, if there are
+// velocities, spheres move along straight lines; otherwise they are static.
+// The tree is either made of full nodes or of quantized ones (see
+// BVHNodeFormat), in which case the box of its root is in 'bounds' and
+// 'nodes' is null.
+struct PackedSpheresView
+{
+    RealNum const* center_x = nullptr;
+    RealNum const* center_y = nullptr;
+    RealNum const* center_z = nullptr;
+    RealNum const* radius = nullptr;
+    std::uint32_t const* material = nullptr;
+    std::size_t sphere_count = 0U;
+    FlatBVHNode const* nodes = nullptr;
+    std::size_t node_count = 0U;
+    RealNum const* velocity_x = nullptr;
+    RealNum const* velocity_y = nullptr;
+    RealNum const* velocity_z = nullptr;
+    QuantizedBVHNode16 const* nodes_16bit = nullptr;
+    QuantizedBVHNode8 const* nodes_8bit = nullptr;
+    AxesAlignedBoundingBox bounds;
+};
+
+// Owning counterpart of PackedSpheresView. Velocities are either empty
+// (all spheres are static) or as long as the rest of the arrays. Only one
+// of the arrays of nodes is filled, depending on the format of the tree.
+struct PackedSpheresArrays
+{
+    std::vector<RealNum> center_x;
+    std::vector<RealNum> center_y;
+    std::vector<RealNum> center_z;
+    std::vector<RealNum> radius;
+    std::vector<std::uint32_t> material;
+    std::vector<FlatBVHNode> nodes;
+    std::vector<RealNum> velocity_x;
+    std::vector<RealNum> velocity_y;
+    std::vector<RealNum> velocity_z;
+    std::vector<QuantizedBVHNode16> nodes_16bit;
+    std::vector<QuantizedBVHNode8> nodes_8bit;
+    AxesAlignedBoundingBox bounds;
+
+    [[nodiscard]] bool IsMoving() const noexcept { return !velocity_x.empty(); }
+
+    [[nodiscard]] PackedSpheresView View() const noexcept
+    {
+        return PackedSpheresView{center_x.data(),
+                                 center_y.data(),
+                                 center_z.data(),
+                                 radius.data(),
+                                 material.data(),
+                                 radius.size(),
+                                 nodes.empty() ? nullptr : nodes.data(),
+                                 nodes.size() + nodes_16bit.size() + nodes_8bit.size(),
+                                 IsMoving() ? velocity_x.data() : nullptr,
+                                 IsMoving() ? velocity_y.data() : nullptr,
+                                 IsMoving() ? velocity_z.data() : nullptr,
+                                 nodes_16bit.empty() ? nullptr : nodes_16bit.data(),
+                                 nodes_8bit.empty() ? nullptr : nodes_8bit.data(),
+                                 bounds};
+    }
+};
+
+// Maximum number of spheres in the leaves of the BVH of packed spheres
+constexpr std::size_t kPackedSpheresPerLeaf = 4U;
+
+namespace packed_spheres_detail {
+
+// Moves values[order[i]] to values[i], using a single temporary array
+template <typename T>
+void Reorder(std::vector<T>& values, std::vector<std::uint32_t> const& order)
+{
+    if (values.empty())
+        return;
+    std::vector<T> reordered;
+    reordered.reserve(order.size());
+    for (std::uint32_t const index : order)
+        reordered.push_back(values[index]);
+    values.swap(reordered);
+}
+
+}  // namespace packed_spheres_detail
+
+// Sorts the spheres in 'spheres' (whose nodes are ignored) in the order of
+// the leaves of a BVH built over them, which is stored in its nodes.
+// Moving spheres are bounded along their paths in [time_from, time_to].
+// Arrays are reordered one at a time, so that packing takes little more
+// memory than the BVH being built. Nodes are stored in 'format' unless
+// some leaf holds more spheres than quantized nodes can refer to, which
+// can only happen if many spheres share their center, and then the full
+// format is kept.
+inline void PackSpheres(PackedSpheresArrays& spheres,
+                        RealNum time_from = Real(0),
+                        RealNum time_to = Real(0),
+                        BVHNodeFormat format = BVHNodeFormat::kFull)
+{
+    std::size_t const sphere_count = spheres.radius.size();
+    std::vector<AxesAlignedBoundingBox> boxes;
+    boxes.reserve(sphere_count);
+    for (std::size_t i = 0; i < sphere_count; ++i) {
+        Vec3 const center(spheres.center_x[i], spheres.center_y[i], spheres.center_z[i]);
+        AxesAlignedBoundingBox box = ComputeAABBForFixedSphere(center, spheres.radius[i]);
+        if (spheres.IsMoving()) {
+            Vec3 const velocity(
+                spheres.velocity_x[i], spheres.velocity_y[i], spheres.velocity_z[i]);
+            box = UnionOfAABBs(
+                ComputeAABBForFixedSphere(center + time_from * velocity, spheres.radius[i]),
+                ComputeAABBForFixedSphere(center + time_to * velocity, spheres.radius[i]));
+        }
+        boxes.push_back(box);
+    }
+
+    std::vector<std::uint32_t> order;
+    BuildFlatBVH(boxes, kPackedSpheresPerLeaf, spheres.nodes, order);
+    boxes = std::vector<AxesAlignedBoundingBox>();
+    packed_spheres_detail::Reorder(spheres.center_x, order);
+    packed_spheres_detail::Reorder(spheres.center_y, order);
+    packed_spheres_detail::Reorder(spheres.center_z, order);
+    packed_spheres_detail::Reorder(spheres.radius, order);
+    packed_spheres_detail::Reorder(spheres.material, order);
+    packed_spheres_detail::Reorder(spheres.velocity_x, order);
+    packed_spheres_detail::Reorder(spheres.velocity_y, order);
+    packed_spheres_detail::Reorder(spheres.velocity_z, order);
+    order = std::vector<std::uint32_t>();
+
+    spheres.nodes_16bit.clear();
+    spheres.nodes_8bit.clear();
+    if (spheres.nodes.empty())
+        return;
+    spheres.bounds = spheres.nodes[0].box;
+    bool quantized = false;
+    if (format == BVHNodeFormat::kQuantized16)
+        quantized = QuantizeFlatBVH(spheres.nodes, spheres.nodes_16bit, spheres.bounds);
+    else if (format == BVHNodeFormat::kQuantized8)
+        quantized = QuantizeFlatBVH(spheres.nodes, spheres.nodes_8bit, spheres.bounds);
+    if (quantized)
+        spheres.nodes = std::vector<FlatBVHNode>();
+}
+
+// Sorts the static spheres with centers 'centers', radii 'radii' and
+// materials 'materials' in the order of the leaves of a BVH built over
+// them, with nodes in 'format'
+inline PackedSpheresArrays PackSpheres(std::vector<Vec3> const& centers,
+                                       std::vector<RealNum> const& radii,
+                                       std::vector<std::uint32_t> const& materials,
+                                       BVHNodeFormat format = BVHNodeFormat::kFull)
+{
+    PackedSpheresArrays packed;
+    packed.center_x.reserve(centers.size());
+    packed.center_y.reserve(centers.size());
+    packed.center_z.reserve(centers.size());
+    for (Vec3 const& center : centers) {
+        packed.center_x.push_back(center.X());
+        packed.center_y.push_back(center.Y());
+        packed.center_z.push_back(center.Z());
+    }
+    packed.radius = radii;
+    packed.material = materials;
+    PackSpheres(packed, Real(0), Real(0), format);
+    return packed;
+}
+
+// Hittable made of many spheres that are used in place from
+// wherever they are stored (e.g. a memory mapped scene file), without
+// creating any object per sphere. Spheres are found through their flat
+// BVH, so the whole set is a single entry in the world of the scene.
+class PackedSpheres : public Hittable
+{
+  public:
+    // 'storage' keeps alive the memory 'view' points to
+    PackedSpheres(PackedSpheresView const& view,
+                  std::vector<std::shared_ptr<Material> > materials,
+                  std::shared_ptr<void const> storage)
+        : view_(view),
+          materials_(std::move(materials)),
+          material_ids_(materials_.size(), kUnboundMaterialId),
+          storage_(std::move(storage))
+    {}
+
+    bool Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const override;
+    bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const override;
+    bool ComputeBoundingBox([[maybe_unused]] RealNum time_from,
+                            [[maybe_unused]] RealNum time_to,
+                            AxesAlignedBoundingBox& bbox) const override
+    {
+        if (view_.node_count == 0U)
+            return false;
+        bbox = view_.nodes != nullptr ? view_.nodes[0].box : view_.bounds;
+        return true;
+    }
+    void BindMaterials(MaterialTable& table) override
+    {
+        for (std::size_t i = 0; i < materials_.size(); ++i)
+            material_ids_[i] = materials_[i] ? table.Add(*materials_[i]) : kUnboundMaterialId;
+    }
+
+    [[nodiscard]] std::size_t Size() const noexcept { return view_.sphere_count; }
+    [[nodiscard]] PackedSpheresView const& View() const noexcept { return view_; }
+    // Materials the indices of the view refer to
+    [[nodiscard]] std::vector<std::shared_ptr<Material> > const& Materials() const noexcept
+    {
+        return materials_;
+    }
+
+  private:
+    // Traverses the tree as TraverseFlatBVH does, whatever its format
+    template <typename LeafIntersector>
+    bool Traverse(Ray const& r,
+                  RealNum t_min,
+                  RealNum t_max,
+                  bool any_hit,
+                  LeafIntersector&& intersect_leaf) const
+    {
+        if (view_.nodes_16bit != nullptr) {
+            return TraverseQuantizedBVH(
+                view_.nodes_16bit, view_.bounds, r, t_min, t_max, any_hit, intersect_leaf);
+        }
+        if (view_.nodes_8bit != nullptr) {
+            return TraverseQuantizedBVH(
+                view_.nodes_8bit, view_.bounds, r, t_min, t_max, any_hit, intersect_leaf);
+        }
+        return TraverseFlatBVH(view_.nodes, r, t_min, t_max, any_hit, intersect_leaf);
+    }
+
+    [[nodiscard]] Vec3 Center(std::size_t i, RealNum time) const noexcept
+    {
+        Vec3 center(view_.center_x[i], view_.center_y[i], view_.center_z[i]);
+        if (view_.velocity_x != nullptr)
+            center += time * Vec3(view_.velocity_x[i], view_.velocity_y[i], view_.velocity_z[i]);
+        return center;
+    }
+
+    PackedSpheresView view_;
+    std::vector<std::shared_ptr<Material> > materials_;
+    std::vector<MaterialId> material_ids_;
+    std::shared_ptr<void const> storage_;
+};
+
+inline bool PackedSpheres::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const
+{
+    if (view_.node_count == 0U)
+        return false;
+    std::size_t closest = 0U;
+    RealNum closest_t = t_max;
+    bool const hit = Traverse(
+        r,
+        t_min,
+        t_max,
+        false,
+        [&](std::uint32_t first, std::uint32_t count, RealNum& closest_so_far) {
+            bool hit_leaf = false;
+            for (std::uint32_t i = first; i < first + count; ++i) {
+                RealNum t;
+                if (FindSphereHit(r.Origin(),
+                                  r.Direction(),
+                                  Center(i, r.Time()),
+                                  view_.radius[i],
+                                  t_min,
+                                  closest_so_far,
+                                  t)) {
+                    closest_so_far = t;
+                    closest_t = t;
+                    closest = i;
+                    hit_leaf = true;
+                }
+            }
+            return hit_leaf;
+        });
+    if (!hit)
+        return false;
+
+    // Only the closest hit is completed into a record
+    rec.t = closest_t;
+    sphere_detail::CompleteSphereHit(r, Center(closest, r.Time()), view_.radius[closest], rec);
+    std::uint32_t const material = view_.material[closest];
+    rec.material_id = material < materials_.size() ? material_ids_[material] : kUnboundMaterialId;
+    return true;
+}
+
+inline bool PackedSpheres::Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+{
+    if (view_.node_count == 0U)
+        return false;
+    return Traverse(r,
+                    t_min,
+                    t_max,
+                    true,
+                    [&](std::uint32_t first, std::uint32_t count, RealNum& t_leaf_max) {
+                        for (std::uint32_t i = first; i < first + count; ++i) {
+                            if (IsSphereHitInInterval(r.Origin(),
+                                                      r.Direction(),
+                                                      Center(i, r.Time()),
+                                                      view_.radius[i],
+                                                      t_min,
+                                                      t_leaf_max))
+                                return true;
+                        }
+                        return false;
+                    });
+}
+
+}  // namespace plemma::glancy
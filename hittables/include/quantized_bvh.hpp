@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "flat_bvh.hpp"
+#include "ray.hpp"
+#include "ray_statistics.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Formats in which the nodes of a flat BVH can be stored. Quantized
+// nodes take a fraction of the memory of full ones (12 and 20 bytes
+// instead of 32, or 56 with double precision), at the cost of slightly
+// looser boxes and of decoding them while traversing the tree, so they
+// pay off when the tree is too big to stay in the caches.
+enum class BVHNodeFormat : std::uint32_t
+{
+    kFull = 0U,
+    kQuantized16 = 1U,
+    kQuantized8 = 2U
+};
+
+// Node of a flat BVH (see FlatBVHNode, whose layout and offsets it keeps)
+// whose box is given relative to the box of its parent, which is split in
+// as many steps per axis as the values of 'Level' allow. Bounds are
+// rounded outwards, so boxes always contain the ones they were quantized
+// from. The box of the root is relative to the bounds of the whole tree,
+// which are stored apart.
+template <typename Level>
+struct QuantizedBVHNode
+{
+    Level minima[3];
+    Level maxima[3];
+    // Number of primitives of leaves, 0 for interior nodes
+    std::uint16_t count;
+    // Leaves: position of their first primitive.
+    // Interior nodes: position of their second child.
+    std::uint32_t offset;
+};
+
+using QuantizedBVHNode8 = QuantizedBVHNode<std::uint8_t>;
+using QuantizedBVHNode16 = QuantizedBVHNode<std::uint16_t>;
+
+namespace quantized_bvh_detail {
+
+template <typename Level>
+constexpr Level kMaxLevel = std::numeric_limits<Level>::max();
+
+// Size of the steps in which the interval [low, high] is split
+template <typename Level>
+inline RealNum Step(RealNum low, RealNum high) noexcept
+{
+    return (high - low) * (Real(1) / Real(kMaxLevel<Level>));
+}
+
+// Minima are measured from the minimum of the parent and maxima from its
+// maximum, so that the extreme levels give back the bounds of the parent
+// exactly, whatever the rounding of the steps
+template <typename Level>
+inline RealNum LowerBound(RealNum low, RealNum step, Level level) noexcept
+{
+    return low + Real(level) * step;
+}
+
+template <typename Level>
+inline RealNum UpperBound(RealNum high, RealNum step, Level level) noexcept
+{
+    return high - Real(kMaxLevel<Level> - level) * step;
+}
+
+template <typename Level>
+inline AxesAlignedBoundingBox Dequantize(QuantizedBVHNode<Level> const& node,
+                                         AxesAlignedBoundingBox const& parent) noexcept
+{
+    Vec3 minima;
+    Vec3 maxima;
+    for (int i = 0; i < 3; ++i) {
+        RealNum const low = parent.Minima()[i];
+        RealNum const high = parent.Maxima()[i];
+        RealNum const step = Step<Level>(low, high);
+        minima[i] = LowerBound(low, step, node.minima[i]);
+        maxima[i] = UpperBound(high, step, node.maxima[i]);
+    }
+    return AxesAlignedBoundingBox(minima, maxima);
+}
+
+// Rounds 'box', which must be contained in 'parent', outwards to levels
+// of 'parent'. Levels are estimated and then moved outwards until the
+// bounds computed as in Dequantize contain the ones of 'box'.
+template <typename Level>
+inline void Quantize(AxesAlignedBoundingBox const& box,
+                     AxesAlignedBoundingBox const& parent,
+                     QuantizedBVHNode<Level>& node) noexcept
+{
+    constexpr RealNum kMaxSteps = Real(kMaxLevel<Level>);
+    for (int i = 0; i < 3; ++i) {
+        RealNum const low = parent.Minima()[i];
+        RealNum const high = parent.Maxima()[i];
+        RealNum const step = Step<Level>(low, high);
+        RealNum steps_below = Real(0);
+        RealNum steps_above = Real(0);
+        if (step > Real(0)) {
+            steps_below = std::floor((box.Minima()[i] - low) / step);
+            steps_above = std::floor((high - box.Maxima()[i]) / step);
+        }
+        auto minimum = static_cast<Level>(std::clamp(steps_below, Real(0), kMaxSteps));
+        auto maximum = static_cast<Level>(kMaxSteps - std::clamp(steps_above, Real(0), kMaxSteps));
+        while (minimum > 0 && LowerBound(low, step, minimum) > box.Minima()[i])
+            --minimum;
+        while (maximum < kMaxLevel<Level> && UpperBound(high, step, maximum) < box.Maxima()[i])
+            ++maximum;
+        node.minima[i] = minimum;
+        node.maxima[i] = maximum;
+    }
+}
+
+}  // namespace quantized_bvh_detail
+
+// Stores the BVH of 'nodes' (which must not be empty) in 'quantized',
+// and the box of its root in 'bounds'. Fails, leaving 'quantized' empty,
+// if some leaf has more primitives than quantized nodes can refer to.
+template <typename Level>
+bool QuantizeFlatBVH(std::vector<FlatBVHNode> const& nodes,
+                     std::vector<QuantizedBVHNode<Level> >& quantized,
+                     AxesAlignedBoundingBox& bounds)
+{
+    quantized.clear();
+    for (FlatBVHNode const& node : nodes) {
+        if (node.count > std::numeric_limits<std::uint16_t>::max())
+            return false;
+    }
+
+    // Nodes are visited in the order they are stored, as in a traversal,
+    // so that the box of the parent of each node has just been decoded
+    quantized.resize(nodes.size());
+    bounds = nodes[0].box;
+    std::vector<std::pair<std::uint32_t, AxesAlignedBoundingBox> > stack;
+    std::uint32_t current = 0U;
+    AxesAlignedBoundingBox parent = bounds;
+    while (true) {
+        FlatBVHNode const& node = nodes[current];
+        QuantizedBVHNode<Level>& quantized_node = quantized[current];
+        quantized_bvh_detail::Quantize(node.box, parent, quantized_node);
+        quantized_node.count = static_cast<std::uint16_t>(node.count);
+        quantized_node.offset = node.offset;
+        if (node.count > 0U) {
+            if (stack.empty())
+                return true;
+            current = stack.back().first;
+            parent = stack.back().second;
+            stack.pop_back();
+        }
+        else {
+            parent = quantized_bvh_detail::Dequantize(quantized_node, parent);
+            stack.emplace_back(node.offset, parent);
+            current = current + 1U;
+        }
+    }
+}
+
+// Same as TraverseFlatBVH for a tree stored with quantized nodes, whose
+// root box is 'bounds'. Boxes of the pending nodes are decoded from the
+// ones of their parents, which are kept in the stack.
+template <typename Level, typename LeafIntersector>
+bool TraverseQuantizedBVH(QuantizedBVHNode<Level> const* nodes,
+                          AxesAlignedBoundingBox const& bounds,
+                          Ray const& r,
+                          RealNum t_min,
+                          RealNum t_max,
+                          bool any_hit,
+                          LeafIntersector&& intersect_leaf)
+{
+    // Depth is logarithmic in the number of primitives for median splits
+    constexpr std::size_t kMaxDepth = 64U;
+    struct PendingNode
+    {
+        std::uint32_t index;
+        AxesAlignedBoundingBox parent;
+    };
+    PendingNode stack[kMaxDepth];
+    std::size_t stack_size = 0U;
+    std::uint32_t current = 0U;
+    AxesAlignedBoundingBox parent = bounds;
+    bool hit_anything = false;
+    while (true) {
+        QuantizedBVHNode<Level> const& node = nodes[current];
+        GLANCY_COUNT_RAY_STATISTIC(node_visits, 1U);
+        AxesAlignedBoundingBox const box = quantized_bvh_detail::Dequantize(node, parent);
+        if (box.Hit(r, t_min, t_max)) {
+            if (node.count > 0U) {
+                if (intersect_leaf(node.offset, std::uint32_t(node.count), t_max)) {
+                    hit_anything = true;
+                    if (any_hit)
+                        return true;
+                }
+            }
+            else {
+                stack[stack_size++] = PendingNode{node.offset, box};
+                current = current + 1U;
+                parent = box;
+                continue;
+            }
+        }
+        if (stack_size == 0U)
+            return hit_anything;
+        --stack_size;
+        current = stack[stack_size].index;
+        parent = stack[stack_size].parent;
+    }
+}
+
+}  // namespace plemma::glancy
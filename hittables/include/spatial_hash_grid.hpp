@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Index of bounding boxes over a uniform grid of cubic cells, where only
+// the cells covered by some box are stored (in a hash map). Finding the
+// boxes overlapping a new one only looks at the boxes sharing cells with
+// it, so building a scene while checking every new hittable against the
+// previous ones is linear in their number as long as the cells are about
+// the size of the hittables.
+class SpatialHashGrid
+{
+  public:
+    explicit SpatialHashGrid(RealNum cell_size) : inv_cell_size_(Real(1) / cell_size) {}
+
+    // Registers 'box', which is given the index returned
+    std::uint32_t Insert(AxesAlignedBoundingBox const& box);
+
+    // Calls 'overlaps(index)' for the registered boxes overlapping 'box'
+    // (maybe more than once for the same index) until it returns true,
+    // e.g. to check the actual hittables in the boxes. Returns whether
+    // it did.
+    template <typename Predicate>
+    bool AnyOverlapping(AxesAlignedBoundingBox const& box, Predicate&& overlaps) const;
+
+    // Whether any registered box overlaps 'box'
+    [[nodiscard]] bool AnyOverlapping(AxesAlignedBoundingBox const& box) const
+    {
+        return AnyOverlapping(box, []([[maybe_unused]] std::uint32_t index) { return true; });
+    }
+
+    [[nodiscard]] std::size_t Size() const noexcept { return boxes_.size(); }
+    [[nodiscard]] AxesAlignedBoundingBox const& Box(std::uint32_t index) const noexcept
+    {
+        return boxes_[index];
+    }
+
+  private:
+    // Boxes covering more cells than this are not stored in cells, but
+    // checked by every query (e.g. a huge sphere acting as the ground)
+    static constexpr std::int64_t kMaxCellsPerBox = 64;
+
+    struct CellRange
+    {
+        std::int64_t minima[3];
+        std::int64_t maxima[3];
+    };
+
+    // Returns false if 'box' covers too many cells
+    bool ComputeCellRange(AxesAlignedBoundingBox const& box, CellRange& range) const noexcept;
+
+    // Coordinates wrap around every 2^21 cells. Boxes are checked anyway,
+    // so different cells sharing a key only cost some extra checks.
+    static std::uint64_t CellKey(std::int64_t x, std::int64_t y, std::int64_t z) noexcept
+    {
+        constexpr std::uint64_t kMask = (std::uint64_t(1) << 21U) - 1U;
+        return (static_cast<std::uint64_t>(x) & kMask) |
+               ((static_cast<std::uint64_t>(y) & kMask) << 21U) |
+               ((static_cast<std::uint64_t>(z) & kMask) << 42U);
+    }
+
+    RealNum inv_cell_size_;
+    std::vector<AxesAlignedBoundingBox> boxes_;
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t> > cells_;
+    std::vector<std::uint32_t> oversized_;
+};
+
+inline bool SpatialHashGrid::ComputeCellRange(AxesAlignedBoundingBox const& box,
+                                              CellRange& range) const noexcept
+{
+    std::int64_t number_cells = 1;
+    for (int i = 0; i < 3; ++i) {
+        RealNum const from = std::floor(box.Minima()[i] * inv_cell_size_);
+        RealNum const to = std::floor(box.Maxima()[i] * inv_cell_size_);
+        // Also rejects infinite and NaN limits
+        if (!(to - from < Real(kMaxCellsPerBox)))
+            return false;
+        range.minima[i] = static_cast<std::int64_t>(from);
+        range.maxima[i] = static_cast<std::int64_t>(to);
+        number_cells *= range.maxima[i] - range.minima[i] + 1;
+    }
+    return number_cells <= kMaxCellsPerBox;
+}
+
+inline std::uint32_t SpatialHashGrid::Insert(AxesAlignedBoundingBox const& box)
+{
+    auto const index = static_cast<std::uint32_t>(boxes_.size());
+    boxes_.push_back(box);
+    CellRange range;
+    if (!ComputeCellRange(box, range)) {
+        oversized_.push_back(index);
+        return index;
+    }
+    for (std::int64_t x = range.minima[0]; x <= range.maxima[0]; ++x) {
+        for (std::int64_t y = range.minima[1]; y <= range.maxima[1]; ++y) {
+            for (std::int64_t z = range.minima[2]; z <= range.maxima[2]; ++z)
+                cells_[CellKey(x, y, z)].push_back(index);
+        }
+    }
+    return index;
+}
+
+template <typename Predicate>
+bool SpatialHashGrid::AnyOverlapping(AxesAlignedBoundingBox const& box,
+                                     Predicate&& overlaps) const
+{
+    for (std::uint32_t const index : oversized_) {
+        if (DoAABBsOverlap(box, boxes_[index]) && overlaps(index))
+            return true;
+    }
+
+    CellRange range;
+    if (!ComputeCellRange(box, range)) {
+        // Big queries are cheaper going through all boxes than all cells
+        for (std::uint32_t index = 0; index < boxes_.size(); ++index) {
+            if (DoAABBsOverlap(box, boxes_[index]) && overlaps(index))
+                return true;
+        }
+        return false;
+    }
+    for (std::int64_t x = range.minima[0]; x <= range.maxima[0]; ++x) {
+        for (std::int64_t y = range.minima[1]; y <= range.maxima[1]; ++y) {
+            for (std::int64_t z = range.minima[2]; z <= range.maxima[2]; ++z) {
+                auto const cell = cells_.find(CellKey(x, y, z));
+                if (cell == cells_.end())
+                    continue;
+                for (std::uint32_t const index : cell->second) {
+                    if (DoAABBsOverlap(box, boxes_[index]) && overlaps(index))
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace plemma::glancy
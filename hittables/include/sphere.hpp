@@ -1,110 +1,352 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <memory>
 #include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "axes_aligned_bounding_box.hpp"
 #include "constants.hpp"
 #include "hittable.hpp"
 #include "material.hpp"
+#include "material_table.hpp"
+#include "orthonormal_basis.hpp"
+#include "point3.hpp"
+#include "rand_engine.hpp"
+#include "ray_statistics.hpp"
 #include "ray.hpp"
 #include "vec3.hpp"
 
 namespace plemma::glancy {
 
+namespace sphere_detail {
+
+// Static centers are stored as points (see Point3), and moving ones as
+// the functions of time that give them
+template <typename Center>
+using StoredCenter = std::conditional_t<std::is_same_v<Center, Vec3>, Point3, Center>;
+
+}  // namespace sphere_detail
+
 template <typename Center, typename Radius>
 class Sphere : public Hittable
 {
   public:
     Sphere() = default;
-    Sphere(Center c, Radius r, std::shared_ptr<Material> mat)
+    Sphere(sphere_detail::StoredCenter<Center> c, Radius r, std::shared_ptr<Material> mat)
         : center_(c), radius_(r), material_(std::move(mat)){};
     [[nodiscard]] bool Hit(Ray const& r,
                            RealNum t_min,
                            RealNum t_max,
                            HitRecord& rec) const override;
+    [[nodiscard]] bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const override;
     bool ComputeBoundingBox(RealNum time_from,
                             RealNum time_to,
                             AxesAlignedBoundingBox& bbox) const override;
+    // Directions are sampled uniformly within the cone of directions
+    // from 'origin' that hit the sphere
+    [[nodiscard]] RealNum PdfValue(Point3 const& origin,
+                                   Vec3 const& direction,
+                                   RealNum time) const override;
+    [[nodiscard]] Vec3 RandomDirection(Point3 const& origin, RealNum time) const override;
+    void BindMaterials(MaterialTable& table) override
+    {
+        material_id_ = material_ ? table.Add(*material_) : kUnboundMaterialId;
+    }
+    // Spheres with negative radius (as the inner surface of hollow glass
+    // spheres) have their normals pointing inwards
+    [[nodiscard]] bool IsConvex() const override;
+    [[nodiscard]] sphere_detail::StoredCenter<Center> const& GetCenter() const noexcept
+    {
+        return center_;
+    }
+    [[nodiscard]] Radius const& GetRadius() const noexcept { return radius_; }
+    [[nodiscard]] std::shared_ptr<Material> const& GetMaterial() const noexcept
+    {
+        return material_;
+    }
 
   private:
-    Center center_;
+    sphere_detail::StoredCenter<Center> center_;
     Radius radius_;
     std::shared_ptr<Material> material_;
+    MaterialId material_id_ = kUnboundMaterialId;
 };
 
-// Returns the smallest AABB containing a static sphere
-inline AxesAlignedBoundingBox ComputeAABBForFixedSphere(Vec3 const& center, RealNum radius)
+// Returns the smallest AABB containing a static sphere. Bounds found with
+// a precise center are rounded outwards.
+inline AxesAlignedBoundingBox ComputeAABBForFixedSphere(Point3 const& center, RealNum radius)
 {
-    return AxesAlignedBoundingBox(center - Vec3(radius, radius, radius),
-                                  center + Vec3(radius, radius, radius));
+    constexpr RealNum kInfinity = std::numeric_limits<RealNum>::infinity();
+    Vec3 minima;
+    Vec3 maxima;
+    for (int axis = 0; axis < 3; ++axis) {
+        PreciseRealNum const low = center[axis] - PreciseRealNum(radius);
+        PreciseRealNum const high = center[axis] + PreciseRealNum(radius);
+        minima[axis] = Real(low);
+        maxima[axis] = Real(high);
+        if (minima[axis] > low)
+            minima[axis] = std::nextafter(minima[axis], -kInfinity);
+        if (maxima[axis] < high)
+            maxima[axis] = std::nextafter(maxima[axis], kInfinity);
+    }
+    return AxesAlignedBoundingBox(minima, maxima);
+}
+
+namespace sphere_detail {
+
+// Roots 't0' <= 't1' of |origin + t direction - center|^2 = radius^2, if
+// any. They are computed with PreciseRealNum: for spheres much bigger than
+// the distance from 'origin' to them (such as the ground of most scenes),
+// |origin - center|^2 - radius^2 is the difference of two huge numbers,
+// which loses in float the digits that place the hit. The discriminant
+// comes from the distance from the center to the line of the ray, which
+// is far more precise than b^2 - a c for small spheres far from 'origin',
+// and the roots from the form of the quadratic formula that never
+// subtracts numbers of about the same size, so that rays leaving the
+// sphere do not find a spurious root near 0 (Haines et al., "Precision
+// Improvements for Ray/Sphere Intersection", Ray Tracing Gems).
+inline bool FindSphereRoots(Point3 const& origin,
+                            Vec3 const& direction,
+                            Point3 const& center,
+                            RealNum radius,
+                            PreciseRealNum& t0,
+                            PreciseRealNum& t1) noexcept
+{
+    using P = PreciseRealNum;
+    P const or_to_center[3] = {
+        origin.X() - center.X(), origin.Y() - center.Y(), origin.Z() - center.Z()};
+    P const dir[3] = {P(direction.X()), P(direction.Y()), P(direction.Z())};
+    P const a = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+    P const b = or_to_center[0] * dir[0] + or_to_center[1] * dir[1] + or_to_center[2] * dir[2];
+    P const c = or_to_center[0] * or_to_center[0] + or_to_center[1] * or_to_center[1] +
+                or_to_center[2] * or_to_center[2] - P(radius) * P(radius);
+    // From the center to the point of the line of the ray closest to it
+    P const b_over_a = b / a;
+    P const to_line[3] = {or_to_center[0] - b_over_a * dir[0],
+                          or_to_center[1] - b_over_a * dir[1],
+                          or_to_center[2] - b_over_a * dir[2]};
+    P const discriminant =
+        a * (P(radius) * P(radius) - (to_line[0] * to_line[0] + to_line[1] * to_line[1] +
+                                      to_line[2] * to_line[2]));
+    if (discriminant <= P(0))
+        return false;
+
+    P const q = b < P(0) ? std::sqrt(discriminant) - b : -b - std::sqrt(discriminant);
+    t0 = q / a;
+    t1 = c / q;
+    if (t0 > t1)
+        std::swap(t0, t1);
+    return true;
+}
+
+// Completes 'rec' for a hit of the ray 'r' with the sphere with center
+// 'center' and radius 'radius' at 'rec.t'. The point is moved back to the
+// surface along the normal, as the root placing it is much less precise
+// than the sphere: that bounds the error of the point by that of the
+// sphere itself (Pharr, Jakob and Humphreys, "Physically Based
+// Rendering", section 3.9.4).
+inline void CompleteSphereHit(Ray const& r,
+                              Point3 const& center,
+                              RealNum radius,
+                              HitRecord& rec) noexcept
+{
+    using P = PreciseRealNum;
+    P const t = rec.t;
+    Point3 const& origin = r.Origin();
+    Vec3 const direction = r.Direction();
+    P from_center[3];
+    for (int axis = 0; axis < 3; ++axis)
+        from_center[axis] = origin[axis] + t * P(direction[axis]) - center[axis];
+    P const distance = std::sqrt(from_center[0] * from_center[0] +
+                                 from_center[1] * from_center[1] +
+                                 from_center[2] * from_center[2]);
+    // Negative radii make the sphere face inwards
+    P const to_normal = P(1) / (radius < Real(0) ? -distance : distance);
+    P const to_surface = P(std::abs(radius)) / distance;
+    Vec3 outward_normal;
+    for (int axis = 0; axis < 3; ++axis) {
+        rec.p[axis] = center[axis] + from_center[axis] * to_surface;
+        outward_normal[axis] = Real(from_center[axis] * to_normal);
+    }
+    SetFaceNormal(r, outward_normal, rec);
+    rec.p_error = Real(RoundingErrorBound<P>(6) * (MaxAbsComponent(center) + P(std::abs(radius))) +
+                       RoundingErrorBound<P>(1) * MaxAbsComponent(rec.p));
+}
+
+}  // namespace sphere_detail
+
+// Returns whether a ray with origin 'origin' and direction 'direction'
+// hits the sphere with center 'center' and radius 'radius' for some value
+// of its parameter in (t_min, t_max)
+inline bool IsSphereHitInInterval(Point3 const& origin,
+                                  Vec3 const& direction,
+                                  Point3 const& center,
+                                  RealNum radius,
+                                  RealNum t_min,
+                                  RealNum t_max) noexcept
+{
+    GLANCY_COUNT_RAY_STATISTIC(primitive_tests, 1U);
+    PreciseRealNum t0 = 0, t1 = 0;
+    if (!sphere_detail::FindSphereRoots(origin, direction, center, radius, t0, t1))
+        return false;
+    bool const hit = (t0 < t_max && t0 > t_min) || (t1 < t_max && t1 > t_min);
+    GLANCY_COUNT_RAY_STATISTIC(primitive_hits, hit ? 1U : 0U);
+    return hit;
+}
+
+// Returns whether a ray with origin 'origin' and direction 'direction'
+// hits the sphere with center 'center' and radius 'radius' for some value
+// of its parameter in (t_min, t_max), in which case 't' is set to the
+// smallest of such values
+inline bool FindSphereHit(Point3 const& origin,
+                          Vec3 const& direction,
+                          Point3 const& center,
+                          RealNum radius,
+                          RealNum t_min,
+                          RealNum t_max,
+                          RealNum& t) noexcept
+{
+    GLANCY_COUNT_RAY_STATISTIC(primitive_tests, 1U);
+    PreciseRealNum t0 = 0, t1 = 0;
+    if (!sphere_detail::FindSphereRoots(origin, direction, center, radius, t0, t1))
+        return false;
+    bool hit = true;
+    if (t0 < t_max && t0 > t_min)
+        t = Real(t0);
+    else if (t1 < t_max && t1 > t_min)
+        t = Real(t1);
+    else
+        hit = false;
+    GLANCY_COUNT_RAY_STATISTIC(primitive_hits, hit ? 1U : 0U);
+    return hit;
 }
 
 template <typename Center, typename Radius>
 bool Sphere<Center, Radius>::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const
 {
-    Vec3 const center = center_(r.Time());
+    Point3 const center = center_(r.Time());
     RealNum const radius = radius_(r.Time());
-    Vec3 const or_to_center = r.Origin() - center;
-    RealNum const a = Dot(r.Direction(), r.Direction());
-    RealNum const b = Dot(or_to_center, r.Direction());
-    RealNum const c = Dot(or_to_center, or_to_center) - radius * radius;
-    RealNum const discriminant = b * b - a * c;
-
-    if (discriminant > Real(0)) {
-        RealNum const sqrt_discriminant = std::sqrt(discriminant);
-        RealNum temp = (-b - sqrt_discriminant) / a;
-        if (temp < t_max && temp > t_min) {
-            rec.t = temp;
-            rec.p = r.PointAtParameter(rec.t);
-            rec.normal = (rec.p - center) / radius;
-            rec.mat = material_;
-            return true;
-        }
-
-        temp = (-b + sqrt_discriminant) / a;
-        if (temp < t_max && temp > t_min) {
-            rec.t = temp;
-            rec.p = r.PointAtParameter(rec.t);
-            rec.normal = (rec.p - center) / radius;
-            rec.mat = material_;
-            return true;
-        }
-    }
-    return false;
+    RealNum t;
+    if (!FindSphereHit(r.Origin(), r.Direction(), center, radius, t_min, t_max, t))
+        return false;
+    rec.t = t;
+    sphere_detail::CompleteSphereHit(r, center, radius, rec);
+    rec.material_id = material_id_;
+    return true;
+}
+
+template <>
+inline bool Sphere<Vec3, RealNum>::Hit(Ray const& r,
+                                       RealNum t_min,
+                                       RealNum t_max,
+                                       HitRecord& rec) const
+{
+    RealNum t;
+    if (!FindSphereHit(r.Origin(), r.Direction(), center_, radius_, t_min, t_max, t))
+        return false;
+    rec.t = t;
+    sphere_detail::CompleteSphereHit(r, center_, radius_, rec);
+    rec.material_id = material_id_;
+    return true;
+}
+
+template <typename Center, typename Radius>
+bool Sphere<Center, Radius>::IsConvex() const
+{
+    return radius_(Real(0)) > Real(0);
 }
 
 template <>
-bool Sphere<Vec3, RealNum>::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const
-{
-    Vec3 const or_to_center = r.Origin() - center_;
-    RealNum const a = Dot(r.Direction(), r.Direction());
-    RealNum const b = Dot(or_to_center, r.Direction());
-    RealNum const c = Dot(or_to_center, or_to_center) - radius_ * radius_;
-    RealNum const discriminant = b * b - a * c;
-
-    if (discriminant > Real(0)) {
-        RealNum const sqrt_discriminant = std::sqrt(discriminant);
-        RealNum temp = (-b - sqrt_discriminant) / a;
-        if (temp < t_max && temp > t_min) {
-            rec.t = temp;
-            rec.p = r.PointAtParameter(rec.t);
-            rec.normal = (rec.p - center_) / radius_;
-            rec.mat = material_;
-            return true;
-        }
-
-        temp = (-b + sqrt_discriminant) / a;
-        if (temp < t_max && temp > t_min) {
-            rec.t = temp;
-            rec.p = r.PointAtParameter(rec.t);
-            rec.normal = (rec.p - center_) / radius_;
-            rec.mat = material_;
-            return true;
-        }
+inline bool Sphere<Vec3, RealNum>::IsConvex() const
+{
+    return radius_ > Real(0);
+}
+
+template <typename Center, typename Radius>
+bool Sphere<Center, Radius>::Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+{
+    return IsSphereHitInInterval(
+        r.Origin(), r.Direction(), center_(r.Time()), radius_(r.Time()), t_min, t_max);
+}
+
+template <>
+inline bool Sphere<Vec3, RealNum>::Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+{
+    return IsSphereHitInInterval(r.Origin(), r.Direction(), center_, radius_, t_min, t_max);
+}
+
+// Returns the density (w.r.t. solid angle) of choosing 'direction' when
+// sampling uniformly the cone of directions from 'origin' that hit the
+// sphere with center 'center' and radius 'radius'. It is 0 if the
+// direction misses the sphere or 'origin' is not outside of it.
+inline RealNum ConeTowardsSpherePdf(Point3 const& origin,
+                                    Vec3 const& direction,
+                                    Point3 const& center,
+                                    RealNum radius) noexcept
+{
+    // Not a ray traced, so the roots are found without counting a test
+    RealNum const squared_distance = (center - origin).SquaredNorm();
+    PreciseRealNum t0 = 0, t1 = 0;
+    if (squared_distance <= radius * radius ||
+        !sphere_detail::FindSphereRoots(origin, direction, center, radius, t0, t1) ||
+        t1 <= PreciseRealNum(0)) {
+        return Real(0);
     }
-    return false;
+    RealNum const cos_theta_max = std::sqrt(Real(1) - radius * radius / squared_distance);
+    RealNum const solid_angle = Real(2) * constants::kPi * (Real(1) - cos_theta_max);
+    return Real(1) / solid_angle;
+}
+
+// Returns a direction chosen uniformly in the cone of directions from
+// 'origin' that hit the sphere with center 'center' and radius 'radius'
+inline Vec3 RandomDirectionInConeTowardsSphere(Point3 const& origin,
+                                               Point3 const& center,
+                                               RealNum radius) noexcept
+{
+    Vec3 const to_center = center - origin;
+    RealNum const squared_distance = to_center.SquaredNorm();
+    if (squared_distance <= radius * radius)
+        return GetRandomUnitVector();
+    RealNum const cos_theta_max = std::sqrt(Real(1) - radius * radius / squared_distance);
+    std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
+    RealNum const z = Real(1) + distribution(my_engine()) * (cos_theta_max - Real(1));
+    RealNum const phi = Real(2) * constants::kPi * distribution(my_engine());
+    RealNum const sin_theta = std::sqrt(std::max(Real(0), Real(1) - z * z));
+    OrthonormalBasis const basis(to_center / std::sqrt(squared_distance));
+    return basis.Local(sin_theta * std::cos(phi), sin_theta * std::sin(phi), z);
+}
+
+template <typename Center, typename Radius>
+RealNum Sphere<Center, Radius>::PdfValue(Point3 const& origin,
+                                         Vec3 const& direction,
+                                         RealNum time) const
+{
+    return ConeTowardsSpherePdf(origin, direction, center_(time), radius_(time));
+}
+
+template <>
+inline RealNum Sphere<Vec3, RealNum>::PdfValue(Point3 const& origin,
+                                               Vec3 const& direction,
+                                               [[maybe_unused]] RealNum time) const
+{
+    return ConeTowardsSpherePdf(origin, direction, center_, radius_);
+}
+
+template <typename Center, typename Radius>
+Vec3 Sphere<Center, Radius>::RandomDirection(Point3 const& origin, RealNum time) const
+{
+    return RandomDirectionInConeTowardsSphere(origin, center_(time), radius_(time));
+}
+
+template <>
+inline Vec3 Sphere<Vec3, RealNum>::RandomDirection(Point3 const& origin,
+                                                   [[maybe_unused]] RealNum time) const
+{
+    return RandomDirectionInConeTowardsSphere(origin, center_, radius_);
 }
 
 template <typename Center, typename Radius>
@@ -112,12 +354,16 @@ bool Sphere<Center, Radius>::ComputeBoundingBox(RealNum time_from,
                                                 RealNum time_to,
                                                 AxesAlignedBoundingBox& bbox) const
 {
-    auto const number_snapshots = static_cast<std::size_t>(
-        std::ceil((time_to - time_from) / constants::kSecondsBetweenSnapshotsForBBoxCalculation));
+    // At least one snapshot, so that instantaneous shutters are covered too
+    auto const number_snapshots = std::max<std::size_t>(
+        1U,
+        static_cast<std::size_t>(std::ceil((time_to - time_from) /
+                                           constants::kSecondsBetweenSnapshotsForBBoxCalculation)));
     std::vector<RealNum> times(number_snapshots);
     RealNum prev_to_start = time_from - constants::kSecondsBetweenSnapshotsForBBoxCalculation;
     std::generate(std::begin(times), std::end(times), [t = prev_to_start]() mutable {
-        return t + constants::kSecondsBetweenSnapshotsForBBoxCalculation;
+        t += constants::kSecondsBetweenSnapshotsForBBoxCalculation;
+        return t;
     });
 
     // Compute the maximum displacement of the center between
@@ -146,9 +392,9 @@ bool Sphere<Center, Radius>::ComputeBoundingBox(RealNum time_from,
 }
 
 template <>
-bool Sphere<Vec3, RealNum>::ComputeBoundingBox([[maybe_unused]] RealNum time_from,
-                                               [[maybe_unused]] RealNum time_to,
-                                               AxesAlignedBoundingBox& bbox) const
+inline bool Sphere<Vec3, RealNum>::ComputeBoundingBox([[maybe_unused]] RealNum time_from,
+                                                      [[maybe_unused]] RealNum time_to,
+                                                      AxesAlignedBoundingBox& bbox) const
 {
     bbox = ComputeAABBForFixedSphere(center_, radius_);
     return true;
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "flat_bvh.hpp"
+#include "hittable.hpp"
+#include "material_table.hpp"
+#include "point3.hpp"
+#include "ray.hpp"
+#include "ray_statistics.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Vertices of a triangle mesh and the positions of the vertices of each
+// of its triangles, three indices per triangle. Vertices are shared by
+// all the triangles using them.
+struct TriangleMeshBuffers
+{
+    std::vector<Vec3> vertices;
+    std::vector<std::uint32_t> indices;
+};
+
+// Returns whether the ray with origin 'origin' and direction 'direction'
+// hits the triangle (v0, v1, v2) for some value of its parameter in
+// (t_min, t_max), in which case 't' is set to it and 'u' and 'v' to the
+// barycentric coordinates of the hit relative to v1 and v2.
+//
+// The test is watertight (Woop, Benthin and Wald, "Watertight Ray/Triangle
+// Intersection", 2013): vertices are moved to a space where the ray goes
+// from the origin along the z axis, and the 2D edge functions of the
+// triangle are evaluated at the origin. Edges shared by two triangles of
+// a mesh are transformed the same way for both, so rays through them hit
+// at least one of them. Edge functions that round to zero are computed
+// again in double precision, so that edges are included in the triangle.
+inline bool FindTriangleHit(Point3 const& origin,
+                            Vec3 const& direction,
+                            Vec3 const& v0,
+                            Vec3 const& v1,
+                            Vec3 const& v2,
+                            RealNum t_min,
+                            RealNum t_max,
+                            RealNum& t,
+                            RealNum& u,
+                            RealNum& v) noexcept
+{
+    GLANCY_COUNT_RAY_STATISTIC(primitive_tests, 1U);
+    // Axis along which the direction is longest becomes z, and the other
+    // two are swapped if needed to keep the winding of the triangle
+    int const kz = MaxAbsDimension(direction);
+    int kx = kz == 2 ? 0 : kz + 1;
+    int ky = kx == 2 ? 0 : kx + 1;
+    if (direction[kz] < Real(0))
+        std::swap(kx, ky);
+    RealNum const shear_x = direction[kx] / direction[kz];
+    RealNum const shear_y = direction[ky] / direction[kz];
+    RealNum const shear_z = Real(1) / direction[kz];
+
+    Vec3 const a = v0 - origin;
+    Vec3 const b = v1 - origin;
+    Vec3 const c = v2 - origin;
+    RealNum const ax = a[kx] - shear_x * a[kz];
+    RealNum const ay = a[ky] - shear_y * a[kz];
+    RealNum const bx = b[kx] - shear_x * b[kz];
+    RealNum const by = b[ky] - shear_y * b[kz];
+    RealNum const cx = c[kx] - shear_x * c[kz];
+    RealNum const cy = c[ky] - shear_y * c[kz];
+
+    // Edge functions, i.e. barycentric coordinates of the hit scaled by
+    // the determinant, relative to v0, v1 and v2
+    RealNum e0 = cx * by - cy * bx;
+    RealNum e1 = ax * cy - ay * cx;
+    RealNum e2 = bx * ay - by * ax;
+    if (e0 == Real(0) || e1 == Real(0) || e2 == Real(0)) {
+        e0 = RealNum(double(cx) * double(by) - double(cy) * double(bx));
+        e1 = RealNum(double(ax) * double(cy) - double(ay) * double(cx));
+        e2 = RealNum(double(bx) * double(ay) - double(by) * double(ax));
+    }
+    if ((e0 < Real(0) || e1 < Real(0) || e2 < Real(0)) &&
+        (e0 > Real(0) || e1 > Real(0) || e2 > Real(0)))
+        return false;
+    RealNum const determinant = e0 + e1 + e2;
+    // Rays parallel to the plane of the triangle (or degenerate triangles)
+    if (determinant == Real(0))
+        return false;
+
+    RealNum const inv_determinant = Real(1) / determinant;
+    RealNum const scaled_t = e0 * shear_z * a[kz] + e1 * shear_z * b[kz] + e2 * shear_z * c[kz];
+    t = scaled_t * inv_determinant;
+    u = e1 * inv_determinant;
+    v = e2 * inv_determinant;
+    bool const hit = t < t_max && t > t_min;
+    GLANCY_COUNT_RAY_STATISTIC(primitive_hits, hit ? 1U : 0U);
+    return hit;
+}
+
+inline bool FindTriangleHit(Point3 const& origin,
+                            Vec3 const& direction,
+                            Vec3 const& v0,
+                            Vec3 const& v1,
+                            Vec3 const& v2,
+                            RealNum t_min,
+                            RealNum t_max,
+                            RealNum& t) noexcept
+{
+    RealNum u, v;
+    return FindTriangleHit(origin, direction, v0, v1, v2, t_min, t_max, t, u, v);
+}
+
+// Maximum number of triangles in the leaves of the BVH of meshes
+constexpr std::size_t kTrianglesPerLeaf = 4U;
+
+// Mesh of triangles made of a single material, with its own BVH over its
+// triangles, so it is a single hittable however many triangles it has.
+// Normals are the geometric ones. Triangles face the side from which their
+// vertices are seen counter-clockwise, which should be the outside for
+// closed meshes, and are hit from both sides (see SetFaceNormal).
+class TriangleMesh : public Hittable
+{
+  public:
+    // Triangles with indices out of the range of 'buffers.vertices' are
+    // dropped. The rest are stored in the order of the leaves of the BVH.
+    TriangleMesh(TriangleMeshBuffers buffers, std::shared_ptr<Material> material);
+
+    bool Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const override;
+    bool Occluded(Ray const& r, RealNum t_min, RealNum t_max) const override;
+    bool ComputeBoundingBox([[maybe_unused]] RealNum time_from,
+                            [[maybe_unused]] RealNum time_to,
+                            AxesAlignedBoundingBox& bbox) const override
+    {
+        if (nodes_.empty())
+            return false;
+        bbox = nodes_[0].box;
+        return true;
+    }
+    void BindMaterials(MaterialTable& table) override
+    {
+        material_id_ = material_ ? table.Add(*material_) : kUnboundMaterialId;
+    }
+
+    [[nodiscard]] std::size_t NumberOfTriangles() const noexcept { return indices_.size() / 3U; }
+    [[nodiscard]] std::size_t NumberOfVertices() const noexcept { return vertices_.size(); }
+
+  private:
+    [[nodiscard]] Vec3 const& Vertex(std::size_t triangle, std::size_t corner) const noexcept
+    {
+        return vertices_[indices_[3U * triangle + corner]];
+    }
+
+    std::vector<Vec3> vertices_;
+    std::vector<std::uint32_t> indices_;
+    std::vector<FlatBVHNode> nodes_;
+    std::shared_ptr<Material> material_;
+    MaterialId material_id_ = kUnboundMaterialId;
+};
+
+inline TriangleMesh::TriangleMesh(TriangleMeshBuffers buffers, std::shared_ptr<Material> material)
+    : vertices_(std::move(buffers.vertices)), material_(std::move(material))
+{
+    std::size_t const number_triangles = buffers.indices.size() / 3U;
+    std::vector<AxesAlignedBoundingBox> boxes;
+    std::vector<std::uint32_t> valid_indices;
+    boxes.reserve(number_triangles);
+    valid_indices.reserve(3U * number_triangles);
+    for (std::size_t i = 0; i < number_triangles; ++i) {
+        std::uint32_t const* corners = &buffers.indices[3U * i];
+        if (corners[0] >= vertices_.size() || corners[1] >= vertices_.size() ||
+            corners[2] >= vertices_.size())
+            continue;
+        Vec3 minima = vertices_[corners[0]];
+        Vec3 maxima = minima;
+        for (std::size_t corner = 1; corner < 3U; ++corner) {
+            for (int axis = 0; axis < 3; ++axis) {
+                minima[axis] = std::min(minima[axis], vertices_[corners[corner]][axis]);
+                maxima[axis] = std::max(maxima[axis], vertices_[corners[corner]][axis]);
+            }
+        }
+        boxes.emplace_back(minima, maxima);
+        valid_indices.insert(valid_indices.end(), corners, corners + 3);
+    }
+
+    std::vector<std::uint32_t> order;
+    BuildFlatBVH(boxes, kTrianglesPerLeaf, nodes_, order);
+    indices_.reserve(valid_indices.size());
+    for (std::uint32_t const triangle : order) {
+        indices_.insert(indices_.end(),
+                        valid_indices.begin() + 3 * std::ptrdiff_t(triangle),
+                        valid_indices.begin() + 3 * std::ptrdiff_t(triangle) + 3);
+    }
+}
+
+inline bool TriangleMesh::Hit(Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) const
+{
+    if (nodes_.empty())
+        return false;
+    std::size_t closest = 0U;
+    RealNum closest_t = t_max;
+    RealNum closest_u = Real(0);
+    RealNum closest_v = Real(0);
+    bool const hit = TraverseFlatBVH(
+        nodes_.data(),
+        r,
+        t_min,
+        t_max,
+        false,
+        [&](std::uint32_t first, std::uint32_t count, RealNum& closest_so_far) {
+            bool hit_leaf = false;
+            for (std::uint32_t i = first; i < first + count; ++i) {
+                RealNum t, u, v;
+                if (FindTriangleHit(r.Origin(),
+                                    r.Direction(),
+                                    Vertex(i, 0U),
+                                    Vertex(i, 1U),
+                                    Vertex(i, 2U),
+                                    t_min,
+                                    closest_so_far,
+                                    t,
+                                    u,
+                                    v)) {
+                    closest_so_far = t;
+                    closest_t = t;
+                    closest_u = u;
+                    closest_v = v;
+                    closest = i;
+                    hit_leaf = true;
+                }
+            }
+            return hit_leaf;
+        });
+    if (!hit)
+        return false;
+
+    rec.t = closest_t;
+    Vec3 const& v0 = Vertex(closest, 0U);
+    Vec3 const& v1 = Vertex(closest, 1U);
+    Vec3 const& v2 = Vertex(closest, 2U);
+    // The point is interpolated from the vertices rather than found along
+    // 'r', which bounds its error by the size of the vertices whatever the
+    // origin of the ray is (Pharr, Jakob and Humphreys, "Physically Based
+    // Rendering", section 3.9.4), with the precision of points. Its error
+    // is still bounded as in RealNum, as rays leaving it must start beyond
+    // the reach of the errors of FindTriangleHit, which works in RealNum.
+    using P = PreciseRealNum;
+    P const u = closest_u;
+    P const v = closest_v;
+    P const w = P(1) - u - v;
+    for (int axis = 0; axis < 3; ++axis)
+        rec.p[axis] = w * P(v0[axis]) + u * P(v1[axis]) + v * P(v2[axis]);
+    rec.p_error = RoundingErrorBound<RealNum>(7) *
+                  Real(std::abs(w) * P(MaxAbsComponent(v0)) + u * P(MaxAbsComponent(v1)) +
+                       v * P(MaxAbsComponent(v2)));
+    SetFaceNormal(r, UnitVector(Cross(v1 - v0, v2 - v0)), rec);
+    rec.material_id = material_id_;
+    return true;
+}
+
+inline bool TriangleMesh::Occluded(Ray const& r, RealNum t_min, RealNum t_max) const
+{
+    if (nodes_.empty())
+        return false;
+    return TraverseFlatBVH(nodes_.data(),
+                           r,
+                           t_min,
+                           t_max,
+                           true,
+                           [&](std::uint32_t first, std::uint32_t count, RealNum& t_leaf_max) {
+                               for (std::uint32_t i = first; i < first + count; ++i) {
+                                   RealNum t;
+                                   if (FindTriangleHit(r.Origin(),
+                                                       r.Direction(),
+                                                       Vertex(i, 0U),
+                                                       Vertex(i, 1U),
+                                                       Vertex(i, 2U),
+                                                       t_min,
+                                                       t_leaf_max,
+                                                       t))
+                                       return true;
+                               }
+                               return false;
+                           });
+}
+
+}  // namespace plemma::glancy
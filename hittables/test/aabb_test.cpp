@@ -124,6 +124,74 @@ TEST_CASE("Hit : AABB x Ray x RealNum x RealNum -> bool", "[AABB]")
     }
 }
 
+TEST_CASE("Hit : agrees with the slab test dividing by the direction", "[AABB]")
+{
+    // Slab test computing the inverse of the direction and branching on
+    // its sign for every box
+    auto const reference_hit = [](AxesAlignedBoundingBox const& bbox,
+                                  Ray const& r,
+                                  RealNum param_min,
+                                  RealNum param_max) {
+        for (int i = 0; i < 3; ++i) {
+            RealNum const inv_direction_comp = Real(1) / r.Direction()[i];
+            RealNum lambda_0 = (bbox.Minima()[i] - r.Origin()[i]) * inv_direction_comp;
+            RealNum lambda_1 = (bbox.Maxima()[i] - r.Origin()[i]) * inv_direction_comp;
+            if (inv_direction_comp < Real(0))
+                std::swap(lambda_0, lambda_1);
+            param_min = lambda_0 > param_min ? lambda_0 : param_min;
+            param_max = lambda_1 < param_max ? lambda_1 : param_max;
+            if (param_min > param_max)
+                return false;
+        }
+        return true;
+    };
+    auto bbox = GENERATE(take(20, filter(IsAABBNonEmpty, RandomFiniteAABB(-30.0, 30.0))));
+    Ray ray = GENERATE(take(50, RandomRay(-30.0, 30.0)));
+    RealNum const param_max = GENERATE(Real(1.0), tconst::kMaxRandomGeneration);
+
+    SECTION("Rays in any direction")
+    {
+        CHECK(bbox.Hit(ray, Real(0.0), param_max) ==
+              reference_hit(bbox, ray, Real(0.0), param_max));
+    }
+
+    SECTION("Rays parallel to the planes of the axes")
+    {
+        int const axis = GENERATE(0, 1, 2);
+        Vec3 direction = ray.Direction();
+        direction[axis] = Real(0.0);
+        Ray const parallel_ray(ray.Origin(), direction, ray.Time());
+        CHECK(bbox.Hit(parallel_ray, Real(0.0), param_max) ==
+              reference_hit(bbox, parallel_ray, Real(0.0), param_max));
+    }
+}
+
+TEST_CASE("Hit : flat boxes far from the origin", "[AABB]")
+{
+    // Boxes flat along x, two units in the last place wide along y and z
+    // and around 2^19 for floats (2^48 for doubles), hit by rays from
+    // nearby origins aimed at their centres. Parameters of the planes
+    // must be computed from the difference of the bounds and the origin:
+    // scaling both by the inverse of the direction before subtracting
+    // them loses it, and the ray misses the box.
+    RealNum const offset = Real(1) / std::numeric_limits<RealNum>::epsilon() / Real(16);
+    RealNum const ulp = offset * std::numeric_limits<RealNum>::epsilon();
+    auto const steps = GENERATE(take(20, random(-1000, 1000)));
+    Vec3 const minima(offset + Real(steps) * ulp, offset - Real(steps) * ulp, offset);
+    Vec3 const size(Real(0), Real(2) * ulp, Real(2) * ulp);
+    AxesAlignedBoundingBox const bbox(minima, minima + size);
+    Vec3 const center = minima + Real(0.5) * size;
+    auto const ulps_away = GENERATE(take(20, random(-1000, 1000)));
+    auto const ulps_before = GENERATE(1, 3, 8);
+    Vec3 const origin(center.X() - Real(ulps_before) * ulp,
+                      center.Y() + Real(ulps_away) * ulp,
+                      center.Z() - Real(ulps_away / 3) * ulp);
+    // The length of the direction does not change which points are hit
+    RealNum const scale = GENERATE(Real(1), Real(1.37), Real(0.291));
+    Ray const r(origin, scale * (center - origin), Real(0));
+    CHECK(bbox.Hit(r, Real(0), tconst::kMaxRandomGeneration));
+}
+
 TEST_CASE("UnionOfAABBs : AABB x AABB -> AABB", "[AABB}")
 {
     SECTION("It is commutative")
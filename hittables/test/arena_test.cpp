@@ -0,0 +1,41 @@
+#include <memory>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("BoundingVolumeHierarchy : nodes allocated in an arena", "[Arena]")
+{
+    // Declared first, so that it outlives every handle to its objects
+    Arena arena;
+    std::vector<HittableInABox> boxed_spheres;
+    Vec3RandomGenerator center_gen(Real(-20.0), Real(20.0));
+    size_t const number_spheres = GENERATE(1, 2, 3, 100);
+    for (size_t i = 0; i < number_spheres; ++i) {
+        center_gen.next();
+        auto sphere = arena.Make<Sphere<Vec3, RealNum> >(center_gen.get(), Real(0.5), nullptr);
+        HittableInABox& added = boxed_spheres.emplace_back(AxesAlignedBoundingBox(), sphere);
+        sphere->ComputeBoundingBox(Real(0.0), Real(1.0), added.first);
+    }
+
+    SECTION("Tree is the same than the one allocated in the heap")
+    {
+        std::vector<HittableInABox> heap_order = boxed_spheres;
+        std::vector<HittableInABox> arena_order = boxed_spheres;
+        BoundingVolumeHierarchy const in_heap(heap_order, Real(0.0), Real(1.0));
+        BoundingVolumeHierarchy const in_arena(arena_order, Real(0.0), Real(1.0), &arena);
+
+        std::vector<AxesAlignedBoundingBox> heap_boxes;
+        std::vector<AxesAlignedBoundingBox> arena_boxes;
+        in_heap.AppendNodeBoxes(number_spheres, heap_boxes);
+        in_arena.AppendNodeBoxes(number_spheres, arena_boxes);
+        CHECK(heap_boxes == arena_boxes);
+    }
+}
+
+}  // namespace plemma::glancy
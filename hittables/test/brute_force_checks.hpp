@@ -0,0 +1,51 @@
+#pragma once
+
+#include <limits>
+#include <type_traits>
+
+#include "catch.hpp"
+
+#include "hittable.hpp"
+#include "ray.hpp"
+
+namespace plemma::glancy {
+
+// Checks that 'hittable' finds the same closest hit of 'r' as 'reference',
+// a simpler hittable or a function testing every primitive with the
+// signature of Hittable::Hit, and that it is occluded exactly when hit.
+// Returns whether 'r' hits, leaving both records for further checks.
+template <typename Reference>
+bool CheckSameHit(Hittable const& hittable,
+                  Reference const& reference,
+                  Ray const& r,
+                  RealNum t_min,
+                  RealNum t_max,
+                  HitRecord& rec,
+                  HitRecord& reference_rec,
+                  double t_epsilon = std::numeric_limits<float>::epsilon() * 100.0)
+{
+    bool reference_hit = false;
+    if constexpr (std::is_base_of_v<Hittable, Reference>)
+        reference_hit = reference.Hit(r, t_min, t_max, reference_rec);
+    else
+        reference_hit = reference(r, t_min, t_max, reference_rec);
+    REQUIRE(hittable.Hit(r, t_min, t_max, rec) == reference_hit);
+    CHECK(hittable.Occluded(r, t_min, t_max) == reference_hit);
+    if (reference_hit)
+        CHECK(rec.t == Approx(reference_rec.t).epsilon(t_epsilon));
+    return reference_hit;
+}
+
+template <typename Reference>
+bool CheckSameHit(Hittable const& hittable,
+                  Reference const& reference,
+                  Ray const& r,
+                  RealNum t_min,
+                  RealNum t_max)
+{
+    HitRecord rec{};
+    HitRecord reference_rec{};
+    return CheckSameHit(hittable, reference, r, t_min, t_max, rec, reference_rec);
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,99 @@
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+#include "temporary_files.hpp"
+
+#include "bounding_volume_hierarchy.hpp"
+#include "bvh_cache.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+std::vector<HittableInABox> RandomBoxedSpheres(size_t number_spheres)
+{
+    std::vector<HittableInABox> boxed_spheres;
+    Vec3RandomGenerator center_gen(Real(-20.0), Real(20.0));
+    for (size_t i = 0; i < number_spheres; ++i) {
+        center_gen.next();
+        auto sphere =
+            std::make_shared<Sphere<Vec3, RealNum> >(center_gen.get(), Real(0.5), nullptr);
+        HittableInABox& added = boxed_spheres.emplace_back(AxesAlignedBoundingBox(), sphere);
+        sphere->ComputeBoundingBox(Real(0.0), Real(1.0), added.first);
+    }
+    return boxed_spheres;
+}
+
+}  // namespace
+
+TEST_CASE("BVH cache : save -> load gives an equivalent tree", "[BVHCache]")
+{
+    size_t const number_spheres = GENERATE(1, 2, 3, 57);
+    std::vector<HittableInABox> world = RandomBoxedSpheres(number_spheres);
+    std::vector<Hittable const*> world_order;
+    for (auto const& boxed_sphere : world)
+        world_order.push_back(boxed_sphere.second.get());
+
+    std::uint64_t const key = ComputeBVHCacheKey(world, Real(0.0), Real(1.0));
+    std::vector<HittableInABox> to_order = world;
+    BoundingVolumeHierarchy const built(to_order, Real(0.0), Real(1.0));
+
+    TemporaryDirectory const directory("bvh_cache_test");
+    std::string const file_path = directory.File("cache.bvh");
+    REQUIRE(SaveBVHCache(file_path, key, built, world_order, to_order));
+
+    SECTION("Loaded tree has the same boxes and hits than the built one")
+    {
+        BoundingVolumeHierarchy loaded;
+        REQUIRE(LoadBVHCache(file_path, key, world, loaded));
+
+        std::vector<AxesAlignedBoundingBox> built_boxes;
+        std::vector<AxesAlignedBoundingBox> loaded_boxes;
+        built.AppendNodeBoxes(number_spheres, built_boxes);
+        loaded.AppendNodeBoxes(number_spheres, loaded_boxes);
+        REQUIRE(built_boxes.size() == BoundingVolumeHierarchy::NumberOfNodes(number_spheres));
+        REQUIRE(built_boxes == loaded_boxes);
+
+        RayRandomGenerator ray_gen(Real(-30.0), Real(30.0), Real(0.0), Real(1.0));
+        for (int i = 0; i < 200; ++i) {
+            ray_gen.next();
+            Ray const r(
+                ray_gen.get().Origin(), -ray_gen.get().Origin().ToVec3(), ray_gen.get().Time());
+            HitRecord built_rec;
+            HitRecord loaded_rec;
+            bool const hits_built = built.Hit(r, Real(0.001), Real(1e4), built_rec);
+            bool const hits_loaded = loaded.Hit(r, Real(0.001), Real(1e4), loaded_rec);
+            REQUIRE(hits_built == hits_loaded);
+            if (hits_built)
+                CHECK(built_rec.t == loaded_rec.t);
+        }
+    }
+
+    SECTION("A different key is rejected")
+    {
+        BoundingVolumeHierarchy loaded;
+        CHECK(!LoadBVHCache(file_path, key + 1U, world, loaded));
+    }
+
+    SECTION("A different number of hittables is rejected")
+    {
+        std::vector<HittableInABox> other_world = RandomBoxedSpheres(number_spheres + 1);
+        BoundingVolumeHierarchy loaded;
+        CHECK(!LoadBVHCache(file_path, key, other_world, loaded));
+    }
+
+    SECTION("Saving again replaces the file without leaving temporary files")
+    {
+        REQUIRE(SaveBVHCache(file_path, key + 1U, built, world_order, to_order));
+        BoundingVolumeHierarchy loaded;
+        CHECK(LoadBVHCache(file_path, key + 1U, world, loaded));
+        CHECK(!LoadBVHCache(file_path, key, world, loaded));
+        for (auto const& entry : std::filesystem::directory_iterator(directory.Path()))
+            CHECK(entry.path().filename() == "cache.bvh");
+    }
+}
+
+}  // namespace plemma::glancy
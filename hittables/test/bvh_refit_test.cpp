@@ -0,0 +1,63 @@
+#include <memory>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+#include "brute_force_checks.hpp"
+
+#include "bounding_volume_hierarchy.hpp"
+#include "hittable_list.hpp"
+#include "motion.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("BoundingVolumeHierarchy : refitted tree keeps the hits of its hittables",
+          "[BoundingVolumeHierarchy]")
+{
+    Vec3RandomGenerator center_gen(Real(-8.0), Real(8.0));
+    Vec3RandomGenerator velocity_gen(Real(-4.0), Real(4.0));
+    size_t const number_spheres = GENERATE(1, 2, 3, 100);
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+
+    HittableList list;
+    std::vector<HittableInABox> boxed_hittables;
+    for (size_t i = 0; i < number_spheres; ++i) {
+        center_gen.next();
+        velocity_gen.next();
+        std::shared_ptr<Hittable> sphere;
+        if (i % 3 == 0) {
+            sphere = std::make_shared<Sphere<Vec3, RealNum> >(center_gen.get(), Real(1), nullptr);
+        }
+        else {
+            sphere = std::make_shared<Sphere<LinearMotion, ConstantMagnitude> >(
+                LinearMotion{center_gen.get(), velocity_gen.get(), Real(0)},
+                ConstantMagnitude{Real(0.5)},
+                nullptr);
+        }
+        list.Add(std::shared_ptr<Hittable>(sphere));
+        HittableInABox& boxed = boxed_hittables.emplace_back(AxesAlignedBoundingBox(), sphere);
+        sphere->ComputeBoundingBox(Real(0), Real(4), boxed.first);
+    }
+
+    // Built for a whole animation and refitted to one of its frames
+    BoundingVolumeHierarchy bvh(boxed_hittables, Real(0), Real(4));
+    RealNum const frame_from = Real(1);
+    RealNum const frame_to = Real(1.5);
+    bvh.Refit(number_spheres, frame_from, frame_to);
+
+    AxesAlignedBoundingBox full_box;
+    AxesAlignedBoundingBox frame_box;
+    REQUIRE(list.ComputeBoundingBox(Real(0), Real(4), full_box));
+    REQUIRE(bvh.ComputeBoundingBox(frame_from, frame_to, frame_box));
+    for (int i = 0; i < 3; ++i) {
+        CHECK(frame_box.Minima()[i] >= full_box.Minima()[i]);
+        CHECK(frame_box.Maxima()[i] <= full_box.Maxima()[i]);
+    }
+
+    // Rays of the times of the frame
+    Ray const r = GENERATE_COPY(take(1000, RandomRayTowardsOrigin(frame_from, frame_to)));
+    CheckSameHit(bvh, list, r, t_min, t_max);
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,46 @@
+#include <memory>
+
+#include "aabb_random_generator.hpp"
+#include "brute_force_checks.hpp"
+
+#include "affine_transform.hpp"
+#include "instance.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("Instance : same hits than the transformed hittable", "[Instance]")
+{
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+
+    // Unit sphere at the origin, scaled uniformly, rotated and moved
+    auto const unit_sphere = std::make_shared<Sphere<Vec3, RealNum> >(
+        Vec3(Real(0), Real(0), Real(0)), Real(1), nullptr);
+    Vec3 const center(Real(1), Real(-2), Real(0.5));
+    RealNum const radius = Real(3);
+    AffineTransform const object_to_world =
+        AffineTransform::Translation(center) *
+        AffineTransform::Rotation(Vec3(Real(1), Real(1), Real(0)), Real(0.3)) *
+        AffineTransform::Scaling(Vec3(radius, radius, radius));
+    Instance const instance(unit_sphere, object_to_world);
+    Sphere<Vec3, RealNum> const sphere(center, radius, nullptr);
+
+    AxesAlignedBoundingBox box;
+    REQUIRE(instance.ComputeBoundingBox(Real(0), Real(1), box));
+    for (int i = 0; i < 3; ++i) {
+        CHECK(box.Minima()[i] <= center[i] - radius + Real(1e-4));
+        CHECK(box.Maxima()[i] >= center[i] + radius - Real(1e-4));
+    }
+
+    Ray const r = GENERATE(take(1000, RandomRayTowardsOrigin()));
+    HitRecord instance_rec{};
+    HitRecord sphere_rec{};
+    if (CheckSameHit(instance, sphere, r, t_min, t_max, instance_rec, sphere_rec, 1e-4)) {
+        CHECK(instance_rec.normal.X() == Approx(sphere_rec.normal.X()).margin(1e-3));
+        CHECK(instance_rec.normal.Y() == Approx(sphere_rec.normal.Y()).margin(1e-3));
+        CHECK(instance_rec.normal.Z() == Approx(sphere_rec.normal.Z()).margin(1e-3));
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,187 @@
+#include <cmath>
+#include <memory>
+#include <variant>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+
+#include "checker_texture.hpp"
+#include "constant_texture.hpp"
+#include "dielectric.hpp"
+#include "diffuse_light.hpp"
+#include "lambertian.hpp"
+#include "material_table.hpp"
+#include "metal.hpp"
+#include "rand_engine.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+// Material out of the closed set of the library
+class Absorbing : public Material
+{
+  public:
+    bool Sample([[maybe_unused]] Ray const& ray_in,
+                [[maybe_unused]] HitRecord const& rec,
+                [[maybe_unused]] ScatterSample& sample) const override
+    {
+        return false;
+    }
+};
+
+// Subclasses of library classes, which must not be flattened
+class HalfLambertian : public Lambertian
+{
+  public:
+    using Lambertian::Lambertian;
+
+    bool Sample(Ray const& ray_in, HitRecord const& rec, ScatterSample& sample) const override
+    {
+        if (!Lambertian::Sample(ray_in, rec, sample))
+            return false;
+        sample.weight = Real(0.5) * sample.weight;
+        return true;
+    }
+
+    [[nodiscard]] Vec3 Evaluate(Ray const& ray_in,
+                                HitRecord const& rec,
+                                Vec3 const& direction) const override
+    {
+        return Real(0.5) * Lambertian::Evaluate(ray_in, rec, direction);
+    }
+};
+
+class GradientTexture : public ConstantTexture
+{
+  public:
+    using ConstantTexture::ConstantTexture;
+
+    [[nodiscard]] Vec3 GetValue(RealNum u, RealNum v, Vec3 const& p) const noexcept override
+    {
+        return std::abs(p.X()) * ConstantTexture::GetValue(u, v, p);
+    }
+};
+
+}  // namespace
+
+TEST_CASE("MaterialTable : flat dispatch agrees with virtual dispatch", "[MaterialTable]")
+{
+    auto checker = std::make_shared<CheckerTexture>(
+        std::make_shared<ConstantTexture>(Vec3(Real(0.2), Real(0.3), Real(0.1))),
+        std::make_shared<ConstantTexture>(Vec3(Real(0.9), Real(0.9), Real(0.9))));
+    std::vector<std::shared_ptr<Material> > const materials{
+        std::make_shared<Lambertian>(checker),
+        std::make_shared<Metal>(Vec3(Real(0.7), Real(0.6), Real(0.5)), Real(0.3)),
+        std::make_shared<Metal>(Vec3(Real(0.7), Real(0.6), Real(0.5)), Real(0)),
+        std::make_shared<WindowGlass>(),
+        std::make_shared<DiffuseLight>(checker),
+        std::make_shared<Absorbing>()};
+
+    MaterialTable table;
+    for (auto const& material : materials)
+        table.Add(*material);
+    CHECK(table.Size() == materials.size());
+    CHECK(table.Add(*materials.front()) == MaterialId{0});
+
+    RayRandomGenerator ray_gen(Real(-30.0), Real(30.0), Real(0.0), Real(1.0));
+    Vec3RandomGenerator direction_gen(Real(-1.0), Real(1.0));
+    for (auto const& material : materials) {
+        Sphere<Vec3, RealNum> sphere(Vec3(Real(0), Real(0), Real(0)), Real(5), material);
+        sphere.BindMaterials(table);
+        for (int i = 0; i < 200; ++i) {
+            ray_gen.next();
+            direction_gen.next();
+            Ray const r(
+                ray_gen.get().Origin(), -ray_gen.get().Origin().ToVec3(), ray_gen.get().Time());
+            HitRecord rec;
+            if (!sphere.Hit(r, Real(0.001), Real(1e4), rec))
+                continue;
+            REQUIRE(rec.material_id != kUnboundMaterialId);
+
+            Vec3 const direction = direction_gen.get();
+            CHECK(table.Evaluate(r, rec, direction) == material->Evaluate(r, rec, direction));
+            CHECK(table.Pdf(r, rec, direction) == material->Pdf(r, rec, direction));
+            CHECK(table.Emitted(r, rec) == material->Emitted(r, rec));
+
+            // Both draw the same numbers from the engine
+            ScatterSample table_sample{};
+            ScatterSample material_sample{};
+            my_engine().seed(static_cast<unsigned int>(i + 1));
+            bool const table_scattered = table.Sample(r, rec, table_sample);
+            my_engine().seed(static_cast<unsigned int>(i + 1));
+            bool const material_scattered = material->Sample(r, rec, material_sample);
+            REQUIRE(table_scattered == material_scattered);
+            if (table_scattered) {
+                CHECK(table_sample.direction == material_sample.direction);
+                CHECK(table_sample.weight == material_sample.weight);
+                CHECK(table_sample.pdf == material_sample.pdf);
+            }
+        }
+    }
+}
+
+TEST_CASE("MaterialTable : subclasses of library classes keep their overrides", "[MaterialTable]")
+{
+    Vec3 const gray(Real(0.5), Real(0.5), Real(0.5));
+    std::vector<std::shared_ptr<Material> > const materials{
+        std::make_shared<HalfLambertian>(std::make_shared<ConstantTexture>(gray)),
+        std::make_shared<Lambertian>(std::make_shared<GradientTexture>(gray)),
+        std::make_shared<DiffuseLight>(std::make_shared<GradientTexture>(gray))};
+
+    MaterialTable table;
+    for (auto const& material : materials)
+        table.Add(*material);
+    REQUIRE(table.Size() == materials.size());
+    CHECK(table.Textures().Size() == 0U);
+
+    Ray const r(Vec3(Real(0), Real(0), Real(-10)), Vec3(Real(0), Real(0), Real(1)), Real(0));
+    Vec3 const direction = UnitVector(Vec3(Real(0.3), Real(0.2), Real(-1)));
+    HitRecord rec;
+    rec.p = Vec3(Real(3), Real(0), Real(-1));
+    rec.normal = Vec3(Real(0), Real(0), Real(-1));
+    for (std::size_t i = 0; i < materials.size(); ++i) {
+        INFO("material " << i);
+        CHECK(std::holds_alternative<ExternalMaterial>(table.Materials()[i]));
+        rec.material_id = static_cast<MaterialId>(i);
+        Material const& material = *materials[i];
+        CHECK(table.Evaluate(r, rec, direction) == material.Evaluate(r, rec, direction));
+        CHECK(table.Emitted(r, rec) == material.Emitted(r, rec));
+
+        ScatterSample table_sample{};
+        ScatterSample material_sample{};
+        my_engine().seed(7U);
+        bool const table_scattered = table.Sample(r, rec, table_sample);
+        my_engine().seed(7U);
+        REQUIRE(table_scattered == material.Sample(r, rec, material_sample));
+        if (table_scattered)
+            CHECK(table_sample.weight == material_sample.weight);
+    }
+}
+
+TEST_CASE("MaterialTable : hits without material absorb", "[MaterialTable]")
+{
+    Lambertian const lambertian(
+        std::make_shared<ConstantTexture>(Vec3(Real(0.5), Real(0.5), Real(0.5))));
+    MaterialTable table;
+    table.Add(lambertian);
+
+    Ray const r(Vec3(Real(0), Real(0), Real(-10)), Vec3(Real(0), Real(0), Real(1)), Real(0));
+    Vec3 const direction(Real(0), Real(0), Real(-1));
+    Vec3 const black(Real(0), Real(0), Real(0));
+    // Not bound, and bound to a bigger table
+    for (MaterialId const id : {kUnboundMaterialId, MaterialId{1}}) {
+        HitRecord rec;
+        rec.p = Vec3(Real(0), Real(0), Real(-1));
+        rec.normal = Vec3(Real(0), Real(0), Real(-1));
+        rec.material_id = id;
+        ScatterSample sample{};
+        CHECK_FALSE(table.Sample(r, rec, sample));
+        CHECK(table.Evaluate(r, rec, direction) == black);
+        CHECK(table.Pdf(r, rec, direction) == Real(0));
+        CHECK(table.Emitted(r, rec) == black);
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,118 @@
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+#include "brute_force_checks.hpp"
+
+#include "bounding_volume_hierarchy.hpp"
+#include "hittable_list.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("Occluded : Hittable x Ray x RealNum x RealNum -> bool", "[Occlusion]")
+{
+    Vec3RandomGenerator center_gen(Real(-8.0), Real(8.0));
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = GENERATE(Real(0.5), Real(1.0), Real(1e4));
+
+    SECTION("Static sphere agrees with Hit")
+    {
+        Ray const r = GENERATE(take(500, RandomRayTowardsOrigin()));
+        Sphere<Vec3, RealNum> const sphere(center_gen.get(), Real(2.0), nullptr);
+        CheckSameHit(sphere, sphere, r, t_min, t_max);
+    }
+
+    SECTION("Moving sphere agrees with Hit")
+    {
+        Ray const r = GENERATE(take(500, RandomRayTowardsOrigin()));
+        Vec3 const center_from = center_gen.get();
+        auto center = [=](RealNum t) { return center_from + t * Vec3(Real(0), Real(3), Real(0)); };
+        auto radius = []([[maybe_unused]] RealNum t) { return Real(2.0); };
+        Sphere<decltype(center), decltype(radius)> const sphere(center, radius, nullptr);
+        CheckSameHit(sphere, sphere, r, t_min, t_max);
+    }
+
+    SECTION("HittableList and BoundingVolumeHierarchy agree with Hit")
+    {
+        HittableList list;
+        std::vector<HittableInABox> boxed_spheres;
+        for (int i = 0; i < 25; ++i) {
+            center_gen.next();
+            auto sphere =
+                std::make_shared<Sphere<Vec3, RealNum> >(center_gen.get(), Real(0.7), nullptr);
+            HittableInABox& added = boxed_spheres.emplace_back(AxesAlignedBoundingBox(), sphere);
+            sphere->ComputeBoundingBox(Real(0.0), Real(1.0), added.first);
+            list.Add(std::move(sphere));
+        }
+        BoundingVolumeHierarchy const bvh(boxed_spheres, Real(0.0), Real(1.0));
+
+        Ray const r = GENERATE(take(500, RandomRayTowardsOrigin()));
+        CheckSameHit(list, list, r, t_min, t_max);
+        CheckSameHit(bvh, list, r, t_min, t_max);
+    }
+}
+
+TEST_CASE("HitExcluding : BoundingVolumeHierarchy x Ray x RealNum x RealNum -> bool", "[Occlusion]")
+{
+    Vec3RandomGenerator center_gen(Real(-8.0), Real(8.0));
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+    std::size_t const number_spheres = GENERATE(1U, 2U, 3U, 25U);
+
+    std::vector<HittableInABox> boxed_spheres;
+    for (std::size_t i = 0; i < number_spheres; ++i) {
+        center_gen.next();
+        auto sphere =
+            std::make_shared<Sphere<Vec3, RealNum> >(center_gen.get(), Real(1.5), nullptr);
+        HittableInABox& added = boxed_spheres.emplace_back(AxesAlignedBoundingBox(), sphere);
+        sphere->ComputeBoundingBox(Real(0.0), Real(1.0), added.first);
+    }
+    BoundingVolumeHierarchy const bvh(boxed_spheres, Real(0.0), Real(1.0));
+
+    Ray const r = GENERATE(take(200, RandomRayTowardsOrigin()));
+    HitRecord rec;
+    bool const hit = bvh.Hit(r, t_min, t_max, rec);
+    HitRecord rec_excluding;
+    REQUIRE(bvh.HitExcluding(r, t_min, t_max, number_spheres, nullptr, rec_excluding) == hit);
+    CHECK(bvh.OccludedExcluding(r, t_min, t_max, number_spheres, nullptr) == hit);
+    if (hit) {
+        CHECK(rec_excluding.t == rec.t);
+        REQUIRE(rec_excluding.object != nullptr);
+
+        // Without the hittable hit first, the next hit is further away
+        Hittable const* const excluded = rec_excluding.object;
+        HitRecord next_rec;
+        if (bvh.HitExcluding(r, t_min, t_max, number_spheres, excluded, next_rec)) {
+            CHECK(next_rec.object != excluded);
+            CHECK(next_rec.t >= rec.t);
+        }
+    }
+}
+
+TEST_CASE("OffsetRayOrigin : rays leaving a sphere do not hit it again", "[Occlusion]")
+{
+    Vec3RandomGenerator direction_gen(Real(-1.0), Real(1.0));
+    // Small spheres and big ones, as the ground of most scenes
+    RealNum const radius = GENERATE(Real(0.5), Real(2.0), Real(1000.0));
+    Sphere<Vec3, RealNum> const sphere(
+        Vec3(Real(0.0), Real(1.0) - radius, Real(0.0)), radius, nullptr);
+    RealNum const t_max = std::numeric_limits<RealNum>::max();
+
+    Ray const r = GENERATE(take(2000, RandomRayTowardsOrigin()));
+    HitRecord rec;
+    if (sphere.Hit(r, Real(0.0), t_max, rec)) {
+        Vec3 const direction = direction_gen.get();
+        Point3 const origin = OffsetRayOrigin(rec.p, rec.p_error, rec.normal, direction);
+        Ray const leaving(origin, direction, r.Time());
+        HitRecord leaving_rec;
+        // Rays leaving inwards must still find the other side of the sphere.
+        // Normals face the ray, so they point inwards for hits from inside.
+        bool const inwards = (Dot(direction, rec.normal) < Real(0)) == rec.front_face;
+        CHECK(sphere.Hit(leaving, Real(0.0), t_max, leaving_rec) == inwards);
+    }
+}
+
+}  // namespace plemma::glancy
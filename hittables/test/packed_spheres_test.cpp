@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+#include "brute_force_checks.hpp"
+
+#include "hittable_list.hpp"
+#include "motion.hpp"
+#include "packed_spheres.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("PackedSpheres : same hits than a list of the same spheres", "[PackedSpheres]")
+{
+    Vec3RandomGenerator center_gen(Real(-8.0), Real(8.0));
+    size_t const number_spheres = GENERATE(1, 2, 5, 300);
+    BVHNodeFormat const format = GENERATE(
+        BVHNodeFormat::kFull, BVHNodeFormat::kQuantized16, BVHNodeFormat::kQuantized8);
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+
+    std::vector<Vec3> centers;
+    std::vector<RealNum> radii;
+    std::vector<std::uint32_t> materials;
+    HittableList list;
+    for (size_t i = 0; i < number_spheres; ++i) {
+        center_gen.next();
+        RealNum const radius = Real(0.1) + Real(0.01) * Real(i % 50);
+        centers.push_back(center_gen.get());
+        radii.push_back(radius);
+        materials.push_back(0U);
+        list.Add(std::make_shared<Sphere<Vec3, RealNum> >(center_gen.get(), radius, nullptr));
+    }
+    auto arrays =
+        std::make_shared<PackedSpheresArrays>(PackSpheres(centers, radii, materials, format));
+    PackedSpheres const packed(arrays->View(), {}, arrays);
+    REQUIRE(packed.Size() == number_spheres);
+
+    AxesAlignedBoundingBox list_box;
+    AxesAlignedBoundingBox packed_box;
+    REQUIRE(list.ComputeBoundingBox(Real(0), Real(1), list_box));
+    REQUIRE(packed.ComputeBoundingBox(Real(0), Real(1), packed_box));
+    CHECK(packed_box.Minima() == list_box.Minima());
+    CHECK(packed_box.Maxima() == list_box.Maxima());
+
+    Ray const r = GENERATE(take(1000, RandomRayTowardsOrigin()));
+    HitRecord packed_rec{};
+    HitRecord list_rec{};
+    if (CheckSameHit(packed, list, r, t_min, t_max, packed_rec, list_rec)) {
+        CHECK(packed_rec.p.X() == Approx(list_rec.p.X()));
+        CHECK(packed_rec.normal.Y() == Approx(list_rec.normal.Y()));
+    }
+}
+
+TEST_CASE("PackedSpheres : moving spheres are hit where they are at the time of the ray",
+          "[PackedSpheres]")
+{
+    Vec3RandomGenerator center_gen(Real(-8.0), Real(8.0));
+    Vec3RandomGenerator velocity_gen(Real(-2.0), Real(2.0));
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+    BVHNodeFormat const format = GENERATE(BVHNodeFormat::kFull, BVHNodeFormat::kQuantized8);
+
+    PackedSpheresArrays arrays;
+    HittableList list;
+    for (size_t i = 0; i < 200; ++i) {
+        center_gen.next();
+        velocity_gen.next();
+        RealNum const radius = Real(0.1) + Real(0.01) * Real(i % 50);
+        // Half of the spheres are static
+        Vec3 const velocity = i % 2 == 0 ? velocity_gen.get() : Vec3(Real(0), Real(0), Real(0));
+        arrays.center_x.push_back(center_gen.get().X());
+        arrays.center_y.push_back(center_gen.get().Y());
+        arrays.center_z.push_back(center_gen.get().Z());
+        arrays.radius.push_back(radius);
+        arrays.material.push_back(0U);
+        arrays.velocity_x.push_back(velocity.X());
+        arrays.velocity_y.push_back(velocity.Y());
+        arrays.velocity_z.push_back(velocity.Z());
+        list.Add(std::make_shared<Sphere<LinearMotion, ConstantMagnitude> >(
+            LinearMotion{center_gen.get(), velocity, Real(0)}, ConstantMagnitude{radius}, nullptr));
+    }
+    PackSpheres(arrays, Real(0), Real(1), format);
+    auto const shared_arrays = std::make_shared<PackedSpheresArrays>(std::move(arrays));
+    PackedSpheres const packed(shared_arrays->View(), {}, shared_arrays);
+
+    Ray const r = GENERATE(take(1000, RandomRayTowardsOrigin()));
+    HitRecord packed_rec{};
+    HitRecord list_rec{};
+    if (CheckSameHit(packed, list, r, t_min, t_max, packed_rec, list_rec))
+        CHECK(packed_rec.normal.Y() == Approx(list_rec.normal.Y()));
+}
+
+}  // namespace plemma::glancy
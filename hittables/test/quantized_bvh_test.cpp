@@ -0,0 +1,138 @@
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+
+#include "flat_bvh.hpp"
+#include "quantized_bvh.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+// Checks that every quantized node refers to the same primitives or child
+// as the full one and that its box contains the full one, visiting nodes
+// in the order they are stored
+template <typename Level>
+void CheckQuantizedNodes(std::vector<FlatBVHNode> const& nodes,
+                         std::vector<QuantizedBVHNode<Level> > const& quantized,
+                         AxesAlignedBoundingBox const& bounds)
+{
+    REQUIRE(quantized.size() == nodes.size());
+    std::vector<std::pair<std::uint32_t, AxesAlignedBoundingBox> > stack;
+    std::uint32_t current = 0U;
+    AxesAlignedBoundingBox parent = bounds;
+    while (true) {
+        AxesAlignedBoundingBox const box =
+            quantized_bvh_detail::Dequantize(quantized[current], parent);
+        CHECK(quantized[current].count == nodes[current].count);
+        CHECK(quantized[current].offset == nodes[current].offset);
+        for (int i = 0; i < 3; ++i) {
+            CHECK(box.Minima()[i] <= nodes[current].box.Minima()[i]);
+            CHECK(box.Maxima()[i] >= nodes[current].box.Maxima()[i]);
+        }
+        if (nodes[current].count > 0U) {
+            if (stack.empty())
+                return;
+            current = stack.back().first;
+            parent = stack.back().second;
+            stack.pop_back();
+        }
+        else {
+            stack.emplace_back(nodes[current].offset, box);
+            ++current;
+            parent = box;
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE("QuantizeFlatBVH : quantized boxes contain the full ones", "[QuantizedBVH]")
+{
+    Vec3RandomGenerator center_gen(Real(-1000.0), Real(1000.0));
+    Vec3RandomGenerator extent_gen(Real(0.0), Real(2.0));
+    size_t const number_boxes = GENERATE(1, 2, 7, 2000);
+
+    std::vector<AxesAlignedBoundingBox> boxes;
+    for (size_t i = 0; i < number_boxes; ++i) {
+        center_gen.next();
+        extent_gen.next();
+        // Some boxes are flat, as those of axis aligned triangles
+        Vec3 extent = extent_gen.get();
+        if (i % 5 == 0)
+            extent[static_cast<int>(i % 3)] = Real(0);
+        boxes.emplace_back(center_gen.get() - extent, center_gen.get() + extent);
+    }
+    std::vector<FlatBVHNode> nodes;
+    std::vector<std::uint32_t> order;
+    BuildFlatBVH(boxes, 4U, nodes, order);
+
+    AxesAlignedBoundingBox bounds;
+    std::vector<QuantizedBVHNode16> nodes_16bit;
+    REQUIRE(QuantizeFlatBVH(nodes, nodes_16bit, bounds));
+    CHECK(bounds == nodes[0].box);
+    CheckQuantizedNodes(nodes, nodes_16bit, bounds);
+
+    std::vector<QuantizedBVHNode8> nodes_8bit;
+    REQUIRE(QuantizeFlatBVH(nodes, nodes_8bit, bounds));
+    CheckQuantizedNodes(nodes, nodes_8bit, bounds);
+}
+
+TEST_CASE("TraverseQuantizedBVH : visits every primitive whose box is hit", "[QuantizedBVH]")
+{
+    Vec3RandomGenerator center_gen(Real(-8.0), Real(8.0));
+    Vec3RandomGenerator extent_gen(Real(0.0), Real(1.0));
+    size_t const number_boxes = GENERATE(1, 2, 7, 300);
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+
+    std::vector<AxesAlignedBoundingBox> boxes;
+    for (size_t i = 0; i < number_boxes; ++i) {
+        center_gen.next();
+        extent_gen.next();
+        boxes.emplace_back(center_gen.get() - extent_gen.get(),
+                           center_gen.get() + extent_gen.get());
+    }
+    std::vector<FlatBVHNode> nodes;
+    std::vector<std::uint32_t> order;
+    BuildFlatBVH(boxes, 4U, nodes, order);
+    AxesAlignedBoundingBox bounds;
+    std::vector<QuantizedBVHNode8> quantized;
+    REQUIRE(QuantizeFlatBVH(nodes, quantized, bounds));
+
+    Ray const r = GENERATE(take(1000, RandomRayTowardsOrigin()));
+    std::vector<bool> visited(number_boxes, false);
+    auto const visit = [&order, &visited](
+                           std::uint32_t first, std::uint32_t count, [[maybe_unused]] RealNum& t) {
+        for (std::uint32_t i = first; i < first + count; ++i)
+            visited[order[i]] = true;
+        return false;
+    };
+    CHECK_FALSE(TraverseQuantizedBVH(quantized.data(), bounds, r, t_min, t_max, false, visit));
+    for (std::size_t i = 0; i < number_boxes; ++i) {
+        if (boxes[i].Hit(r, t_min, t_max))
+            CHECK(visited[i]);
+    }
+}
+
+TEST_CASE("QuantizeFlatBVH : fails for leaves too big for quantized nodes", "[QuantizedBVH]")
+{
+    // Boxes sharing their centroid can not be split
+    AxesAlignedBoundingBox const box(Vec3(Real(-1), Real(-1), Real(-1)),
+                                     Vec3(Real(1), Real(1), Real(1)));
+    std::vector<AxesAlignedBoundingBox> const boxes(70000U, box);
+    std::vector<FlatBVHNode> nodes;
+    std::vector<std::uint32_t> order;
+    BuildFlatBVH(boxes, 4U, nodes, order);
+    REQUIRE(nodes.size() == 1U);
+
+    AxesAlignedBoundingBox bounds;
+    std::vector<QuantizedBVHNode8> quantized;
+    CHECK_FALSE(QuantizeFlatBVH(nodes, quantized, bounds));
+    CHECK(quantized.empty());
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+
+#include "spatial_hash_grid.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("SpatialHashGrid : same overlaps than checking all boxes", "[SpatialHashGrid]")
+{
+    Vec3RandomGenerator corner_gen(Real(-20.0), Real(20.0));
+    Vec3RandomGenerator extent_gen(Real(0.0), Real(2.0));
+    RealNum const cell_size = GENERATE(Real(0.5), Real(1.0), Real(4.0));
+
+    SpatialHashGrid grid(cell_size);
+    std::vector<AxesAlignedBoundingBox> boxes;
+    // Oversized box, stored out of the cells
+    boxes.emplace_back(Vec3(Real(-1000), Real(-2000), Real(-1000)),
+                       Vec3(Real(1000), Real(-19), Real(1000)));
+    for (int i = 0; i < 200; ++i) {
+        corner_gen.next();
+        extent_gen.next();
+        boxes.emplace_back(corner_gen.get(), corner_gen.get() + extent_gen.get());
+    }
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+        CHECK(grid.Insert(boxes[i]) == std::uint32_t(i));
+    CHECK(grid.Size() == boxes.size());
+
+    for (int i = 0; i < 500; ++i) {
+        corner_gen.next();
+        extent_gen.next();
+        AxesAlignedBoundingBox const query(corner_gen.get(), corner_gen.get() + extent_gen.get());
+        std::vector<bool> expected(boxes.size());
+        bool any_expected = false;
+        for (std::size_t j = 0; j < boxes.size(); ++j) {
+            expected[j] = DoAABBsOverlap(query, boxes[j]);
+            any_expected = any_expected || expected[j];
+        }
+        CHECK(grid.AnyOverlapping(query) == any_expected);
+
+        // Visiting every reported index must find all the overlapping boxes
+        std::vector<bool> found(boxes.size(), false);
+        grid.AnyOverlapping(query, [&](std::uint32_t index) {
+            found[index] = true;
+            return false;
+        });
+        CHECK(found == expected);
+    }
+}
+
+}  // namespace plemma::glancy
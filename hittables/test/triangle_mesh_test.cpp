@@ -0,0 +1,162 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "aabb_random_generator.hpp"
+#include "brute_force_checks.hpp"
+
+#include "triangle_mesh.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("FindTriangleHit : Vec3^5 x RealNum^2 -> bool", "[TriangleMesh]")
+{
+    Vec3 const v0(Real(0.0), Real(0.0), Real(0.0));
+    Vec3 const v1(Real(1.0), Real(0.0), Real(0.0));
+    Vec3 const v2(Real(0.0), Real(1.0), Real(0.0));
+    Vec3 const direction(Real(0.0), Real(0.0), Real(-1.0));
+    RealNum t = Real(0.0);
+
+    CHECK(FindTriangleHit(Vec3(Real(0.25), Real(0.25), Real(2.0)),
+                          direction,
+                          v0,
+                          v1,
+                          v2,
+                          Real(0.001),
+                          Real(10.0),
+                          t));
+    CHECK(t == Approx(2.0));
+    // Through an edge and out of the triangle
+    CHECK(FindTriangleHit(
+        Vec3(Real(0.5), Real(0.5), Real(2.0)), direction, v0, v1, v2, Real(0.001), Real(10.0), t));
+    CHECK_FALSE(FindTriangleHit(
+        Vec3(Real(0.6), Real(0.6), Real(2.0)), direction, v0, v1, v2, Real(0.001), Real(10.0), t));
+    // Out of the interval of the parameter
+    CHECK_FALSE(FindTriangleHit(Vec3(Real(0.25), Real(0.25), Real(2.0)),
+                                direction,
+                                v0,
+                                v1,
+                                v2,
+                                Real(0.001),
+                                Real(1.0),
+                                t));
+}
+
+TEST_CASE("FindTriangleHit : rays through shared edges and vertices hit", "[TriangleMesh]")
+{
+    // Fan of triangles around a vertex, in a plane out of the ones of the
+    // axes. Rays aimed at the shared vertex or at points of the shared
+    // edges must not slip between the triangles.
+    Vec3RandomGenerator origin_gen(Real(-30.0), Real(30.0));
+    Vec3RandomGenerator fraction_gen(Real(0.0), Real(1.0));
+    Vec3 const center(Real(3.1), Real(-2.7), Real(5.3));
+    Vec3 const axis_u = UnitVector(Vec3(Real(1.0), Real(0.3), Real(-0.2)));
+    Vec3 const axis_v = UnitVector(Cross(Vec3(Real(0.1), Real(0.4), Real(1.0)), axis_u));
+    constexpr std::size_t kFanSize = 7U;
+    std::vector<Vec3> ring;
+    for (std::size_t i = 0; i < kFanSize; ++i) {
+        RealNum const angle = Real(2.0 * 3.14159265358979 * double(i) / double(kFanSize));
+        RealNum const radius = Real(1.0 + 0.5 * double(i % 2U));
+        ring.push_back(center + radius * (std::cos(angle) * axis_u + std::sin(angle) * axis_v));
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        origin_gen.next();
+        fraction_gen.next();
+        std::size_t const edge = std::size_t(i) % kFanSize;
+        Vec3 const target = i % 2 == 0 ? center
+                                       : center + fraction_gen.get().X() * (ring[edge] - center);
+        Ray const r(origin_gen.get(), target - origin_gen.get(), Real(0));
+        bool hit = false;
+        for (std::size_t j = 0; j < kFanSize && !hit; ++j) {
+            RealNum t;
+            hit = FindTriangleHit(r.Origin(),
+                                  r.Direction(),
+                                  center,
+                                  ring[j],
+                                  ring[(j + 1U) % kFanSize],
+                                  Real(0.0),
+                                  Real(10.0),
+                                  t);
+        }
+        CHECK(hit);
+    }
+}
+
+TEST_CASE("TriangleMesh : normals face the incoming ray", "[TriangleMesh]")
+{
+    // Seen counter-clockwise from positive z
+    TriangleMeshBuffers buffers;
+    buffers.vertices = {Vec3(Real(0.0), Real(0.0), Real(0.0)),
+                        Vec3(Real(1.0), Real(0.0), Real(0.0)),
+                        Vec3(Real(0.0), Real(1.0), Real(0.0))};
+    buffers.indices = {0U, 1U, 2U};
+    TriangleMesh const mesh(std::move(buffers), nullptr);
+    RealNum const side = GENERATE(Real(1.0), Real(-1.0));
+    Ray const r(Vec3(Real(0.25), Real(0.25), Real(2.0) * side),
+                Vec3(Real(0.0), Real(0.0), -side),
+                Real(0.0));
+
+    HitRecord rec{};
+    REQUIRE(mesh.Hit(r, Real(0.001), Real(10.0), rec));
+    CHECK(rec.front_face == (side > Real(0.0)));
+    CHECK(rec.normal == Vec3(Real(0.0), Real(0.0), side));
+}
+
+TEST_CASE("TriangleMesh : same hits than testing every triangle", "[TriangleMesh]")
+{
+    Vec3RandomGenerator vertex_gen(Real(-8.0), Real(8.0));
+    Vec3RandomGenerator offset_gen(Real(-1.0), Real(1.0));
+    size_t const number_triangles = GENERATE(1, 2, 7, 500);
+    RealNum const t_min = Real(0.001);
+    RealNum const t_max = Real(1e4);
+
+    // Small triangles, with vertices shared by consecutive ones
+    TriangleMeshBuffers buffers;
+    for (size_t i = 0; i < number_triangles + 2U; ++i) {
+        if (i % 3U == 0U)
+            vertex_gen.next();
+        offset_gen.next();
+        buffers.vertices.push_back(vertex_gen.get() + offset_gen.get());
+    }
+    for (size_t i = 0; i < number_triangles; ++i) {
+        buffers.indices.push_back(static_cast<std::uint32_t>(i));
+        buffers.indices.push_back(static_cast<std::uint32_t>(i + 1U));
+        buffers.indices.push_back(static_cast<std::uint32_t>(i + 2U));
+    }
+    // Triangles referring to missing vertices are dropped
+    buffers.indices.insert(buffers.indices.end(), {0U, 1U, 100000U});
+    TriangleMeshBuffers const copy = buffers;
+    TriangleMesh const mesh(std::move(buffers), nullptr);
+    REQUIRE(mesh.NumberOfTriangles() == number_triangles);
+
+    auto const every_triangle = [&copy, number_triangles](
+                                    Ray const& r, RealNum t_min, RealNum t_max, HitRecord& rec) {
+        bool hit = false;
+        for (size_t j = 0; j < number_triangles; ++j) {
+            RealNum t;
+            if (FindTriangleHit(r.Origin(),
+                                r.Direction(),
+                                copy.vertices[j],
+                                copy.vertices[j + 1U],
+                                copy.vertices[j + 2U],
+                                t_min,
+                                t_max,
+                                t)) {
+                hit = true;
+                t_max = t;
+                rec.t = t;
+            }
+        }
+        return hit;
+    };
+    Ray const r = GENERATE(take(1000, RandomRayTowardsOrigin()));
+    HitRecord rec{};
+    HitRecord brute_force_rec{};
+    if (CheckSameHit(mesh, every_triangle, r, t_min, t_max, rec, brute_force_rec))
+        CHECK(rec.normal.Norm() == Approx(1.0));
+}
+
+}  // namespace plemma::glancy
@@ -10,83 +10,111 @@
 
 namespace plemma::glancy {
 
-// Class implementing material of type Dielectric. Objects of
-// such type of material are characterized by the following
-// property with respect to interaction with light:
-// - when a ray hits them, it splits into a reflected and
-// a refracted ray. In this implementation, we will choose
-// randomly which of the two resulting rays to follow after
-// the split for each ray that hits the object.
-
-// Remember that ri = c/v, where c is the speed of light in vacuum
+// Scattering model of dielectrics, shared by the Dielectric classes and
+// their flat counterpart in MaterialTable. When a ray hits them, it splits
+// into a reflected and a refracted ray. In this implementation, we choose
+// randomly which of the two resulting rays to follow after the split for
+// each ray that hits the object:
+// - Weight is always (1, 1, 1) (which means "no attenuation")
+// - Scattered ray is chosen randomly between a reflected and
+//   a refracted ray. In the case the refracted ray doesn't exist,
+//   we choose the reflected one with probability 1. See method
+//   `bool Refract(const Vec3& v, const Vec3& n, RealNum ni_over_nt, Vec3& refracted)`
+//   for more information
+// - Both candidates are specular directions, so pdf is 0
+inline bool SampleDielectric(RealNum refractive_index,
+                             Ray const& ray_in,
+                             HitRecord const& rec,
+                             ScatterSample& sample)
+{
+    Vec3 const reflected = Reflect(ray_in.Direction(), rec.normal);
+    RealNum ni_over_nt;
+    sample.weight = Vec3(Real(1), Real(1), Real(1));
+    sample.pdf = Real(0);
+    Vec3 refracted;
+    RealNum reflect_prob;
+    RealNum cosine;
+    // The normal faces the ray, which leaves the dielectric if it hit the
+    // back of its surface
+    RealNum const cos_in = -Dot(ray_in.Direction(), rec.normal) / ray_in.Direction().Norm();
+    if (!rec.front_face) {
+        ni_over_nt = refractive_index;
+        cosine = refractive_index * cos_in;
+    }
+    else {
+        ni_over_nt = Real(1) / refractive_index;
+        cosine = cos_in;
+    }
+
+    if (Refract(ray_in.Direction(), rec.normal, ni_over_nt, refracted)) {
+        reflect_prob = utilities::Schlick(cosine, refractive_index);
+    }
+    else {
+        reflect_prob = Real(1);
+    }
+
+    std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
+
+    if (distribution(my_engine()) < reflect_prob) {
+        sample.direction = reflected;
+    }
+    else {
+        sample.direction = refracted;
+    }
+    return true;
+}
+
+// Common base of all dielectrics, which only differ in their refractive
+// index. Remember that ri = c/v, where c is the speed of light in vacuum
 // and v is the phase velocity of light in the medium (material).
-// That means ri >= 1.0
-template <int refractive_index_numerator, int refractive_index_denominator>
-class Dielectric : public Material
+// That means ri >= 1.0. Its scattering can not be overridden, so that
+// MaterialTable flattens every dielectric.
+class RefractiveMaterial : public Material
 {
   public:
-    Dielectric()
-        : refractive_index_{Real(refractive_index_numerator) / Real(refractive_index_denominator)}
-    {}
-    // Returns false if the ray is absorbed by this material
-    // and true otherwise. It also computes the scattered ray
-    // resulting from the interaction between ray and material
-    // and the attenuation that should be applied to the
-    // computed color.
-    // In the case of dielectrics:
-    // - Return value is always true, rays are never absorbed.
-    // - Attenuation is always (1, 1, 1) (which means "no attenuation")
-    // - Scattered ray is chosen randomly between a reflected and
-    //   a refracted ray. In the case the refracted ray doesn't exist,
-    //   we choose the reflected one with probability 1. See method
-    //   `bool Refract(const Vec3& v, const Vec3& n, RealNum ni_over_nt, Vec3& refracted)`
-    //   for more information
-    bool Scatter(Ray const& ray_in,
-                 HitRecord const& rec,
-                 Vec3& attenuation,
-                 Ray& scattered_ray) const override
+    explicit RefractiveMaterial(RealNum refractive_index) : refractive_index_{refractive_index} {}
+
+    bool Sample(Ray const& ray_in, HitRecord const& rec, ScatterSample& sample) const final
+    {
+        return SampleDielectric(refractive_index_, ray_in, rec, sample);
+    }
+
+    [[nodiscard]] Vec3 Evaluate(Ray const& ray_in,
+                                HitRecord const& rec,
+                                Vec3 const& direction) const final
+    {
+        return Material::Evaluate(ray_in, rec, direction);
+    }
+
+    [[nodiscard]] RealNum Pdf(Ray const& ray_in,
+                              HitRecord const& rec,
+                              Vec3 const& direction) const final
+    {
+        return Material::Pdf(ray_in, rec, direction);
+    }
+
+    [[nodiscard]] Vec3 Emitted(Ray const& ray_in, HitRecord const& rec) const final
     {
-        Vec3 outward_normal;
-        Vec3 const reflected = Reflect(ray_in.Direction(), rec.normal);
-        RealNum ni_over_nt;
-        attenuation = Vec3(Real(1), Real(1), Real(1));
-        Vec3 refracted;
-        RealNum reflect_prob;
-        RealNum cosine;
-        if (Dot(ray_in.Direction(), rec.normal) > Real(0)) {
-            outward_normal = -rec.normal;
-            ni_over_nt = refractive_index_;
-            cosine =
-                refractive_index_ * Dot(ray_in.Direction(), rec.normal) / ray_in.Direction().Norm();
-        }
-        else {
-            outward_normal = rec.normal;
-            ni_over_nt = Real(1) / refractive_index_;
-            cosine = -Dot(ray_in.Direction(), rec.normal) / ray_in.Direction().Norm();
-        }
-
-        if (Refract(ray_in.Direction(), outward_normal, ni_over_nt, refracted)) {
-            reflect_prob = utilities::Schlick(cosine, refractive_index_);
-        }
-        else {
-            reflect_prob = Real(1);
-        }
-
-        std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
-
-        if (distribution(my_engine()) < reflect_prob) {
-            scattered_ray = Ray(rec.p, reflected, ray_in.Time());
-        }
-        else {
-            scattered_ray = Ray(rec.p, refracted, ray_in.Time());
-        }
-        return true;
+        return Material::Emitted(ray_in, rec);
     }
 
+    [[nodiscard]] RealNum RefractiveIndex() const noexcept { return refractive_index_; }
+
   private:
     RealNum const refractive_index_;
 };
 
+// Dielectric with a refractive index known at compile time
+template <int refractive_index_numerator, int refractive_index_denominator>
+class Dielectric : public RefractiveMaterial
+{
+  public:
+    Dielectric()
+        : RefractiveMaterial{Real(refractive_index_numerator) /
+                             Real(refractive_index_denominator)}
+    {}
+};
+
 // Refractive index of vacuum = 1
 constexpr int kRefractiveIndexVacuumNum = 1;
 constexpr int kRefractiveIndexVacuumDen = 1;
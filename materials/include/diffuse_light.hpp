@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include "hittable.hpp"
+#include "material.hpp"
+#include "ray.hpp"
+#include "texture.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Emissive material. It does not scatter any ray and emits light given by
+// a texture from the side the normal points to. Hittables made of it should
+// be added to the lights of the scene so that the renderer samples them.
+class DiffuseLight : public Material
+{
+  public:
+    explicit DiffuseLight(std::shared_ptr<Texture> emit) : emit_(std::move(emit)) {}
+
+    bool Sample([[maybe_unused]] Ray const& ray_in,
+                [[maybe_unused]] HitRecord const& rec,
+                [[maybe_unused]] ScatterSample& sample) const override
+    {
+        return false;
+    }
+
+    // Lights only emit from the side they face
+    [[nodiscard]] Vec3 Emitted([[maybe_unused]] Ray const& ray_in,
+                               HitRecord const& rec) const override
+    {
+        if (!rec.front_face)
+            return Vec3(Real(0), Real(0), Real(0));
+        return emit_->GetValue(Real(0), Real(0), rec.p.ToVec3());
+    }
+
+    [[nodiscard]] std::shared_ptr<Texture> const& Emit() const noexcept { return emit_; }
+
+  private:
+    std::shared_ptr<Texture> emit_;
+};
+
+}  // namespace plemma::glancy
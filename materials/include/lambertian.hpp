@@ -1,31 +1,80 @@
 #pragma once
 
+#include "constants.hpp"
 #include "hittable.hpp"
 #include "material.hpp"
+#include "orthonormal_basis.hpp"
 #include "rand_engine.hpp"
 #include "ray.hpp"
 #include "texture.hpp"
 #include "vec3.hpp"
 
+#include <cmath>
 #include <memory>
+#include <random>
 
 namespace plemma::glancy {
 
+// Scattering model of Lambertian surfaces, shared by the Lambertian class
+// and its flat counterpart in MaterialTable.
+
+// Density of the cosine distribution around the normal: cos(theta) / pi
+inline RealNum LambertianPdf(HitRecord const& rec, Vec3 const& direction) noexcept
+{
+    RealNum const cosine = Dot(rec.normal, UnitVector(direction));
+    return cosine > Real(0) ? cosine / constants::kPi : Real(0);
+}
+
+// Importance samples the cosine distribution around the normal
+inline bool SampleLambertian(Vec3 const& albedo, HitRecord const& rec, ScatterSample& sample)
+{
+    std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
+    RealNum const phi = Real(2) * constants::kPi * distribution(my_engine());
+    RealNum const r2 = distribution(my_engine());
+    RealNum const sqrt_r2 = std::sqrt(r2);
+    RealNum const cosine = std::sqrt(Real(1) - r2);
+    OrthonormalBasis const basis(rec.normal);
+    sample.direction = basis.Local(std::cos(phi) * sqrt_r2, std::sin(phi) * sqrt_r2, cosine);
+    sample.weight = albedo;
+    sample.pdf = cosine / constants::kPi;
+    return sample.pdf > Real(0);
+}
+
+// Ideal diffuse material. Scattered directions are importance sampled
+// with a cosine distribution around the normal, which is exactly the
+// distribution of light reflected by a Lambertian surface, so the
+// weight of every sample is just the albedo.
 class Lambertian : public Material
 {
   public:
     explicit Lambertian(std::shared_ptr<Texture> alb) : albedo_(alb) {}
-    bool Scatter(Ray const& ray_in,
-                 HitRecord const& rec,
-                 Vec3& attenuation,
-                 Ray& scattered_ray) const override
+
+    bool Sample([[maybe_unused]] Ray const& ray_in,
+                HitRecord const& rec,
+                ScatterSample& sample) const override
     {
-        Vec3 direction = rec.normal + GetRandomPointInUnitBall();
-        scattered_ray = Ray(rec.p, direction, ray_in.Time());
-        attenuation = albedo_->GetValue(Real(0.0), Real(0.0), rec.p);
-        return true;
+        Vec3 const albedo = albedo_->GetValue(Real(0.0), Real(0.0), rec.p.ToVec3());
+        return SampleLambertian(albedo, rec, sample);
     }
 
+    // albedo / pi * cos(theta)
+    [[nodiscard]] Vec3 Evaluate([[maybe_unused]] Ray const& ray_in,
+                                HitRecord const& rec,
+                                Vec3 const& direction) const override
+    {
+        return LambertianPdf(rec, direction) *
+               albedo_->GetValue(Real(0.0), Real(0.0), rec.p.ToVec3());
+    }
+
+    [[nodiscard]] RealNum Pdf([[maybe_unused]] Ray const& ray_in,
+                              HitRecord const& rec,
+                              Vec3 const& direction) const override
+    {
+        return LambertianPdf(rec, direction);
+    }
+
+    [[nodiscard]] std::shared_ptr<Texture> const& Albedo() const noexcept { return albedo_; }
+
   private:
     std::shared_ptr<Texture> albedo_;
 };
@@ -6,13 +6,72 @@
 
 namespace plemma::glancy {
 
+// Outcome of sampling the scattering of a ray by a material
+struct ScatterSample
+{
+    // Direction of the scattered ray (not necessarily unit)
+    Vec3 direction;
+    // Factor to apply to the light coming from 'direction', i.e. the
+    // BSDF times the cosine with the normal divided by 'pdf'
+    Vec3 weight;
+    // Density (w.r.t. solid angle) with which 'direction' was chosen,
+    // or 0 if it was chosen from a discrete set of directions (specular)
+    RealNum pdf;
+};
+
 class Material
 {
   public:
-    virtual bool Scatter(Ray const& ray_in,
-                         HitRecord const& rec,
-                         Vec3& attenuation,
-                         Ray& scattered_ray) const = 0;
+    // Chooses randomly a direction for the scattered ray. Returns false
+    // if the ray is absorbed instead.
+    virtual bool Sample(Ray const& ray_in, HitRecord const& rec, ScatterSample& sample) const = 0;
+
+    // BSDF for light coming from 'direction' and leaving towards the
+    // origin of 'ray_in', times the cosine of 'direction' with the normal.
+    // Specular materials (default) return black for any direction.
+    [[nodiscard]] virtual Vec3 Evaluate([[maybe_unused]] Ray const& ray_in,
+                                        [[maybe_unused]] HitRecord const& rec,
+                                        [[maybe_unused]] Vec3 const& direction) const
+    {
+        return Vec3(Real(0), Real(0), Real(0));
+    }
+
+    // Density (w.r.t. solid angle) with which Sample would choose
+    // 'direction'. Specular materials (default) return 0, which tells the
+    // renderer that their scattering can not be combined with light sampling.
+    [[nodiscard]] virtual RealNum Pdf([[maybe_unused]] Ray const& ray_in,
+                                      [[maybe_unused]] HitRecord const& rec,
+                                      [[maybe_unused]] Vec3 const& direction) const
+    {
+        return Real(0);
+    }
+
+    // Light emitted by the material at the point of 'rec' towards the
+    // origin of 'ray_in'. Non-emissive materials (default) return black.
+    [[nodiscard]] virtual Vec3 Emitted([[maybe_unused]] Ray const& ray_in,
+                                       [[maybe_unused]] HitRecord const& rec) const
+    {
+        return Vec3(Real(0), Real(0), Real(0));
+    }
+
+    // Returns false if the ray is absorbed by this material and true
+    // otherwise. It also computes the scattered ray resulting from the
+    // interaction between ray and material and the attenuation that
+    // should be applied to the computed color.
+    bool Scatter(Ray const& ray_in,
+                 HitRecord const& rec,
+                 Vec3& attenuation,
+                 Ray& scattered_ray) const
+    {
+        ScatterSample sample;
+        if (!Sample(ray_in, rec, sample))
+            return false;
+        scattered_ray = Ray(rec.p, sample.direction, ray_in.Time());
+        attenuation = sample.weight;
+        return true;
+    }
+
+    virtual ~Material() = default;
 };
 
 }  // namespace plemma::glancy
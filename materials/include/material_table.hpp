@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "dielectric.hpp"
+#include "diffuse_light.hpp"
+#include "hittable.hpp"
+#include "lambertian.hpp"
+#include "material.hpp"
+#include "metal.hpp"
+#include "ray.hpp"
+#include "texture_table.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Flat counterparts of the materials in this library. Textures are referred
+// to by their id in the TextureTable of the MaterialTable owning them.
+struct FlatLambertian
+{
+    TextureId albedo;
+};
+
+struct FlatMetal
+{
+    Vec3 albedo;
+    RealNum fuzz;
+};
+
+struct FlatDielectric
+{
+    RealNum refractive_index;
+};
+
+struct FlatDiffuseLight
+{
+    TextureId emit;
+};
+
+// Materials out of the closed set above (user defined ones, subclasses of
+// library ones, or library ones with textures that can not be flattened)
+// keep being dispatched through their virtual interface
+using ExternalMaterial = Material const*;
+
+using FlatMaterial = std::
+    variant<FlatLambertian, FlatMetal, FlatDielectric, FlatDiffuseLight, ExternalMaterial>;
+
+// Contiguous storage of the materials of a scene, so that shading a hit
+// dispatches with a switch over a small closed set of types (std::visit)
+// instead of a virtual call through a pointer to wherever the material
+// was allocated. It is compiled from the class hierarchy once, when the
+// scene is loaded (see Scene::BindMaterials and Hittable::BindMaterials),
+// so scenes keep being described with the extensible Material and Texture
+// classes.
+class MaterialTable
+{
+  public:
+    // Returns the id of 'material' in the table, flattening it the first
+    // time it is added.
+    MaterialId Add(Material const& material);
+
+    void Clear() noexcept
+    {
+        materials_.clear();
+        ids_.clear();
+        textures_ = TextureTable();
+    }
+
+    [[nodiscard]] std::size_t Size() const noexcept { return materials_.size(); }
+
+    // Flattened materials, indexed by their id, and the textures they use
+    [[nodiscard]] std::vector<FlatMaterial> const& Materials() const noexcept
+    {
+        return materials_;
+    }
+    [[nodiscard]] TextureTable const& Textures() const noexcept { return textures_; }
+
+    // Same as the homonymous methods of Material, for the material of
+    // 'rec'. Hits without a material of the table (hittables without
+    // material or not bound to it) absorb every ray and emit nothing.
+    bool Sample(Ray const& ray_in, HitRecord const& rec, ScatterSample& sample) const;
+    [[nodiscard]] Vec3 Evaluate(Ray const& ray_in,
+                                HitRecord const& rec,
+                                Vec3 const& direction) const;
+    [[nodiscard]] RealNum Pdf(Ray const& ray_in,
+                              HitRecord const& rec,
+                              Vec3 const& direction) const;
+    [[nodiscard]] Vec3 Emitted(Ray const& ray_in, HitRecord const& rec) const;
+
+  private:
+    template <typename Visitor>
+    decltype(auto) Visit(HitRecord const& rec, Visitor&& visitor) const
+    {
+        if (rec.material_id >= materials_.size())
+            return visitor(ExternalMaterial{nullptr});
+        return std::visit(std::forward<Visitor>(visitor), materials_[rec.material_id]);
+    }
+
+    std::vector<FlatMaterial> materials_;
+    std::unordered_map<Material const*, MaterialId> ids_;
+    TextureTable textures_;
+};
+
+inline MaterialId MaterialTable::Add(Material const& material)
+{
+    auto const it = ids_.find(&material);
+    if (it != ids_.end())
+        return it->second;
+
+    // Only the exact library classes are flattened, since subclasses of
+    // them may override the scattering. Dielectrics can not (see
+    // RefractiveMaterial), so all of them are.
+    FlatMaterial flat = ExternalMaterial{&material};
+    std::type_info const& type = typeid(material);
+    if (type == typeid(Lambertian)) {
+        auto const& lambertian = static_cast<Lambertian const&>(material);
+        TextureId const albedo =
+            lambertian.Albedo() ? textures_.Add(*lambertian.Albedo()) : kInvalidTextureId;
+        if (albedo != kInvalidTextureId)
+            flat = FlatLambertian{albedo};
+    }
+    else if (type == typeid(Metal)) {
+        auto const& metal = static_cast<Metal const&>(material);
+        flat = FlatMetal{metal.Albedo(), metal.Fuzz()};
+    }
+    else if (auto const* refractive = dynamic_cast<RefractiveMaterial const*>(&material)) {
+        flat = FlatDielectric{refractive->RefractiveIndex()};
+    }
+    else if (type == typeid(DiffuseLight)) {
+        auto const& light = static_cast<DiffuseLight const&>(material);
+        TextureId const emit = light.Emit() ? textures_.Add(*light.Emit()) : kInvalidTextureId;
+        if (emit != kInvalidTextureId)
+            flat = FlatDiffuseLight{emit};
+    }
+
+    auto const id = static_cast<MaterialId>(materials_.size());
+    materials_.push_back(flat);
+    ids_.emplace(&material, id);
+    return id;
+}
+
+inline bool MaterialTable::Sample(Ray const& ray_in,
+                                  HitRecord const& rec,
+                                  ScatterSample& sample) const
+{
+    return Visit(rec, [&](auto const& material) -> bool {
+        using Type = std::decay_t<decltype(material)>;
+        if constexpr (std::is_same_v<Type, FlatLambertian>)
+            return SampleLambertian(
+                textures_.Value(material.albedo, Real(0), Real(0), rec.p.ToVec3()), rec, sample);
+        else if constexpr (std::is_same_v<Type, FlatMetal>)
+            return SampleMetal(material.albedo, material.fuzz, ray_in, rec, sample);
+        else if constexpr (std::is_same_v<Type, FlatDielectric>)
+            return SampleDielectric(material.refractive_index, ray_in, rec, sample);
+        else if constexpr (std::is_same_v<Type, FlatDiffuseLight>)
+            return false;
+        else
+            return material != nullptr && material->Sample(ray_in, rec, sample);
+    });
+}
+
+inline Vec3 MaterialTable::Evaluate(Ray const& ray_in,
+                                    HitRecord const& rec,
+                                    Vec3 const& direction) const
+{
+    return Visit(rec, [&](auto const& material) -> Vec3 {
+        using Type = std::decay_t<decltype(material)>;
+        if constexpr (std::is_same_v<Type, FlatLambertian>)
+            return LambertianPdf(rec, direction) *
+                   textures_.Value(material.albedo, Real(0), Real(0), rec.p.ToVec3());
+        else if constexpr (std::is_same_v<Type, FlatMetal>)
+            return EvaluateMetal(material.albedo, material.fuzz, ray_in, rec, direction);
+        else if constexpr (std::is_same_v<Type, ExternalMaterial>)
+            return material != nullptr ? material->Evaluate(ray_in, rec, direction)
+                                       : Vec3(Real(0), Real(0), Real(0));
+        else
+            return Vec3(Real(0), Real(0), Real(0));
+    });
+}
+
+inline RealNum MaterialTable::Pdf(Ray const& ray_in,
+                                  HitRecord const& rec,
+                                  Vec3 const& direction) const
+{
+    return Visit(rec, [&](auto const& material) -> RealNum {
+        using Type = std::decay_t<decltype(material)>;
+        if constexpr (std::is_same_v<Type, FlatLambertian>)
+            return LambertianPdf(rec, direction);
+        else if constexpr (std::is_same_v<Type, FlatMetal>)
+            return MetalPdf(material.fuzz, ray_in, rec, direction);
+        else if constexpr (std::is_same_v<Type, ExternalMaterial>)
+            return material != nullptr ? material->Pdf(ray_in, rec, direction) : Real(0);
+        else
+            return Real(0);
+    });
+}
+
+inline Vec3 MaterialTable::Emitted(Ray const& ray_in, HitRecord const& rec) const
+{
+    return Visit(rec, [&](auto const& material) -> Vec3 {
+        using Type = std::decay_t<decltype(material)>;
+        if constexpr (std::is_same_v<Type, FlatDiffuseLight>) {
+            if (!rec.front_face)
+                return Vec3(Real(0), Real(0), Real(0));
+            return textures_.Value(material.emit, Real(0), Real(0), rec.p.ToVec3());
+        }
+        else if constexpr (std::is_same_v<Type, ExternalMaterial>)
+            return material != nullptr ? material->Emitted(ray_in, rec)
+                                       : Vec3(Real(0), Real(0), Real(0));
+        else
+            return Vec3(Real(0), Real(0), Real(0));
+    });
+}
+
+}  // namespace plemma::glancy
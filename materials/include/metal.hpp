@@ -1,28 +1,163 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "constants.hpp"
 #include "material.hpp"
+#include "orthonormal_basis.hpp"
 #include "rand_engine.hpp"
 #include "ray.hpp"
 #include "vec3.hpp"
 
 namespace plemma::glancy {
 
+// Scattering model of metals, shared by the Metal class and its flat
+// counterpart in MaterialTable. Fuzziness 0 gives a perfect mirror.
+// Otherwise it is modelled as a rough conductor with a GGX
+// (Trowbridge-Reitz) microfacet distribution whose roughness parameter
+// alpha is the fuzziness, Smith masking-shadowing and Schlick's Fresnel
+// approximation with the albedo as reflectance at normal incidence.
+// Microfacet normals are importance sampled with density D(h) cos(theta_h).
+namespace ggx {
+
+// Normal distribution function D(h)
+inline RealNum Distribution(RealNum alpha, RealNum cos_theta_h) noexcept
+{
+    RealNum const alpha_sq = alpha * alpha;
+    RealNum const denominator = cos_theta_h * cos_theta_h * (alpha_sq - Real(1)) + Real(1);
+    return alpha_sq / (constants::kPi * denominator * denominator);
+}
+
+// Separable Smith masking-shadowing function G(wo, wi)
+inline RealNum MaskingShadowing(RealNum alpha, RealNum cos_out, RealNum cos_in) noexcept
+{
+    RealNum const alpha_sq = alpha * alpha;
+    auto const g1 = [alpha_sq](RealNum cosine) {
+        return Real(2) * cosine /
+               (cosine + std::sqrt(alpha_sq + (Real(1) - alpha_sq) * cosine * cosine));
+    };
+    return g1(cos_out) * g1(cos_in);
+}
+
+// Schlick's approximation with 'albedo' as reflectance at normal incidence
+inline Vec3 Fresnel(Vec3 const& albedo, RealNum cosine) noexcept
+{
+    RealNum const factor = std::pow(Real(1) - std::max(Real(0), cosine), Real(5));
+    return albedo + factor * (Vec3(Real(1), Real(1), Real(1)) - albedo);
+}
+
+}  // namespace ggx
+
+inline bool SampleMetal(Vec3 const& albedo,
+                        RealNum fuzz,
+                        Ray const& ray_in,
+                        HitRecord const& rec,
+                        ScatterSample& sample)
+{
+    Vec3 const to_viewer = -UnitVector(ray_in.Direction());
+    if (fuzz <= Real(0)) {
+        sample.direction = Reflect(-to_viewer, rec.normal);
+        sample.weight = albedo;
+        sample.pdf = Real(0);
+        return (Dot(sample.direction, rec.normal) > Real(0));
+    }
+
+    std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
+    RealNum const r1 = distribution(my_engine());
+    RealNum const phi = Real(2) * constants::kPi * distribution(my_engine());
+    RealNum const cos_theta_h =
+        std::sqrt((Real(1) - r1) / (Real(1) + (fuzz * fuzz - Real(1)) * r1));
+    RealNum const sin_theta_h = std::sqrt(std::max(Real(0), Real(1) - cos_theta_h * cos_theta_h));
+    OrthonormalBasis const basis(rec.normal);
+    Vec3 const half_vector =
+        basis.Local(sin_theta_h * std::cos(phi), sin_theta_h * std::sin(phi), cos_theta_h);
+
+    sample.direction = Reflect(-to_viewer, half_vector);
+    RealNum const cos_out = Dot(rec.normal, to_viewer);
+    RealNum const cos_in = Dot(rec.normal, sample.direction);
+    RealNum const cos_half = Dot(to_viewer, half_vector);
+    if (cos_out <= Real(0) || cos_in <= Real(0) || cos_half <= Real(0))
+        return false;
+
+    sample.pdf = ggx::Distribution(fuzz, cos_theta_h) * cos_theta_h / (Real(4) * cos_half);
+    // BSDF * cos_in / pdf simplifies to F * G * |wo.h| / (cos_out * cos_h)
+    sample.weight =
+        (ggx::MaskingShadowing(fuzz, cos_out, cos_in) * cos_half / (cos_out * cos_theta_h)) *
+        ggx::Fresnel(albedo, cos_half);
+    return true;
+}
+
+inline Vec3 EvaluateMetal(Vec3 const& albedo,
+                          RealNum fuzz,
+                          Ray const& ray_in,
+                          HitRecord const& rec,
+                          Vec3 const& direction)
+{
+    Vec3 const black(Real(0), Real(0), Real(0));
+    if (fuzz <= Real(0))
+        return black;
+    Vec3 const to_viewer = -UnitVector(ray_in.Direction());
+    Vec3 const to_light = UnitVector(direction);
+    RealNum const cos_out = Dot(rec.normal, to_viewer);
+    RealNum const cos_in = Dot(rec.normal, to_light);
+    if (cos_out <= Real(0) || cos_in <= Real(0))
+        return black;
+    Vec3 const half_vector = UnitVector(to_viewer + to_light);
+    RealNum const cos_theta_h = Dot(rec.normal, half_vector);
+    RealNum const cos_half = Dot(to_viewer, half_vector);
+    // F * D * G / (4 * cos_out * cos_in) * cos_in
+    return (ggx::Distribution(fuzz, cos_theta_h) * ggx::MaskingShadowing(fuzz, cos_out, cos_in) /
+            (Real(4) * cos_out)) *
+           ggx::Fresnel(albedo, cos_half);
+}
+
+inline RealNum MetalPdf(RealNum fuzz,
+                        Ray const& ray_in,
+                        HitRecord const& rec,
+                        Vec3 const& direction)
+{
+    if (fuzz <= Real(0))
+        return Real(0);
+    Vec3 const to_viewer = -UnitVector(ray_in.Direction());
+    Vec3 const to_light = UnitVector(direction);
+    if (Dot(rec.normal, to_viewer) <= Real(0) || Dot(rec.normal, to_light) <= Real(0))
+        return Real(0);
+    Vec3 const half_vector = UnitVector(to_viewer + to_light);
+    RealNum const cos_theta_h = Dot(rec.normal, half_vector);
+    RealNum const cos_half = Dot(to_viewer, half_vector);
+    if (cos_theta_h <= Real(0) || cos_half <= Real(0))
+        return Real(0);
+    return ggx::Distribution(fuzz, cos_theta_h) * cos_theta_h / (Real(4) * cos_half);
+}
+
 class Metal : public Material
 {
   public:
     Metal(Vec3 const& alb, RealNum f) : albedo_(alb), fuzz_(std::min(f, Real(1))) {}
 
-    bool Scatter(Ray const& ray_in,
-                 HitRecord const& rec,
-                 Vec3& attenuation,
-                 Ray& scattered_ray) const override
+    bool Sample(Ray const& ray_in, HitRecord const& rec, ScatterSample& sample) const override
+    {
+        return SampleMetal(albedo_, fuzz_, ray_in, rec, sample);
+    }
+
+    [[nodiscard]] Vec3 Evaluate(Ray const& ray_in,
+                                HitRecord const& rec,
+                                Vec3 const& direction) const override
+    {
+        return EvaluateMetal(albedo_, fuzz_, ray_in, rec, direction);
+    }
+
+    [[nodiscard]] RealNum Pdf(Ray const& ray_in,
+                              HitRecord const& rec,
+                              Vec3 const& direction) const override
     {
-        Vec3 const reflected = Reflect(UnitVector(ray_in.Direction()), rec.normal);
-        scattered_ray = Ray(rec.p, reflected + fuzz_ * GetRandomPointInUnitBall(), ray_in.Time());
-        attenuation = albedo_;
-        return (Dot(scattered_ray.Direction(), rec.normal) > Real(0));
+        return MetalPdf(fuzz_, ray_in, rec, direction);
     }
 
+    [[nodiscard]] Vec3 const& Albedo() const noexcept { return albedo_; }
+    [[nodiscard]] RealNum Fuzz() const noexcept { return fuzz_; }
+
     // https://en.wikipedia.org/wiki/Albedo
   private:
     Vec3 albedo_;
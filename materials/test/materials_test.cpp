@@ -0,0 +1,5 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+// Catch provides its own main(), we only use this file as starting
+// point for our tests
@@ -0,0 +1,207 @@
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include "catch.hpp"
+
+#include "constant_texture.hpp"
+#include "constants.hpp"
+#include "lambertian.hpp"
+#include "metal.hpp"
+#include "rand_engine.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+constexpr int kSampleCount = 200000;
+
+// Hit at the origin of a surface facing +z, by a ray coming from a
+// direction making an angle of cosine 'cos_out' with the normal
+struct Incidence
+{
+    explicit Incidence(RealNum cos_out)
+    {
+        RealNum const sin_out = std::sqrt(Real(1) - cos_out * cos_out);
+        Vec3 const to_viewer(sin_out, Real(0), cos_out);
+        ray_in = Ray(Point3(to_viewer), -to_viewer, Real(0));
+        rec.t = Real(1);
+        rec.p = Point3(Real(0), Real(0), Real(0));
+        rec.normal = Vec3(Real(0), Real(0), Real(1));
+    }
+
+    Ray ray_in;
+    HitRecord rec{};
+};
+
+// Direction drawn uniformly from the unit sphere, of density 1 / (4 pi)
+Vec3 UniformDirection()
+{
+    std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
+    RealNum const z = Real(1) - Real(2) * distribution(my_engine());
+    RealNum const phi = Real(2) * constants::kPi * distribution(my_engine());
+    RealNum const r = std::sqrt(std::max(Real(0), Real(1) - z * z));
+    return Vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// Monte Carlo estimates, over the whole sphere of directions, of the
+// integrals of Pdf and Evaluate, with the same directions for both
+struct Integrals
+{
+    double pdf = 0.0;
+    Vec3 evaluate;
+};
+
+Integrals Integrate(Material const& material, Incidence const& incidence)
+{
+    double pdf_sum = 0.0;
+    double evaluate_sum[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < kSampleCount; ++i) {
+        Vec3 const direction = UniformDirection();
+        pdf_sum += double(material.Pdf(incidence.ray_in, incidence.rec, direction));
+        Vec3 const value = material.Evaluate(incidence.ray_in, incidence.rec, direction);
+        for (int c = 0; c < 3; ++c)
+            evaluate_sum[c] += double(value[c]);
+    }
+    double const scale = 4.0 * double(constants::kPi) / double(kSampleCount);
+    Integrals integrals;
+    integrals.pdf = pdf_sum * scale;
+    integrals.evaluate = Vec3(Real(evaluate_sum[0] * scale),
+                              Real(evaluate_sum[1] * scale),
+                              Real(evaluate_sum[2] * scale));
+    return integrals;
+}
+
+// Outcome of drawing many samples with Sample: the fraction of rays that
+// are scattered and the mean weight, counting absorbed rays as black
+struct Sampling
+{
+    double scattered = 0.0;
+    Vec3 mean_weight;
+};
+
+Sampling SampleMany(Material const& material, Incidence const& incidence)
+{
+    int scattered = 0;
+    double weight_sum[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < kSampleCount; ++i) {
+        ScatterSample sample;
+        if (!material.Sample(incidence.ray_in, incidence.rec, sample))
+            continue;
+        ++scattered;
+        for (int c = 0; c < 3; ++c)
+            weight_sum[c] += double(sample.weight[c]);
+    }
+    Sampling sampling;
+    sampling.scattered = double(scattered) / double(kSampleCount);
+    sampling.mean_weight = Vec3(Real(weight_sum[0] / kSampleCount),
+                                Real(weight_sum[1] / kSampleCount),
+                                Real(weight_sum[2] / kSampleCount));
+    return sampling;
+}
+
+}  // namespace
+
+TEST_CASE("Lambertian : density and energy of the scattering", "[Materials]")
+{
+    my_engine().seed(29U);
+    RealNum const cos_out = GENERATE(Real(1), Real(0.7), Real(0.2));
+    Incidence const incidence(cos_out);
+    Lambertian const white(
+        std::make_shared<ConstantTexture>(Vec3(Real(1), Real(1), Real(1))));
+
+    SECTION("Pdf integrates to one")
+    {
+        Integrals const integrals = Integrate(white, incidence);
+        CHECK(integrals.pdf == Approx(1.0).epsilon(0.02));
+    }
+
+    SECTION("Sampled directions have the density given by Pdf and the weight given by Evaluate")
+    {
+        for (int i = 0; i < 1000; ++i) {
+            ScatterSample sample;
+            REQUIRE(white.Sample(incidence.ray_in, incidence.rec, sample));
+            CHECK(sample.pdf ==
+                  Approx(white.Pdf(incidence.ray_in, incidence.rec, sample.direction))
+                      .epsilon(1e-3)
+                      .margin(1e-4));
+            Vec3 const value = white.Evaluate(incidence.ray_in, incidence.rec, sample.direction);
+            for (int c = 0; c < 3; ++c)
+                CHECK(sample.weight[c] * sample.pdf == Approx(value[c]).epsilon(1e-3).margin(1e-4));
+        }
+    }
+
+    SECTION("White furnace : a white surface reflects all the light it receives")
+    {
+        Sampling const sampling = SampleMany(white, incidence);
+        Integrals const integrals = Integrate(white, incidence);
+        for (int c = 0; c < 3; ++c) {
+            CHECK(sampling.mean_weight[c] == Approx(1.0).epsilon(1e-3));
+            CHECK(integrals.evaluate[c] == Approx(1.0).epsilon(0.02));
+        }
+    }
+}
+
+TEST_CASE("Metal : density and energy of the GGX scattering", "[Materials]")
+{
+    my_engine().seed(29U);
+    RealNum const fuzz = GENERATE(Real(0.3), Real(0.6), Real(1));
+    RealNum const cos_out = GENERATE(Real(1), Real(0.7), Real(0.2));
+    INFO("fuzz " << fuzz << ", cosine " << cos_out);
+    Incidence const incidence(cos_out);
+    Metal const white(Vec3(Real(1), Real(1), Real(1)), fuzz);
+
+    SECTION("Pdf integrates to the probability of scattering")
+    {
+        // Directions reflected below the surface are absorbed, so that the
+        // density integrates to less than one
+        Integrals const integrals = Integrate(white, incidence);
+        Sampling const sampling = SampleMany(white, incidence);
+        CHECK(integrals.pdf == Approx(sampling.scattered).epsilon(0.05));
+        CHECK(sampling.scattered <= 1.0);
+    }
+
+    SECTION("Sampled directions have the density given by Pdf and the weight given by Evaluate")
+    {
+        for (int i = 0; i < 1000; ++i) {
+            ScatterSample sample;
+            if (!white.Sample(incidence.ray_in, incidence.rec, sample))
+                continue;
+            CHECK(sample.pdf > Real(0));
+            CHECK(sample.pdf ==
+                  Approx(white.Pdf(incidence.ray_in, incidence.rec, sample.direction))
+                      .epsilon(1e-2)
+                      .margin(1e-3));
+            Vec3 const value = white.Evaluate(incidence.ray_in, incidence.rec, sample.direction);
+            for (int c = 0; c < 3; ++c)
+                CHECK(sample.weight[c] * sample.pdf == Approx(value[c]).epsilon(1e-2).margin(1e-3));
+        }
+    }
+
+    SECTION("White furnace : a white metal reflects at most the light it receives")
+    {
+        // Single scattering microfacet models lose the light bouncing
+        // between microfacets
+        Sampling const sampling = SampleMany(white, incidence);
+        Integrals const integrals = Integrate(white, incidence);
+        for (int c = 0; c < 3; ++c) {
+            CHECK(sampling.mean_weight[c] <= Approx(1.0).epsilon(0.01));
+            CHECK(sampling.mean_weight[c] == Approx(integrals.evaluate[c]).epsilon(0.05));
+        }
+    }
+}
+
+TEST_CASE("Metal : white furnace of nearly smooth metals", "[Materials]")
+{
+    // Little light is lost between microfacets or below the surface, so
+    // that nearly all the light is reflected
+    my_engine().seed(29U);
+    Incidence const incidence(Real(1));
+    Metal const white(Vec3(Real(1), Real(1), Real(1)), Real(0.05));
+    Sampling const sampling = SampleMany(white, incidence);
+    CHECK(sampling.scattered == Approx(1.0).epsilon(0.01));
+    for (int c = 0; c < 3; ++c)
+        CHECK(sampling.mean_weight[c] == Approx(1.0).epsilon(0.02));
+}
+
+}  // namespace plemma::glancy
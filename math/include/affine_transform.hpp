@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "point3.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Affine transformation of R^3, x -> A x + b, with A stored by rows.
+// Transformations compose like functions: (f * g)(x) = f(g(x)).
+class AffineTransform
+{
+  public:
+    // Identity
+    constexpr AffineTransform() noexcept
+        : rows_{Vec3(Real(1), Real(0), Real(0)),
+                Vec3(Real(0), Real(1), Real(0)),
+                Vec3(Real(0), Real(0), Real(1))},
+          translation_(Real(0), Real(0), Real(0))
+    {}
+    constexpr AffineTransform(Vec3 const& row_x,
+                              Vec3 const& row_y,
+                              Vec3 const& row_z,
+                              Vec3 const& translation) noexcept
+        : rows_{row_x, row_y, row_z}, translation_(translation)
+    {}
+
+    [[nodiscard]] static constexpr AffineTransform Translation(Vec3 const& offset) noexcept
+    {
+        AffineTransform transform;
+        transform.translation_ = offset;
+        return transform;
+    }
+    [[nodiscard]] static constexpr AffineTransform Scaling(Vec3 const& factors) noexcept
+    {
+        return AffineTransform(Vec3(factors.X(), Real(0), Real(0)),
+                               Vec3(Real(0), factors.Y(), Real(0)),
+                               Vec3(Real(0), Real(0), factors.Z()),
+                               Vec3(Real(0), Real(0), Real(0)));
+    }
+    // Rotation of 'angle' radians around 'axis' (which does not need to
+    // be unit), counter-clockwise when looking from its tip
+    [[nodiscard]] static AffineTransform Rotation(Vec3 const& axis, RealNum angle) noexcept;
+
+    [[nodiscard]] constexpr Vec3 TransformPoint(Vec3 const& p) const noexcept
+    {
+        return TransformVector(p) + translation_;
+    }
+    // Computed with the precision of 'p' (see Point3)
+    [[nodiscard]] constexpr Point3 TransformPoint(Point3 const& p) const noexcept
+    {
+        using P = PreciseRealNum;
+        Point3 transformed;
+        for (int i = 0; i < 3; ++i) {
+            transformed[i] = P(rows_[i].X()) * p.X() + P(rows_[i].Y()) * p.Y() +
+                             P(rows_[i].Z()) * p.Z() + P(translation_[i]);
+        }
+        return transformed;
+    }
+    [[nodiscard]] constexpr Vec3 TransformVector(Vec3 const& v) const noexcept
+    {
+        return Vec3(Dot(rows_[0], v), Dot(rows_[1], v), Dot(rows_[2], v));
+    }
+    // Bound of the absolute error of each component of TransformPoint(p),
+    // if each component of 'p' has an absolute error of up to 'p_error'
+    // (Pharr, Jakob and Humphreys, "Physically Based Rendering", 3.9.3)
+    [[nodiscard]] RealNum TransformPointError(Point3 const& p, RealNum p_error) const noexcept
+    {
+        using P = PreciseRealNum;
+        P const gamma = RoundingErrorBound<P>(3);
+        P const abs_p[3] = {std::abs(p.X()), std::abs(p.Y()), std::abs(p.Z())};
+        P error = P(0);
+        for (int i = 0; i < 3; ++i) {
+            P const abs_row[3] = {P(std::abs(rows_[i].X())),
+                                  P(std::abs(rows_[i].Y())),
+                                  P(std::abs(rows_[i].Z()))};
+            P const row_error =
+                (P(1) + gamma) * (abs_row[0] + abs_row[1] + abs_row[2]) * P(p_error) +
+                gamma * (abs_row[0] * abs_p[0] + abs_row[1] * abs_p[1] + abs_row[2] * abs_p[2] +
+                         P(std::abs(translation_[i])));
+            error = std::max(error, row_error);
+        }
+        return Real(error);
+    }
+    // Returns the product of the transpose of A by 'v'. Normals transform
+    // with the transpose of the linear part of the inverse transformation.
+    [[nodiscard]] constexpr Vec3 TransposeTransformVector(Vec3 const& v) const noexcept
+    {
+        return v.X() * rows_[0] + v.Y() * rows_[1] + v.Z() * rows_[2];
+    }
+
+    [[nodiscard]] constexpr RealNum Determinant() const noexcept
+    {
+        return Dot(rows_[0], Cross(rows_[1], rows_[2]));
+    }
+    // Whether the transformation can be inverted
+    [[nodiscard]] constexpr bool IsInvertible() const noexcept
+    {
+        return Determinant() != Real(0);
+    }
+    // Inverse transformation. Must be invertible.
+    [[nodiscard]] constexpr AffineTransform Inverse() const noexcept;
+
+    [[nodiscard]] constexpr Vec3 const& Row(int i) const noexcept { return rows_[i]; }
+    [[nodiscard]] constexpr Vec3 const& Translation() const noexcept { return translation_; }
+
+  private:
+    Vec3 rows_[3];
+    Vec3 translation_;
+};
+
+constexpr AffineTransform operator*(AffineTransform const& f, AffineTransform const& g) noexcept
+{
+    // Columns of g's linear part transformed by f give the columns of the
+    // product; rows are then read from them through the transpose.
+    Vec3 const column_x = f.TransformVector(Vec3(g.Row(0).X(), g.Row(1).X(), g.Row(2).X()));
+    Vec3 const column_y = f.TransformVector(Vec3(g.Row(0).Y(), g.Row(1).Y(), g.Row(2).Y()));
+    Vec3 const column_z = f.TransformVector(Vec3(g.Row(0).Z(), g.Row(1).Z(), g.Row(2).Z()));
+    return AffineTransform(Vec3(column_x.X(), column_y.X(), column_z.X()),
+                           Vec3(column_x.Y(), column_y.Y(), column_z.Y()),
+                           Vec3(column_x.Z(), column_y.Z(), column_z.Z()),
+                           f.TransformPoint(g.Translation()));
+}
+
+constexpr AffineTransform AffineTransform::Inverse() const noexcept
+{
+    // Rows of the inverse of A are the cross products of its rows (the
+    // columns of its adjugate) divided by the determinant
+    RealNum const inv_determinant = Real(1) / Determinant();
+    Vec3 const column_x = Cross(rows_[1], rows_[2]) * inv_determinant;
+    Vec3 const column_y = Cross(rows_[2], rows_[0]) * inv_determinant;
+    Vec3 const column_z = Cross(rows_[0], rows_[1]) * inv_determinant;
+    AffineTransform inverse(Vec3(column_x.X(), column_y.X(), column_z.X()),
+                            Vec3(column_x.Y(), column_y.Y(), column_z.Y()),
+                            Vec3(column_x.Z(), column_y.Z(), column_z.Z()),
+                            Vec3(Real(0), Real(0), Real(0)));
+    inverse.translation_ = -inverse.TransformVector(translation_);
+    return inverse;
+}
+
+inline AffineTransform AffineTransform::Rotation(Vec3 const& axis, RealNum angle) noexcept
+{
+    Vec3 const u = UnitVector(axis);
+    RealNum const c = std::cos(angle);
+    RealNum const s = std::sin(angle);
+    RealNum const t = Real(1) - c;
+    return AffineTransform(
+        Vec3(t * u.X() * u.X() + c, t * u.X() * u.Y() - s * u.Z(), t * u.X() * u.Z() + s * u.Y()),
+        Vec3(t * u.X() * u.Y() + s * u.Z(), t * u.Y() * u.Y() + c, t * u.Y() * u.Z() - s * u.X()),
+        Vec3(t * u.X() * u.Z() - s * u.Y(), t * u.Y() * u.Z() + s * u.X(), t * u.Z() * u.Z() + c),
+        Vec3(Real(0), Real(0), Real(0)));
+}
+
+}  // namespace plemma::glancy
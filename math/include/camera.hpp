@@ -71,4 +71,29 @@ class Camera
     RealNum time_close_shutter_;
 };
 
+// Parameters of a camera, as given by scene files and render jobs
+struct CameraSettings
+{
+    Vec3 look_from{Real(0), Real(0), Real(1)};
+    Vec3 look_at{Real(0), Real(0), Real(0)};
+    Vec3 up{Real(0), Real(1), Real(0)};
+    RealNum vertical_fov_deg = Real(30);
+    RealNum aperture = Real(0);
+    // Non positive values focus on 'look_at'
+    RealNum focus_distance = Real(0);
+    RealNum time_from = Real(0);
+    RealNum time_to = Real(0);
+};
+
+// Whether a camera can be built from 'camera': it looks away from where it
+// is, along a direction other than 'up', through a field of view in
+// (0, 180) degrees, and its lens and shutter are not inverted
+inline bool IsValidCamera(CameraSettings const& camera) noexcept
+{
+    Vec3 const view = camera.look_at - camera.look_from;
+    return Cross(view, camera.up).Norm() > Real(0) && camera.vertical_fov_deg > Real(0) &&
+           camera.vertical_fov_deg < Real(180) && camera.aperture >= Real(0) &&
+           camera.time_from <= camera.time_to;
+}
+
 }  // namespace plemma::glancy
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cmath>
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Right-handed orthonormal basis {u, v, w} of R^3 built around a given
+// unit vector w. Useful to sample directions around a normal (or any
+// other axis) in local coordinates and then move them to world ones.
+class OrthonormalBasis
+{
+  public:
+    // 'w' must be a unit vector. Construction follows Duff et al.,
+    // "Building an Orthonormal Basis, Revisited" (2017), which has no
+    // branches apart from the sign and is robust for any w.
+    explicit OrthonormalBasis(Vec3 const& w) noexcept : w_(w)
+    {
+        RealNum const sign = std::copysign(Real(1), w.Z());
+        RealNum const a = Real(-1) / (sign + w.Z());
+        RealNum const b = w.X() * w.Y() * a;
+        u_ = Vec3(Real(1) + sign * w.X() * w.X() * a, sign * b, -sign * w.X());
+        v_ = Vec3(b, sign + w.Y() * w.Y() * a, -w.Y());
+    }
+
+    [[nodiscard]] constexpr Vec3 const& U() const noexcept { return u_; }
+    [[nodiscard]] constexpr Vec3 const& V() const noexcept { return v_; }
+    [[nodiscard]] constexpr Vec3 const& W() const noexcept { return w_; }
+
+    // Returns the vector with coordinates (a, b, c) in this basis
+    [[nodiscard]] constexpr Vec3 Local(RealNum a, RealNum b, RealNum c) const noexcept
+    {
+        return a * u_ + b * v_ + c * w_;
+    }
+
+  private:
+    Vec3 u_;
+    Vec3 v_;
+    Vec3 w_;
+};
+
+}  // namespace plemma::glancy
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <ostream>
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Position in space, stored with PreciseRealNum (see types.hpp), for the
+// origins of rays and the points they hit. With mixed precision, a hit
+// point keeps the digits of double it was computed with, so that the rays
+// leaving it start where it was found rather than where float can place
+// it. Differences of points are computed in PreciseRealNum before being
+// rounded to a Vec3, which keeps them precise for nearby points however
+// far they are from the origin of the world. With float or double
+// precision, points are just Vec3 under another name.
+class Point3
+{
+  public:
+    typedef PreciseRealNum value_type;
+
+    constexpr Point3() noexcept = default;
+    constexpr Point3(PreciseRealNum a, PreciseRealNum b, PreciseRealNum c) noexcept
+        : comp_{a, b, c}
+    {}
+    // Points of scenes are given as Vec3
+    constexpr Point3(Vec3 const& v) noexcept : comp_{v.X(), v.Y(), v.Z()} {}
+
+    [[nodiscard]] constexpr PreciseRealNum X() const noexcept { return comp_[0]; }
+    [[nodiscard]] constexpr PreciseRealNum Y() const noexcept { return comp_[1]; }
+    [[nodiscard]] constexpr PreciseRealNum Z() const noexcept { return comp_[2]; }
+    constexpr PreciseRealNum operator[](int i) const noexcept { return comp_[i]; }
+    constexpr PreciseRealNum& operator[](int i) noexcept { return comp_[i]; }
+
+    // The point rounded to RealNum
+    [[nodiscard]] constexpr Vec3 ToVec3() const noexcept
+    {
+        return Vec3(Real(comp_[0]), Real(comp_[1]), Real(comp_[2]));
+    }
+
+  private:
+    std::array<PreciseRealNum, 3> comp_{};
+};
+
+inline std::ostream& operator<<(std::ostream& os, Point3 const& p) noexcept
+{
+    os << p[0] << " " << p[1] << " " << p[2];
+    return os;
+}
+
+constexpr bool operator==(Point3 const& p, Point3 const& q) noexcept
+{
+    return p[0] == q[0] && p[1] == q[1] && p[2] == q[2];
+}
+
+constexpr bool operator!=(Point3 const& p, Point3 const& q) noexcept
+{
+    return !(p == q);
+}
+
+constexpr Point3 operator+(Point3 const& p, Vec3 const& v) noexcept
+{
+    return Point3(p[0] + PreciseRealNum(v[0]),
+                  p[1] + PreciseRealNum(v[1]),
+                  p[2] + PreciseRealNum(v[2]));
+}
+
+constexpr Point3 operator-(Point3 const& p, Vec3 const& v) noexcept
+{
+    return Point3(p[0] - PreciseRealNum(v[0]),
+                  p[1] - PreciseRealNum(v[1]),
+                  p[2] - PreciseRealNum(v[2]));
+}
+
+// Vector from 'q' to 'p', rounded after subtracting
+constexpr Vec3 operator-(Point3 const& p, Point3 const& q) noexcept
+{
+    return Vec3(Real(p[0] - q[0]), Real(p[1] - q[1]), Real(p[2] - q[2]));
+}
+
+// Point at parameter 't' of the line through 'p' with direction 'v',
+// computed in PreciseRealNum
+constexpr Point3 PointAlong(Point3 const& p, Vec3 const& v, PreciseRealNum t) noexcept
+{
+    return Point3(p[0] + t * PreciseRealNum(v[0]),
+                  p[1] + t * PreciseRealNum(v[1]),
+                  p[2] + t * PreciseRealNum(v[2]));
+}
+
+inline PreciseRealNum MaxAbsComponent(Point3 const& p) noexcept
+{
+    return std::max({std::abs(p[0]), std::abs(p[1]), std::abs(p[2])});
+}
+
+}  // namespace plemma::glancy
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <limits>
+#include "point3.hpp"
 #include "vec3.hpp"
 
 namespace plemma::glancy {
@@ -9,21 +11,55 @@ class Ray
 {
   public:
     constexpr Ray() noexcept = default;
-    constexpr Ray(Vec3 const& origin, Vec3 const& direction, RealNum t)
+    constexpr Ray(Point3 const& origin, Vec3 const& direction, RealNum t)
         : origin_(origin), direction_(direction), time_(t)
-    {}
-    [[nodiscard]] constexpr Vec3 Origin() const { return origin_; }
+    {
+        for (int axis = 0; axis < 3; ++axis) {
+            inverse_direction_[axis] = InverseComponent(direction_[axis]);
+            direction_is_negative_[axis] = inverse_direction_[axis] < Real(0) ? 1 : 0;
+        }
+    }
+    [[nodiscard]] constexpr Point3 const& Origin() const { return origin_; }
     [[nodiscard]] constexpr Vec3 Direction() const { return direction_; }
     [[nodiscard]] constexpr RealNum Time() const { return time_; }
-    [[nodiscard]] constexpr Vec3 PointAtParameter(RealNum lambda) const
+    [[nodiscard]] constexpr Point3 PointAtParameter(RealNum lambda) const
+    {
+        return PointAlong(origin_, direction_, lambda);
+    }
+
+    // Computed once per ray for the slab tests of the boxes it traverses
+    // (see AxesAlignedBoundingBox::Hit), so that the parameter at which
+    // the ray crosses the plane x_i = c is (c - Origin()[i]) *
+    // InverseDirection()[i], without any division.
+    [[nodiscard]] constexpr Vec3 const& InverseDirection() const noexcept
+    {
+        return inverse_direction_;
+    }
+    // 1 if component 'axis' of the direction is negative, 0 otherwise
+    [[nodiscard]] constexpr int DirectionIsNegative(int axis) const noexcept
     {
-        return origin_ + lambda * direction_;
+        return direction_is_negative_[axis];
     }
 
   private:
-    Vec3 origin_{};
+    // Components of the direction closer to zero than this are moved to
+    // it, so that inverses are finite and so are the parameters of the
+    // planes of boxes up to 1e20 away
+    static constexpr RealNum InverseComponent(RealNum component) noexcept
+    {
+        constexpr RealNum kMinComponent = Real(1e-18);
+        if (component >= Real(0) && component < kMinComponent)
+            component = kMinComponent;
+        else if (component < Real(0) && component > -kMinComponent)
+            component = -kMinComponent;
+        return Real(1) / component;
+    }
+
+    Point3 origin_{};
     Vec3 direction_{};
     RealNum time_{};
+    Vec3 inverse_direction_{};
+    int direction_is_negative_[3]{};
 };
 
 constexpr Vec3 Reflect(Vec3 const& v, Vec3 const& n) noexcept
@@ -44,4 +80,30 @@ inline bool Refract(Vec3 const& v, Vec3 const& n, RealNum ni_over_nt, Vec3& refr
     return false;
 }
 
+// Returns the origin for a ray leaving in 'direction' the point 'p' of a
+// surface with unit normal 'n', where 'p_error' bounds the absolute error
+// of each component of 'p'. The point is moved along the normal, to the
+// side the ray leaves to, just enough to leave the box of the points 'p'
+// could be, so that the ray can start right at its origin without finding
+// the surface it leaves again, instead of skipping a fixed distance that
+// both misses close hits and is too short for big coordinates.
+inline Point3 OffsetRayOrigin(Point3 const& p,
+                              RealNum p_error,
+                              Vec3 const& n,
+                              Vec3 const& direction) noexcept
+{
+    RealNum const distance = p_error * (std::abs(n.X()) + std::abs(n.Y()) + std::abs(n.Z()));
+    Vec3 const offset = (Dot(direction, n) < Real(0) ? -distance : distance) * n;
+    Point3 origin = p + offset;
+    // Rounding the sum could leave it closer to 'p' than 'offset'
+    constexpr PreciseRealNum kInfinity = std::numeric_limits<PreciseRealNum>::infinity();
+    for (int axis = 0; axis < 3; ++axis) {
+        if (offset[axis] > Real(0))
+            origin[axis] = std::nextafter(origin[axis], kInfinity);
+        else if (offset[axis] < Real(0))
+            origin[axis] = std::nextafter(origin[axis], -kInfinity);
+    }
+    return origin;
+}
+
 }  // namespace plemma::glancy
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <iostream>
 #include <random>
+#include "constants.hpp"
 #include "rand_engine.hpp"
 #include "utilities.hpp"
 
@@ -186,6 +188,23 @@ inline Vec3 UnitVector(Vec3 const& v) noexcept
     return v / v.Norm();
 }
 
+// Largest absolute value of the components of 'v'
+inline RealNum MaxAbsComponent(Vec3 const& v) noexcept
+{
+    return std::max({std::abs(v.X()), std::abs(v.Y()), std::abs(v.Z())});
+}
+
+// Index of the component of 'v' with the largest absolute value
+inline int MaxAbsDimension(Vec3 const& v) noexcept
+{
+    RealNum const x = std::abs(v.X());
+    RealNum const y = std::abs(v.Y());
+    RealNum const z = std::abs(v.Z());
+    if (x > y)
+        return x > z ? 0 : 2;
+    return y > z ? 1 : 2;
+}
+
 inline Vec3 GetRandomPointInUnitBall() noexcept
 {
     Vec3 p(Real(1), Real(1), Real(1));
@@ -196,6 +215,16 @@ inline Vec3 GetRandomPointInUnitBall() noexcept
     return p;
 }
 
+// Returns a random point uniformly distributed on the unit sphere
+inline Vec3 GetRandomUnitVector() noexcept
+{
+    std::uniform_real_distribution<RealNum> distribution(Real(0), Real(1));
+    RealNum const z = Real(1) - Real(2) * distribution(my_engine());
+    RealNum const phi = Real(2) * constants::kPi * distribution(my_engine());
+    RealNum const r = std::sqrt(std::max(Real(0), Real(1) - z * z));
+    return Vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
 inline Vec3 GetRandomPointInUnitDiscXY() noexcept
 {
     Vec3 p(Real(1), Real(1), Real(1));
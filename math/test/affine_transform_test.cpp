@@ -0,0 +1,60 @@
+#include <cmath>
+
+#include "vec3_random_generator.hpp"
+
+#include "affine_transform.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("Inverse : AffineTransform -> AffineTransform", "[AffineTransform]")
+{
+    Vec3 const axis =
+        GENERATE(take(10, filter(CanVec3BeUsedToDivide, RandomFiniteVec3(-1.0, 1.0))));
+    Vec3 const offset = GENERATE(take(5, RandomFiniteVec3(-10.0, 10.0)));
+    Vec3 const p = GENERATE(take(5, RandomFiniteVec3(-10.0, 10.0)));
+    AffineTransform const transform = AffineTransform::Translation(offset) *
+                                      AffineTransform::Rotation(axis, Real(0.7)) *
+                                      AffineTransform::Scaling(Vec3(Real(2), Real(0.5), Real(3)));
+    REQUIRE(transform.IsInvertible());
+    AffineTransform const inverse = transform.Inverse();
+
+    SECTION("Points are mapped back")
+    {
+        CHECK_THAT(inverse.TransformPoint(transform.TransformPoint(p)),
+                   IsComponentWiseApprox<Vec3>(Real(1e-3), p));
+        CHECK_THAT((transform * inverse).TransformPoint(p),
+                   IsComponentWiseApprox<Vec3>(Real(1e-3), p));
+    }
+
+    SECTION("Vectors are not translated")
+    {
+        CHECK_THAT(inverse.TransformVector(transform.TransformVector(p)),
+                   IsComponentWiseApprox<Vec3>(Real(1e-3), p));
+    }
+}
+
+TEST_CASE("Rotation : Vec3 x RealNum -> AffineTransform", "[AffineTransform]")
+{
+    RealNum const tolerance = tconst::kAbsoluteToleranceEqualityCheckAroundZero;
+    Vec3 const z(Real(0), Real(0), Real(2));
+
+    SECTION("Quarter turn around z maps x to y")
+    {
+        AffineTransform const rotation =
+            AffineTransform::Rotation(z, Real(0.5) * std::acos(Real(-1)));
+        CHECK_THAT(rotation.TransformVector(Vec3(Real(1), Real(0), Real(0))),
+                   IsComponentWiseApprox<Vec3>(tolerance, Vec3(Real(0), Real(1), Real(0))));
+        CHECK(rotation.Determinant() == Approx(1.0));
+    }
+
+    SECTION("Norms are preserved")
+    {
+        Vec3 const axis =
+            GENERATE(take(20, filter(CanVec3BeUsedToDivide, RandomFiniteVec3(-1.0, 1.0))));
+        Vec3 const v = GENERATE(take(5, RandomFiniteVec3(-10.0, 10.0)));
+        AffineTransform const rotation = AffineTransform::Rotation(axis, Real(2.1));
+        CHECK(rotation.TransformVector(v).Norm() == Approx(v.Norm()).epsilon(1e-4));
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,46 @@
+#include "vec3_random_generator.hpp"
+
+#include "orthonormal_basis.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("Constructor : unit Vec3 -> OrthonormalBasis", "[OrthonormalBasis]")
+{
+    Vec3 w = GENERATE(take(100, filter(CanVec3BeUsedToDivide, RandomFiniteVec3(-10.0, 10.0))),
+                      Vec3(Real(0), Real(0), Real(1)),
+                      Vec3(Real(0), Real(0), Real(-1)),
+                      Vec3(Real(1), Real(0), Real(0)));
+    w.Normalize();
+    OrthonormalBasis const basis(w);
+
+    SECTION("W is the given vector")
+    {
+        CHECK(basis.W() == w);
+    }
+
+    SECTION("Vectors are unit and orthogonal")
+    {
+        RealNum const tolerance = tconst::kAbsoluteToleranceEqualityCheckAroundZero;
+        CHECK(basis.U().Norm() == Approx(1.0).margin(tolerance));
+        CHECK(basis.V().Norm() == Approx(1.0).margin(tolerance));
+        CHECK(Dot(basis.U(), basis.V()) == Approx(0.0).margin(tolerance));
+        CHECK(Dot(basis.U(), basis.W()) == Approx(0.0).margin(tolerance));
+        CHECK(Dot(basis.V(), basis.W()) == Approx(0.0).margin(tolerance));
+    }
+
+    SECTION("Basis is right-handed")
+    {
+        CHECK_THAT(Cross(basis.U(), basis.V()),
+                   IsComponentWiseApprox<Vec3>(tconst::kAbsoluteToleranceEqualityCheckAroundZero,
+                                               basis.W()));
+    }
+
+    SECTION("Local coordinates are mapped to the basis")
+    {
+        CHECK(basis.Local(Real(0), Real(0), Real(1)) == basis.W());
+        CHECK(basis.Local(Real(1), Real(0), Real(0)) == basis.U());
+        CHECK(basis.Local(Real(0), Real(1), Real(0)) == basis.V());
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,28 @@
+#include <cmath>
+
+#include "vec3_random_generator.hpp"
+
+#include "point3.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("Point3 : Vec3 -> Point3 -> Vec3 is the identity", "[Point3]")
+{
+    Vec3 const v = GENERATE(take(100, RandomFiniteVec3()));
+    CHECK(Point3(v).ToVec3() == v);
+}
+
+TEST_CASE("Point3 : differences are rounded after subtracting", "[Point3]")
+{
+    Vec3 const far = GENERATE(take(100, RandomFiniteVec3(Real(-1e5), Real(1e5))));
+    Vec3 const offset = GENERATE(take(10, RandomFiniteVec3(Real(-1e-3), Real(1e-3))));
+    Point3 const p = Point3(far) + offset;
+    Vec3 const difference = p - Point3(far);
+    // The sum is the only rounding, of the size of the points
+    PreciseRealNum const error = RoundingErrorBound<PreciseRealNum>(1) * MaxAbsComponent(p);
+    for (int axis = 0; axis < 3; ++axis)
+        CHECK(std::abs(PreciseRealNum(difference[axis]) - PreciseRealNum(offset[axis])) <=
+              error + PreciseRealNum(RoundingErrorBound<RealNum>(1) * std::abs(offset[axis])));
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <vector>
+
+#include "vec3_random_generator.hpp"
+
+#include "rand_engine.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("Pcg32 : same output as the reference implementation", "[RandEngine]")
+{
+    // First outputs of the demo of the reference implementation, seeded
+    // with pcg32_srandom_r(&rng, 42u, 54u)
+    Pcg32 engine(42U, 54U);
+    std::vector<std::uint32_t> outputs;
+    for (int i = 0; i < 6; ++i)
+        outputs.push_back(engine());
+    std::vector<std::uint32_t> const expected{
+        0xA15C02B7U, 0x7B47F409U, 0xBA1D3330U, 0x83D2F293U, 0xBFA4784BU, 0xCBED606EU};
+    CHECK(outputs == expected);
+}
+
+TEST_CASE("Pcg32 : sequences depend on every bit of the seed", "[RandEngine]")
+{
+    std::uint64_t const seed = 0x0123456789ABCDEFULL;
+    Pcg32 engine(seed);
+    std::uint32_t const first = engine();
+    engine.seed(seed);
+    CHECK(engine() == first);
+    // Seeds equal in their lowest 32 bits
+    for (int bit = 32; bit < 64; ++bit) {
+        engine.seed(seed ^ (std::uint64_t(1) << unsigned(bit)));
+        CHECK(engine() != first);
+    }
+}
+
+}  // namespace plemma::glancy
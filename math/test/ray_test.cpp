@@ -143,4 +143,29 @@ TEST_CASE("Reflect : Vec3 x Vec3 -> Vec3", "[Ray]")
     }
 }
 
+TEST_CASE("OffsetRayOrigin : Point3 x RealNum x Vec3 x Vec3 -> Point3", "[Ray]")
+{
+    Vec3 const p = GENERATE(take(50, RandomFiniteVec3(-100.0, 100.0)));
+    RealNum const p_error = GENERATE(Real(1e-6), Real(1e-4), Real(1e-2));
+    Vec3 normal = GENERATE(take(10, filter(CanVec3BeUsedToDivide, RandomFiniteVec3(-1.0, 1.0))));
+    normal.Normalize();
+    Vec3 const direction = GENERATE(take(4, RandomFiniteVec3(-1.0, 1.0)));
+    Vec3 const offset = OffsetRayOrigin(p, p_error, normal, direction) - Point3(p);
+    RealNum const side = Dot(direction, normal) < Real(0) ? Real(-1) : Real(1);
+
+    SECTION("Origin is moved to the side the ray leaves to")
+    {
+        CHECK(side * Dot(offset, normal) > Real(0));
+    }
+
+    SECTION("Origin leaves the box of the points within the error")
+    {
+        // The face of the box the normal points to the most is at least as
+        // far along the normal as the corner towards it
+        RealNum const box_reach =
+            p_error * (std::abs(normal.X()) + std::abs(normal.Y()) + std::abs(normal.Z()));
+        CHECK(side * Dot(offset, normal) >= box_reach * Real(0.999));
+    }
+}
+
 }  // namespace plemma::glancy
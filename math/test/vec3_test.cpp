@@ -593,6 +593,15 @@ TEST_CASE("UnitVector : Vec3 -> Vec3", "[Vec3]")
     }
 }
 
+TEST_CASE("MaxAbsDimension : Vec3 -> int", "[Vec3]")
+{
+    auto v = GENERATE(take(100, RandomFiniteVec3(-10.0, 10.0)));
+    int const dimension = MaxAbsDimension(v);
+    REQUIRE(dimension >= 0);
+    REQUIRE(dimension < 3);
+    CHECK(std::abs(v[dimension]) == MaxAbsComponent(v));
+}
+
 TEST_CASE("GetRandomPointInUnitBall", "[Vec3]")
 {
     SECTION("Resulting Vec3 has norm <= 1")
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "heatmap.hpp"
+#include "image.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Sums of the colors (before any gamma correction) of the samples in
+// [sample_from, sample_to) of the pixels in [x_from, x_to) x [y_from, y_to)
+// of an image. Rendering an image can be split in tiles over different
+// regions or sample ranges of it, even in different processes, whose sums
+// are then merged in an AccumulationBuffer.
+struct AccumulationTile
+{
+    AccumulationTile() = default;
+    AccumulationTile(std::size_t x0,
+                     std::size_t y0,
+                     std::size_t x1,
+                     std::size_t y1,
+                     std::size_t s0,
+                     std::size_t s1)
+        : x_from(x0),
+          y_from(y0),
+          x_to(x1),
+          y_to(y1),
+          sample_from(s0),
+          sample_to(s1),
+          color(3U * (x1 - x0) * (y1 - y0), 0.0F)
+    {}
+
+    void Add(std::size_t x, std::size_t y, Vec3 const& sum) noexcept
+    {
+        std::size_t const i = 3U * ((y - y_from) * (x_to - x_from) + (x - x_from));
+        color[i] += static_cast<float>(sum.X());
+        color[i + 1U] += static_cast<float>(sum.Y());
+        color[i + 2U] += static_cast<float>(sum.Z());
+    }
+
+    std::size_t x_from = 0U;
+    std::size_t y_from = 0U;
+    std::size_t x_to = 0U;
+    std::size_t y_to = 0U;
+    std::size_t sample_from = 0U;
+    std::size_t sample_to = 0U;
+    // Three floats per pixel, row by row
+    std::vector<float> color;
+};
+
+// Sums of the colors of the samples of every pixel of an image, and their
+// number, merged from tiles
+class AccumulationBuffer
+{
+  public:
+    AccumulationBuffer(std::size_t width, std::size_t height)
+        : width_(width),
+          height_(height),
+          color_(3U * width * height, 0.0F),
+          samples_(width * height, 0U)
+    {}
+
+    // Adds the sums of 'tile', which must be inside the image
+    void Add(AccumulationTile const& tile) noexcept
+    {
+        auto const samples = static_cast<std::uint32_t>(tile.sample_to - tile.sample_from);
+        std::size_t const tile_width = tile.x_to - tile.x_from;
+        for (std::size_t y = tile.y_from; y < tile.y_to; ++y) {
+            for (std::size_t x = tile.x_from; x < tile.x_to; ++x) {
+                std::size_t const from = 3U * ((y - tile.y_from) * tile_width + (x - tile.x_from));
+                std::size_t const to = 3U * (y * width_ + x);
+                for (std::size_t c = 0; c < 3U; ++c)
+                    color_[to + c] += tile.color[from + c];
+                samples_[y * width_ + x] += samples;
+            }
+        }
+    }
+
+    // Paints in 'image' the mean color of the samples of each pixel,
+    // corrected by 'gamma_correction'. Pixels without samples are black.
+    template <typename UnaryOp>
+    void Resolve(UnaryOp&& gamma_correction, Image& image) const
+    {
+        for (std::size_t y = 0; y < height_; ++y) {
+            for (std::size_t x = 0; x < width_; ++x) {
+                std::size_t const i = y * width_ + x;
+                Vec3 color(Real(0), Real(0), Real(0));
+                if (samples_[i] > 0U) {
+                    color = Vec3(Real(color_[3U * i]),
+                                 Real(color_[3U * i + 1U]),
+                                 Real(color_[3U * i + 2U])) /
+                            Real(samples_[i]);
+                }
+                std::transform(
+                    std::begin(color), std::end(color), std::begin(color), gamma_correction);
+                color *= Real(255.9999);
+                image.PaintPixel(x, y, color);
+            }
+        }
+    }
+
+    // Paints in 'image' a heatmap (see HeatmapColor) of the mean of the
+    // first component of the samples of each pixel, which holds their cost
+    // for the heatmap modes of Renderer. The scale goes from 0 to the 99th
+    // percentile of the pixels, so that a few outliers don't hide the rest.
+    void ResolveHeatmap(Image& image) const
+    {
+        std::vector<float> means(width_ * height_, 0.0F);
+        for (std::size_t i = 0; i < means.size(); ++i) {
+            if (samples_[i] > 0U)
+                means[i] = color_[3U * i] / static_cast<float>(samples_[i]);
+        }
+        std::vector<float> sorted = means;
+        float scale = 0.0F;
+        if (!sorted.empty()) {
+            auto const percentile =
+                sorted.begin() + std::ptrdiff_t(99U * (sorted.size() - 1U) / 100U);
+            std::nth_element(sorted.begin(), percentile, sorted.end());
+            scale = *percentile;
+        }
+        for (std::size_t y = 0; y < height_; ++y) {
+            for (std::size_t x = 0; x < width_; ++x) {
+                float const mean = means[y * width_ + x];
+                Vec3 color = HeatmapColor(scale > 0.0F ? Real(mean / scale) : Real(0));
+                color *= Real(255.9999);
+                image.PaintPixel(x, y, color);
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t Width() const noexcept { return width_; }
+    [[nodiscard]] std::size_t Height() const noexcept { return height_; }
+    [[nodiscard]] std::uint32_t Samples(std::size_t x, std::size_t y) const noexcept
+    {
+        return samples_[y * width_ + x];
+    }
+    // Sum of the colors of the samples of the pixel (x, y)
+    [[nodiscard]] Vec3 Sum(std::size_t x, std::size_t y) const noexcept
+    {
+        std::size_t const i = 3U * (y * width_ + x);
+        return Vec3(Real(color_[i]), Real(color_[i + 1U]), Real(color_[i + 2U]));
+    }
+
+  private:
+    std::size_t width_;
+    std::size_t height_;
+    std::vector<float> color_;
+    std::vector<std::uint32_t> samples_;
+};
+
+namespace accumulation_detail {
+
+constexpr char kTileMagic[8] = {'G', 'L', 'N', 'C', 'Y', 'T', 'I', 'L'};
+
+}  // namespace accumulation_detail
+
+// Writes 'tile' to 'file' (e.g. a pipe to another process), with the byte
+// order of this machine. Returns whether it succeeded.
+inline bool WriteAccumulationTile(std::FILE* file, AccumulationTile const& tile)
+{
+    std::uint64_t const header[6] = {tile.x_from,
+                                     tile.y_from,
+                                     tile.x_to,
+                                     tile.y_to,
+                                     tile.sample_from,
+                                     tile.sample_to};
+    auto const& magic = accumulation_detail::kTileMagic;
+    return std::fwrite(magic, sizeof(magic), 1U, file) == 1U &&
+           std::fwrite(header, sizeof(header), 1U, file) == 1U &&
+           (tile.color.empty() ||
+            std::fwrite(tile.color.data(), sizeof(float), tile.color.size(), file) ==
+                tile.color.size());
+}
+
+// Reads from 'file' a tile written by WriteAccumulationTile. Returns false
+// at the end of the file or if what is read is not a tile of an image of
+// 'width' x 'height' pixels.
+inline bool ReadAccumulationTile(std::FILE* file,
+                                 std::size_t width,
+                                 std::size_t height,
+                                 AccumulationTile& tile)
+{
+    char magic[sizeof(accumulation_detail::kTileMagic)];
+    std::uint64_t header[6];
+    if (std::fread(magic, sizeof(magic), 1U, file) != 1U ||
+        std::memcmp(magic, accumulation_detail::kTileMagic, sizeof(magic)) != 0 ||
+        std::fread(header, sizeof(header), 1U, file) != 1U)
+        return false;
+    if (!(header[0] <= header[2] && header[2] <= width && header[1] <= header[3] &&
+          header[3] <= height && header[4] <= header[5]))
+        return false;
+    tile = AccumulationTile(header[0], header[1], header[2], header[3], header[4], header[5]);
+    return tile.color.empty() ||
+           std::fread(tile.color.data(), sizeof(float), tile.color.size(), file) ==
+               tile.color.size();
+}
+
+}  // namespace plemma::glancy
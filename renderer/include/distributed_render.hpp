@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+#include "accumulation_buffer.hpp"
+#include "binary_scene.hpp"
+#include "file_scene.hpp"
+#include "image.hpp"
+#include "progress_reporter.hpp"
+#include "renderer.hpp"
+#include "scene_settings.hpp"
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#define GLANCY_POPEN _popen
+#define GLANCY_PCLOSE _pclose
+#else
+#define GLANCY_POPEN popen
+#define GLANCY_PCLOSE pclose
+#endif
+
+namespace plemma::glancy {
+
+// Rendering of an image split in shards, each rendered by a different
+// worker process (local or remote, see DistributeRender), whose sums of
+// samples are merged by the process that started them. Every sample is
+// drawn from its own random sequence (see Renderer::Accumulate), so the
+// merged image is the one a single process would render with the same
+// seed, whichever the number of shards and the way the image is split
+// (but for the rounding of sums of samples split between shards).
+//
+// A worker writes to its standard output the size of the image followed
+// by its tiles (see WriteAccumulationTile). Everything else it prints goes
+// to its standard error.
+
+// How an image is split between shards
+enum class ShardSplit
+{
+    // Square tiles of the image, dealt to the shards in turns. Good when
+    // the cost of the image is unevenly spread over it.
+    kTiles,
+    // The whole image, each shard rendering a range of the samples of
+    // every pixel. Workers send a whole image each, but share the work
+    // evenly whatever the image.
+    kSamples
+};
+
+// Side, in pixels, of the tiles of ShardSplit::kTiles
+constexpr std::size_t kShardTileSide = 32U;
+
+inline bool ParseShardSplit(std::string const& text, ShardSplit& split) noexcept
+{
+    if (text == "tiles")
+        split = ShardSplit::kTiles;
+    else if (text == "samples")
+        split = ShardSplit::kSamples;
+    else
+        return false;
+    return true;
+}
+
+inline char const* ShardSplitName(ShardSplit split) noexcept
+{
+    return split == ShardSplit::kTiles ? "tiles" : "samples";
+}
+
+// Empty tiles rendered by shard 'shard' (out of 'number_shards') of an
+// image with 'settings'
+inline std::vector<AccumulationTile> ShardTiles(RenderSettings const& settings,
+                                                ShardSplit split,
+                                                std::size_t shard,
+                                                std::size_t number_shards)
+{
+    std::vector<AccumulationTile> tiles;
+    if (split == ShardSplit::kSamples) {
+        std::size_t const spp = settings.samples_per_pixel;
+        tiles.emplace_back(0U,
+                           0U,
+                           settings.width,
+                           settings.height,
+                           spp * shard / number_shards,
+                           spp * (shard + 1U) / number_shards);
+        return tiles;
+    }
+    std::size_t const columns = (settings.width + kShardTileSide - 1U) / kShardTileSide;
+    std::size_t const rows = (settings.height + kShardTileSide - 1U) / kShardTileSide;
+    for (std::size_t t = shard; t < columns * rows; t += number_shards) {
+        std::size_t const x = (t % columns) * kShardTileSide;
+        std::size_t const y = (t / columns) * kShardTileSide;
+        tiles.emplace_back(x,
+                           y,
+                           std::min(x + kShardTileSide, settings.width),
+                           std::min(y + kShardTileSide, settings.height),
+                           0U,
+                           settings.samples_per_pixel);
+    }
+    return tiles;
+}
+
+namespace distributed_render_detail {
+
+inline RealNum GammaCorrection(RealNum x) noexcept { return std::sqrt(x); }
+
+// Quotes 'argument' for the shell running the worker commands
+inline std::string Quote(std::string const& argument)
+{
+#if defined(_WIN32)
+    return '"' + argument + '"';
+#else
+    std::string quoted = "'";
+    for (char const c : argument)
+        quoted += c == '\'' ? std::string("'\\''") : std::string(1U, c);
+    return quoted + "'";
+#endif
+}
+
+// Renders shard 'shard' of the scene in 'scene_path' and writes the size
+// of the image and the tiles of the shard to 'output'
+template <typename SceneFromFile>
+bool RenderShard(std::string const& scene_path,
+                 ShardSplit split,
+                 std::size_t shard,
+                 std::size_t number_shards,
+                 std::uint64_t seed,
+                 std::FILE* output,
+                 std::string& error)
+{
+    SceneFromFile scene(scene_path);
+    scene.LoadWorld();
+    if (!scene.IsLoaded()) {
+        error = scene.Error();
+        return false;
+    }
+    RenderSettings const& settings = scene.Settings();
+    Camera const camera = scene.MakeCamera();
+    Renderer<RealNum (*)(RealNum)> rend(&GammaCorrection,
+                                        settings.width,
+                                        settings.height,
+                                        settings.samples_per_pixel,
+                                        settings.max_depth);
+    ApplyEnvironmentSettings(rend);
+    rend.SetSeed(seed);
+    rend.Prepare(scene, camera.TimeShutterOpens(), camera.TimeShutterCloses());
+
+    std::vector<AccumulationTile> tiles = ShardTiles(settings, split, shard, number_shards);
+    {
+        std::uint64_t samples = 0U;
+        for (AccumulationTile const& tile : tiles) {
+            samples += std::uint64_t(tile.x_to - tile.x_from) * (tile.y_to - tile.y_from) *
+                       (tile.sample_to - tile.sample_from);
+        }
+        ProgressReporter progress(samples, rend.ProgressInterval(), std::cerr);
+        for (AccumulationTile& tile : tiles)
+            rend.Accumulate(scene, camera, tile, &progress);
+    }
+
+    // Nothing is written until the shard is done, so that the process
+    // merging the shards reads them in whichever order
+    std::uint64_t const size[2] = {settings.width, settings.height};
+    bool written = std::fwrite(size, sizeof(size), 1U, output) == 1U;
+    for (AccumulationTile const& tile : tiles)
+        written = written && WriteAccumulationTile(output, tile);
+    if (!written || std::fflush(output) != 0) {
+        error = "could not write the rendered tiles";
+        return false;
+    }
+    return true;
+}
+
+// Adds to 'buffer' the tiles written by RenderShard to 'input', up to its
+// end. 'buffer' is made with the size of the image if it is still empty.
+// Returns false if the size does not match or the tiles are broken, which
+// includes the last tile being cut short by the end of the stream.
+inline bool ReadShard(std::FILE* input, std::optional<AccumulationBuffer>& buffer)
+{
+    std::uint64_t size[2];
+    if (std::fread(size, sizeof(size), 1U, input) != 1U)
+        return false;
+    if (!buffer)
+        buffer.emplace(size[0], size[1]);
+    if (size[0] != buffer->Width() || size[1] != buffer->Height())
+        return false;
+    AccumulationTile tile;
+    // The stream may only end between tiles
+    for (int next = std::fgetc(input); next != EOF; next = std::fgetc(input)) {
+        std::ungetc(next, input);
+        if (!ReadAccumulationTile(input, size[0], size[1], tile))
+            return false;
+        buffer->Add(tile);
+    }
+    return std::ferror(input) == 0;
+}
+
+}  // namespace distributed_render_detail
+
+// Renders shard 'shard' (out of 'number_shards') of the scene stored in
+// 'scene_path' (text or binary) and writes its tiles to the standard
+// output. The camera of the scene is used, even for animations. Returns
+// false and sets 'error' if it fails.
+inline bool RunRenderWorker(std::string const& scene_path,
+                            ShardSplit split,
+                            std::size_t shard,
+                            std::size_t number_shards,
+                            std::uint64_t seed,
+                            std::string& error)
+{
+    if (number_shards == 0U || shard >= number_shards) {
+        error = "invalid shard";
+        return false;
+    }
+#if defined(_WIN32)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    // Progress messages must not be mixed with the tiles
+    std::cout.rdbuf(std::cerr.rdbuf());
+    if (IsBinarySceneFile(scene_path)) {
+        return distributed_render_detail::RenderShard<BinaryScene>(
+            scene_path, split, shard, number_shards, seed, stdout, error);
+    }
+    return distributed_render_detail::RenderShard<FileScene>(
+        scene_path, split, shard, number_shards, seed, stdout, error);
+}
+
+// Renders the scene stored in 'scene_path' in 'number_shards' worker
+// processes running at the same time, each started with the command
+//
+//   <worker_command> --worker <scene> <split> <shard> <shards> <seed>
+//
+// and saves the merged image in 'output_path'. 'worker_command' is run by
+// the shell, so it can start glancy in another machine (e.g. 'ssh host
+// glancy'), as long as the scene can be found there at the same path.
+// Returns false and sets 'error' if any worker fails.
+inline bool DistributeRender(std::string const& worker_command,
+                             std::string const& scene_path,
+                             std::size_t number_shards,
+                             ShardSplit split,
+                             std::uint64_t seed,
+                             std::string const& output_path,
+                             std::string& error)
+{
+    using distributed_render_detail::Quote;
+    if (number_shards == 0U) {
+        error = "no shards to render";
+        return false;
+    }
+    std::vector<std::FILE*> workers;
+    for (std::size_t shard = 0; shard < number_shards; ++shard) {
+        std::string const command = worker_command + " --worker " + Quote(scene_path) + " " +
+                                    ShardSplitName(split) + " " + std::to_string(shard) + " " +
+                                    std::to_string(number_shards) + " " + std::to_string(seed);
+        std::FILE* const worker = GLANCY_POPEN(command.c_str(), "r");
+        if (!worker) {
+            error = "could not start worker: " + command;
+            break;
+        }
+        workers.push_back(worker);
+    }
+
+    std::optional<AccumulationBuffer> buffer;
+    for (std::size_t shard = 0; shard < workers.size(); ++shard) {
+        std::FILE* const worker = workers[shard];
+        bool const read = error.empty() && distributed_render_detail::ReadShard(worker, buffer);
+        if (GLANCY_PCLOSE(worker) != 0 || !read) {
+            if (error.empty())
+                error = "worker of shard " + std::to_string(shard) + " failed";
+        }
+    }
+    if (!error.empty())
+        return false;
+
+    Image image(buffer->Width(), buffer->Height());
+    buffer->Resolve(&distributed_render_detail::GammaCorrection, image);
+    if (!image.Save(output_path)) {
+        error = "could not save " + output_path;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace plemma::glancy
+
+#undef GLANCY_POPEN
+#undef GLANCY_PCLOSE
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include "types.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// What Renderer writes in each pixel. Every mode but kBeauty renders a
+// false-colour heatmap of the mean cost of the samples of each pixel, to
+// spot the regions of a scene that are expensive to render and compare
+// BVHs on them.
+enum class RenderMode
+{
+    // Light arriving to the camera, i.e. the actual image
+    kBeauty,
+    // BVH nodes entered per sample, shadow rays included
+    kNodeVisits,
+    // Ray-primitive intersection tests per sample, shadow rays included
+    kPrimitiveTests,
+    // Bounces of the path of each sample
+    kPathLength,
+    // Time spent per sample
+    kTime
+};
+
+inline bool ParseRenderMode(std::string const& text, RenderMode& mode) noexcept
+{
+    constexpr std::array<std::pair<char const*, RenderMode>, 5> kNames{
+        {{"beauty", RenderMode::kBeauty},
+         {"nodes", RenderMode::kNodeVisits},
+         {"primitives", RenderMode::kPrimitiveTests},
+         {"paths", RenderMode::kPathLength},
+         {"time", RenderMode::kTime}}};
+    for (auto const& [name, named_mode] : kNames) {
+        if (text == name) {
+            mode = named_mode;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether 'mode' can be rendered by this build. All modes but kBeauty and
+// kTime count work with the ray statistics, so they need builds with
+// GLANCY_ENABLE_RAY_STATISTICS.
+constexpr bool IsRenderModeAvailable(RenderMode mode) noexcept
+{
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+    static_cast<void>(mode);
+    return true;
+#else
+    return mode == RenderMode::kBeauty || mode == RenderMode::kTime;
+#endif
+}
+
+// Colour of 'x' in [0, 1] in a heatmap: black for cheap, through purple,
+// red and orange, to pale yellow for expensive. Components are in [0, 1].
+inline Vec3 HeatmapColor(RealNum x) noexcept
+{
+    constexpr std::size_t kStops = 5U;
+    Vec3 const stops[kStops] = {Vec3(Real(0), Real(0), Real(0.02)),
+                                Vec3(Real(0.35), Real(0.05), Real(0.5)),
+                                Vec3(Real(0.85), Real(0.2), Real(0.25)),
+                                Vec3(Real(0.98), Real(0.6), Real(0.05)),
+                                Vec3(Real(0.99), Real(0.99), Real(0.75))};
+    RealNum const position = std::clamp(x, Real(0), Real(1)) * Real(kStops - 1U);
+    auto const stop = std::min(static_cast<std::size_t>(position), kStops - 2U);
+    RealNum const weight = position - Real(stop);
+    return (Real(1) - weight) * stops[stop] + weight * stops[stop + 1U];
+}
+
+}  // namespace plemma::glancy
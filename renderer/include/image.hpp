@@ -4,6 +4,7 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include "profiler.hpp"
 
 namespace plemma::glancy {
 
@@ -15,14 +16,21 @@ class Image
     {
         pixels_[h_index][v_index] = color;
     }
-    void Save(std::string const& file_path) const;
+    [[nodiscard]] Vec3 const& Pixel(size_t h_index, size_t v_index) const
+    {
+        return pixels_[h_index][v_index];
+    }
+    // Writes the image to 'file_path' as a PPM file. Returns false if it
+    // could not be written.
+    [[nodiscard]] bool Save(std::string const& file_path) const;
 
   private:
     std::vector<std::vector<Vec3> > pixels_{};
 };
 
-void Image::Save(std::string const& file_path) const
+inline bool Image::Save(std::string const& file_path) const
 {
+    GLANCY_PROFILE_ZONE("Save");
     std::ofstream my_image;
     my_image.open(file_path);
     size_t width = pixels_.size();
@@ -37,6 +45,7 @@ void Image::Save(std::string const& file_path) const
         }
     }
     my_image.close();
+    return !my_image.fail();
 }
 
 }  // namespace plemma::glancy
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <thread>
+
+namespace plemma::glancy {
+
+// Reports the progress of a render from a thread of its own, so that the
+// threads rendering only bump an atomic counter and never wait for the
+// output. Every 'interval' it writes the share of samples done, the
+// camera rays traced per second since the last report and the estimated
+// time left; the last report is written when it is destroyed. A zero
+// interval makes it silent. Renders that stop at a 'deadline' report the
+// time left until it if that is sooner than the estimate.
+class ProgressReporter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    ProgressReporter(std::uint64_t total_samples,
+                     Clock::duration interval,
+                     std::ostream& out,
+                     Clock::time_point deadline = Clock::time_point::max())
+        : total_samples_(total_samples),
+          interval_(interval),
+          out_(out),
+          start_(Clock::now()),
+          deadline_(deadline)
+    {
+        if (interval_ > Clock::duration::zero())
+            reporter_ = std::thread(&ProgressReporter::Report, this);
+    }
+
+    ~ProgressReporter()
+    {
+        if (!reporter_.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        stop_.notify_one();
+        reporter_.join();
+    }
+
+    ProgressReporter(ProgressReporter const&) = delete;
+    ProgressReporter& operator=(ProgressReporter const&) = delete;
+
+    // Adds 'samples' to the samples done. Safe to call from any thread.
+    void Add(std::uint64_t samples) noexcept
+    {
+        done_.fetch_add(samples, std::memory_order_relaxed);
+    }
+
+  private:
+    void Report()
+    {
+        std::uint64_t previous_done = 0U;
+        Clock::time_point previous_time = start_;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            bool const stopping = stop_.wait_for(lock, interval_, [this] { return stopping_; });
+            std::uint64_t const done = done_.load(std::memory_order_relaxed);
+            Clock::time_point const now = Clock::now();
+            double const seconds = std::chrono::duration<double>(now - previous_time).count();
+            double const elapsed = std::chrono::duration<double>(now - start_).count();
+
+            // The line is built first so that it is written at once
+            std::ostringstream line;
+            line << (total_samples_ > 0U ? 100U * done / total_samples_ : 100U)
+                 << "% processing completed";
+            if (seconds > 0.0 && !stopping) {
+                line << " (" << static_cast<std::uint64_t>(double(done - previous_done) / seconds)
+                     << " camera rays/s";
+                if (done > 0U && done < total_samples_) {
+                    double left = elapsed * double(total_samples_ - done) / double(done);
+                    if (deadline_ != Clock::time_point::max()) {
+                        double const budget_left =
+                            std::chrono::duration<double>(deadline_ - now).count();
+                        left = std::max(0.0, std::min(left, budget_left));
+                    }
+                    line << ", " << std::fixed << std::setprecision(1) << left << " s left";
+                }
+                line << ")";
+            }
+            else if (stopping) {
+                line << " in " << static_cast<std::uint64_t>(elapsed * 1000.0) << " ms";
+            }
+            line << ".\n";
+            out_ << line.str() << std::flush;
+
+            if (stopping)
+                return;
+            previous_done = done;
+            previous_time = now;
+        }
+    }
+
+    std::uint64_t const total_samples_;
+    Clock::duration const interval_;
+    std::ostream& out_;
+    Clock::time_point const start_;
+    Clock::time_point const deadline_;
+    std::atomic<std::uint64_t> done_{0U};
+    std::mutex mutex_;
+    std::condition_variable stop_;
+    bool stopping_ = false;
+    std::thread reporter_;
+};
+
+}  // namespace plemma::glancy
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "scene_file_tokens.hpp"
+#include "scene_settings.hpp"
+
+namespace plemma::glancy {
+
+// Render requested to a RenderService. It is described in a text file
+// with the same syntax as scene files:
+//
+//   scene <scene file>
+//   output <image file>
+//   priority <n>
+//   image <width> <height>
+//   samples <rays per pixel>
+//   max_depth <maximum number of bounces>
+//   time_budget <seconds>
+//   camera <options as in scene files>
+//
+// Only the scene and the output are mandatory. The rest override what the
+// scene file gives; camera options change the camera of the scene. Jobs
+// with higher priority are rendered first (default is 0). Jobs with a
+// time budget stop adding samples when it is over (see
+// Renderer::SetTimeBudget).
+struct RenderJob
+{
+    std::string scene_path;
+    std::string output_path;
+    std::uint64_t priority = 0U;
+    std::optional<std::size_t> width;
+    std::optional<std::size_t> height;
+    std::optional<std::size_t> samples_per_pixel;
+    std::optional<std::uint16_t> max_depth;
+    // Seconds
+    std::optional<RealNum> time_budget;
+    // Text of the camera statements, applied once the scene is loaded
+    std::string camera_options;
+
+    // Settings of the scene with the ones of the job applied
+    [[nodiscard]] RenderSettings Apply(RenderSettings settings) const noexcept
+    {
+        settings.width = width.value_or(settings.width);
+        settings.height = height.value_or(settings.height);
+        settings.samples_per_pixel = samples_per_pixel.value_or(settings.samples_per_pixel);
+        settings.max_depth = max_depth.value_or(settings.max_depth);
+        return settings;
+    }
+
+    // Applies the camera options of the job to 'camera'. Returns false if
+    // any is invalid.
+    [[nodiscard]] bool Apply(CameraSettings& camera) const noexcept
+    {
+        std::string_view rest(camera_options);
+        while (!rest.empty()) {
+            std::size_t const line_end = std::min(rest.find('\n'), rest.size());
+            scene_file_detail::Tokens tokens(rest.substr(0U, line_end));
+            rest.remove_prefix(std::min(line_end + 1U, rest.size()));
+            if (!scene_file_detail::ParseCameraOptions(tokens, camera, true))
+                return false;
+        }
+        return true;
+    }
+};
+
+// Parses the job described by 'text' into 'job'. Returns false and sets
+// 'error' if it is not valid.
+inline bool ParseRenderJob(std::string_view text, RenderJob& job, std::string& error)
+{
+    std::size_t line_number = 0U;
+    auto const fail = [&](char const* message) {
+        error = "line " + std::to_string(line_number) + ": " + message;
+        return false;
+    };
+    while (!text.empty()) {
+        ++line_number;
+        std::size_t const line_end = std::min(text.find('\n'), text.size());
+        std::string_view const line = text.substr(0U, line_end);
+        text.remove_prefix(std::min(line_end + 1U, text.size()));
+        scene_file_detail::Tokens tokens(line);
+        std::string_view keyword;
+        if (!tokens.Next(keyword))
+            continue;
+
+        if (keyword == "scene" || keyword == "output") {
+            std::string_view path;
+            if (!tokens.Next(path))
+                return fail("expected path");
+            (keyword == "scene" ? job.scene_path : job.output_path) = std::string(path);
+        }
+        else if (keyword == "priority") {
+            if (!tokens.Next(job.priority))
+                return fail("expected priority");
+        }
+        else if (keyword == "image") {
+            std::uint64_t width, height;
+            if (!tokens.Next(width) || !tokens.Next(height) || width == 0U || height == 0U)
+                return fail("expected width and height of the image");
+            job.width = width;
+            job.height = height;
+        }
+        else if (keyword == "samples") {
+            std::uint64_t samples;
+            if (!tokens.Next(samples) || samples == 0U)
+                return fail("expected number of rays per pixel");
+            job.samples_per_pixel = samples;
+        }
+        else if (keyword == "max_depth") {
+            std::uint64_t max_depth;
+            if (!tokens.Next(max_depth) || max_depth > std::numeric_limits<std::uint16_t>::max())
+                return fail("expected maximum depth");
+            job.max_depth = static_cast<std::uint16_t>(max_depth);
+        }
+        else if (keyword == "time_budget") {
+            RealNum seconds;
+            if (!tokens.Next(seconds) || !(seconds > Real(0)))
+                return fail("expected time budget in seconds");
+            job.time_budget = seconds;
+        }
+        else if (keyword == "camera") {
+            // Checked now, applied when the scene is loaded
+            CameraSettings camera;
+            if (!scene_file_detail::ParseCameraOptions(tokens, camera, true))
+                return fail("invalid camera option");
+            job.camera_options.append(line.substr(line.find("camera") + 6U));
+            job.camera_options.push_back('\n');
+            continue;
+        }
+        else {
+            return fail("unknown statement");
+        }
+        if (!tokens.AtEnd())
+            return fail("unexpected tokens at the end of the statement");
+    }
+    if (job.scene_path.empty() || job.output_path.empty()) {
+        error = "scene and output are mandatory";
+        return false;
+    }
+    return true;
+}
+
+// Job waiting in the queue of a RenderService
+struct QueuedRenderJob
+{
+    RenderJob job;
+    // Path of the job file, without the extension of its state
+    std::string file_path;
+    // Order in which the job was queued
+    std::uint64_t sequence = 0U;
+};
+
+// Position in 'queue' of the job to render next: the one with the highest
+// priority, and the first queued among them. Returns the size of 'queue'
+// if it is empty.
+inline std::size_t NextRenderJob(std::vector<QueuedRenderJob> const& queue) noexcept
+{
+    std::size_t best = queue.size();
+    for (std::size_t i = 0U; i < queue.size(); ++i) {
+        if (best == queue.size() || queue[i].job.priority > queue[best].job.priority ||
+            (queue[i].job.priority == queue[best].job.priority &&
+             queue[i].sequence < queue[best].sequence))
+            best = i;
+    }
+    return best;
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "binary_scene.hpp"
+#include "file_scene.hpp"
+#include "image.hpp"
+#include "render_job.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "scene_settings.hpp"
+
+namespace plemma::glancy {
+
+// Long running process rendering the jobs (see RenderJob) dropped in a
+// spool directory as '<name>.job' files, so that batches of renders do
+// not pay for starting glancy and preparing their scenes once per image.
+//
+// Any '.job' file is read as soon as it is seen, so clients must write
+// jobs under another name (e.g. '<name>.job.tmp', which is ignored) and
+// then rename them to '<name>.job' in the same directory, which shows
+// the whole file at once. Job files get the extension of their state
+// appended as they go through the service: '.queued' once read, '.running'
+// while rendered and '.done' or '.failed' at the end (also when the image
+// can not be saved), the latter with the error appended. Relative paths
+// in jobs are relative to the spool directory. Jobs are rendered by a pool
+// of workers, highest priority first (then oldest first), each worker
+// rendering a job at a time. Loaded scenes are kept for the next jobs
+// using them, and reloaded if their files change. Scenes are only read
+// once loaded, so jobs of the same scene are rendered at the same time by
+// different workers, each of them with its own renderer and BVH of the
+// scene, which are kept too.
+// Creating a file named 'stop' in the spool directory stops the service
+// once the jobs being rendered are done; jobs still queued are picked up
+// again by the next service using the directory. Builds with
+// GLANCY_ENABLE_RAY_STATISTICS then print the work done per ray over the
+// jobs of all the workers.
+class RenderService
+{
+  public:
+    // Scenes kept in memory between jobs. The least recently used ones
+    // are dropped when there are more.
+    static constexpr std::size_t kMaxCachedScenes = 4U;
+
+    RenderService(std::string spool_directory, std::size_t number_workers)
+        : spool_directory_(std::move(spool_directory)),
+          number_workers_(std::max<std::size_t>(number_workers, 1U))
+    {}
+
+    // Serves jobs until stopped (see class description). Returns false if
+    // the spool directory can not be read.
+    bool Run();
+
+  private:
+    static RealNum GammaCorrection(RealNum x) noexcept { return std::sqrt(x); }
+    using ServiceRenderer = Renderer<RealNum (*)(RealNum)>;
+
+    // Renderer of a worker for a scene, with the world prepared for the
+    // interval [time_from, time_to] if 'prepared' is true
+    struct WorkerRenderer
+    {
+        ServiceRenderer renderer{&GammaCorrection, 1U, 1U, 1U, 1U};
+        bool prepared = false;
+        RealNum time_from = Real(0);
+        RealNum time_to = Real(0);
+    };
+
+    struct CachedScene
+    {
+        // Held by the worker loading the scene, so that the others wait
+        // for it instead of loading it again
+        std::mutex load_mutex;
+        bool loaded = false;
+        std::unique_ptr<Scene> scene;
+        RenderSettings settings;
+        CameraSettings camera;
+        std::filesystem::file_time_type modified;
+        // Time budget of the jobs that don't give one
+        ProgressReporter::Clock::duration time_budget;
+        // One per worker, each only used by its worker
+        std::vector<WorkerRenderer> renderers;
+        std::uint64_t last_used = 0U;
+    };
+
+    // Renames the new job files and queues them. If 'recover' is true,
+    // jobs left queued or running by a previous service are queued too.
+    void ClaimJobs(bool recover);
+    void Work(std::size_t worker);
+    bool RenderQueuedJob(QueuedRenderJob const& queued, std::size_t worker, std::string& error);
+    // Scene cached for 'path', loading it if needed
+    std::shared_ptr<CachedScene> AcquireScene(std::string const& path, std::string& error);
+    template <typename SceneFromFile>
+    static bool LoadScene(std::string const& path, CachedScene& cached, std::string& error);
+    std::string Resolve(std::string const& path) const;
+
+    std::string spool_directory_;
+    std::size_t number_workers_;
+
+    std::mutex mutex_;
+    std::condition_variable job_available_;
+    std::vector<QueuedRenderJob> queue_;
+    std::uint64_t next_sequence_ = 0U;
+    bool stopping_ = false;
+    std::unordered_map<std::string, std::shared_ptr<CachedScene> > scenes_;
+    std::uint64_t next_use_ = 0U;
+};
+
+inline bool RenderService::Run()
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(spool_directory_, error)) {
+        std::cerr << "Spool directory " << spool_directory_ << " can not be read" << std::endl;
+        return false;
+    }
+    std::cout << "Serving render jobs from " << spool_directory_ << " with " << number_workers_
+              << " workers" << std::endl;
+
+    ClaimJobs(true);
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < number_workers_; ++i)
+        workers.emplace_back(&RenderService::Work, this, i);
+
+    std::filesystem::path const stop_file = std::filesystem::path(spool_directory_) / "stop";
+    while (!std::filesystem::exists(stop_file, error)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        ClaimJobs(false);
+    }
+    std::filesystem::remove(stop_file, error);
+    std::cout << "Stopping once the jobs being rendered are done" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    job_available_.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+    std::cout << "Ray statistics of the jobs rendered:" << std::endl;
+    WriteRayStatistics(std::cout, TotalRayStatistics());
+#endif
+    return true;
+}
+
+inline void RenderService::ClaimJobs(bool recover)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> job_files;
+    for (auto const& entry : std::filesystem::directory_iterator(spool_directory_, error)) {
+        if (!entry.is_regular_file(error))
+            continue;
+        std::string const extension = entry.path().extension().string();
+        if (extension == ".job" || (recover && (extension == ".queued" || extension == ".running")))
+            job_files.push_back(entry.path());
+    }
+    // Oldest names first, so that jobs named by date keep their order
+    std::sort(job_files.begin(), job_files.end());
+
+    for (std::filesystem::path const& job_file : job_files) {
+        std::string file_path = job_file.string();
+        if (job_file.extension() != ".job")
+            file_path = (job_file.parent_path() / job_file.stem()).string();
+        std::filesystem::rename(job_file, file_path + ".queued", error);
+        if (error)
+            continue;
+
+        QueuedRenderJob queued{RenderJob(), file_path, 0U};
+        std::ifstream file(file_path + ".queued");
+        std::string const text(std::istreambuf_iterator<char>(file), {});
+        std::string parse_error;
+        if (!ParseRenderJob(text, queued.job, parse_error)) {
+            std::ofstream(file_path + ".queued", std::ios::app)
+                << "\n# error: " << parse_error << "\n";
+            std::filesystem::rename(file_path + ".queued", file_path + ".failed", error);
+            std::cerr << "Invalid job " << file_path << ": " << parse_error << std::endl;
+            continue;
+        }
+        queued.job.scene_path = Resolve(queued.job.scene_path);
+        queued.job.output_path = Resolve(queued.job.output_path);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued.sequence = next_sequence_++;
+            queue_.push_back(std::move(queued));
+        }
+        job_available_.notify_one();
+    }
+}
+
+inline void RenderService::Work(std::size_t worker)
+{
+    while (true) {
+        QueuedRenderJob queued;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_available_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (stopping_)
+                return;
+            auto const best = queue_.begin() + std::ptrdiff_t(NextRenderJob(queue_));
+            queued = std::move(*best);
+            queue_.erase(best);
+        }
+
+        std::error_code error;
+        std::filesystem::rename(queued.file_path + ".queued", queued.file_path + ".running", error);
+        std::cout << "Rendering job " << queued.file_path << std::endl;
+        std::string render_error;
+        bool const rendered = RenderQueuedJob(queued, worker, render_error);
+        if (!rendered) {
+            std::ofstream(queued.file_path + ".running", std::ios::app)
+                << "\n# error: " << render_error << "\n";
+            std::cerr << "Job " << queued.file_path << " failed: " << render_error << std::endl;
+        }
+        std::filesystem::rename(queued.file_path + ".running",
+                                queued.file_path + (rendered ? ".done" : ".failed"),
+                                error);
+    }
+}
+
+inline bool RenderService::RenderQueuedJob(QueuedRenderJob const& queued,
+                                           std::size_t worker,
+                                           std::string& error)
+{
+    RenderJob const& job = queued.job;
+    std::shared_ptr<CachedScene> const cached = AcquireScene(job.scene_path, error);
+    if (!cached)
+        return false;
+
+    RenderSettings const settings = job.Apply(cached->settings);
+    CameraSettings camera = cached->camera;
+    if (!job.Apply(camera)) {
+        error = "invalid camera option";
+        return false;
+    }
+    // Cameras of scene files are checked as they are loaded, but not once
+    // changed by the job
+    if (!IsValidCamera(camera)) {
+        error = scene_file_detail::kInvalidCamera;
+        return false;
+    }
+
+    WorkerRenderer& prepared = cached->renderers[worker];
+    ServiceRenderer& renderer = prepared.renderer;
+    renderer.SetImageSettings(
+        settings.width, settings.height, settings.samples_per_pixel, settings.max_depth);
+    renderer.SetTimeBudget(cached->time_budget);
+    if (job.time_budget) {
+        renderer.SetTimeBudget(std::chrono::duration_cast<ProgressReporter::Clock::duration>(
+            std::chrono::duration<double>(*job.time_budget)));
+    }
+    // The world is only prepared again for shutter intervals out of the
+    // one it was prepared for
+    if (!prepared.prepared || camera.time_from < prepared.time_from ||
+        camera.time_to > prepared.time_to) {
+        renderer.Prepare(*cached->scene, camera.time_from, camera.time_to);
+        prepared.prepared = true;
+        prepared.time_from = camera.time_from;
+        prepared.time_to = camera.time_to;
+    }
+    else {
+        renderer.Refit(camera.time_from, camera.time_to);
+    }
+
+    Image image(settings.width, settings.height);
+    renderer.Render(*cached->scene, MakeCamera(camera, settings), image);
+    if (!image.Save(job.output_path)) {
+        error = "could not save " + job.output_path;
+        return false;
+    }
+    return true;
+}
+
+inline std::shared_ptr<RenderService::CachedScene> RenderService::AcquireScene(
+    std::string const& path,
+    std::string& error)
+{
+    std::error_code file_error;
+    auto const modified = std::filesystem::last_write_time(path, file_error);
+    if (file_error) {
+        error = "could not open " + path;
+        return nullptr;
+    }
+
+    std::shared_ptr<CachedScene> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<CachedScene>& entry = scenes_[path];
+        // Outdated scenes are replaced, and dropped once the jobs
+        // rendering them are done
+        if (!entry || entry->modified != modified) {
+            entry = std::make_shared<CachedScene>();
+            entry->modified = modified;
+        }
+        entry->last_used = next_use_++;
+        cached = entry;
+        while (scenes_.size() > kMaxCachedScenes) {
+            auto oldest = scenes_.begin();
+            for (auto it = scenes_.begin(); it != scenes_.end(); ++it) {
+                if (it->second->last_used < oldest->second->last_used)
+                    oldest = it;
+            }
+            scenes_.erase(oldest);
+        }
+    }
+
+    std::lock_guard<std::mutex> load_lock(cached->load_mutex);
+    if (cached->loaded)
+        return cached;
+    std::cout << "Loading scene from " << path << std::endl;
+    cached->renderers = std::vector<WorkerRenderer>(number_workers_);
+    for (WorkerRenderer& worker_renderer : cached->renderers)
+        ApplyEnvironmentSettings(worker_renderer.renderer);
+    cached->time_budget = cached->renderers.front().renderer.TimeBudget();
+    bool const loaded = IsBinarySceneFile(path) ? LoadScene<BinaryScene>(path, *cached, error)
+                                                : LoadScene<FileScene>(path, *cached, error);
+    if (!loaded) {
+        // Dropped, so that the next job of the scene tries again
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const it = scenes_.find(path);
+        if (it != scenes_.end() && it->second == cached)
+            scenes_.erase(it);
+        return nullptr;
+    }
+    cached->loaded = true;
+    return cached;
+}
+
+template <typename SceneFromFile>
+bool RenderService::LoadScene(std::string const& path, CachedScene& cached, std::string& error)
+{
+    auto scene = std::make_unique<SceneFromFile>(path);
+    scene->LoadWorld();
+    if (!scene->IsLoaded()) {
+        error = scene->Error();
+        return false;
+    }
+    cached.settings = scene->Settings();
+    cached.camera = scene->CameraSetup();
+    cached.scene = std::move(scene);
+    return true;
+}
+
+inline std::string RenderService::Resolve(std::string const& path) const
+{
+    std::filesystem::path const resolved(path);
+    if (resolved.is_absolute())
+        return path;
+    return (std::filesystem::path(spool_directory_) / resolved).string();
+}
+
+}  // namespace plemma::glancy
@@ -1,12 +1,25 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <string>
+#include "accumulation_buffer.hpp"
+#include "arena.hpp"
 #include "bounding_volume_hierarchy.hpp"
+#include "bvh_cache.hpp"
 #include "camera.hpp"
+#include "heatmap.hpp"
 #include "image.hpp"
+#include "material.hpp"
+#include "material_table.hpp"
+#include "profiler.hpp"
+#include "progress_reporter.hpp"
+#include "ray_statistics.hpp"
 #include "scene.hpp"
+#include "utilities.hpp"
 
 namespace plemma::glancy {
 
@@ -22,106 +35,476 @@ class Renderer
           maximum_depth_(maxd)
     {}
 
+    // Renders 'scene' seen from 'camera' into 'image'. Same as calling
+    // Prepare for the shutter interval of the camera and then Render.
     void ProcessScene(Scene const& scene, Camera const& camera, Image& image) noexcept;
 
+    // Builds the BVH of the world of 'scene' for the interval [t0, t1].
+    // Several images can then be rendered from it, e.g. the frames of an
+    // animation spanning that interval. The scene is only read, so it can
+    // be shared with other renderers.
+    void Prepare(Scene const& scene, RealNum t0, RealNum t1) noexcept;
+    // Tightens the BVH built by Prepare around the hittables in [t0, t1],
+    // which must be inside the interval it was built for. The shape of
+    // the tree is kept, and nothing is done if no hittable moves.
+    void Refit(RealNum t0, RealNum t1) noexcept;
+    // Renders 'scene', which must have been prepared for an interval
+    // containing the shutter interval of 'camera'. Builds with
+    // GLANCY_ENABLE_RAY_STATISTICS add the work done to the ray statistics
+    // of the thread (see TotalRayStatistics).
+    void Render(Scene const& scene, Camera const& camera, Image& image) noexcept;
+    // Adds to 'tile' the colors of its samples of its pixels, as Render
+    // would find them. Each sample is drawn from its own random sequence,
+    // whose 64-bit seed is a hash of the seed of the renderer, the pixel
+    // and the index of the sample, so that an image is the same however
+    // it is split in tiles (and whichever process renders them). The
+    // samples done are added to 'progress', if any, row by row.
+    void Accumulate(Scene const& scene,
+                    Camera const& camera,
+                    AccumulationTile& tile,
+                    ProgressReporter* progress = nullptr) noexcept;
+    // Accumulates into 'buffer', of the size of the image, passes of
+    // samples over the whole image until the time budget is over or all
+    // the samples per pixel are done, as Render does when there is a
+    // budget. Every pixel ends with the same number of samples, and with
+    // a budget of zero or less all of them are done in a single pass.
+    void AccumulateWithinBudget(Scene const& scene,
+                                Camera const& camera,
+                                AccumulationBuffer& buffer) noexcept;
+
+    // How often Render reports its progress to the standard output (see
+    // ProgressReporter), every second by default. Zero silences it.
+    void SetProgressInterval(ProgressReporter::Clock::duration interval) noexcept
+    {
+        progress_interval_ = interval;
+    }
+    [[nodiscard]] ProgressReporter::Clock::duration ProgressInterval() const noexcept
+    {
+        return progress_interval_;
+    }
+
+    // Wall-clock time Render may take. If it is above zero (default is
+    // zero), the image is rendered in passes adding samples to every
+    // pixel, and no pass is started if it would not end in time, so that
+    // the image has the same number of samples everywhere. The samples per
+    // pixel are then the most Render takes. Preparing the scene is not
+    // included.
+    void SetTimeBudget(ProgressReporter::Clock::duration budget) noexcept
+    {
+        time_budget_ = budget;
+    }
+    [[nodiscard]] ProgressReporter::Clock::duration TimeBudget() const noexcept
+    {
+        return time_budget_;
+    }
+
+    // What is rendered (see RenderMode), the image by default. The mode
+    // must be available in this build (see IsRenderModeAvailable).
+    void SetMode(RenderMode mode) noexcept { mode_ = mode; }
+    [[nodiscard]] RenderMode Mode() const noexcept { return mode_; }
+
+    // Seed of the random sequences of the samples. It is random unless set.
+    void SetSeed(std::uint64_t seed) noexcept { seed_ = seed; }
+    [[nodiscard]] std::uint64_t Seed() const noexcept { return seed_; }
+
+    // Changes the size and quality of the images rendered from now on,
+    // keeping the prepared world
+    void SetImageSettings(size_t h_pixels, size_t v_pixels, size_t rays_pixel, uint16_t maxd)
+    {
+        num_horizontal_pixels_ = h_pixels;
+        num_vertical_pixels_ = v_pixels;
+        num_rays_per_pixel_ = rays_pixel;
+        maximum_depth_ = maxd;
+    }
+
+    // Sets the directory where built BVHs are cached between runs. If it
+    // is empty (default), the BVH is always built from scratch.
+    void SetBVHCacheDirectory(std::string directory)
+    {
+        bvh_cache_directory_ = std::move(directory);
+    }
+
   private:
-    [[nodiscard]] Vec3 GetColor(Hittable const& target, Ray const& r, uint16_t depth) const
-        noexcept;
+    // Shadow rays stop this fraction of their length short of the light
+    // they are cast to, so that the light does not occlude itself
+    static constexpr RealNum kShadowRayMargin = Real(0.001);
+
+    // Returns the light arriving along the ray 'r'. 'scattering_pdf' is the
+    // density with which 'r' was chosen when scattered by a material, or 0
+    // if it was not chosen from a density (camera rays and specular bounces).
+    // 'excluded' is a hittable 'r' can not hit, if any (see
+    // ExcludedHittable).
+    [[nodiscard]] Vec3 GetColor(Scene const& scene,
+                                Ray const& r,
+                                uint16_t depth,
+                                RealNum scattering_pdf,
+                                Hittable const* excluded = nullptr) const noexcept;
+    // Hittable of 'rec' if a ray leaving its point in 'direction' can not
+    // hit it again, so that tracing the ray can skip it, or null otherwise
+    [[nodiscard]] static Hittable const* ExcludedHittable(HitRecord const& rec,
+                                                          Vec3 const& direction) noexcept
+    {
+        // Normals face the side the hit came from, so going out of the
+        // surface is staying on that side only for hits on the outside
+        bool const outwards = (Dot(direction, rec.normal) > Real(0)) == rec.front_face;
+        bool const leaves = rec.object != nullptr && outwards && rec.object->IsConvex();
+        return leaves ? rec.object : nullptr;
+    }
+    // Next event estimation: returns the light arriving directly from a
+    // randomly sampled light of the scene to the point of 'rec' and leaving
+    // it towards the origin of 'r', weighted with multiple importance sampling
+    [[nodiscard]] Vec3 SampleLights(Scene const& scene,
+                                    Ray const& r,
+                                    HitRecord const& rec) const noexcept;
+    // Cost of tracing the camera ray 'r', measured as 'mode_' says
+    [[nodiscard]] RealNum MeasureCost(Scene const& scene, Ray const& r) const noexcept;
     void PreprocessWorld(HittableList const& world, RealNum t0, RealNum t1) noexcept;
 
+    // Interior nodes of 'ordered_world_'. It is declared before it so that
+    // it outlives the tree.
+    Arena bvh_arena_;
     BoundingVolumeHierarchy ordered_world_;
+    size_t world_size_ = 0U;
+    // Whether the box of any hittable of the world changes with time
+    bool world_moves_ = false;
+    std::string bvh_cache_directory_;
     UnaryOp GammaCorrection;
-    const size_t num_horizontal_pixels_;
-    const size_t num_vertical_pixels_;
-    const size_t num_rays_per_pixel_;
-    const uint16_t maximum_depth_;
+    RenderMode mode_ = RenderMode::kBeauty;
+    ProgressReporter::Clock::duration progress_interval_ = std::chrono::seconds(1);
+    ProgressReporter::Clock::duration time_budget_ = ProgressReporter::Clock::duration::zero();
+    std::uint64_t seed_ = RandomSeed();
+    size_t num_horizontal_pixels_;
+    size_t num_vertical_pixels_;
+    size_t num_rays_per_pixel_;
+    uint16_t maximum_depth_;
 };
 
+// Applies to 'renderer' the settings given by environment variables, if
+// set: GLANCY_BVH_CACHE_DIR (see SetBVHCacheDirectory),
+// GLANCY_PROGRESS_INTERVAL_MS (see SetProgressInterval, 0 for batch runs)
+// and GLANCY_TIME_BUDGET_S (see SetTimeBudget, in seconds)
+template <typename UnaryOp>
+void ApplyEnvironmentSettings(Renderer<UnaryOp>& renderer)
+{
+    if (char const* bvh_cache_directory = std::getenv("GLANCY_BVH_CACHE_DIR"))
+        renderer.SetBVHCacheDirectory(bvh_cache_directory);
+    if (char const* progress_interval = std::getenv("GLANCY_PROGRESS_INTERVAL_MS"))
+        renderer.SetProgressInterval(
+            std::chrono::milliseconds(std::strtoull(progress_interval, nullptr, 10)));
+    if (char const* time_budget = std::getenv("GLANCY_TIME_BUDGET_S")) {
+        renderer.SetTimeBudget(std::chrono::duration_cast<ProgressReporter::Clock::duration>(
+            std::chrono::duration<double>(std::strtod(time_budget, nullptr))));
+    }
+}
+
 template <typename UnaryOp>
 void Renderer<UnaryOp>::ProcessScene(Scene const& scene,
                                      Camera const& camera,
                                      Image& image) noexcept
 {
+    Prepare(scene, camera.TimeShutterOpens(), camera.TimeShutterCloses());
+    Render(scene, camera, image);
+}
+
+template <typename UnaryOp>
+void Renderer<UnaryOp>::Prepare(Scene const& scene, RealNum t0, RealNum t1) noexcept
+{
+    GLANCY_PROFILE_ZONE("Prepare");
+    std::cout << "Pre-processing scene for faster rendering" << std::endl;
+    PreprocessWorld(scene.World(), t0, t1);
+}
+
+template <typename UnaryOp>
+void Renderer<UnaryOp>::Refit(RealNum t0, RealNum t1) noexcept
+{
+    GLANCY_PROFILE_ZONE("Refit");
+    if (world_moves_ && world_size_ > 0U)
+        ordered_world_.Refit(world_size_, t0, t1);
+}
+
+template <typename UnaryOp>
+void Renderer<UnaryOp>::Render(Scene const& scene, Camera const& camera, Image& image) noexcept
+{
+    AccumulationBuffer buffer(num_horizontal_pixels_, num_vertical_pixels_);
+    if (time_budget_ > ProgressReporter::Clock::duration::zero()) {
+        AccumulateWithinBudget(scene, camera, buffer);
+    }
+    else {
+        AccumulationTile tile(
+            0U, 0U, num_horizontal_pixels_, num_vertical_pixels_, 0U, num_rays_per_pixel_);
+        {
+            ProgressReporter progress(std::uint64_t(num_horizontal_pixels_) *
+                                          num_vertical_pixels_ * num_rays_per_pixel_,
+                                      progress_interval_,
+                                      std::cout);
+            Accumulate(scene, camera, tile, &progress);
+        }
+        buffer.Add(tile);
+    }
+    GLANCY_PROFILE_ZONE("Resolve");
+    if (mode_ == RenderMode::kBeauty)
+        buffer.Resolve(GammaCorrection, image);
+    else
+        buffer.ResolveHeatmap(image);
+}
+
+template <typename UnaryOp>
+void Renderer<UnaryOp>::AccumulateWithinBudget(Scene const& scene,
+                                               Camera const& camera,
+                                               AccumulationBuffer& buffer) noexcept
+{
+    using Clock = ProgressReporter::Clock;
+    bool const budgeted = time_budget_ > Clock::duration::zero();
+    Clock::time_point const deadline = budgeted ? Clock::now() + time_budget_
+                                                : Clock::time_point::max();
+    // Progress is measured against every sample the budget allows
+    ProgressReporter progress(std::uint64_t(num_horizontal_pixels_) * num_vertical_pixels_ *
+                                  num_rays_per_pixel_,
+                              progress_interval_,
+                              std::cout,
+                              deadline);
+    // Passes start with a sample per pixel and grow while they are short
+    // compared to the budget, to keep the cost of each pass low
+    size_t pass_samples = budgeted ? 1U : num_rays_per_pixel_;
+    size_t samples_done = 0U;
+    // Passes keep adding to the same tile, so that the image is the same
+    // as if its samples were rendered in one go
+    AccumulationTile tile(0U, 0U, num_horizontal_pixels_, num_vertical_pixels_, 0U, 0U);
+    while (samples_done < num_rays_per_pixel_) {
+        pass_samples = std::min(pass_samples, num_rays_per_pixel_ - samples_done);
+        tile.sample_from = samples_done;
+        tile.sample_to = samples_done + pass_samples;
+        Clock::time_point const pass_start = Clock::now();
+        Accumulate(scene, camera, tile, &progress);
+        samples_done += pass_samples;
+        Clock::time_point const now = Clock::now();
+        Clock::duration const pass_duration = now - pass_start;
+
+        // Passes are not cut, so the next one is only started if it is
+        // expected to end before the deadline
+        size_t const next_pass_samples = pass_duration * 8 < time_budget_ ? 2U * pass_samples
+                                                                          : pass_samples;
+        Clock::duration const expected = pass_duration *
+                                         static_cast<Clock::rep>(next_pass_samples) /
+                                         static_cast<Clock::rep>(pass_samples);
+        if (now + expected > deadline)
+            break;
+        pass_samples = next_pass_samples;
+    }
+    tile.sample_from = 0U;
+    tile.sample_to = samples_done;
+    buffer.Add(tile);
+}
+
+template <typename UnaryOp>
+void Renderer<UnaryOp>::Accumulate(Scene const& scene,
+                                   Camera const& camera,
+                                   AccumulationTile& tile,
+                                   ProgressReporter* progress) noexcept
+{
+    GLANCY_PROFILE_ZONE("Accumulate");
     constexpr int initial_depth = 0;
     RealNum const horizontal_length = Real(num_horizontal_pixels_);
     RealNum const vertical_length = Real(num_vertical_pixels_);
+    std::uint64_t const row_samples =
+        std::uint64_t(tile.x_to - tile.x_from) * (tile.sample_to - tile.sample_from);
     std::uniform_real_distribution<RealNum> dist(Real(0), Real(1));
-    std::cout << "Pre-processing scene for faster rendering" << std::endl;
-    PreprocessWorld(scene.World(), camera.TimeShutterOpens(), camera.TimeShutterCloses());
-    std::cout << "0% processing completed." << std::endl;
-    int percentage_completed = 0;
-    int prev_percentage_written = 0;
-    for (size_t j = num_vertical_pixels_; j >= 1; --j) {
+    for (size_t j = tile.y_to; j > tile.y_from; --j) {
         size_t index_ver = j - 1;
-        for (size_t index_hor = 0; index_hor < num_horizontal_pixels_; ++index_hor) {
-            Vec3 color(Real(0), Real(0), Real(0));
-            for (size_t s = 0; s < num_rays_per_pixel_; ++s) {
+        for (size_t index_hor = tile.x_from; index_hor < tile.x_to; ++index_hor) {
+            std::uint64_t const pixel_seed =
+                MixSeed(seed_ ^ MixSeed(index_ver * num_horizontal_pixels_ + index_hor));
+            // Samples are added one by one to the sums of the tile, so that
+            // they are the same whichever passes the samples are split in
+            for (size_t s = tile.sample_from; s < tile.sample_to; ++s) {
+                my_engine().seed(MixSeed(pixel_seed + s));
                 RealNum u = (Real(index_hor) + dist(my_engine())) / horizontal_length;
                 RealNum v = (Real(index_ver) + dist(my_engine())) / vertical_length;
 
                 Ray r = camera.GetRay(u, v);
+                GLANCY_COUNT_RAY_STATISTIC(camera_rays, 1U);
 
-                color += GetColor(ordered_world_, r, initial_depth);
+                if (mode_ == RenderMode::kBeauty)
+                    tile.Add(index_hor, index_ver, GetColor(scene, r, initial_depth, Real(0)));
+                else
+                    tile.Add(index_hor, index_ver, Vec3(MeasureCost(scene, r), Real(0), Real(0)));
             }
+        }
+        if (progress)
+            progress->Add(row_samples);
+    }
+}
 
-            color /= Real(num_rays_per_pixel_);
+template <typename UnaryOp>
+Vec3 Renderer<UnaryOp>::GetColor(Scene const& scene,
+                                 Ray const& r,
+                                 uint16_t depth,
+                                 RealNum scattering_pdf,
+                                 Hittable const* excluded) const noexcept
+{
+    GLANCY_COUNT_RAY_STATISTIC(rays, 1U);
+    HitRecord rec;
+    bool hit;
+    {
+        GLANCY_PROFILE_ZONE("Traverse");
+        // Rays scattered start off the surface they leave (see
+        // OffsetRayOrigin), so they can be searched from their origin
+        hit = ordered_world_.HitExcluding(
+            r, Real(0), std::numeric_limits<RealNum>::max(), world_size_, excluded, rec);
+    }
+    if (!hit) {
+        GLANCY_COUNT_RAY_STATISTIC(escaped, 1U);
+        GLANCY_COUNT_PATH_END(depth);
+        return scene.Background(r);
+    }
 
-            std::transform(std::begin(color), std::end(color), std::begin(color), GammaCorrection);
-            color *= Real(255.9999);
-            image.PaintPixel(index_hor, index_ver, color);
-        }
+    MaterialTable const& materials = scene.Materials();
+    Vec3 emitted = materials.Emitted(r, rec);
+    // If the ray was scattered by a non-specular material, the light it
+    // found could have been sampled explicitly as well: weight both
+    // strategies with multiple importance sampling.
+    if (scattering_pdf > Real(0) && !(emitted == Vec3(Real(0), Real(0), Real(0)))) {
+        RealNum const light_pdf = scene.Lights().PdfValue(r.Origin(), r.Direction(), r.Time());
+        emitted *= utilities::PowerHeuristic(scattering_pdf, light_pdf);
+    }
 
-        percentage_completed =
-            static_cast<int>(Real(100) * (Real(1) - Real(index_ver + 1) / vertical_length));
-        if (static_cast<int>(percentage_completed) >= prev_percentage_written + 5) {
-            int to_write = percentage_completed - (percentage_completed % 5);
-            std::cout << to_write << "% processing completed." << std::endl;
-            prev_percentage_written = to_write;
-        }
+    ScatterSample sample;
+    bool scattered;
+    {
+        GLANCY_PROFILE_ZONE("Scatter");
+        scattered = depth < maximum_depth_ && materials.Sample(r, rec, sample);
+    }
+    if (!scattered) {
+        GLANCY_COUNT_RAY_STATISTIC(absorbed, depth < maximum_depth_ ? 1U : 0U);
+        GLANCY_COUNT_RAY_STATISTIC(max_depth_terminations, depth < maximum_depth_ ? 0U : 1U);
+        GLANCY_COUNT_PATH_END(depth);
+        return emitted;
     }
 
-    std::cout << "100% processing completed." << std::endl;
-    std::cout << std::endl;
+    Point3 const scattered_origin =
+        OffsetRayOrigin(rec.p, rec.p_error, rec.normal, sample.direction);
+    Ray const scattered_ray(scattered_origin, sample.direction, r.Time());
+    Hittable const* const scattered_excluded = ExcludedHittable(rec, sample.direction);
+    if (sample.pdf <= Real(0)) {
+        return emitted + sample.weight * GetColor(scene,
+                                                  scattered_ray,
+                                                  depth + 1,
+                                                  Real(0),
+                                                  scattered_excluded);
+    }
+    return emitted + SampleLights(scene, r, rec) +
+           sample.weight *
+               GetColor(scene, scattered_ray, depth + 1, sample.pdf, scattered_excluded);
 }
 
 template <typename UnaryOp>
-Vec3 Renderer<UnaryOp>::GetColor(Hittable const& target, Ray const& r, uint16_t depth) const
-    noexcept
+RealNum Renderer<UnaryOp>::MeasureCost(Scene const& scene, Ray const& r) const noexcept
 {
-    HitRecord rec;
-    // We increase the minimum parameter to avoid finding out the original intersection again
-    RealNum min_param = Real(0.001);
-    if (target.Hit(r, min_param, std::numeric_limits<RealNum>::max(), rec)) {
-        Ray scattered_ray;
-        Vec3 attenuation;
-        if (depth < maximum_depth_ && rec.mat->Scatter(r, rec, attenuation, scattered_ray)) {
-            return attenuation * GetColor(target, scattered_ray, depth + 1);
-        }
-        else {
-            return Vec3(Real(0), Real(0), Real(0));
-        }
-    }
-    else {
-        Vec3 unit_direction = UnitVector(r.Direction());
-        RealNum t = Real(0.5) * (unit_direction.Y() + Real(1));
-        return (Real(1) - t) * Vec3(Real(1), Real(1), Real(1)) +
-               t * Vec3(Real(0.5), Real(0.7), Real(1));
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+    RayStatistics const before = ThisThreadRayStatistics();
+#endif
+    auto const begin = std::chrono::steady_clock::now();
+    static_cast<void>(GetColor(scene, r, 0, Real(0)));
+    auto const end = std::chrono::steady_clock::now();
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+    RayStatistics const& after = ThisThreadRayStatistics();
+    switch (mode_) {
+        case RenderMode::kNodeVisits:
+            return Real(after.node_visits - before.node_visits);
+        case RenderMode::kPrimitiveTests:
+            return Real(after.primitive_tests - before.primitive_tests);
+        case RenderMode::kPathLength:
+            // Every bounce traces one more ray
+            return Real(after.rays - before.rays - 1U);
+        default:
+            break;
     }
+#endif
+    // Microseconds
+    return Real(std::chrono::duration<double, std::micro>(end - begin).count());
+}
+
+template <typename UnaryOp>
+Vec3 Renderer<UnaryOp>::SampleLights(Scene const& scene,
+                                     Ray const& r,
+                                     HitRecord const& rec) const noexcept
+{
+    GLANCY_PROFILE_ZONE("SampleLights");
+    Vec3 const black(Real(0), Real(0), Real(0));
+    HittableList const& lights = scene.Lights();
+    if (lights.Empty())
+        return black;
+
+    Vec3 const direction = lights.RandomDirection(rec.p, r.Time());
+    Point3 const origin = OffsetRayOrigin(rec.p, rec.p_error, rec.normal, direction);
+    Ray const to_light(origin, direction, r.Time());
+    RealNum const light_pdf = lights.PdfValue(rec.p, direction, r.Time());
+    if (light_pdf <= Real(0))
+        return black;
+    MaterialTable const& materials = scene.Materials();
+    Vec3 const bsdf_cosine = materials.Evaluate(r, rec, to_light.Direction());
+    if (bsdf_cosine == black)
+        return black;
+
+    HitRecord light_rec;
+    if (!lights.Hit(to_light, Real(0), std::numeric_limits<RealNum>::max(), light_rec))
+        return black;
+    Vec3 const light_emitted = materials.Emitted(to_light, light_rec);
+    if (light_emitted == black)
+        return black;
+    // Shadow ray: stop short of the light so that it doesn't occlude itself
+    if (ordered_world_.OccludedExcluding(to_light,
+                                         Real(0),
+                                         light_rec.t * (Real(1) - kShadowRayMargin),
+                                         world_size_,
+                                         ExcludedHittable(rec, direction)))
+        return black;
+
+    RealNum const scattering_pdf = materials.Pdf(r, rec, to_light.Direction());
+    return (utilities::PowerHeuristic(light_pdf, scattering_pdf) / light_pdf) *
+           (bsdf_cosine * light_emitted);
 }
 
 template <typename UnaryOp>
 void Renderer<UnaryOp>::PreprocessWorld(HittableList const& world, RealNum t0, RealNum t1) noexcept
 {
+    GLANCY_PROFILE_ZONE("PreprocessWorld");
     std::vector<HittableInABox> boxed_hittables;
-    int counter = 0;
+    std::vector<Hittable const*> world_order;
+    world_moves_ = false;
     for (auto it = std::begin(world); it != std::end(world); ++it) {
         std::shared_ptr<Hittable> hpt = *it;
         HittableInABox& added_element = boxed_hittables.emplace_back(AxesAlignedBoundingBox(), hpt);
         hpt->ComputeBoundingBox(t0, t1, added_element.first);
-        ++counter;
+        world_order.push_back(hpt.get());
+        // Boxes of static hittables are the same for any interval
+        AxesAlignedBoundingBox box_at_t0;
+        if (!world_moves_ && t0 < t1 && hpt->ComputeBoundingBox(t0, t0, box_at_t0)) {
+            world_moves_ = !(box_at_t0.Minima() == added_element.first.Minima() &&
+                             box_at_t0.Maxima() == added_element.first.Maxima());
+        }
+    }
+    world_size_ = boxed_hittables.size();
+
+    // Nodes of the previous tree are all dropped before reusing their memory
+    ordered_world_ = BoundingVolumeHierarchy();
+    bvh_arena_.Release();
+    GLANCY_PROFILE_ZONE("BuildBVH");
+    if (bvh_cache_directory_.empty()) {
+        ordered_world_ = BoundingVolumeHierarchy(boxed_hittables, t0, t1, &bvh_arena_);
+        return;
+    }
+
+    std::uint64_t const key = ComputeBVHCacheKey(boxed_hittables, t0, t1);
+    std::string const cache_file_path = bvh_cache_directory_ + "/" + BVHCacheFileName(key);
+    if (LoadBVHCache(cache_file_path, key, boxed_hittables, ordered_world_, &bvh_arena_)) {
+        std::cout << "Reusing BVH cached in " << cache_file_path << std::endl;
+        return;
     }
 
-    ordered_world_ = BoundingVolumeHierarchy(boxed_hittables, t0, t1);
+    ordered_world_ = BoundingVolumeHierarchy(boxed_hittables, t0, t1, &bvh_arena_);
+    if (!SaveBVHCache(cache_file_path, key, ordered_world_, world_order, boxed_hittables))
+        std::cout << "BVH could not be cached in " << cache_file_path << std::endl;
 }
 
 }  // namespace plemma::glancy
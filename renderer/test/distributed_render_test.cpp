@@ -0,0 +1,261 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "temporary_files.hpp"
+
+#include "distributed_render.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+constexpr char kSceneText[] =
+    "image 70 45\n"
+    "samples 4\n"
+    "max_depth 4\n"
+    "camera look_from 0 1 5 look_at 0 0 0\n"
+    "material clay lambertian 0.4 0.2 0.1\n"
+    "material mirror metal 0.8 0.8 0.8 0.1\n"
+    "sphere 0 0 0 1 clay\n"
+    "sphere 1.5 0 -1 0.5 mirror\n"
+    "sphere 0 -101 0 100 clay\n";
+
+AccumulationTile MakeTile()
+{
+    AccumulationTile tile(2U, 1U, 5U, 3U, 4U, 9U);
+    for (std::size_t i = 0; i < tile.color.size(); ++i)
+        tile.color[i] = 0.25F * static_cast<float>(i) - 1.0F;
+    return tile;
+}
+
+// Pixel values of the PPM file in 'path'
+std::vector<int> ReadPixels(std::filesystem::path const& path)
+{
+    std::ifstream file(path);
+    std::string format;
+    int width = 0;
+    int height = 0;
+    int max_value = 0;
+    file >> format >> width >> height >> max_value;
+    return std::vector<int>(std::istream_iterator<int>(file), {});
+}
+
+// Renders the scene in 'scene_path' in one go, as glancy does
+void RenderWhole(std::string const& scene_path, std::uint64_t seed, std::string const& output)
+{
+    FileScene scene(scene_path);
+    scene.LoadWorld();
+    REQUIRE(scene.IsLoaded());
+    RenderSettings const& settings = scene.Settings();
+    Camera const camera = scene.MakeCamera();
+    Renderer<RealNum (*)(RealNum)> rend(&distributed_render_detail::GammaCorrection,
+                                        settings.width,
+                                        settings.height,
+                                        settings.samples_per_pixel,
+                                        settings.max_depth);
+    rend.SetProgressInterval(ProgressReporter::Clock::duration::zero());
+    rend.SetSeed(seed);
+    rend.Prepare(scene, camera.TimeShutterOpens(), camera.TimeShutterCloses());
+    Image image(settings.width, settings.height);
+    rend.Render(scene, camera, image);
+    REQUIRE(image.Save(output));
+}
+
+// Renders the scene in 'scene_path' in 'number_shards' shards, each with
+// its own scene and renderer as a worker process would, merged through
+// the same stream format
+void RenderShards(std::string const& scene_path,
+                  ShardSplit split,
+                  std::size_t number_shards,
+                  std::uint64_t seed,
+                  std::string const& output)
+{
+    std::optional<AccumulationBuffer> buffer;
+    for (std::size_t shard = 0; shard < number_shards; ++shard) {
+        std::FILE* const stream = std::tmpfile();
+        REQUIRE(stream != nullptr);
+        std::string error;
+        bool const rendered = distributed_render_detail::RenderShard<FileScene>(
+            scene_path, split, shard, number_shards, seed, stream, error);
+        std::rewind(stream);
+        bool const read = rendered && distributed_render_detail::ReadShard(stream, buffer);
+        std::fclose(stream);
+        REQUIRE(error.empty());
+        REQUIRE(read);
+    }
+    Image image(buffer->Width(), buffer->Height());
+    buffer->Resolve(&distributed_render_detail::GammaCorrection, image);
+    REQUIRE(image.Save(output));
+}
+
+}  // namespace
+
+TEST_CASE("AccumulationTile : tiles are read as they were written", "[AccumulationTile]")
+{
+    AccumulationTile const written = MakeTile();
+    std::FILE* const file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    REQUIRE(WriteAccumulationTile(file, written));
+    REQUIRE(WriteAccumulationTile(file, written));
+    std::rewind(file);
+
+    for (int i = 0; i < 2; ++i) {
+        AccumulationTile read;
+        REQUIRE(ReadAccumulationTile(file, 5U, 3U, read));
+        CHECK(read.x_from == written.x_from);
+        CHECK(read.y_from == written.y_from);
+        CHECK(read.x_to == written.x_to);
+        CHECK(read.y_to == written.y_to);
+        CHECK(read.sample_from == written.sample_from);
+        CHECK(read.sample_to == written.sample_to);
+        CHECK(read.color == written.color);
+    }
+    AccumulationTile read;
+    CHECK_FALSE(ReadAccumulationTile(file, 5U, 3U, read));
+    std::fclose(file);
+}
+
+TEST_CASE("AccumulationTile : broken tiles are rejected", "[AccumulationTile]")
+{
+    AccumulationTile const written = MakeTile();
+    std::FILE* const file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    REQUIRE(WriteAccumulationTile(file, written));
+    long const size = std::ftell(file);
+    std::rewind(file);
+    std::vector<char> bytes(static_cast<std::size_t>(size));
+    REQUIRE(std::fread(bytes.data(), 1U, bytes.size(), file) == bytes.size());
+    std::fclose(file);
+
+    // Magic, then the header (x_from, y_from, x_to, y_to, sample_from,
+    // sample_to) as 64-bit numbers, then the colors
+    constexpr std::size_t kHeader = 8U;
+    auto const read_back = [](std::vector<char> const& stored, std::size_t width,
+                              std::size_t height) {
+        std::FILE* const stream = std::tmpfile();
+        REQUIRE(stream != nullptr);
+        REQUIRE(std::fwrite(stored.data(), 1U, stored.size(), stream) == stored.size());
+        std::rewind(stream);
+        AccumulationTile tile;
+        bool const read = ReadAccumulationTile(stream, width, height, tile);
+        std::fclose(stream);
+        return read;
+    };
+    auto const with_field = [&](std::size_t field, std::uint64_t value) {
+        std::vector<char> changed = bytes;
+        std::memcpy(changed.data() + kHeader + field * sizeof(value), &value, sizeof(value));
+        return changed;
+    };
+
+    // Shards are the size of the image followed by their tiles, up to the
+    // end of the stream
+    auto const read_shard = [](std::vector<char> const& tiles) {
+        std::FILE* const stream = std::tmpfile();
+        REQUIRE(stream != nullptr);
+        std::uint64_t const size[2] = {5U, 3U};
+        REQUIRE(std::fwrite(size, sizeof(size), 1U, stream) == 1U);
+        REQUIRE(std::fwrite(tiles.data(), 1U, tiles.size(), stream) == tiles.size());
+        std::rewind(stream);
+        std::optional<AccumulationBuffer> buffer;
+        bool const read = distributed_render_detail::ReadShard(stream, buffer);
+        std::fclose(stream);
+        return read;
+    };
+
+    CHECK(read_back(bytes, 5U, 3U));
+    CHECK(read_shard(bytes));
+    CHECK(read_shard(std::vector<char>()));
+    SECTION("Image smaller than the tile") { CHECK_FALSE(read_back(bytes, 4U, 3U)); }
+    SECTION("Bad magic")
+    {
+        std::vector<char> changed = bytes;
+        changed[0] = 'X';
+        CHECK_FALSE(read_back(changed, 5U, 3U));
+    }
+    SECTION("Region backwards") { CHECK_FALSE(read_back(with_field(2U, 1U), 5U, 3U)); }
+    SECTION("Region past the image") { CHECK_FALSE(read_back(with_field(3U, 4U), 5U, 3U)); }
+    SECTION("Huge region") { CHECK_FALSE(read_back(with_field(2U, ~std::uint64_t(0)), 5U, 3U)); }
+    SECTION("Samples backwards") { CHECK_FALSE(read_back(with_field(5U, 3U), 5U, 3U)); }
+    SECTION("Truncated colors")
+    {
+        std::vector<char> changed(bytes.begin(), bytes.end() - 1);
+        CHECK_FALSE(read_back(changed, 5U, 3U));
+        CHECK_FALSE(read_shard(changed));
+    }
+    SECTION("Truncated header")
+    {
+        std::vector<char> changed(bytes.begin(), bytes.begin() + kHeader + 20);
+        CHECK_FALSE(read_back(changed, 5U, 3U));
+        CHECK_FALSE(read_shard(changed));
+    }
+}
+
+TEST_CASE("ShardTiles : shards cover every sample of every pixel once", "[DistributedRender]")
+{
+    RenderSettings settings;
+    settings.width = 70U;
+    settings.height = 45U;
+    settings.samples_per_pixel = 5U;
+    ShardSplit const split = GENERATE(ShardSplit::kTiles, ShardSplit::kSamples);
+    std::size_t const number_shards = GENERATE(1U, 2U, 3U, 7U, 20U);
+
+    std::vector<int> counts(settings.width * settings.height * settings.samples_per_pixel, 0);
+    for (std::size_t shard = 0; shard < number_shards; ++shard) {
+        for (AccumulationTile const& tile : ShardTiles(settings, split, shard, number_shards)) {
+            REQUIRE(tile.x_to <= settings.width);
+            REQUIRE(tile.y_to <= settings.height);
+            REQUIRE(tile.sample_to <= settings.samples_per_pixel);
+            REQUIRE(tile.color.size() ==
+                    3U * (tile.x_to - tile.x_from) * (tile.y_to - tile.y_from));
+            for (std::size_t y = tile.y_from; y < tile.y_to; ++y) {
+                for (std::size_t x = tile.x_from; x < tile.x_to; ++x) {
+                    for (std::size_t s = tile.sample_from; s < tile.sample_to; ++s)
+                        ++counts[(y * settings.width + x) * settings.samples_per_pixel + s];
+                }
+            }
+        }
+    }
+    for (int const count : counts)
+        REQUIRE(count == 1);
+}
+
+TEST_CASE("DistributeRender : shards merge into the image of a single render",
+          "[DistributedRender]")
+{
+    TemporaryDirectory const directory("distributed_render_test");
+    std::string const scene_path = directory.File("distributed_render_test.scene");
+    std::string const whole_path = directory.File("whole.ppm");
+    std::string const shards_path = directory.File("shards.ppm");
+    WriteFile(scene_path, kSceneText);
+    std::uint64_t const seed = 0x9E3779B97F4A7C15ULL;
+    RenderWhole(scene_path, seed, whole_path);
+
+    SECTION("Tiles are the same bit for bit")
+    {
+        std::size_t const number_shards = GENERATE(1U, 2U, 5U);
+        RenderShards(scene_path, ShardSplit::kTiles, number_shards, seed, shards_path);
+        CHECK(ReadFile(shards_path) == ReadFile(whole_path));
+    }
+    SECTION("Samples differ by the rounding of their partial sums at most")
+    {
+        std::size_t const number_shards = GENERATE(1U, 3U);
+        RenderShards(scene_path, ShardSplit::kSamples, number_shards, seed, shards_path);
+        std::vector<int> const whole = ReadPixels(whole_path);
+        std::vector<int> const shards = ReadPixels(shards_path);
+        REQUIRE(whole.size() == 70U * 45U * 3U);
+        REQUIRE(shards.size() == whole.size());
+        for (std::size_t i = 0; i < whole.size(); ++i)
+            REQUIRE(std::abs(whole[i] - shards[i]) <= 1);
+    }
+}
+
+}  // namespace plemma::glancy
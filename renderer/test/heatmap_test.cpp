@@ -0,0 +1,207 @@
+#include <cstddef>
+#include <string>
+
+#include "catch.hpp"
+
+#include "renderer.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+constexpr std::size_t kWidth = 8U;
+constexpr std::size_t kHeight = 6U;
+
+// Sphere on a ground, seen from above the horizon: the bottom row of the
+// image sees the ground and the top row the sky
+class GroundScene : public Scene
+{
+  public:
+    void LoadWorld() noexcept final
+    {
+        SceneBuilder& builder = Builder();
+        Vec3 const gray(Real(0.5), Real(0.5), Real(0.5));
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0), Real(-100), Real(0)), Real(100), builder.MakeLambertian(gray)));
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0), Real(0.6), Real(0)), Real(0.6), builder.MakeLambertian(gray)));
+        BindMaterials();
+    }
+    [[nodiscard]] HittableList const& World() const noexcept final { return world_; }
+
+  private:
+    HittableList world_;
+};
+
+// Sums of the costs of 'samples' samples per pixel of the scene, measured
+// as 'mode' says
+AccumulationTile MeasureCosts(RenderMode mode, std::size_t samples)
+{
+    GroundScene scene;
+    scene.LoadWorld();
+    Camera const camera(Vec3(Real(0), Real(1.5), Real(5)),
+                        Vec3(Real(0), Real(0.5), Real(0)),
+                        Vec3(Real(0), Real(1), Real(0)),
+                        Real(40),
+                        Real(kWidth) / Real(kHeight),
+                        Real(0),
+                        Real(5),
+                        Real(0),
+                        Real(0));
+    Renderer<RealNum (*)(RealNum)> rend(
+        +[](RealNum x) { return x; }, kWidth, kHeight, samples, 5U);
+    rend.SetSeed(31U);
+    rend.SetMode(mode);
+    rend.Prepare(scene, Real(0), Real(0));
+    AccumulationTile tile(0U, 0U, kWidth, kHeight, 0U, samples);
+    rend.Accumulate(scene, camera, tile);
+    return tile;
+}
+
+// Sum of the costs of the pixels of row 'y' of 'tile'
+double RowCost(AccumulationTile const& tile, std::size_t y)
+{
+    double cost = 0.0;
+    for (std::size_t x = 0; x < kWidth; ++x)
+        cost += double(tile.color[3U * (y * kWidth + x)]);
+    return cost;
+}
+
+void CheckSameColor(Vec3 const& pixel, Vec3 const& color)
+{
+    for (int c = 0; c < 3; ++c)
+        CHECK(pixel[c] == Approx(color[c] * Real(255.9999)));
+}
+
+}  // namespace
+
+TEST_CASE("ParseRenderMode : names of the modes", "[Heatmap]")
+{
+    RenderMode mode = RenderMode::kTime;
+    CHECK(ParseRenderMode("beauty", mode));
+    CHECK(mode == RenderMode::kBeauty);
+    CHECK(ParseRenderMode("nodes", mode));
+    CHECK(mode == RenderMode::kNodeVisits);
+    CHECK(ParseRenderMode("primitives", mode));
+    CHECK(mode == RenderMode::kPrimitiveTests);
+    CHECK(ParseRenderMode("paths", mode));
+    CHECK(mode == RenderMode::kPathLength);
+    CHECK(ParseRenderMode("time", mode));
+    CHECK(mode == RenderMode::kTime);
+
+    // Unknown names leave the mode as it was
+    for (std::string const unknown : {"", "Time", "node", "times", "beauty "}) {
+        INFO("'" << unknown << "'");
+        CHECK_FALSE(ParseRenderMode(unknown, mode));
+        CHECK(mode == RenderMode::kTime);
+    }
+}
+
+TEST_CASE("HeatmapColor : from black to pale yellow", "[Heatmap]")
+{
+    Vec3 const cheapest = HeatmapColor(Real(0));
+    Vec3 const dearest = HeatmapColor(Real(1));
+    CHECK(cheapest.X() == Approx(0.0));
+    CHECK(cheapest.Y() == Approx(0.0));
+    CHECK(cheapest.Z() == Approx(0.02));
+    CHECK(dearest.X() == Approx(0.99));
+    CHECK(dearest.Y() == Approx(0.99));
+    CHECK(dearest.Z() == Approx(0.75));
+
+    // Out of [0, 1], the ends
+    CHECK(HeatmapColor(Real(-3)) == cheapest);
+    CHECK(HeatmapColor(Real(7)) == dearest);
+
+    // Dearer costs are always brighter
+    RealNum previous_brightness = Real(-1);
+    for (int i = 0; i <= 100; ++i) {
+        Vec3 const color = HeatmapColor(Real(i) / Real(100));
+        RealNum const brightness = color.X() + color.Y() + color.Z();
+        CHECK(brightness > previous_brightness);
+        previous_brightness = brightness;
+        for (int c = 0; c < 3; ++c) {
+            CHECK(color[c] >= Real(0));
+            CHECK(color[c] <= Real(1));
+        }
+    }
+}
+
+TEST_CASE("AccumulationBuffer : heatmaps of the mean costs", "[Heatmap]")
+{
+    // 100 pixels, so that the 99th percentile is the second dearest
+    constexpr std::size_t kSide = 10U;
+    AccumulationBuffer buffer(kSide, kSide);
+    Image image(kSide, kSide);
+
+    SECTION("The scale goes up to the 99th percentile")
+    {
+        // Pixel i has a mean cost of i over 2 samples, and a colour that
+        // does not count
+        AccumulationTile tile(0U, 0U, kSide, kSide, 0U, 2U);
+        for (std::size_t i = 0; i < kSide * kSide; ++i)
+            tile.Add(i % kSide, i / kSide, Vec3(Real(2 * i), Real(5), Real(7)));
+        buffer.Add(tile);
+        buffer.ResolveHeatmap(image);
+        RealNum const scale = Real(98);
+        for (std::size_t i = 0; i < kSide * kSide; ++i) {
+            INFO("pixel " << i);
+            CheckSameColor(image.Pixel(i % kSide, i / kSide), HeatmapColor(Real(i) / scale));
+        }
+        // The outlier is clamped
+        CheckSameColor(image.Pixel(kSide - 1U, kSide - 1U), HeatmapColor(Real(1)));
+    }
+
+    SECTION("Buffers costing nothing, or without samples, are all black")
+    {
+        AccumulationTile tile(0U, 0U, kSide, kSide / 2U, 0U, 3U);
+        buffer.Add(tile);
+        buffer.ResolveHeatmap(image);
+        for (std::size_t y = 0; y < kSide; ++y) {
+            for (std::size_t x = 0; x < kSide; ++x)
+                CheckSameColor(image.Pixel(x, y), HeatmapColor(Real(0)));
+        }
+    }
+}
+
+TEST_CASE("Renderer : costs measured for heatmaps", "[Heatmap]")
+{
+    constexpr std::size_t kSamples = 4U;
+
+    SECTION("Time")
+    {
+        AccumulationTile const tile = MeasureCosts(RenderMode::kTime, kSamples);
+        for (std::size_t i = 0; i < tile.color.size(); i += 3U) {
+            CHECK(tile.color[i] >= 0.0F);
+            // Costs go to the first component only
+            CHECK(tile.color[i + 1U] == 0.0F);
+            CHECK(tile.color[i + 2U] == 0.0F);
+        }
+        double total = 0.0;
+        for (std::size_t y = 0; y < kHeight; ++y)
+            total += RowCost(tile, y);
+        CHECK(total > 0.0);
+    }
+
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+    SECTION("Path lengths")
+    {
+        AccumulationTile const tile = MeasureCosts(RenderMode::kPathLength, kSamples);
+        // Rays to the sky do not bounce, rays to the ground do at least once
+        CHECK(RowCost(tile, kHeight - 1U) == 0.0);
+        CHECK(RowCost(tile, 0U) >= double(kWidth * kSamples));
+    }
+
+    SECTION("BVH nodes and primitives")
+    {
+        for (RenderMode const mode : {RenderMode::kNodeVisits, RenderMode::kPrimitiveTests}) {
+            AccumulationTile const tile = MeasureCosts(mode, kSamples);
+            // Bouncing on the ground costs more than escaping to the sky
+            CHECK(RowCost(tile, 0U) > RowCost(tile, kHeight - 1U));
+            CHECK(RowCost(tile, kHeight - 1U) >= 0.0);
+        }
+    }
+#endif
+}
+
+}  // namespace plemma::glancy
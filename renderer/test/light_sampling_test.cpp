@@ -0,0 +1,115 @@
+#include <cstddef>
+#include <cstdint>
+
+#include "catch.hpp"
+
+#include "renderer.hpp"
+#include "sphere.hpp"
+#include "utilities.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+// Diffuse and glossy spheres lit by a small sphere, in the dark. Unless
+// 'sample_lights' is true, the light is not among the lights of the
+// scene, so that it is only found by the rays scattered towards it.
+class SmallLightScene : public Scene
+{
+  public:
+    explicit SmallLightScene(bool sample_lights) : sample_lights_(sample_lights) {}
+
+    void LoadWorld() noexcept final
+    {
+        SceneBuilder& builder = Builder();
+        Vec3 const gray(Real(0.5), Real(0.5), Real(0.5));
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0), Real(-100), Real(0)), Real(100), builder.MakeLambertian(gray)));
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(-0.8), Real(0.6), Real(0)),
+            Real(0.6),
+            builder.MakeLambertian(Vec3(Real(0.7), Real(0.3), Real(0.2)))));
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0.8), Real(0.6), Real(0)),
+            Real(0.6),
+            builder.MakeMetal(Vec3(Real(0.8), Real(0.8), Real(0.9)), Real(0.3))));
+        Vec3 const emission(Real(20), Real(20), Real(20));
+        auto light = Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0), Real(2.2), Real(0.5)), Real(0.25), builder.MakeDiffuseLight(emission));
+        world_.Add(std::shared_ptr<Hittable>(light));
+        lights_.Add(std::move(light));
+        BindMaterials();
+    }
+    [[nodiscard]] HittableList const& World() const noexcept final { return world_; }
+    [[nodiscard]] HittableList const& Lights() const noexcept final
+    {
+        return sample_lights_ ? lights_ : Scene::Lights();
+    }
+    [[nodiscard]] Vec3 Background([[maybe_unused]] Ray const& r) const noexcept final
+    {
+        return Vec3(Real(0), Real(0), Real(0));
+    }
+
+  private:
+    bool sample_lights_;
+    HittableList world_;
+    HittableList lights_;
+};
+
+// Mean color of the pixels of the scene, sampled 'samples_per_pixel' times
+Vec3 MeanColor(bool sample_lights, std::size_t samples_per_pixel)
+{
+    constexpr std::size_t kWidth = 32U;
+    constexpr std::size_t kHeight = 24U;
+    SmallLightScene scene(sample_lights);
+    scene.LoadWorld();
+    Camera const camera(Vec3(Real(0), Real(1.5), Real(5)),
+                        Vec3(Real(0), Real(0.5), Real(0)),
+                        Vec3(Real(0), Real(1), Real(0)),
+                        Real(40),
+                        Real(kWidth) / Real(kHeight),
+                        Real(0),
+                        Real(5),
+                        Real(0),
+                        Real(0));
+    Renderer<RealNum (*)(RealNum)> rend(
+        +[](RealNum x) { return x; }, kWidth, kHeight, samples_per_pixel, 5U);
+    rend.SetSeed(17U);
+    rend.Prepare(scene, Real(0), Real(0));
+    AccumulationTile tile(0U, 0U, kWidth, kHeight, 0U, samples_per_pixel);
+    rend.Accumulate(scene, camera, tile);
+
+    double sum[3] = {0.0, 0.0, 0.0};
+    for (std::size_t i = 0; i < tile.color.size(); ++i)
+        sum[i % 3U] += double(tile.color[i]);
+    double const samples = double(kWidth * kHeight * samples_per_pixel);
+    return Vec3(Real(sum[0] / samples), Real(sum[1] / samples), Real(sum[2] / samples));
+}
+
+}  // namespace
+
+TEST_CASE("PowerHeuristic : weights of both strategies sum to one", "[LightSampling]")
+{
+    RealNum const pdf = GENERATE(take(20, random(Real(0.001), Real(100.0))));
+    RealNum const other_pdf = GENERATE(take(20, random(Real(0.001), Real(100.0))));
+    CHECK(utilities::PowerHeuristic(pdf, other_pdf) +
+              utilities::PowerHeuristic(other_pdf, pdf) ==
+          Approx(1.0));
+    // Strategies that can not sample a direction take no weight
+    CHECK(utilities::PowerHeuristic(pdf, Real(0)) == Approx(1.0));
+    CHECK(utilities::PowerHeuristic(Real(0), pdf) == Approx(0.0));
+}
+
+TEST_CASE("Renderer : sampling small lights converges to the same image", "[LightSampling]")
+{
+    // Both estimators are unbiased, so only noise tells them apart.
+    // Without light sampling, many more samples are needed for as little.
+    Vec3 const with_light_sampling = MeanColor(true, 64U);
+    Vec3 const without_light_sampling = MeanColor(false, 4096U);
+    for (int i = 0; i < 3; ++i) {
+        CHECK(with_light_sampling[i] > Real(0.01));
+        CHECK(with_light_sampling[i] == Approx(without_light_sampling[i]).epsilon(0.05));
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,163 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "temporary_files.hpp"
+
+#include "profiler.hpp"
+
+namespace plemma::profiler {
+
+namespace {
+
+// Line of the report of WriteReport for a zone
+struct ReportLine
+{
+    std::size_t depth = 0U;
+    std::uint64_t calls = 0U;
+    double total_ms = 0.0;
+    double self_ms = 0.0;
+};
+
+// Line of the first zone called 'name' in the report, if any. Zones are
+// shared by all the tests of the executable, so each test names its own.
+std::optional<ReportLine> FindZone(std::string const& name)
+{
+    std::ostringstream report;
+    WriteReport(report);
+    std::istringstream lines(report.str());
+    for (std::string line; std::getline(lines, line);) {
+        std::size_t const begin = line.find_first_not_of(' ');
+        if (begin == std::string::npos || line.compare(begin, name.size(), name) != 0 ||
+            line[begin + name.size()] != ' ')
+            continue;
+        ReportLine found;
+        // Zones are indented two spaces per enclosing zone, below the root
+        found.depth = begin / 2U;
+        std::istringstream numbers(line.substr(begin + name.size()));
+        numbers >> found.calls >> found.total_ms >> found.self_ms;
+        return found;
+    }
+    return std::nullopt;
+}
+
+void SleepFor(int milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+}  // namespace
+
+TEST_CASE("Profiler : nested zones have their inclusive and self times", "[Profiler]")
+{
+    {
+        Zone const outer("ProfilerTestOuter");
+        SleepFor(10);
+        for (int i = 0; i < 2; ++i) {
+            Zone const inner("ProfilerTestInner");
+            SleepFor(10);
+        }
+    }
+
+    std::optional<ReportLine> const outer = FindZone("ProfilerTestOuter");
+    std::optional<ReportLine> const inner = FindZone("ProfilerTestInner");
+    REQUIRE(outer);
+    REQUIRE(inner);
+    CHECK(outer->depth == 1U);
+    CHECK(inner->depth == 2U);
+    CHECK(outer->calls == 1U);
+    CHECK(inner->calls == 2U);
+    // Totals include the enclosed zones, self times do not
+    CHECK(inner->total_ms >= 20.0);
+    CHECK(inner->self_ms == Approx(inner->total_ms).margin(0.002));
+    CHECK(outer->total_ms >= 30.0);
+    CHECK(outer->self_ms >= 10.0);
+    CHECK(outer->total_ms == Approx(outer->self_ms + inner->total_ms).margin(0.002));
+}
+
+TEST_CASE("Profiler : zones of all threads are merged", "[Profiler]")
+{
+    constexpr std::uint64_t kThreads = 3U;
+    std::vector<std::thread> threads;
+    for (std::uint64_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([] {
+            Zone const work("ProfilerTestThreadWork");
+            for (int j = 0; j < 4; ++j)
+                Zone const step("ProfilerTestThreadStep");
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // Threads are done, but their zones are kept
+    std::optional<ReportLine> const work = FindZone("ProfilerTestThreadWork");
+    std::optional<ReportLine> const step = FindZone("ProfilerTestThreadStep");
+    REQUIRE(work);
+    REQUIRE(step);
+    CHECK(work->depth == 1U);
+    CHECK(step->depth == 2U);
+    CHECK(work->calls == kThreads);
+    CHECK(step->calls == 4U * kThreads);
+}
+
+TEST_CASE("Profiler : traces are in the Chrome trace event format", "[Profiler]")
+{
+    EnableTrace(true);
+    {
+        Zone const traced("ProfilerTest\"Traced\"");
+        SleepFor(1);
+    }
+    EnableTrace(false);
+    {
+        Zone const untraced("ProfilerTestUntraced");
+    }
+
+    glancy::TemporaryDirectory const directory("profiler_test");
+    std::string const path = directory.File("trace.json");
+    REQUIRE(WriteChromeTrace(path));
+    std::string const trace = glancy::ReadFile(path);
+
+    std::string const header = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    REQUIRE(trace.compare(0U, header.size(), header) == 0);
+    CHECK(trace.substr(trace.size() - 4U) == "\n]}\n");
+    CHECK(trace.find("ProfilerTestUntraced") == std::string::npos);
+
+    // Complete events, with the name escaped and the times in microseconds
+    std::string const event = "{\"name\":\"ProfilerTest\\\"Traced\\\"\",\"ph\":\"X\",\"pid\":1,";
+    std::size_t const begin = trace.find(event);
+    REQUIRE(begin != std::string::npos);
+    std::size_t const end = trace.find('}', begin);
+    REQUIRE(end != std::string::npos);
+    std::string const fields = trace.substr(begin + event.size(), end - begin - event.size());
+    std::size_t const ts = fields.find(",\"ts\":");
+    std::size_t const dur = fields.find(",\"dur\":");
+    REQUIRE(fields.compare(0U, 6U, "\"tid\":") == 0);
+    REQUIRE(ts != std::string::npos);
+    REQUIRE(dur != std::string::npos);
+    CHECK(std::stod(fields.substr(ts + 6U)) >= 0.0);
+    CHECK(std::stod(fields.substr(dur + 7U)) >= 1000.0);
+}
+
+#if defined(GLANCY_ENABLE_PROFILER)
+TEST_CASE("Profiler : GLANCY_PROFILE_ZONE times its scope", "[Profiler]")
+{
+    for (int i = 0; i < 3; ++i) {
+        GLANCY_PROFILE_ZONE("ProfilerTestMacro");
+        GLANCY_PROFILE_ZONE("ProfilerTestMacroNested");
+    }
+    std::optional<ReportLine> const zone = FindZone("ProfilerTestMacro");
+    std::optional<ReportLine> const nested = FindZone("ProfilerTestMacroNested");
+    REQUIRE(zone);
+    REQUIRE(nested);
+    CHECK(zone->calls == 3U);
+    CHECK(nested->depth == zone->depth + 1U);
+}
+#endif
+
+}  // namespace plemma::profiler
@@ -0,0 +1,48 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "catch.hpp"
+
+#include "progress_reporter.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("ProgressReporter : reports the samples done", "[ProgressReporter]")
+{
+    std::ostringstream out;
+    {
+        ProgressReporter progress(4U, std::chrono::hours(1), out);
+        progress.Add(1U);
+        progress.Add(2U);
+    }
+    CHECK(out.str().rfind("75% processing completed in ", 0) == 0);
+}
+
+TEST_CASE("ProgressReporter : a zero interval is silent", "[ProgressReporter]")
+{
+    std::ostringstream out;
+    {
+        ProgressReporter progress(4U, ProgressReporter::Clock::duration::zero(), out);
+        progress.Add(4U);
+    }
+    CHECK(out.str().empty());
+}
+
+TEST_CASE("ProgressReporter : time left is clamped to a passed deadline", "[ProgressReporter]")
+{
+    std::ostringstream out;
+    {
+        ProgressReporter::Clock::time_point const deadline =
+            ProgressReporter::Clock::now() - std::chrono::seconds(1);
+        ProgressReporter progress(1000U, std::chrono::milliseconds(1), out, deadline);
+        progress.Add(1U);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    std::string const report = out.str();
+    CHECK(report.find(", 0.0 s left)") != std::string::npos);
+    CHECK(report.find('-') == std::string::npos);
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,62 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "ray_statistics.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("TotalRayStatistics : counters of all threads are merged", "[RayStatistics]")
+{
+    // Other tests may have counted before
+    RayStatistics const before = TotalRayStatistics();
+    constexpr std::uint64_t kThreads = 4U;
+    std::vector<std::thread> threads;
+    for (std::uint64_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([i] {
+            RayStatistics& statistics = ThisThreadRayStatistics();
+            statistics.rays += i + 1U;
+            statistics.AddPathEnd(3U);
+            statistics.AddPathEnd(100U);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // Threads are done, but their counters are kept
+    RayStatistics const after = TotalRayStatistics();
+    CHECK(after.rays - before.rays == kThreads * (kThreads + 1U) / 2U);
+    CHECK(after.path_depths[3] - before.path_depths[3] == kThreads);
+    CHECK(after.path_depths[RayStatistics::kDepthBuckets - 1U] -
+              before.path_depths[RayStatistics::kDepthBuckets - 1U] ==
+          kThreads);
+    CHECK(after.escaped == before.escaped);
+}
+
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+TEST_CASE("RayStatistics : shadow rays count their sphere tests as other rays", "[RayStatistics]")
+{
+    Sphere<Vec3, RealNum> const sphere(Vec3(Real(0), Real(0), Real(-5)), Real(1), nullptr);
+    Ray const towards(Vec3(Real(0), Real(0), Real(0)), Vec3(Real(0), Real(0), Real(-1)), Real(0));
+    Ray const away(Vec3(Real(0), Real(0), Real(0)), Vec3(Real(0), Real(0), Real(1)), Real(0));
+
+    RayStatistics const before = ThisThreadRayStatistics();
+    HitRecord rec;
+    CHECK(sphere.Hit(towards, Real(0.001), Real(100), rec));
+    CHECK_FALSE(sphere.Hit(away, Real(0.001), Real(100), rec));
+    RayStatistics const after_hits = ThisThreadRayStatistics();
+    CHECK(sphere.Occluded(towards, Real(0.001), Real(100)));
+    CHECK_FALSE(sphere.Occluded(away, Real(0.001), Real(100)));
+    RayStatistics const after_occlusions = ThisThreadRayStatistics();
+
+    CHECK(after_hits.primitive_tests - before.primitive_tests == 2U);
+    CHECK(after_hits.primitive_hits - before.primitive_hits == 1U);
+    CHECK(after_occlusions.primitive_tests - after_hits.primitive_tests == 2U);
+    CHECK(after_occlusions.primitive_hits - after_hits.primitive_hits == 1U);
+}
+#endif
+
+}  // namespace plemma::glancy
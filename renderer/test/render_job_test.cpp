@@ -0,0 +1,127 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "render_job.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("ParseRenderJob : valid jobs", "[RenderJob]")
+{
+    SECTION("Only the mandatory statements")
+    {
+        RenderJob job;
+        std::string error;
+        REQUIRE(ParseRenderJob("scene a.scene\noutput a.ppm\n", job, error));
+        CHECK(job.scene_path == "a.scene");
+        CHECK(job.output_path == "a.ppm");
+        CHECK(job.priority == 0U);
+        CHECK(!job.width);
+        CHECK(!job.samples_per_pixel);
+        CHECK(!job.max_depth);
+        CHECK(!job.time_budget);
+        CHECK(job.camera_options.empty());
+
+        RenderSettings scene_settings;
+        scene_settings.width = 30U;
+        scene_settings.height = 20U;
+        scene_settings.samples_per_pixel = 5U;
+        scene_settings.max_depth = 7U;
+        RenderSettings const settings = job.Apply(scene_settings);
+        CHECK(settings.width == 30U);
+        CHECK(settings.height == 20U);
+        CHECK(settings.samples_per_pixel == 5U);
+        CHECK(settings.max_depth == 7U);
+    }
+
+    SECTION("Every statement, with comments and blank lines")
+    {
+        std::string const text = "# render of the day\n"
+                                 "scene  a.scene\n"
+                                 "\n"
+                                 "output a.ppm\n"
+                                 "priority 3\n"
+                                 "image 64 32\n"
+                                 "samples 16\n"
+                                 "max_depth 9\n"
+                                 "time_budget 2.5\n"
+                                 "camera vfov 40\n"
+                                 "camera look_at 1 2 3";
+        RenderJob job;
+        std::string error;
+        REQUIRE(ParseRenderJob(text, job, error));
+        CHECK(job.priority == 3U);
+        CHECK(job.width == std::size_t{64});
+        CHECK(job.height == std::size_t{32});
+        CHECK(job.samples_per_pixel == std::size_t{16});
+        CHECK(job.max_depth == std::uint16_t{9});
+        CHECK(job.time_budget == Real(2.5));
+
+        RenderSettings const settings = job.Apply(RenderSettings());
+        CHECK(settings.width == 64U);
+        CHECK(settings.height == 32U);
+        CHECK(settings.samples_per_pixel == 16U);
+        CHECK(settings.max_depth == 9U);
+
+        CameraSettings camera;
+        REQUIRE(job.Apply(camera));
+        CHECK(camera.vertical_fov_deg == Real(40));
+        CHECK(camera.look_at == Vec3(Real(1), Real(2), Real(3)));
+    }
+}
+
+TEST_CASE("ParseRenderJob : invalid jobs", "[RenderJob]")
+{
+    auto const [text, expected_error] = GENERATE(table<char const*, char const*>({
+        {"output a.ppm\n", "scene and output are mandatory"},
+        {"scene a.scene\n", "scene and output are mandatory"},
+        {"scene\noutput a.ppm\n", "line 1: expected path"},
+        {"scene a.scene\noutput a.ppm\npriority high\n", "line 3: expected priority"},
+        {"scene a.scene\noutput a.ppm\nimage 0 10\n",
+         "line 3: expected width and height of the image"},
+        {"scene a.scene\noutput a.ppm\nimage 10\n",
+         "line 3: expected width and height of the image"},
+        {"scene a.scene\noutput a.ppm\nsamples 0\n", "line 3: expected number of rays per pixel"},
+        {"scene a.scene\noutput a.ppm\nmax_depth 65536\n", "line 3: expected maximum depth"},
+        {"scene a.scene\noutput a.ppm\ntime_budget 0\n", "line 3: expected time budget in seconds"},
+        {"scene a.scene\noutput a.ppm\ntime_budget -1\n",
+         "line 3: expected time budget in seconds"},
+        {"scene a.scene\noutput a.ppm\ncamera zoom 2\n", "line 3: invalid camera option"},
+        {"scene a.scene\noutput a.ppm\nsamples 4 4\n",
+         "line 3: unexpected tokens at the end of the statement"},
+        {"scene a.scene\noutput a.ppm\nsphere 0 0 0 1 clay\n", "line 3: unknown statement"}}));
+
+    RenderJob job;
+    std::string error;
+    CHECK(!ParseRenderJob(text, job, error));
+    CHECK(error == expected_error);
+}
+
+TEST_CASE("NextRenderJob : highest priority first, then first queued", "[RenderJob]")
+{
+    std::vector<QueuedRenderJob> queue;
+    CHECK(NextRenderJob(queue) == 0U);
+
+    // Priorities in the order the jobs were queued
+    for (std::uint64_t const priority : {1U, 0U, 5U, 1U, 5U, 0U}) {
+        QueuedRenderJob queued;
+        queued.job.priority = priority;
+        queued.file_path = std::to_string(queue.size());
+        queued.sequence = queue.size();
+        queue.push_back(queued);
+    }
+    // Jobs queued later may be appended, or left where taken jobs were
+    std::swap(queue[0], queue[4]);
+
+    std::vector<std::string> order;
+    while (!queue.empty()) {
+        std::size_t const next = NextRenderJob(queue);
+        REQUIRE(next < queue.size());
+        order.push_back(queue[next].file_path);
+        queue.erase(queue.begin() + std::ptrdiff_t(next));
+    }
+    CHECK(order == std::vector<std::string>{"2", "4", "0", "3", "1", "5"});
+}
+
+}  // namespace plemma::glancy
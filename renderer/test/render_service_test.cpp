@@ -0,0 +1,80 @@
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "catch.hpp"
+#include "temporary_files.hpp"
+
+#include "render_service.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("RenderService : jobs go through the spool directory", "[RenderService]")
+{
+    TemporaryDirectory const directory("render_service_test");
+    std::filesystem::path const& spool = directory.Path();
+    WriteFile(spool / "ball.scene",
+              "image 8 6\n"
+              "samples 2\n"
+              "max_depth 3\n"
+              "camera look_from 0 0 5 look_at 0 0 0\n"
+              "material clay lambertian 0.4 0.2 0.1\n"
+              "sphere 0 0 0 1 clay\n");
+    // Jobs of the same scene, rendered by different workers
+    WriteFile(spool / "a.job", "scene ball.scene\noutput a.ppm\n");
+    WriteFile(spool / "b.job", "scene ball.scene\noutput b.ppm\ncamera look_from 0 3 5\n");
+    WriteFile(spool / "unsaved.job", "scene ball.scene\noutput missing_directory/c.ppm\n");
+    WriteFile(spool / "invalid.job", "scene ball.scene\n");
+    WriteFile(spool / "missing_scene.job", "scene missing.scene\noutput d.ppm\n");
+    // Cameras that can not be built once changed by the job
+    WriteFile(spool / "no_view.job", "scene ball.scene\noutput f.ppm\ncamera look_at 0 0 5\n");
+    WriteFile(spool / "up_along_view.job", "scene ball.scene\noutput g.ppm\ncamera up 0 0 1\n");
+    // Not renamed yet by its client
+    WriteFile(spool / "partial.job.tmp", "scene ball.scene\noutput e.ppm\n");
+
+    RenderService service(spool.string(), 2U);
+    bool served = false;
+    std::thread serving([&] { served = service.Run(); });
+    auto const finished = [&] {
+        return std::filesystem::exists(spool / "a.job.done") &&
+               std::filesystem::exists(spool / "b.job.done") &&
+               std::filesystem::exists(spool / "unsaved.job.failed") &&
+               std::filesystem::exists(spool / "invalid.job.failed") &&
+               std::filesystem::exists(spool / "missing_scene.job.failed") &&
+               std::filesystem::exists(spool / "no_view.job.failed") &&
+               std::filesystem::exists(spool / "up_along_view.job.failed");
+    };
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+    while (!finished() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    WriteFile(spool / "stop", "");
+    serving.join();
+
+    CHECK(served);
+    REQUIRE(finished());
+    CHECK(ReadFile(spool / "a.ppm").rfind("P3\n8 6\n255\n", 0U) == 0U);
+    CHECK(ReadFile(spool / "b.ppm").rfind("P3\n8 6\n255\n", 0U) == 0U);
+    CHECK(ReadFile(spool / "unsaved.job.failed").find("# error: could not save") !=
+          std::string::npos);
+    CHECK(ReadFile(spool / "invalid.job.failed").find("# error: ") != std::string::npos);
+    CHECK(ReadFile(spool / "missing_scene.job.failed").find("# error: ") != std::string::npos);
+    for (char const* const job : {"no_view.job.failed", "up_along_view.job.failed"}) {
+        CHECK(ReadFile(spool / job).find(std::string("# error: ") +
+                                         scene_file_detail::kInvalidCamera) != std::string::npos);
+    }
+    CHECK(!std::filesystem::exists(spool / "f.ppm"));
+    CHECK(!std::filesystem::exists(spool / "g.ppm"));
+    CHECK(std::filesystem::exists(spool / "partial.job.tmp"));
+    CHECK(!std::filesystem::exists(spool / "e.ppm"));
+    CHECK(!std::filesystem::exists(spool / "stop"));
+}
+
+TEST_CASE("RenderService : missing spool directory", "[RenderService]")
+{
+    TemporaryDirectory const directory("render_service_test");
+    RenderService service(directory.File("missing_spool"), 1U);
+    CHECK(!service.Run());
+}
+
+}  // namespace plemma::glancy
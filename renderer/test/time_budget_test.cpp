@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstddef>
+
+#include "catch.hpp"
+
+#include "renderer.hpp"
+#include "sphere.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+constexpr std::size_t kWidth = 16U;
+constexpr std::size_t kHeight = 12U;
+
+// Diffuse spheres under the sky, cheap enough to render many samples of
+class SpheresScene : public Scene
+{
+  public:
+    void LoadWorld() noexcept final
+    {
+        SceneBuilder& builder = Builder();
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0), Real(-100), Real(0)),
+            Real(100),
+            builder.MakeLambertian(Vec3(Real(0.5), Real(0.5), Real(0.5)))));
+        world_.Add(Make<Sphere<Vec3, RealNum> >(
+            Vec3(Real(0), Real(0.6), Real(0)),
+            Real(0.6),
+            builder.MakeLambertian(Vec3(Real(0.7), Real(0.3), Real(0.2)))));
+        BindMaterials();
+    }
+    [[nodiscard]] HittableList const& World() const noexcept final { return world_; }
+
+  private:
+    HittableList world_;
+};
+
+Camera MakeTestCamera()
+{
+    return Camera(Vec3(Real(0), Real(1.5), Real(5)),
+                  Vec3(Real(0), Real(0.5), Real(0)),
+                  Vec3(Real(0), Real(1), Real(0)),
+                  Real(40),
+                  Real(kWidth) / Real(kHeight),
+                  Real(0),
+                  Real(5),
+                  Real(0),
+                  Real(0));
+}
+
+RealNum Identity(RealNum x)
+{
+    return x;
+}
+
+using TestRenderer = Renderer<RealNum (*)(RealNum)>;
+
+void PrepareTestRenderer(TestRenderer& rend, SpheresScene const& scene)
+{
+    rend.SetSeed(23U);
+    rend.SetProgressInterval(ProgressReporter::Clock::duration::zero());
+    rend.Prepare(scene, Real(0), Real(0));
+}
+
+// Number of samples of the pixels of 'buffer', which must be the same for all
+std::uint32_t CommonSamples(AccumulationBuffer const& buffer)
+{
+    std::uint32_t const samples = buffer.Samples(0U, 0U);
+    for (std::size_t y = 0; y < kHeight; ++y) {
+        for (std::size_t x = 0; x < kWidth; ++x)
+            REQUIRE(buffer.Samples(x, y) == samples);
+    }
+    return samples;
+}
+
+// Checks that 'buffer' holds the very same sums as rendering 'samples'
+// samples per pixel without a time budget
+void CheckSameAsFixedRender(SpheresScene const& scene,
+                            AccumulationBuffer const& buffer,
+                            std::size_t samples)
+{
+    TestRenderer rend(&Identity, kWidth, kHeight, samples, 5U);
+    PrepareTestRenderer(rend, scene);
+    AccumulationTile tile(0U, 0U, kWidth, kHeight, 0U, samples);
+    rend.Accumulate(scene, MakeTestCamera(), tile);
+    AccumulationBuffer fixed(kWidth, kHeight);
+    fixed.Add(tile);
+    for (std::size_t y = 0; y < kHeight; ++y) {
+        for (std::size_t x = 0; x < kWidth; ++x) {
+            REQUIRE(fixed.Samples(x, y) == buffer.Samples(x, y));
+            REQUIRE(fixed.Sum(x, y) == buffer.Sum(x, y));
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Renderer : time budgets", "[TimeBudget]")
+{
+    SpheresScene scene;
+    scene.LoadWorld();
+    Camera const camera = MakeTestCamera();
+    AccumulationBuffer buffer(kWidth, kHeight);
+
+    SECTION("A tiny budget stops early with the same samples in every pixel")
+    {
+        constexpr std::size_t kMaximumSamples = 100000U;
+        TestRenderer rend(&Identity, kWidth, kHeight, kMaximumSamples, 5U);
+        PrepareTestRenderer(rend, scene);
+        rend.SetTimeBudget(std::chrono::microseconds(1));
+        rend.AccumulateWithinBudget(scene, camera, buffer);
+        std::uint32_t const samples = CommonSamples(buffer);
+        CHECK(samples >= 1U);
+        CHECK(samples < kMaximumSamples);
+    }
+
+    SECTION("Passes within a budget add up to the image rendered in one go")
+    {
+        TestRenderer rend(&Identity, kWidth, kHeight, 4096U, 5U);
+        PrepareTestRenderer(rend, scene);
+        rend.SetTimeBudget(std::chrono::milliseconds(100));
+        rend.AccumulateWithinBudget(scene, camera, buffer);
+        std::uint32_t const samples = CommonSamples(buffer);
+        REQUIRE(samples >= 1U);
+        CheckSameAsFixedRender(scene, buffer, samples);
+    }
+
+    SECTION("Budgets of zero or less render every sample")
+    {
+        constexpr std::size_t kSamples = 8U;
+        TestRenderer rend(&Identity, kWidth, kHeight, kSamples, 5U);
+        PrepareTestRenderer(rend, scene);
+        auto const budget = GENERATE(as<ProgressReporter::Clock::duration>(),
+                                     ProgressReporter::Clock::duration::zero(),
+                                     -std::chrono::seconds(1));
+        rend.SetTimeBudget(budget);
+        rend.AccumulateWithinBudget(scene, camera, buffer);
+        CHECK(CommonSamples(buffer) == kSamples);
+        CheckSameAsFixedRender(scene, buffer, kSamples);
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,525 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "camera.hpp"
+#include "flat_bvh.hpp"
+#include "hittable_list.hpp"
+#include "mapped_file.hpp"
+#include "material_table.hpp"
+#include "packed_spheres.hpp"
+#include "scene.hpp"
+#include "scene_settings.hpp"
+#include "sphere.hpp"
+#include "texture_table.hpp"
+
+namespace plemma::glancy {
+
+// Binary scene files, meant to be produced once from a text scene file
+// (see FileScene and 'glancy --pack') and then loaded without parsing
+// anything nor building any tree: spheres and the flat BVH over them are
+// memory mapped and used in place, so loading costs the same for a
+// handful of spheres than for millions of them.
+//
+// Layout of a binary scene file (native endianness):
+//   BinarySceneHeader
+//   BinaryTexture textures[texture_count]          (padded to 8 bytes)
+//   BinaryMaterial materials[material_count]       (padded to 8 bytes)
+//   RealNum center_x[sphere_count]                 (padded to 8 bytes)
+//   RealNum center_y[sphere_count]                 (padded to 8 bytes)
+//   RealNum center_z[sphere_count]                 (padded to 8 bytes)
+//   RealNum radius[sphere_count]                   (padded to 8 bytes)
+//   std::uint32_t sphere_material[sphere_count]    (padded to 8 bytes)
+//   FlatBVHNode nodes[node_count]
+//
+// Spheres are stored in the order of the leaves of the tree. Textures
+// and materials are the flattened ones of a MaterialTable, so checker
+// textures only refer to textures stored before them.
+
+constexpr std::uint32_t kBinarySceneFormatVersion = 1U;
+constexpr char kBinarySceneMagic[8] = {'G', 'L', 'N', 'C', 'Y', 'S', 'C', 'N'};
+
+struct BinarySceneHeader
+{
+    char magic[8];
+    std::uint32_t format_version;
+    std::uint32_t real_num_size;
+    std::uint64_t texture_count;
+    std::uint64_t material_count;
+    std::uint64_t sphere_count;
+    std::uint64_t node_count;
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t samples_per_pixel;
+    std::uint32_t max_depth;
+    std::uint32_t has_background;
+    Vec3 background;
+    CameraSettings camera;
+};
+
+enum class BinaryTextureKind : std::uint32_t
+{
+    kConstant = 0U,
+    kChecker = 1U
+};
+
+struct BinaryTexture
+{
+    BinaryTextureKind kind;
+    TextureId first;
+    TextureId second;
+    Vec3 color;
+};
+
+enum class BinaryMaterialKind : std::uint32_t
+{
+    kLambertian = 0U,
+    kMetal = 1U,
+    kDielectric = 2U,
+    kDiffuseLight = 3U
+};
+
+struct BinaryMaterial
+{
+    BinaryMaterialKind kind;
+    // Albedo of lambertians and emission of lights
+    TextureId texture;
+    // Albedo of metals
+    Vec3 color;
+    // Fuzziness of metals and refractive index of dielectrics
+    RealNum parameter;
+};
+
+static_assert(std::is_trivially_copyable_v<BinarySceneHeader> &&
+                  std::is_trivially_copyable_v<BinaryTexture> &&
+                  std::is_trivially_copyable_v<BinaryMaterial> &&
+                  std::is_trivially_copyable_v<FlatBVHNode>,
+              "Binary scene records must be trivially copyable");
+
+namespace binary_scene_detail {
+
+constexpr std::size_t PaddedToEightBytes(std::size_t size) noexcept
+{
+    return (size + 7U) & ~std::size_t(7U);
+}
+
+// Offsets of the sections of a file with the counts in 'header'
+struct Sections
+{
+    explicit Sections(BinarySceneHeader const& header) noexcept
+    {
+        std::size_t const spheres = header.sphere_count;
+        textures = PaddedToEightBytes(sizeof(BinarySceneHeader));
+        materials = textures + PaddedToEightBytes(header.texture_count * sizeof(BinaryTexture));
+        center_x = materials + PaddedToEightBytes(header.material_count * sizeof(BinaryMaterial));
+        center_y = center_x + PaddedToEightBytes(spheres * sizeof(RealNum));
+        center_z = center_y + PaddedToEightBytes(spheres * sizeof(RealNum));
+        radius = center_z + PaddedToEightBytes(spheres * sizeof(RealNum));
+        sphere_material = radius + PaddedToEightBytes(spheres * sizeof(RealNum));
+        nodes = sphere_material + PaddedToEightBytes(spheres * sizeof(std::uint32_t));
+        end = nodes + header.node_count * sizeof(FlatBVHNode);
+    }
+
+    std::size_t textures;
+    std::size_t materials;
+    std::size_t center_x;
+    std::size_t center_y;
+    std::size_t center_z;
+    std::size_t radius;
+    std::size_t sphere_material;
+    std::size_t nodes;
+    std::size_t end;
+};
+
+// Whether 'nodes' are a tree laid out as BuildFlatBVH does over
+// 'sphere_count' primitives, shallow enough to be traversed
+inline bool IsValidFlatBVH(FlatBVHNode const* nodes,
+                           std::size_t node_count,
+                           std::size_t sphere_count) noexcept
+{
+    // In a depth first layout, nodes are visited in the order they are stored
+    constexpr std::size_t kMaxDepth = 64U;
+    std::uint32_t stack[kMaxDepth];
+    std::size_t stack_size = 0U;
+    std::size_t visited = 0U;
+    std::size_t current = 0U;
+    while (true) {
+        if (current != visited++ || current >= node_count)
+            return false;
+        FlatBVHNode const& node = nodes[current];
+        if (node.count > 0U) {
+            if (std::size_t(node.offset) + node.count > sphere_count)
+                return false;
+            if (stack_size == 0U)
+                return visited == node_count;
+            current = stack[--stack_size];
+        }
+        else {
+            if (stack_size == kMaxDepth || node.offset <= current + 1U)
+                return false;
+            stack[stack_size++] = node.offset;
+            ++current;
+        }
+    }
+}
+
+}  // namespace binary_scene_detail
+
+// Writes the static spheres of 'world' (procedural ones, stored in
+// PackedSpheres, included), their materials and the settings to
+// 'file_path'. Fails, describing why in 'error', if 'world' contains
+// anything else or materials that are not part of this library.
+inline bool SaveBinaryScene(std::string const& file_path,
+                            HittableList const& world,
+                            RenderSettings const& settings,
+                            CameraSettings const& camera,
+                            std::optional<Vec3> const& background,
+                            std::string& error)
+{
+    MaterialTable table;
+    std::vector<Vec3> centers;
+    std::vector<RealNum> radii;
+    std::vector<std::uint32_t> sphere_materials;
+    for (auto const& item : world) {
+        if (auto const* packed = dynamic_cast<PackedSpheres const*>(item.get())) {
+            PackedSpheresView const& view = packed->View();
+            if (view.velocity_x != nullptr) {
+                error = "moving procedural spheres can not be stored in binary scene files";
+                return false;
+            }
+            std::vector<MaterialId> material_ids;
+            for (auto const& material : packed->Materials())
+                material_ids.push_back(material ? table.Add(*material) : kUnboundMaterialId);
+            for (std::size_t i = 0; i < view.sphere_count; ++i) {
+                if (view.material[i] >= material_ids.size() ||
+                    material_ids[view.material[i]] == kUnboundMaterialId) {
+                    error = "spheres without material can not be stored in binary scene files";
+                    return false;
+                }
+                centers.emplace_back(view.center_x[i], view.center_y[i], view.center_z[i]);
+                radii.push_back(view.radius[i]);
+                sphere_materials.push_back(material_ids[view.material[i]]);
+            }
+            continue;
+        }
+        auto const* sphere = dynamic_cast<Sphere<Vec3, RealNum> const*>(item.get());
+        if (sphere == nullptr) {
+            error = "only static spheres can be stored in binary scene files";
+            return false;
+        }
+        if (!sphere->GetMaterial()) {
+            error = "spheres without material can not be stored in binary scene files";
+            return false;
+        }
+        centers.push_back(sphere->GetCenter().ToVec3());
+        radii.push_back(sphere->GetRadius());
+        sphere_materials.push_back(table.Add(*sphere->GetMaterial()));
+    }
+
+    std::vector<BinaryTexture> textures;
+    for (auto const& texture : table.Textures().Textures()) {
+        BinaryTexture& record = textures.emplace_back(
+            BinaryTexture{BinaryTextureKind::kConstant, 0U, 0U, Vec3()});
+        if (auto const* constant = std::get_if<FlatConstantTexture>(&texture)) {
+            record.color = constant->color;
+        }
+        else {
+            auto const& checker = std::get<FlatCheckerTexture>(texture);
+            record.kind = BinaryTextureKind::kChecker;
+            record.first = checker.first;
+            record.second = checker.second;
+        }
+    }
+
+    std::vector<BinaryMaterial> materials;
+    for (auto const& material : table.Materials()) {
+        BinaryMaterial& record = materials.emplace_back(
+            BinaryMaterial{BinaryMaterialKind::kLambertian, kInvalidTextureId, Vec3(), Real(0)});
+        if (auto const* lambertian = std::get_if<FlatLambertian>(&material)) {
+            record.texture = lambertian->albedo;
+        }
+        else if (auto const* metal = std::get_if<FlatMetal>(&material)) {
+            record.kind = BinaryMaterialKind::kMetal;
+            record.color = metal->albedo;
+            record.parameter = metal->fuzz;
+        }
+        else if (auto const* dielectric = std::get_if<FlatDielectric>(&material)) {
+            record.kind = BinaryMaterialKind::kDielectric;
+            record.parameter = dielectric->refractive_index;
+        }
+        else if (auto const* light = std::get_if<FlatDiffuseLight>(&material)) {
+            record.kind = BinaryMaterialKind::kDiffuseLight;
+            record.texture = light->emit;
+        }
+        else {
+            error = "only materials of glancy can be stored in binary scene files";
+            return false;
+        }
+    }
+
+    PackedSpheresArrays const packed = PackSpheres(centers, radii, sphere_materials);
+
+    BinarySceneHeader header{};
+    std::memcpy(header.magic, kBinarySceneMagic, sizeof(header.magic));
+    header.format_version = kBinarySceneFormatVersion;
+    header.real_num_size = static_cast<std::uint32_t>(sizeof(RealNum));
+    header.texture_count = textures.size();
+    header.material_count = materials.size();
+    header.sphere_count = packed.radius.size();
+    header.node_count = packed.nodes.size();
+    header.width = settings.width;
+    header.height = settings.height;
+    header.samples_per_pixel = settings.samples_per_pixel;
+    header.max_depth = settings.max_depth;
+    header.has_background = background ? 1U : 0U;
+    header.background = background.value_or(Vec3(Real(0), Real(0), Real(0)));
+    header.camera = camera;
+
+    binary_scene_detail::Sections const sections(header);
+    std::vector<char> contents(sections.end);
+    auto const copy = [&contents](std::size_t offset, void const* data, std::size_t size) {
+        if (size > 0U)
+            std::memcpy(contents.data() + offset, data, size);
+    };
+    copy(0U, &header, sizeof(header));
+    copy(sections.textures, textures.data(), textures.size() * sizeof(BinaryTexture));
+    copy(sections.materials, materials.data(), materials.size() * sizeof(BinaryMaterial));
+    std::size_t const coordinates_size = packed.radius.size() * sizeof(RealNum);
+    copy(sections.center_x, packed.center_x.data(), coordinates_size);
+    copy(sections.center_y, packed.center_y.data(), coordinates_size);
+    copy(sections.center_z, packed.center_z.data(), coordinates_size);
+    copy(sections.radius, packed.radius.data(), coordinates_size);
+    copy(sections.sphere_material,
+         packed.material.data(),
+         packed.material.size() * sizeof(std::uint32_t));
+    copy(sections.nodes, packed.nodes.data(), packed.nodes.size() * sizeof(FlatBVHNode));
+
+    std::ofstream scene_file(file_path, std::ios::binary | std::ios::trunc);
+    scene_file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    if (!scene_file) {
+        error = "could not write " + file_path;
+        return false;
+    }
+    return true;
+}
+
+// Whether 'file_path' starts as a binary scene file
+inline bool IsBinarySceneFile(std::string const& file_path) noexcept
+{
+    MappedFile const file(file_path);
+    return file.IsOpen() && file.Size() >= sizeof(kBinarySceneMagic) &&
+           std::memcmp(file.Data(), kBinarySceneMagic, sizeof(kBinarySceneMagic)) == 0;
+}
+
+// Scene stored in a binary scene file. The file stays mapped while the
+// world of the scene is alive, and its spheres are rendered from there
+// through a single PackedSpheres hittable. Spheres made of light
+// materials are also added, one by one, to the lights of the scene.
+class BinaryScene : public Scene
+{
+  public:
+    explicit BinaryScene(std::string file_path) : file_path_(std::move(file_path)) {}
+
+    // Maps and validates the file. Whether it succeeded can be checked
+    // with IsLoaded.
+    void LoadWorld() noexcept final;
+    [[nodiscard]] HittableList const& World() const noexcept final { return world_; }
+    [[nodiscard]] HittableList const& Lights() const noexcept final { return lights_; }
+    [[nodiscard]] Vec3 Background(Ray const& r) const noexcept final
+    {
+        return background_ ? *background_ : Scene::Background(r);
+    }
+    ~BinaryScene() final = default;
+
+    [[nodiscard]] bool IsLoaded() const noexcept { return error_.empty(); }
+    // Description of the first error found while loading, if any
+    [[nodiscard]] std::string const& Error() const noexcept { return error_; }
+    [[nodiscard]] RenderSettings const& Settings() const noexcept { return settings_; }
+    [[nodiscard]] CameraSettings const& CameraSetup() const noexcept { return camera_; }
+    [[nodiscard]] Camera MakeCamera() const noexcept
+    {
+        return glancy::MakeCamera(camera_, settings_);
+    }
+
+  private:
+    bool LoadMaterials(std::byte const* data,
+                       BinarySceneHeader const& header,
+                       binary_scene_detail::Sections const& sections,
+                       std::vector<std::shared_ptr<Material> >& materials,
+                       std::vector<bool>& emits_light);
+    bool Fail(char const* message);
+
+    std::string file_path_;
+    HittableList world_;
+    HittableList lights_;
+    std::optional<Vec3> background_;
+    RenderSettings settings_;
+    CameraSettings camera_;
+    std::string error_;
+};
+
+inline void BinaryScene::LoadWorld() noexcept
+{
+    // Loading again starts from an empty scene
+    error_.clear();
+    world_.Clear();
+    lights_.Clear();
+    ReleaseArena();
+    background_.reset();
+    settings_ = RenderSettings();
+    camera_ = CameraSettings();
+
+    auto file = std::make_shared<MappedFile>(file_path_);
+    if (!file->IsOpen()) {
+        error_ = "could not open " + file_path_;
+        return;
+    }
+
+    BinarySceneHeader header;
+    if (file->Size() < sizeof(header)) {
+        Fail("not a binary scene file");
+        return;
+    }
+    std::memcpy(&header, file->Data(), sizeof(header));
+    if (std::memcmp(header.magic, kBinarySceneMagic, sizeof(header.magic)) != 0 ||
+        header.format_version != kBinarySceneFormatVersion) {
+        Fail("not a binary scene file of a supported version");
+        return;
+    }
+    if (header.real_num_size != sizeof(RealNum)) {
+        Fail("binary scene file written with a different floating point precision");
+        return;
+    }
+    // Counts are bounded so that computing the size of the sections can
+    // not overflow, and spheres can be referred to with 32 bits
+    constexpr std::uint64_t kMaxCount = std::uint64_t(1U) << 31U;
+    if (header.texture_count > kMaxCount || header.material_count > kMaxCount ||
+        header.sphere_count > kMaxCount || header.node_count > kMaxCount ||
+        (header.sphere_count > 0U) != (header.node_count > 0U) || header.width == 0U ||
+        header.height == 0U || header.samples_per_pixel == 0U ||
+        header.max_depth > std::numeric_limits<std::uint16_t>::max()) {
+        Fail("corrupted binary scene file header");
+        return;
+    }
+    // Same cameras as those of scene files
+    if (!IsValidCamera(header.camera)) {
+        Fail("invalid camera in binary scene file");
+        return;
+    }
+    binary_scene_detail::Sections const sections(header);
+    if (file->Size() < sections.end) {
+        Fail("truncated binary scene file");
+        return;
+    }
+
+    settings_.width = header.width;
+    settings_.height = header.height;
+    settings_.samples_per_pixel = header.samples_per_pixel;
+    settings_.max_depth = static_cast<std::uint16_t>(header.max_depth);
+    camera_ = header.camera;
+    if (header.has_background != 0U)
+        background_ = header.background;
+
+    std::byte const* data = file->Data();
+    std::vector<std::shared_ptr<Material> > materials;
+    std::vector<bool> emits_light;
+    if (!LoadMaterials(data, header, sections, materials, emits_light))
+        return;
+
+    // Mapped memory is page aligned and offsets are multiple of 8 bytes,
+    // so spheres and nodes can be used in place
+    PackedSpheresView view;
+    view.center_x = reinterpret_cast<RealNum const*>(data + sections.center_x);
+    view.center_y = reinterpret_cast<RealNum const*>(data + sections.center_y);
+    view.center_z = reinterpret_cast<RealNum const*>(data + sections.center_z);
+    view.radius = reinterpret_cast<RealNum const*>(data + sections.radius);
+    view.material = reinterpret_cast<std::uint32_t const*>(data + sections.sphere_material);
+    view.sphere_count = header.sphere_count;
+    view.nodes = reinterpret_cast<FlatBVHNode const*>(data + sections.nodes);
+    view.node_count = header.node_count;
+    if (view.node_count > 0U &&
+        !binary_scene_detail::IsValidFlatBVH(view.nodes, view.node_count, view.sphere_count)) {
+        Fail("corrupted tree in binary scene file");
+        return;
+    }
+
+    for (std::size_t i = 0; i < view.sphere_count; ++i) {
+        std::uint32_t const material = view.material[i];
+        if (material >= materials.size()) {
+            Fail("sphere with undefined material in binary scene file");
+            return;
+        }
+        if (emits_light[material]) {
+            Vec3 const center(view.center_x[i], view.center_y[i], view.center_z[i]);
+            lights_.Add(
+                Make<Sphere<Vec3, RealNum> >(center, view.radius[i], materials[material]));
+        }
+    }
+    if (view.sphere_count > 0U)
+        world_.Add(Make<PackedSpheres>(view, std::move(materials), std::move(file)));
+    BindMaterials();
+}
+
+inline bool BinaryScene::LoadMaterials(std::byte const* data,
+                                       BinarySceneHeader const& header,
+                                       binary_scene_detail::Sections const& sections,
+                                       std::vector<std::shared_ptr<Material> >& materials,
+                                       std::vector<bool>& emits_light)
+{
+    SceneBuilder& builder = Builder();
+    std::vector<std::shared_ptr<Texture> > textures;
+    textures.reserve(header.texture_count);
+    for (std::size_t i = 0; i < header.texture_count; ++i) {
+        BinaryTexture record;
+        std::memcpy(&record, data + sections.textures + i * sizeof(record), sizeof(record));
+        if (record.kind == BinaryTextureKind::kConstant) {
+            textures.push_back(builder.MakeConstantTexture(record.color));
+        }
+        else if (record.kind == BinaryTextureKind::kChecker && record.first < i &&
+                 record.second < i) {
+            textures.push_back(
+                builder.MakeCheckerTexture(textures[record.first], textures[record.second]));
+        }
+        else {
+            return Fail("corrupted texture in binary scene file");
+        }
+    }
+
+    materials.reserve(header.material_count);
+    emits_light.reserve(header.material_count);
+    for (std::size_t i = 0; i < header.material_count; ++i) {
+        BinaryMaterial record;
+        std::memcpy(&record, data + sections.materials + i * sizeof(record), sizeof(record));
+        bool const has_texture = record.texture < textures.size();
+        if (record.kind == BinaryMaterialKind::kLambertian && has_texture)
+            materials.push_back(builder.MakeLambertian(textures[record.texture]));
+        else if (record.kind == BinaryMaterialKind::kMetal)
+            materials.push_back(builder.MakeMetal(record.color, record.parameter));
+        else if (record.kind == BinaryMaterialKind::kDielectric && record.parameter >= Real(1))
+            materials.push_back(builder.MakeDielectric(record.parameter));
+        else if (record.kind == BinaryMaterialKind::kDiffuseLight && has_texture)
+            materials.push_back(builder.MakeDiffuseLight(textures[record.texture]));
+        else
+            return Fail("corrupted material in binary scene file");
+        emits_light.push_back(record.kind == BinaryMaterialKind::kDiffuseLight);
+    }
+    return true;
+}
+
+inline bool BinaryScene::Fail(char const* message)
+{
+    error_ = file_path_ + ": " + message;
+    return false;
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+#include "orthonormal_basis.hpp"
+#include "scene_settings.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Path of a camera through time given by keyframes. Positions (where the
+// camera is and where it looks at) follow a centripetal Catmull-Rom spline
+// through the keyframes, so that fly-throughs and turntables are smooth
+// with a few of them; the rest of the parameters are interpolated linearly,
+// the up direction being normalised and kept across the view.
+class CameraPath
+{
+  public:
+    // Adds the keyframe placing the camera at 'camera' at time 'time',
+    // replacing any other keyframe at the same time
+    void AddKeyframe(RealNum time, CameraSettings const& camera);
+
+    // Camera at time 'time', which is the one of the first (last) keyframe
+    // before (after) all of them. Must not be empty.
+    [[nodiscard]] CameraSettings At(RealNum time) const noexcept;
+
+    [[nodiscard]] bool Empty() const noexcept { return keyframes_.empty(); }
+    [[nodiscard]] std::size_t Size() const noexcept { return keyframes_.size(); }
+
+  private:
+    struct Keyframe
+    {
+        RealNum time;
+        CameraSettings camera;
+    };
+
+    // Centripetal Catmull-Rom spline from p1 (s = 0) to p2 (s = 1)
+    [[nodiscard]] static Vec3 CatmullRom(
+        Vec3 const& p0, Vec3 const& p1, Vec3 const& p2, Vec3 const& p3, RealNum s) noexcept;
+
+    // First of 'candidates' not along 'view', as a unit vector
+    [[nodiscard]] static Vec3 UpAcross(Vec3 const& view,
+                                       std::initializer_list<Vec3> candidates) noexcept;
+
+    // Sorted by time
+    std::vector<Keyframe> keyframes_;
+};
+
+inline void CameraPath::AddKeyframe(RealNum time, CameraSettings const& camera)
+{
+    auto const position = std::lower_bound(
+        keyframes_.begin(), keyframes_.end(), time, [](Keyframe const& keyframe, RealNum t) {
+            return keyframe.time < t;
+        });
+    if (position != keyframes_.end() && position->time == time)
+        position->camera = camera;
+    else
+        keyframes_.insert(position, Keyframe{time, camera});
+}
+
+inline CameraSettings CameraPath::At(RealNum time) const noexcept
+{
+    if (time <= keyframes_.front().time)
+        return keyframes_.front().camera;
+    if (time >= keyframes_.back().time)
+        return keyframes_.back().camera;
+
+    // Keyframes i and i + 1 surround 'time'
+    auto const next = std::upper_bound(
+        keyframes_.begin(), keyframes_.end(), time, [](RealNum t, Keyframe const& keyframe) {
+            return t < keyframe.time;
+        });
+    std::size_t const i = static_cast<std::size_t>(next - keyframes_.begin()) - 1U;
+    CameraSettings const& from = keyframes_[i].camera;
+    CameraSettings const& to = keyframes_[i + 1U].camera;
+    // Ends of the path are extended with the keyframes at them
+    CameraSettings const& before = keyframes_[i > 0U ? i - 1U : i].camera;
+    CameraSettings const& after = keyframes_[std::min(i + 2U, keyframes_.size() - 1U)].camera;
+    RealNum const s = (time - keyframes_[i].time) / (keyframes_[i + 1U].time - keyframes_[i].time);
+    auto const lerp = [s](RealNum a, RealNum b) { return a + s * (b - a); };
+
+    CameraSettings camera = from;
+    camera.look_from =
+        CatmullRom(before.look_from, from.look_from, to.look_from, after.look_from, s);
+    camera.look_at = CatmullRom(before.look_at, from.look_at, to.look_at, after.look_at, s);
+    // Blending the ups of two keyframes shortens them, and may turn them
+    // along the view, as may the view turn along them: the up of the
+    // closest keyframe is taken then
+    Vec3 const& closest_up = s < Real(0.5) ? from.up : to.up;
+    Vec3 const& farthest_up = s < Real(0.5) ? to.up : from.up;
+    camera.up = UpAcross(camera.look_at - camera.look_from,
+                         {from.up + s * (to.up - from.up), closest_up, farthest_up});
+    camera.vertical_fov_deg = lerp(from.vertical_fov_deg, to.vertical_fov_deg);
+    camera.aperture = lerp(from.aperture, to.aperture);
+    camera.focus_distance = lerp(from.focus_distance, to.focus_distance);
+    return camera;
+}
+
+// Knots are spaced by the square root of the distance between keyframes,
+// rather than uniformly, so that the spline neither overshoots nor forms
+// cusps or loops when they are unevenly spaced (Yuksel et al.,
+// "Parameterization and Applications of Catmull-Rom Curves", 2011). The
+// spline is evaluated as the cubic Hermite curve with the tangents it has
+// at p1 and p2.
+inline Vec3 CameraPath::CatmullRom(
+    Vec3 const& p0, Vec3 const& p1, Vec3 const& p2, Vec3 const& p3, RealNum s) noexcept
+{
+    RealNum const d12 = std::sqrt((p2 - p1).Norm());
+    if (d12 <= Real(0))
+        return p1;
+    // Ends of the path repeat their keyframe, which then takes the spacing
+    // of the segment next to it
+    RealNum d01 = std::sqrt((p1 - p0).Norm());
+    RealNum d23 = std::sqrt((p3 - p2).Norm());
+    if (d01 <= Real(0))
+        d01 = d12;
+    if (d23 <= Real(0))
+        d23 = d12;
+    // Tangents scaled to the segment from p1 to p2
+    Vec3 const m1 = d12 * ((p1 - p0) / d01 - (p2 - p0) / (d01 + d12)) + (p2 - p1);
+    Vec3 const m2 = (p2 - p1) + d12 * ((p3 - p2) / d23 - (p3 - p1) / (d12 + d23));
+
+    RealNum const s2 = s * s;
+    RealNum const s3 = s2 * s;
+    return (Real(2) * s3 - Real(3) * s2 + Real(1)) * p1 + (s3 - Real(2) * s2 + s) * m1 +
+           (Real(3) * s2 - Real(2) * s3) * p2 + (s3 - s2) * m2;
+}
+
+// Falls back to a direction across the view when every candidate is along
+// it, e.g. when the camera flies over what it looks at
+inline Vec3 CameraPath::UpAcross(Vec3 const& view,
+                                 std::initializer_list<Vec3> candidates) noexcept
+{
+    // Sine of the smallest angle between the up and the view
+    constexpr RealNum kMinSine = Real(1e-3);
+    RealNum const view_length = view.Norm();
+    for (Vec3 const& up : candidates) {
+        RealNum const length = up.Norm();
+        if (length > Real(0) &&
+            (view_length <= Real(0) || Cross(view, up).Norm() > kMinSine * view_length * length))
+            return up / length;
+    }
+    return OrthonormalBasis(view / view_length).V();
+}
+
+}  // namespace plemma::glancy
@@ -30,40 +30,42 @@ class DifferentDielectricsScene : public Scene
 
 inline void DifferentDielectricsScene::LoadWorld() noexcept
 {
+    SceneBuilder& builder = Builder();
     // All spheres will be static as this scene is to test different
     // dielectric materials
     // Add base sphere ("floor")
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3{Real(0), Real(-1e5), Real(0)},
         Real(1e5),
-        std::make_shared<Lambertian>(
-            std::make_shared<ConstantTexture>(Vec3(Real(0.0075), Real(0.3), Real(0.675))))));
+        builder.MakeLambertian(Vec3(Real(0.0075), Real(0.3), Real(0.675)))));
 
     // Add one sphere for each type of dielectric (except vacuum)
     RealNum radius_big_circle{Real(5.5)};
     RealNum coordinate_odd_multiples_of_45{std::sqrt(Real(2)) * radius_big_circle / Real(2)};
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3{coordinate_odd_multiples_of_45, Real(0.5), coordinate_odd_multiples_of_45},
         Real(0.5),
-        std::make_shared<Ice>()));
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-        Vec3{radius_big_circle, Real(0.6), Real(0)}, Real(0.6), std::make_shared<Water>()));
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+        builder.MakeDielectric<Ice>()));
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
+        Vec3{radius_big_circle, Real(0.6), Real(0)}, Real(0.6), builder.MakeDielectric<Water>()));
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3{coordinate_odd_multiples_of_45, Real(0.7), -coordinate_odd_multiples_of_45},
         Real(0.7),
-        std::make_shared<OliveOil>()));
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-        Vec3{Real(0), Real(0.8), -radius_big_circle}, Real(0.8), std::make_shared<WindowGlass>()));
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+        builder.MakeDielectric<OliveOil>()));
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
+        Vec3{Real(0), Real(0.8), -radius_big_circle},
+        Real(0.8),
+        builder.MakeDielectric<WindowGlass>()));
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3{-coordinate_odd_multiples_of_45, Real(0.9), -coordinate_odd_multiples_of_45},
         Real(0.9),
-        std::make_shared<FlintGlass>()));
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-        Vec3{-radius_big_circle, Real(1), Real(0)}, Real(1), std::make_shared<Sapphire>()));
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+        builder.MakeDielectric<FlintGlass>()));
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
+        Vec3{-radius_big_circle, Real(1), Real(0)}, Real(1), builder.MakeDielectric<Sapphire>()));
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3{-coordinate_odd_multiples_of_45, Real(1.1), coordinate_odd_multiples_of_45},
         Real(1.1),
-        std::make_shared<Diamond>()));
+        builder.MakeDielectric<Diamond>()));
 
     std::uniform_real_distribution<RealNum> dist(Real(0), Real(1));
     // Add some spheres inside the "dielectric circle"
@@ -78,17 +80,15 @@ inline void DifferentDielectricsScene::LoadWorld() noexcept
                         Real(0.5) * (Real(1) + dist(my_engine())),
                         Real(0.5) * (Real(1) + dist(my_engine())));
             RealNum fuzziness{Real(0.5) * dist(my_engine())};
-            world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                center, radius, std::make_shared<Metal>(albedo, fuzziness)));
+            world_.Add(Make<Sphere<Vec3, RealNum> >(
+                center, radius, builder.MakeMetal(albedo, fuzziness)));
         }
         else {
             Vec3 albedo(dist(my_engine()) * dist(my_engine()),
                         dist(my_engine()) * dist(my_engine()),
                         dist(my_engine()) * dist(my_engine()));
-            world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                center,
-                radius,
-                std::make_shared<Lambertian>(std::make_shared<ConstantTexture>(albedo))));
+            world_.Add(
+                Make<Sphere<Vec3, RealNum> >(center, radius, builder.MakeLambertian(albedo)));
         }
     }
 
@@ -104,19 +104,18 @@ inline void DifferentDielectricsScene::LoadWorld() noexcept
                         Real(0.5) * (Real(1) + dist(my_engine())),
                         Real(0.5) * (Real(1) + dist(my_engine())));
             RealNum fuzziness{Real(0.5) * dist(my_engine())};
-            world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                center, radius, std::make_shared<Metal>(albedo, fuzziness)));
+            world_.Add(Make<Sphere<Vec3, RealNum> >(
+                center, radius, builder.MakeMetal(albedo, fuzziness)));
         }
         else {
             Vec3 albedo(dist(my_engine()) * dist(my_engine()),
                         dist(my_engine()) * dist(my_engine()),
                         dist(my_engine()) * dist(my_engine()));
-            world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                center,
-                radius,
-                std::make_shared<Lambertian>(std::make_shared<ConstantTexture>(albedo))));
+            world_.Add(
+                Make<Sphere<Vec3, RealNum> >(center, radius, builder.MakeLambertian(albedo)));
         }
     }
+    BindMaterials();
 }
 
 // DifferentDielectricsScene scene;
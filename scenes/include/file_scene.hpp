@@ -0,0 +1,608 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "affine_transform.hpp"
+#include "camera.hpp"
+#include "camera_path.hpp"
+#include "constants.hpp"
+#include "instance.hpp"
+#include "mapped_file.hpp"
+#include "material.hpp"
+#include "mesh_files.hpp"
+#include "motion.hpp"
+#include "packed_spheres.hpp"
+#include "procedural_spheres.hpp"
+#include "scene.hpp"
+#include "scene_file_tokens.hpp"
+#include "scene_settings.hpp"
+#include "sphere.hpp"
+#include "texture.hpp"
+#include "triangle_mesh.hpp"
+
+namespace plemma::glancy {
+
+// Scene described in a text file, so that scenes can be generated and
+// rendered without rebuilding glancy. The file is made of statements, one
+// per line, whose tokens are separated by blanks. Everything after a '#'
+// is a comment. Textures and materials are given a name when defined and
+// must be defined before being used. Colors are given as three numbers.
+//
+//   image <width> <height>
+//   samples <rays per pixel>
+//   max_depth <maximum number of bounces>
+//   camera [look_from x y z] [look_at x y z] [up x y z] [vfov degrees]
+//          [aperture a] [focus_distance d] [shutter t0 t1]
+//   background sky | background <color>
+//   texture <name> constant <color>
+//   texture <name> checker <texture> <texture>
+//   material <name> lambertian <texture | color>
+//   material <name> metal <color> <fuzziness>
+//   material <name> dielectric <refractive index>
+//   material <name> light <texture | color>
+//   sphere <center> <radius> <material>
+//   moving_sphere <center at t0> <center at t1> <t0> <t1> <radius> <material>
+//   mesh <OBJ or PLY file> <material> [translate x y z] [scale s | scale x y z]
+//        [rotate <axis> <degrees>]
+//   procedural_spheres <count> material <material> <weight> [material ...]
+//        [seed s] [center x y z] [density d] [radius r0 r1]
+//        [clusters n spread s] [motion fraction max_speed]
+//   bvh_nodes full | quantized16 | quantized8
+//   animation <frames> <t0> <t1> [shutter <fraction of each frame>]
+//   keyframe <time> [camera options but shutter]
+//
+// Spheres made of light materials are added to the lights of the scene.
+// Meshes made of them glow, but are not sampled as lights. Paths of mesh
+// files are relative to the directory of the scene file. Each mesh file is
+// loaded once and shared by all the statements using it, which place
+// instances of it transformed by their options (applied in order).
+// Procedural spheres (see ProceduralSpheresSettings) are generated
+// straight into packed arrays, so that scenes of hundreds of millions of
+// spheres can be described in a line. Like meshes, they are not sampled as
+// lights. Those of all the statements are packed into a single hittable
+// once the whole file is read, bounding moving spheres along the shutter
+// interval of the camera, with the tree nodes given by 'bvh_nodes' (see
+// BVHNodeFormat, full by default).
+// The file is memory mapped and parsed in place, without copying it nor
+// allocating anything per token, so that it can hold millions of spheres.
+class FileScene : public Scene
+{
+  public:
+    explicit FileScene(std::string file_path) : file_path_(std::move(file_path)) {}
+
+    // Parses the file. Whether it succeeded can be checked with IsLoaded.
+    void LoadWorld() noexcept final;
+    [[nodiscard]] HittableList const& World() const noexcept final { return world_; }
+    [[nodiscard]] HittableList const& Lights() const noexcept final { return lights_; }
+    [[nodiscard]] Vec3 Background(Ray const& r) const noexcept final
+    {
+        return background_ ? *background_ : Scene::Background(r);
+    }
+    ~FileScene() final = default;
+
+    [[nodiscard]] bool IsLoaded() const noexcept { return error_.empty(); }
+    // Description of the first error found while loading, if any
+    [[nodiscard]] std::string const& Error() const noexcept { return error_; }
+    [[nodiscard]] RenderSettings const& Settings() const noexcept { return settings_; }
+    [[nodiscard]] CameraSettings const& CameraSetup() const noexcept { return camera_; }
+    [[nodiscard]] Camera MakeCamera() const noexcept
+    {
+        return glancy::MakeCamera(camera_, settings_);
+    }
+    // Frames given by the 'animation' statement, if any
+    [[nodiscard]] std::optional<AnimationSettings> const& Animation() const noexcept
+    {
+        return animation_;
+    }
+    [[nodiscard]] CameraPath const& Path() const noexcept { return path_; }
+    // Camera of frame 'frame' of the animation, which must be given
+    [[nodiscard]] Camera MakeFrameCamera(std::size_t frame) const noexcept;
+    // Color given by the 'background' statement, if any
+    [[nodiscard]] std::optional<Vec3> const& BackgroundColor() const noexcept
+    {
+        return background_;
+    }
+
+  private:
+    struct NamedMaterial
+    {
+        std::shared_ptr<Material> material;
+        bool emits_light;
+    };
+
+    // Parses a statement. Returns false and fills error_ if it is invalid.
+    bool ParseStatement(scene_file_detail::Tokens& tokens);
+    bool ParseAnimation(scene_file_detail::Tokens& tokens);
+    bool ParseKeyframe(scene_file_detail::Tokens& tokens);
+    bool ParseTexture(scene_file_detail::Tokens& tokens);
+    bool ParseMaterial(scene_file_detail::Tokens& tokens);
+    bool ParseSphere(scene_file_detail::Tokens& tokens, bool is_moving);
+    bool ParseMesh(scene_file_detail::Tokens& tokens);
+    bool ParseProceduralSpheres(scene_file_detail::Tokens& tokens);
+    // Texture given either by name or as a color
+    bool ParseTextureReference(scene_file_detail::Tokens& tokens,
+                               std::shared_ptr<Texture>& texture);
+    bool Fail(char const* message);
+
+    std::string file_path_;
+    HittableList world_;
+    HittableList lights_;
+    std::optional<Vec3> background_;
+    RenderSettings settings_;
+    CameraSettings camera_;
+    std::optional<AnimationSettings> animation_;
+    CameraPath path_;
+    std::string error_;
+    // Only valid while loading: names are views into the mapped file
+    std::unordered_map<std::string_view, std::shared_ptr<Texture> > textures_;
+    std::unordered_map<std::string_view, NamedMaterial> materials_;
+    std::unordered_map<std::string, std::shared_ptr<Hittable> > meshes_;
+    PackedSpheresArrays procedural_spheres_;
+    std::vector<std::shared_ptr<Material> > procedural_materials_;
+    BVHNodeFormat procedural_node_format_ = BVHNodeFormat::kFull;
+    CameraSettings last_keyframe_;
+};
+
+inline void FileScene::LoadWorld() noexcept
+{
+    // Loading again starts from an empty scene
+    error_.clear();
+    world_.Clear();
+    lights_.Clear();
+    ReleaseArena();
+    background_.reset();
+    settings_ = RenderSettings();
+    camera_ = CameraSettings();
+    animation_.reset();
+    path_ = CameraPath();
+    procedural_node_format_ = BVHNodeFormat::kFull;
+    last_keyframe_ = CameraSettings();
+
+    MappedFile const file(file_path_);
+    if (!file.IsOpen()) {
+        error_ = "could not open " + file_path_;
+        return;
+    }
+
+    auto const* data = reinterpret_cast<char const*>(file.Data());
+    std::string_view rest(data, file.Size());
+    std::size_t line_number = 0U;
+    while (!rest.empty()) {
+        ++line_number;
+        std::size_t const line_end = std::min(rest.find('\n'), rest.size());
+        scene_file_detail::Tokens tokens(rest.substr(0U, line_end));
+        rest.remove_prefix(std::min(line_end + 1U, rest.size()));
+        if (!ParseStatement(tokens)) {
+            error_ = file_path_ + ":" + std::to_string(line_number) + ": " + error_;
+            break;
+        }
+    }
+    // Options of the camera may be given by several statements
+    if (error_.empty() && !IsValidCamera(camera_))
+        error_ = file_path_ + ": " + scene_file_detail::kInvalidCamera;
+    if (error_.empty() && !procedural_spheres_.radius.empty()) {
+        if (animation_) {
+            PackSpheres(procedural_spheres_,
+                        animation_->time_from,
+                        animation_->time_to,
+                        procedural_node_format_);
+        }
+        else {
+            PackSpheres(procedural_spheres_,
+                        camera_.time_from,
+                        camera_.time_to,
+                        procedural_node_format_);
+        }
+        auto const arrays = std::make_shared<PackedSpheresArrays>(std::move(procedural_spheres_));
+        world_.Add(Make<PackedSpheres>(arrays->View(), std::move(procedural_materials_), arrays));
+    }
+    textures_.clear();
+    materials_.clear();
+    meshes_.clear();
+    procedural_spheres_ = PackedSpheresArrays();
+    procedural_materials_.clear();
+    BindMaterials();
+}
+
+inline bool FileScene::ParseStatement(scene_file_detail::Tokens& tokens)
+{
+    std::string_view keyword;
+    if (!tokens.Next(keyword))
+        return true;
+
+    if (keyword == "sphere" || keyword == "moving_sphere") {
+        if (!ParseSphere(tokens, keyword == "moving_sphere"))
+            return false;
+    }
+    else if (keyword == "mesh") {
+        if (!ParseMesh(tokens))
+            return false;
+    }
+    else if (keyword == "procedural_spheres") {
+        if (!ParseProceduralSpheres(tokens))
+            return false;
+    }
+    else if (keyword == "bvh_nodes") {
+        std::string_view format;
+        if (!tokens.Next(format))
+            return Fail("expected format of the tree nodes");
+        if (format == "full")
+            procedural_node_format_ = BVHNodeFormat::kFull;
+        else if (format == "quantized16")
+            procedural_node_format_ = BVHNodeFormat::kQuantized16;
+        else if (format == "quantized8")
+            procedural_node_format_ = BVHNodeFormat::kQuantized8;
+        else
+            return Fail("unknown format of the tree nodes");
+    }
+    else if (keyword == "material") {
+        if (!ParseMaterial(tokens))
+            return false;
+    }
+    else if (keyword == "texture") {
+        if (!ParseTexture(tokens))
+            return false;
+    }
+    else if (keyword == "camera") {
+        if (!scene_file_detail::ParseCameraOptions(tokens, camera_, true))
+            return Fail("invalid camera option");
+    }
+    else if (keyword == "animation") {
+        if (!ParseAnimation(tokens))
+            return false;
+    }
+    else if (keyword == "keyframe") {
+        if (!ParseKeyframe(tokens))
+            return false;
+    }
+    else if (keyword == "image") {
+        std::uint64_t width, height;
+        if (!tokens.Next(width) || !tokens.Next(height) || width == 0U || height == 0U)
+            return Fail("expected width and height of the image");
+        settings_.width = width;
+        settings_.height = height;
+    }
+    else if (keyword == "samples") {
+        std::uint64_t samples;
+        if (!tokens.Next(samples) || samples == 0U)
+            return Fail("expected number of rays per pixel");
+        settings_.samples_per_pixel = samples;
+    }
+    else if (keyword == "max_depth") {
+        std::uint64_t max_depth;
+        if (!tokens.Next(max_depth) || max_depth > std::numeric_limits<std::uint16_t>::max())
+            return Fail("expected maximum depth");
+        settings_.max_depth = static_cast<std::uint16_t>(max_depth);
+    }
+    else if (keyword == "background") {
+        if (tokens.NextIsNumber()) {
+            Vec3 color;
+            if (!tokens.Next(color))
+                return Fail("expected background color");
+            background_ = color;
+        }
+        else {
+            std::string_view kind;
+            if (!tokens.Next(kind) || kind != "sky")
+                return Fail("expected 'sky' or a color as background");
+            background_.reset();
+        }
+    }
+    else {
+        return Fail("unknown statement");
+    }
+
+    return tokens.AtEnd() || Fail("unexpected tokens at the end of the statement");
+}
+
+inline Camera FileScene::MakeFrameCamera(std::size_t frame) const noexcept
+{
+    RealNum opens;
+    RealNum closes;
+    animation_->FrameShutter(frame, opens, closes);
+    // The camera stays where it is when the shutter opens during a frame
+    CameraSettings camera = path_.Empty() ? camera_ : path_.At(opens);
+    camera.time_from = opens;
+    camera.time_to = closes;
+    return glancy::MakeCamera(camera, settings_);
+}
+
+inline bool FileScene::ParseAnimation(scene_file_detail::Tokens& tokens)
+{
+    AnimationSettings animation;
+    std::uint64_t frame_count;
+    if (!tokens.Next(frame_count) || frame_count == 0U || !tokens.Next(animation.time_from) ||
+        !tokens.Next(animation.time_to) || !(animation.time_from <= animation.time_to))
+        return Fail("expected number of frames and time interval (t0 <= t1) of animation");
+    animation.frame_count = frame_count;
+    std::string_view option;
+    if (tokens.Next(option) &&
+        (option != "shutter" || !tokens.Next(animation.shutter) ||
+         !(animation.shutter >= Real(0) && animation.shutter <= Real(1))))
+        return Fail("expected shutter (between 0 and 1) of animation");
+    animation_ = animation;
+    return true;
+}
+
+inline bool FileScene::ParseKeyframe(scene_file_detail::Tokens& tokens)
+{
+    RealNum time;
+    if (!tokens.Next(time))
+        return Fail("expected time of keyframe");
+    CameraSettings camera = path_.Empty() ? camera_ : last_keyframe_;
+    if (!scene_file_detail::ParseCameraOptions(tokens, camera, false))
+        return Fail("invalid keyframe option");
+    if (!IsValidCamera(camera))
+        return Fail(scene_file_detail::kInvalidCamera);
+    path_.AddKeyframe(time, camera);
+    last_keyframe_ = camera;
+    return true;
+}
+
+inline bool FileScene::ParseTexture(scene_file_detail::Tokens& tokens)
+{
+    std::string_view name;
+    std::string_view kind;
+    if (!tokens.Next(name) || !tokens.Next(kind))
+        return Fail("expected name and kind of texture");
+
+    std::shared_ptr<Texture> texture;
+    if (kind == "constant") {
+        Vec3 color;
+        if (!tokens.Next(color))
+            return Fail("expected color of constant texture");
+        texture = Builder().MakeConstantTexture(color);
+    }
+    else if (kind == "checker") {
+        std::shared_ptr<Texture> first;
+        std::shared_ptr<Texture> second;
+        if (!ParseTextureReference(tokens, first) || !ParseTextureReference(tokens, second))
+            return false;
+        texture = Builder().MakeCheckerTexture(first, second);
+    }
+    else {
+        return Fail("unknown kind of texture");
+    }
+    textures_[name] = std::move(texture);
+    return true;
+}
+
+inline bool FileScene::ParseMaterial(scene_file_detail::Tokens& tokens)
+{
+    std::string_view name;
+    std::string_view kind;
+    if (!tokens.Next(name) || !tokens.Next(kind))
+        return Fail("expected name and kind of material");
+
+    NamedMaterial named{nullptr, false};
+    if (kind == "lambertian") {
+        std::shared_ptr<Texture> albedo;
+        if (!ParseTextureReference(tokens, albedo))
+            return false;
+        named.material = Builder().MakeLambertian(albedo);
+    }
+    else if (kind == "metal") {
+        Vec3 albedo;
+        RealNum fuzziness;
+        if (!tokens.Next(albedo) || !tokens.Next(fuzziness))
+            return Fail("expected albedo and fuzziness of metal");
+        named.material = Builder().MakeMetal(albedo, fuzziness);
+    }
+    else if (kind == "dielectric") {
+        RealNum refractive_index;
+        if (!tokens.Next(refractive_index) || refractive_index < Real(1))
+            return Fail("expected refractive index (>= 1) of dielectric");
+        named.material = Builder().MakeDielectric(refractive_index);
+    }
+    else if (kind == "light") {
+        std::shared_ptr<Texture> emit;
+        if (!ParseTextureReference(tokens, emit))
+            return false;
+        named.material = Builder().MakeDiffuseLight(emit);
+        named.emits_light = true;
+    }
+    else {
+        return Fail("unknown kind of material");
+    }
+    materials_[name] = std::move(named);
+    return true;
+}
+
+inline bool FileScene::ParseSphere(scene_file_detail::Tokens& tokens, bool is_moving)
+{
+    Vec3 center_from;
+    Vec3 center_to;
+    RealNum time_from = Real(0);
+    RealNum time_to = Real(0);
+    RealNum radius;
+    std::string_view material_name;
+    if (!tokens.Next(center_from))
+        return Fail("expected center of sphere");
+    if (is_moving &&
+        (!tokens.Next(center_to) || !tokens.Next(time_from) || !tokens.Next(time_to) ||
+         !(time_from < time_to))) {
+        return Fail("expected final center and time interval (t0 < t1) of moving sphere");
+    }
+    if (!tokens.Next(radius) || !(radius > Real(0)))
+        return Fail("expected positive radius of sphere");
+    if (!tokens.Next(material_name))
+        return Fail("expected material of sphere");
+    auto const material = materials_.find(material_name);
+    if (material == materials_.end())
+        return Fail("undefined material");
+
+    std::shared_ptr<Hittable> sphere;
+    if (is_moving) {
+        Vec3 const velocity = (center_to - center_from) / (time_to - time_from);
+        sphere = Make<Sphere<LinearMotion, ConstantMagnitude> >(
+            LinearMotion{center_from, velocity, time_from},
+            ConstantMagnitude{radius},
+            material->second.material);
+    }
+    else {
+        sphere = Make<Sphere<Vec3, RealNum> >(center_from, radius, material->second.material);
+    }
+    if (material->second.emits_light)
+        lights_.Add(std::shared_ptr<Hittable>(sphere));
+    world_.Add(std::move(sphere));
+    return true;
+}
+
+inline bool FileScene::ParseMesh(scene_file_detail::Tokens& tokens)
+{
+    std::string_view mesh_file;
+    std::string_view material_name;
+    if (!tokens.Next(mesh_file) || !tokens.Next(material_name))
+        return Fail("expected file and material of mesh");
+    auto const material = materials_.find(material_name);
+    if (material == materials_.end())
+        return Fail("undefined material");
+
+    AffineTransform object_to_world;
+    std::string_view option;
+    while (tokens.Next(option)) {
+        bool valid = false;
+        if (option == "translate") {
+            Vec3 offset;
+            valid = tokens.Next(offset);
+            object_to_world = AffineTransform::Translation(offset) * object_to_world;
+        }
+        else if (option == "scale") {
+            RealNum factor = Real(1);
+            valid = tokens.Next(factor);
+            Vec3 factors(factor, factor, factor);
+            if (valid && tokens.NextIsNumber())
+                valid = tokens.Next(factors[1]) && tokens.Next(factors[2]);
+            object_to_world = AffineTransform::Scaling(factors) * object_to_world;
+        }
+        else if (option == "rotate") {
+            Vec3 axis;
+            RealNum angle_deg;
+            valid = tokens.Next(axis) && tokens.Next(angle_deg) && axis.Norm() > Real(0);
+            if (valid) {
+                object_to_world =
+                    AffineTransform::Rotation(axis, constants::kPi * angle_deg / Real(180)) *
+                    object_to_world;
+            }
+        }
+        if (!valid)
+            return Fail("invalid mesh option");
+    }
+    if (!object_to_world.IsInvertible())
+        return Fail("mesh transformation can not be inverted");
+
+    std::string mesh_path(mesh_file);
+    std::size_t const directory_end = file_path_.rfind('/');
+    if (mesh_path.front() != '/' && directory_end != std::string::npos)
+        mesh_path = file_path_.substr(0U, directory_end + 1U) + mesh_path;
+    std::shared_ptr<Hittable>& mesh = meshes_[mesh_path];
+    if (!mesh) {
+        TriangleMeshBuffers buffers;
+        if (!LoadMesh(mesh_path, buffers, error_))
+            return false;
+        mesh = Make<TriangleMesh>(std::move(buffers), nullptr);
+    }
+    world_.Add(Make<Instance>(mesh, object_to_world, material->second.material));
+    return true;
+}
+
+inline bool FileScene::ParseProceduralSpheres(scene_file_detail::Tokens& tokens)
+{
+    ProceduralSpheresSettings settings;
+    if (!tokens.Next(settings.count) || settings.count == 0U)
+        return Fail("expected number of procedural spheres");
+    if (procedural_spheres_.radius.size() + settings.count >
+        std::numeric_limits<std::uint32_t>::max())
+        return Fail("too many procedural spheres");
+
+    auto const first_material = static_cast<std::uint32_t>(procedural_materials_.size());
+    std::string_view option;
+    while (tokens.Next(option)) {
+        bool valid = false;
+        if (option == "material") {
+            std::string_view material_name;
+            RealNum weight;
+            valid = tokens.Next(material_name) && tokens.Next(weight) && weight > Real(0);
+            auto const material = materials_.find(material_name);
+            if (valid && material == materials_.end())
+                return Fail("undefined material");
+            if (valid) {
+                procedural_materials_.push_back(material->second.material);
+                settings.material_weights.push_back(weight);
+            }
+        }
+        else if (option == "seed") {
+            valid = tokens.Next(settings.seed);
+        }
+        else if (option == "center") {
+            valid = tokens.Next(settings.center);
+        }
+        else if (option == "density") {
+            valid = tokens.Next(settings.density) && settings.density > Real(0) &&
+                    settings.density <= Real(1);
+        }
+        else if (option == "radius") {
+            valid = tokens.Next(settings.min_radius) && tokens.Next(settings.max_radius) &&
+                    settings.min_radius > Real(0) && settings.min_radius <= settings.max_radius;
+        }
+        else if (option == "clusters") {
+            std::string_view spread;
+            valid = tokens.Next(settings.clusters) && tokens.Next(spread) && spread == "spread" &&
+                    tokens.Next(settings.cluster_spread) && settings.cluster_spread >= Real(0);
+            // Their centers are stored while generating the spheres
+            if (valid && settings.clusters > settings.count)
+                return Fail("more clusters than procedural spheres");
+        }
+        else if (option == "motion") {
+            valid = tokens.Next(settings.motion_fraction) && tokens.Next(settings.max_speed) &&
+                    settings.motion_fraction >= Real(0) && settings.motion_fraction <= Real(1);
+        }
+        if (!valid)
+            return Fail("invalid procedural spheres option");
+    }
+    if (settings.material_weights.empty())
+        return Fail("expected materials of procedural spheres");
+
+    std::size_t const first_sphere = procedural_spheres_.radius.size();
+    GenerateProceduralSpheres(settings, procedural_spheres_);
+    for (std::size_t i = first_sphere; i < procedural_spheres_.material.size(); ++i)
+        procedural_spheres_.material[i] += first_material;
+    return true;
+}
+
+inline bool FileScene::ParseTextureReference(scene_file_detail::Tokens& tokens,
+                                             std::shared_ptr<Texture>& texture)
+{
+    if (tokens.NextIsNumber()) {
+        Vec3 color;
+        if (!tokens.Next(color))
+            return Fail("expected color");
+        texture = Builder().MakeConstantTexture(color);
+        return true;
+    }
+    std::string_view name;
+    if (!tokens.Next(name))
+        return Fail("expected texture");
+    auto const it = textures_.find(name);
+    if (it == textures_.end())
+        return Fail("undefined texture");
+    texture = it->second;
+    return true;
+}
+
+inline bool FileScene::Fail(char const* message)
+{
+    error_ = message;
+    return false;
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_file.hpp"
+#include "scene_file_tokens.hpp"
+#include "triangle_mesh.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+namespace mesh_file_detail {
+
+// Adds the triangles of a fan covering the convex polygon with vertices
+// 'polygon' (in order)
+inline void AddTriangleFan(std::vector<std::uint32_t> const& polygon,
+                           std::vector<std::uint32_t>& indices)
+{
+    for (std::size_t i = 2; i < polygon.size(); ++i) {
+        indices.push_back(polygon[0]);
+        indices.push_back(polygon[i - 1U]);
+        indices.push_back(polygon[i]);
+    }
+}
+
+// Parses the position of the vertex in an OBJ face element (e.g. "3",
+// "3/1", "3//2", "-1/4/2"). Positions start at 1, and negative ones are
+// relative to the last vertex defined.
+inline bool ParseObjVertexIndex(std::string_view token,
+                                std::size_t number_vertices,
+                                std::uint32_t& index) noexcept
+{
+    token = token.substr(0U, token.find('/'));
+    bool const relative = !token.empty() && token[0] == '-';
+    std::uint64_t position;
+    if (!scene_file_detail::ParseUnsigned(relative ? token.substr(1U) : token, position) ||
+        position == 0U || position > number_vertices)
+        return false;
+    index = static_cast<std::uint32_t>(relative ? number_vertices - position : position - 1U);
+    return true;
+}
+
+enum class PlyFormat
+{
+    kAscii,
+    kBinaryLittleEndian,
+    kBinaryBigEndian
+};
+
+enum class PlyType
+{
+    kInvalid,
+    kInt8,
+    kUInt8,
+    kInt16,
+    kUInt16,
+    kInt32,
+    kUInt32,
+    kFloat32,
+    kFloat64
+};
+
+// Bytes taken by a value of 'type' in binary bodies
+inline std::size_t PlyTypeSize(PlyType type) noexcept
+{
+    switch (type) {
+        case PlyType::kInt8:
+        case PlyType::kUInt8:
+            return 1U;
+        case PlyType::kInt16:
+        case PlyType::kUInt16:
+            return 2U;
+        case PlyType::kInt32:
+        case PlyType::kUInt32:
+        case PlyType::kFloat32:
+            return 4U;
+        case PlyType::kFloat64:
+            return 8U;
+        default:
+            return 0U;
+    }
+}
+
+inline PlyType ParsePlyType(std::string_view name) noexcept
+{
+    if (name == "char" || name == "int8")
+        return PlyType::kInt8;
+    if (name == "uchar" || name == "uint8")
+        return PlyType::kUInt8;
+    if (name == "short" || name == "int16")
+        return PlyType::kInt16;
+    if (name == "ushort" || name == "uint16")
+        return PlyType::kUInt16;
+    if (name == "int" || name == "int32")
+        return PlyType::kInt32;
+    if (name == "uint" || name == "uint32")
+        return PlyType::kUInt32;
+    if (name == "float" || name == "float32")
+        return PlyType::kFloat32;
+    if (name == "double" || name == "float64")
+        return PlyType::kFloat64;
+    return PlyType::kInvalid;
+}
+
+struct PlyProperty
+{
+    std::string_view name;
+    PlyType type;
+    // Type of the number of items, for list properties
+    PlyType count_type;
+    bool is_list;
+};
+
+struct PlyElement
+{
+    std::string_view name;
+    std::uint64_t count;
+    std::vector<PlyProperty> properties;
+
+    // Fewest bytes each item of the element can take in a body of
+    // 'format' (lists may be empty), and at least one, so that counts can
+    // be checked against the size of the file before trusting them
+    [[nodiscard]] std::size_t MinimumItemSize(PlyFormat format) const noexcept
+    {
+        std::size_t size = 0U;
+        for (PlyProperty const& property : properties) {
+            // Text values take a character and a separator, but the last
+            // one of the file may not be followed by any
+            PlyType const type = property.is_list ? property.count_type : property.type;
+            size += format == PlyFormat::kAscii ? 1U : PlyTypeSize(type);
+        }
+        return std::max<std::size_t>(size, 1U);
+    }
+};
+
+// Reads the values of the body of a PLY file one by one, whatever its
+// format
+class PlyBodyReader
+{
+  public:
+    PlyBodyReader(std::string_view body, PlyFormat format) noexcept
+        : rest_(body), format_(format)
+    {}
+
+    // Bytes of the body not read yet
+    [[nodiscard]] std::size_t Remaining() const noexcept { return rest_.size(); }
+
+    bool Read(PlyType type, double& value) noexcept
+    {
+        if (format_ == PlyFormat::kAscii)
+            return ReadText(type, value);
+        switch (type) {
+            case PlyType::kInt8:
+                return ReadBinary<std::int8_t>(value);
+            case PlyType::kUInt8:
+                return ReadBinary<std::uint8_t>(value);
+            case PlyType::kInt16:
+                return ReadBinary<std::int16_t>(value);
+            case PlyType::kUInt16:
+                return ReadBinary<std::uint16_t>(value);
+            case PlyType::kInt32:
+                return ReadBinary<std::int32_t>(value);
+            case PlyType::kUInt32:
+                return ReadBinary<std::uint32_t>(value);
+            case PlyType::kFloat32:
+                return ReadBinary<float>(value);
+            case PlyType::kFloat64:
+                return ReadBinary<double>(value);
+            default:
+                return false;
+        }
+    }
+
+  private:
+    bool ReadText(PlyType type, double& value) noexcept
+    {
+        std::size_t begin = 0U;
+        while (begin < rest_.size() && (scene_file_detail::IsBlank(rest_[begin]) ||
+                                        rest_[begin] == '\n'))
+            ++begin;
+        std::size_t end = begin;
+        while (end < rest_.size() &&
+               !(scene_file_detail::IsBlank(rest_[end]) || rest_[end] == '\n'))
+            ++end;
+        std::string_view const token = rest_.substr(begin, end - begin);
+        rest_.remove_prefix(end);
+        if (type == PlyType::kFloat32 || type == PlyType::kFloat64) {
+            RealNum real;
+            if (!scene_file_detail::ParseReal(token, real))
+                return false;
+            value = real;
+            return true;
+        }
+        // Integers are parsed exactly, even if RealNum can not hold them
+        bool const negative = !token.empty() && token[0] == '-';
+        std::uint64_t magnitude;
+        if (!scene_file_detail::ParseUnsigned(negative ? token.substr(1U) : token, magnitude))
+            return false;
+        value = negative ? -static_cast<double>(magnitude) : static_cast<double>(magnitude);
+        return true;
+    }
+
+    template <typename T>
+    bool ReadBinary(double& value) noexcept
+    {
+        if (rest_.size() < sizeof(T))
+            return false;
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, rest_.data(), sizeof(T));
+        rest_.remove_prefix(sizeof(T));
+        std::uint16_t const probe = 1U;
+        bool const is_little_endian_host = *reinterpret_cast<unsigned char const*>(&probe) == 1U;
+        if ((format_ == PlyFormat::kBinaryLittleEndian) != is_little_endian_host) {
+            for (std::size_t i = 0; i < sizeof(T) / 2U; ++i)
+                std::swap(bytes[i], bytes[sizeof(T) - 1U - i]);
+        }
+        T read;
+        std::memcpy(&read, bytes, sizeof(T));
+        value = static_cast<double>(read);
+        return true;
+    }
+
+    std::string_view rest_;
+    PlyFormat format_;
+};
+
+}  // namespace mesh_file_detail
+
+// Loads into 'buffers' the Wavefront OBJ file 'file_path'. Only vertex
+// positions ('v') and faces ('f') are read; faces with more than three
+// vertices must be convex and are split into triangles. Returns false
+// and describes the error in 'error' if the file can not be loaded.
+inline bool LoadObjMesh(std::string const& file_path,
+                        TriangleMeshBuffers& buffers,
+                        std::string& error)
+{
+    MappedFile const file(file_path);
+    if (!file.IsOpen()) {
+        error = "could not open " + file_path;
+        return false;
+    }
+
+    buffers = TriangleMeshBuffers();
+    std::vector<std::uint32_t> polygon;
+    std::string_view rest(reinterpret_cast<char const*>(file.Data()), file.Size());
+    std::size_t line_number = 0U;
+    while (!rest.empty()) {
+        ++line_number;
+        std::size_t const line_end = std::min(rest.find('\n'), rest.size());
+        scene_file_detail::Tokens tokens(rest.substr(0U, line_end));
+        rest.remove_prefix(std::min(line_end + 1U, rest.size()));
+
+        std::string_view keyword;
+        if (!tokens.Next(keyword))
+            continue;
+        bool valid = true;
+        if (keyword == "v") {
+            Vec3 vertex;
+            // Optional weights after the position are ignored
+            valid = tokens.Next(vertex);
+            buffers.vertices.push_back(vertex);
+        }
+        else if (keyword == "f") {
+            polygon.clear();
+            std::string_view token;
+            while (valid && tokens.Next(token)) {
+                std::uint32_t index;
+                valid = mesh_file_detail::ParseObjVertexIndex(
+                    token, buffers.vertices.size(), index);
+                polygon.push_back(index);
+            }
+            valid = valid && polygon.size() >= 3U;
+            mesh_file_detail::AddTriangleFan(polygon, buffers.indices);
+        }
+        // Normals, texture coordinates, groups, materials... are ignored
+        if (!valid) {
+            error = file_path + ":" + std::to_string(line_number) + ": invalid vertex or face";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Loads into 'buffers' the PLY file 'file_path', either in text or in
+// binary format. Vertices are read from the x, y and z properties of the
+// 'vertex' element and faces from the 'vertex_indices' (or
+// 'vertex_index') list of the 'face' element. Faces with more than three
+// vertices must be convex and are split into triangles. Returns false
+// and describes the error in 'error' if the file can not be loaded.
+inline bool LoadPlyMesh(std::string const& file_path,
+                        TriangleMeshBuffers& buffers,
+                        std::string& error)
+{
+    using mesh_file_detail::PlyElement;
+    using mesh_file_detail::PlyFormat;
+    using mesh_file_detail::PlyType;
+
+    MappedFile const file(file_path);
+    if (!file.IsOpen()) {
+        error = "could not open " + file_path;
+        return false;
+    }
+    auto const fail = [&error, &file_path](char const* message) {
+        error = file_path + ": " + message;
+        return false;
+    };
+
+    std::string_view rest(reinterpret_cast<char const*>(file.Data()), file.Size());
+    auto const next_line = [&rest]() {
+        std::size_t const line_end = std::min(rest.find('\n'), rest.size());
+        std::string_view const line = rest.substr(0U, line_end);
+        rest.remove_prefix(std::min(line_end + 1U, rest.size()));
+        return line;
+    };
+    if (next_line().substr(0U, 3U) != "ply")
+        return fail("not a PLY file");
+
+    PlyFormat format = PlyFormat::kAscii;
+    std::vector<PlyElement> elements;
+    while (true) {
+        if (rest.empty())
+            return fail("unterminated header");
+        scene_file_detail::Tokens tokens(next_line());
+        std::string_view keyword;
+        if (!tokens.Next(keyword) || keyword == "comment" || keyword == "obj_info")
+            continue;
+        if (keyword == "end_header")
+            break;
+
+        std::string_view first;
+        if (!tokens.Next(first))
+            return fail("invalid header");
+        if (keyword == "format") {
+            if (first == "ascii")
+                format = PlyFormat::kAscii;
+            else if (first == "binary_little_endian")
+                format = PlyFormat::kBinaryLittleEndian;
+            else if (first == "binary_big_endian")
+                format = PlyFormat::kBinaryBigEndian;
+            else
+                return fail("unknown format");
+        }
+        else if (keyword == "element") {
+            PlyElement& element = elements.emplace_back();
+            element.name = first;
+            if (!tokens.Next(element.count))
+                return fail("invalid element");
+        }
+        else if (keyword == "property") {
+            if (elements.empty())
+                return fail("property out of any element");
+            mesh_file_detail::PlyProperty property{{}, PlyType::kInvalid, PlyType::kInvalid, false};
+            std::string_view type = first;
+            if (first == "list") {
+                std::string_view count_type;
+                property.is_list = true;
+                if (!tokens.Next(count_type) || !tokens.Next(type))
+                    return fail("invalid list property");
+                property.count_type = mesh_file_detail::ParsePlyType(count_type);
+                if (property.count_type == PlyType::kInvalid)
+                    return fail("unknown property type");
+            }
+            property.type = mesh_file_detail::ParsePlyType(type);
+            if (property.type == PlyType::kInvalid || !tokens.Next(property.name))
+                return fail("invalid property");
+            elements.back().properties.push_back(property);
+        }
+        else {
+            return fail("unknown header line");
+        }
+    }
+
+    buffers = TriangleMeshBuffers();
+    std::size_t number_vertices = 0U;
+    std::vector<std::uint32_t> polygon;
+    mesh_file_detail::PlyBodyReader reader(rest, format);
+    for (PlyElement const& element : elements) {
+        bool const is_vertex = element.name == "vertex";
+        bool const is_face = element.name == "face";
+        if (element.count > reader.Remaining() / element.MinimumItemSize(format))
+            return fail("element count larger than the file");
+        if (is_vertex && element.count > std::numeric_limits<std::uint32_t>::max())
+            return fail("too many vertices");
+        if (is_vertex)
+            buffers.vertices.reserve(element.count);
+        for (std::uint64_t i = 0; i < element.count; ++i) {
+            double position[3] = {0.0, 0.0, 0.0};
+            polygon.clear();
+            for (auto const& property : element.properties) {
+                double value;
+                if (!property.is_list) {
+                    if (!reader.Read(property.type, value))
+                        return fail("truncated body");
+                    if (is_vertex && property.name.size() == 1U && property.name[0] >= 'x' &&
+                        property.name[0] <= 'z')
+                        position[property.name[0] - 'x'] = value;
+                    continue;
+                }
+                double count;
+                if (!reader.Read(property.count_type, count) || count < 0.0)
+                    return fail("truncated body");
+                bool const are_indices = is_face && (property.name == "vertex_indices" ||
+                                                     property.name == "vertex_index");
+                for (std::uint64_t item = 0; item < std::uint64_t(count); ++item) {
+                    if (!reader.Read(property.type, value))
+                        return fail("truncated body");
+                    if (are_indices) {
+                        if (value < 0.0 || value >= double(number_vertices))
+                            return fail("face with invalid vertex index");
+                        polygon.push_back(static_cast<std::uint32_t>(value));
+                    }
+                }
+            }
+            if (is_vertex) {
+                buffers.vertices.emplace_back(
+                    Real(position[0]), Real(position[1]), Real(position[2]));
+            }
+            mesh_file_detail::AddTriangleFan(polygon, buffers.indices);
+        }
+        if (is_vertex)
+            number_vertices = buffers.vertices.size();
+    }
+    return true;
+}
+
+// Loads 'file_path' with LoadObjMesh or LoadPlyMesh, depending on its
+// extension
+inline bool LoadMesh(std::string const& file_path, TriangleMeshBuffers& buffers, std::string& error)
+{
+    auto const has_extension = [&file_path](std::string_view extension) {
+        return file_path.size() >= extension.size() &&
+               std::string_view(file_path).substr(file_path.size() - extension.size()) ==
+                   extension;
+    };
+    if (has_extension(".obj") || has_extension(".OBJ"))
+        return LoadObjMesh(file_path, buffers, error);
+    if (has_extension(".ply") || has_extension(".PLY"))
+        return LoadPlyMesh(file_path, buffers, error);
+    error = file_path + ": unknown mesh format (expected .obj or .ply)";
+    return false;
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "constants.hpp"
+#include "packed_spheres.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Parameters of a procedurally generated set of spheres, meant to build
+// scenes of any size (up to hundreds of millions of spheres) to measure
+// how building and traversing them scales. The same settings always give
+// the same spheres, whatever the platform (see GenerateProceduralSpheres).
+struct ProceduralSpheresSettings
+{
+    std::uint64_t count = 0U;
+    std::uint64_t seed = 1U;
+    // Center of the cubic region the spheres are generated in. Its side is
+    // such that the spheres take 'density' of its volume.
+    Vec3 center{Real(0), Real(0), Real(0)};
+    RealNum density = Real(0.01);
+    // Radii are uniformly distributed in [min_radius, max_radius]
+    RealNum min_radius = Real(0.1);
+    RealNum max_radius = Real(0.2);
+    // Spheres gather around this number of points (at most 'count'),
+    // scattered with this standard deviation relative to the side of the
+    // region. If there are no clusters, spheres are spread uniformly over
+    // the region.
+    std::uint64_t clusters = 0U;
+    RealNum cluster_spread = Real(0.05);
+    // Fraction of the spheres that move, with a random direction and a
+    // speed uniformly distributed in [0, max_speed]
+    RealNum motion_fraction = Real(0);
+    RealNum max_speed = Real(1);
+    // Relative frequency of each material index. A single material (index
+    // 0) is used if it is empty.
+    std::vector<RealNum> material_weights;
+};
+
+// Side of the cubic region in which the spheres of 'settings' are placed
+inline RealNum ProceduralSpheresRegionSide(ProceduralSpheresSettings const& settings) noexcept
+{
+    // Mean of r^3 for r uniformly distributed between the radii
+    RealNum const r0 = settings.min_radius;
+    RealNum const r1 = settings.max_radius;
+    RealNum const mean_cubed_radius = r1 > r0
+                                          ? (r1 * r1 * r1 * r1 - r0 * r0 * r0 * r0) /
+                                                (Real(4) * (r1 - r0))
+                                          : r0 * r0 * r0;
+    RealNum const spheres_volume =
+        Real(settings.count) * Real(4) / Real(3) * constants::kPi * mean_cubed_radius;
+    return std::cbrt(spheres_volume / settings.density);
+}
+
+namespace procedural_spheres_detail {
+
+// Values are drawn from the raw output of the engine, which the standard
+// fixes, rather than through the distributions of the standard library,
+// whose algorithms are left to each implementation. They are computed in
+// double with basic operations only, and then rounded to RealNum.
+
+// Uniform in [0, 1)
+inline double Unit(std::mt19937_64& engine) noexcept
+{
+    return double(engine() >> 11U) * 0x1.0p-53;
+}
+
+// Approximately normal with mean 0 and standard deviation 1, as the sum of
+// 12 uniform values minus 6 (so within 6 standard deviations of the mean)
+inline double Normal(std::mt19937_64& engine) noexcept
+{
+    double sum = -6.0;
+    for (int i = 0; i < 12; ++i)
+        sum += Unit(engine);
+    return sum;
+}
+
+// Uniform over the directions, by rejection in the unit ball
+inline Vec3 RandomDirection(std::mt19937_64& engine) noexcept
+{
+    while (true) {
+        double const x = 2.0 * Unit(engine) - 1.0;
+        double const y = 2.0 * Unit(engine) - 1.0;
+        double const z = 2.0 * Unit(engine) - 1.0;
+        double const squared_norm = x * x + y * y + z * z;
+        if (squared_norm > 0.0 && squared_norm <= 1.0) {
+            double const norm = std::sqrt(squared_norm);
+            return Vec3(Real(x / norm), Real(y / norm), Real(z / norm));
+        }
+    }
+}
+
+// Index in [0, cumulative.size()) chosen with the probabilities given by
+// the cumulative sums of their weights, which must not be empty
+inline std::uint32_t Choose(std::vector<double> const& cumulative,
+                            std::mt19937_64& engine) noexcept
+{
+    double const value = Unit(engine) * cumulative.back();
+    auto const chosen = static_cast<std::size_t>(
+        std::upper_bound(cumulative.begin(), cumulative.end(), value) - cumulative.begin());
+    return static_cast<std::uint32_t>(std::min(chosen, cumulative.size() - 1U));
+}
+
+}  // namespace procedural_spheres_detail
+
+// Appends the spheres of 'settings' to the arrays of 'spheres' (ignoring
+// its nodes), which can then be packed with PackSpheres. Spheres are
+// written straight into the arrays, which are grown once, so generating
+// them costs the memory of the arrays only. Velocities are only filled if
+// some spheres move (or 'spheres' already had moving spheres). They are
+// drawn from std::mt19937_64 seeded with the seed of 'settings', so that
+// the same settings give the same spheres on every platform.
+inline void GenerateProceduralSpheres(ProceduralSpheresSettings const& settings,
+                                      PackedSpheresArrays& spheres)
+{
+    std::mt19937_64 engine(settings.seed);
+    auto const unit = [&engine] { return procedural_spheres_detail::Unit(engine); };
+    auto const normal = [&engine] { return procedural_spheres_detail::Normal(engine); };
+    std::vector<double> cumulative_weights;
+    double weights_sum = 0.0;
+    for (RealNum const weight : settings.material_weights) {
+        weights_sum += double(weight);
+        cumulative_weights.push_back(weights_sum);
+    }
+
+    RealNum const side = ProceduralSpheresRegionSide(settings);
+    Vec3 const region_min = settings.center - Real(0.5) * Vec3(side, side, side);
+    auto const random_in_region = [&]() {
+        double const x = unit();
+        double const y = unit();
+        double const z = unit();
+        return region_min + side * Vec3(Real(x), Real(y), Real(z));
+    };
+    std::vector<Vec3> cluster_centers(settings.clusters);
+    for (Vec3& cluster_center : cluster_centers)
+        cluster_center = random_in_region();
+    RealNum const spread = settings.cluster_spread * side;
+
+    std::size_t const previous_count = spheres.radius.size();
+    std::size_t const total_count = previous_count + settings.count;
+    bool const with_velocities = settings.motion_fraction > Real(0) || spheres.IsMoving();
+    for (auto* values : {&spheres.center_x, &spheres.center_y, &spheres.center_z, &spheres.radius})
+        values->reserve(total_count);
+    spheres.material.reserve(total_count);
+    if (with_velocities) {
+        for (auto* values : {&spheres.velocity_x, &spheres.velocity_y, &spheres.velocity_z}) {
+            values->reserve(total_count);
+            values->resize(previous_count, Real(0));
+        }
+    }
+
+    for (std::uint64_t i = 0; i < settings.count; ++i) {
+        Vec3 center;
+        if (cluster_centers.empty()) {
+            center = random_in_region();
+        }
+        else {
+            Vec3 const& cluster_center = cluster_centers[engine() % cluster_centers.size()];
+            double const x = normal();
+            double const y = normal();
+            double const z = normal();
+            center = cluster_center + spread * Vec3(Real(x), Real(y), Real(z));
+        }
+        spheres.center_x.push_back(center.X());
+        spheres.center_y.push_back(center.Y());
+        spheres.center_z.push_back(center.Z());
+        double const radius_step = double(settings.max_radius - settings.min_radius) * unit();
+        spheres.radius.push_back(Real(double(settings.min_radius) + radius_step));
+        spheres.material.push_back(
+            cumulative_weights.empty()
+                ? 0U
+                : procedural_spheres_detail::Choose(cumulative_weights, engine));
+        if (!with_velocities)
+            continue;
+
+        Vec3 velocity(Real(0), Real(0), Real(0));
+        if (unit() < double(settings.motion_fraction)) {
+            Vec3 const direction = procedural_spheres_detail::RandomDirection(engine);
+            velocity = Real(double(settings.max_speed) * unit()) * direction;
+        }
+        spheres.velocity_x.push_back(velocity.X());
+        spheres.velocity_y.push_back(velocity.Y());
+        spheres.velocity_z.push_back(velocity.Z());
+    }
+}
+
+}  // namespace plemma::glancy
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include "checker_texture.hpp"
 #include "constant_texture.hpp"
@@ -8,6 +9,7 @@
 #include "metal.hpp"
 #include "scene.hpp"
 #include "sphere.hpp"
+#include "sphere_placer.hpp"
 
 namespace plemma::glancy {
 
@@ -24,96 +26,116 @@ class RandomSpheresScene : public Scene
 
 inline void RandomSpheresScene::LoadWorld() noexcept
 {
+    SceneBuilder& builder = Builder();
     std::uniform_real_distribution<RealNum> dist(Real(0), Real(1));
 
     // Add big sphere on top of which all other sphere will lay
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3(Real(0), Real(-1000), Real(0)),
         Real(1000),
-        std::make_shared<Lambertian>(std::make_shared<CheckerTexture>(
-            std::make_shared<ConstantTexture>(Vec3(Real(0.2), Real(0.3), Real(0.1))),
-            std::make_shared<ConstantTexture>(Vec3(Real(0.9), Real(0.9), Real(0.9)))))));
+        builder.MakeLambertian(builder.MakeCheckerTexture(
+            builder.MakeConstantTexture(Vec3(Real(0.2), Real(0.3), Real(0.1))),
+            builder.MakeConstantTexture(Vec3(Real(0.9), Real(0.9), Real(0.9)))))));
 
     // Add 3 mid size spheres
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-        Vec3(Real(0), Real(1), Real(0)), Real(1), std::make_shared<WindowGlass>()));
+    Vec3 const mid_size_centers[3] = {Vec3(Real(0), Real(1), Real(0)),
+                                      Vec3(Real(-4), Real(1), Real(0)),
+                                      Vec3(Real(4), Real(1), Real(0))};
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
+        mid_size_centers[0], Real(1), builder.MakeDielectric<WindowGlass>()));
 
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-        Vec3(Real(-4), Real(1), Real(0)),
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
+        mid_size_centers[1],
         Real(1),
-        std::make_shared<Lambertian>(
-            std::make_shared<ConstantTexture>(Vec3(Real(0.4), Real(0.2), Real(0.1))))));
+        builder.MakeLambertian(Vec3(Real(0.4), Real(0.2), Real(0.1)))));
 
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-        Vec3(Real(4), Real(1), Real(0)),
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
+        mid_size_centers[2],
         Real(1),
-        std::make_shared<Metal>(Vec3(Real(0.7), Real(0.6), Real(0.5)), Real(0))));
+        builder.MakeMetal(Vec3(Real(0.7), Real(0.6), Real(0.5)), Real(0))));
+
+    // Small spheres do not overlap each other nor the mid size ones, which
+    // is ensured by rejection sampling their position inside their cell
+    SpherePlacer placer(Real(0.5));
+    for (Vec3 const& center : mid_size_centers)
+        placer.Reserve(center, Real(1));
+    constexpr std::size_t kMaxPlacementAttempts = 8U;
 
     // Add a bunch of random spheres
     for (int a = -11; a < 11; ++a) {
         for (int b = -11; b < 11; ++b) {
             RealNum mat_choice = dist(my_engine());
-            Vec3 center(Real(a) + Real(0.9) * dist(my_engine()),
-                        Real(0.2),
-                        Real(b) + Real(0.9) * dist(my_engine()));
             RealNum perturbance = dist(my_engine());
+            RealNum radius = Real(0.2);
+            bool is_static = (dist(my_engine()) > Real(0.2));
+
+            // Moving spheres take the room of the whole path they follow
+            Vec3 const path_middle(
+                Real(0), is_static ? Real(0) : Real(0.5) * perturbance, Real(0));
+            RealNum const room_radius = radius + path_middle.Y();
+            Vec3 room_center;
+            RealNum room;
+            auto const propose = [&](Vec3& candidate_center, RealNum& candidate_radius) {
+                candidate_center = Vec3(Real(a) + Real(0.9) * dist(my_engine()),
+                                        Real(0.2),
+                                        Real(b) + Real(0.9) * dist(my_engine())) +
+                                   path_middle;
+                candidate_radius = room_radius;
+            };
+            if (!placer.PlaceByRejection(propose, kMaxPlacementAttempts, room_center, room))
+                continue;
+
+            Vec3 const center = room_center - path_middle;
             auto moving_center = [=](RealNum t) {
                 return center + t * Vec3(Real(0), perturbance, Real(0));
             };
-            RealNum radius = Real(0.2);
             auto constant_radius = [=]([[maybe_unused]] RealNum t) { return radius; };
-            bool is_static = (dist(my_engine()) > Real(0.2));
+            using MovingSphere = Sphere<decltype(moving_center), decltype(constant_radius)>;
 
-            if ((center - Vec3(Real(4), Real(0.2), Real(0))).SquaredNorm() > Real(0.9 * 0.9)) {
-                if (mat_choice < Real(0.65)) {
-                    Vec3 albedo(dist(my_engine()) * dist(my_engine()),
-                                dist(my_engine()) * dist(my_engine()),
-                                dist(my_engine()) * dist(my_engine()));
-                    auto alb_texture = std::make_shared<ConstantTexture>(albedo);
-                    if (is_static) {
-                        world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                            center, radius, std::make_shared<Lambertian>(alb_texture)));
-                    }
-                    else {
-                        world_.Add(std::make_shared<
-                                   Sphere<decltype(moving_center), decltype(constant_radius)> >(
-                            moving_center,
-                            constant_radius,
-                            std::make_shared<Lambertian>(alb_texture)));
-                    }
+            if (mat_choice < Real(0.65)) {
+                Vec3 albedo(dist(my_engine()) * dist(my_engine()),
+                            dist(my_engine()) * dist(my_engine()),
+                            dist(my_engine()) * dist(my_engine()));
+                auto alb_texture = builder.MakeConstantTexture(albedo);
+                if (is_static) {
+                    world_.Add(Make<Sphere<Vec3, RealNum> >(
+                        center, radius, builder.MakeLambertian(alb_texture)));
                 }
-                else if (mat_choice < Real(0.85)) {
-                    Vec3 albedo(Real(0.5) * (Real(1) + dist(my_engine())),
-                                Real(0.5) * (Real(1) + dist(my_engine())),
-                                Real(0.5) * (Real(1) + dist(my_engine())));
-                    if (is_static) {
-                        world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                            center,
-                            radius,
-                            std::make_shared<Metal>(albedo, Real(0.5) * dist(my_engine()))));
-                    }
-                    else {
-                        world_.Add(std::make_shared<
-                                   Sphere<decltype(moving_center), decltype(constant_radius)> >(
-                            moving_center,
-                            constant_radius,
-                            std::make_shared<Metal>(albedo, Real(0.5) * dist(my_engine()))));
-                    }
+                else {
+                    world_.Add(Make<MovingSphere>(
+                        moving_center, constant_radius, builder.MakeLambertian(alb_texture)));
+                }
+            }
+            else if (mat_choice < Real(0.85)) {
+                Vec3 albedo(Real(0.5) * (Real(1) + dist(my_engine())),
+                            Real(0.5) * (Real(1) + dist(my_engine())),
+                            Real(0.5) * (Real(1) + dist(my_engine())));
+                if (is_static) {
+                    world_.Add(Make<Sphere<Vec3, RealNum> >(
+                        center,
+                        radius,
+                        builder.MakeMetal(albedo, Real(0.5) * dist(my_engine()))));
+                }
+                else {
+                    world_.Add(Make<MovingSphere>(
+                        moving_center,
+                        constant_radius,
+                        builder.MakeMetal(albedo, Real(0.5) * dist(my_engine()))));
+                }
+            }
+            else {
+                if (is_static) {
+                    world_.Add(Make<Sphere<Vec3, RealNum> >(
+                        center, radius, builder.MakeDielectric<WindowGlass>()));
                 }
                 else {
-                    if (is_static) {
-                        world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
-                            center, radius, std::make_shared<WindowGlass>()));
-                    }
-                    else {
-                        world_.Add(std::make_shared<
-                                   Sphere<decltype(moving_center), decltype(constant_radius)> >(
-                            moving_center, constant_radius, std::make_shared<WindowGlass>()));
-                    }
+                    world_.Add(Make<MovingSphere>(
+                        moving_center, constant_radius, builder.MakeDielectric<WindowGlass>()));
                 }
             }
         }
     }
+    BindMaterials();
 }
 
 }  // namespace plemma::glancy
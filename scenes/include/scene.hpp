@@ -1,8 +1,13 @@
 #pragma once
 
 #include <memory>
+#include <utility>
+#include "arena.hpp"
 #include "camera.hpp"
 #include "hittable_list.hpp"
+#include "material_table.hpp"
+#include "ray.hpp"
+#include "scene_builder.hpp"
 #include "vec3.hpp"
 
 namespace plemma::glancy {
@@ -10,12 +15,76 @@ namespace plemma::glancy {
 class Scene
 {
   public:
+    // Builds the world and the lights of the scene, and then binds their
+    // materials (see BindMaterials)
     virtual void LoadWorld() noexcept = 0;
     [[nodiscard]] virtual HittableList const& World() const noexcept = 0;
+    // Hittables of the world that emit light and should be sampled
+    // explicitly by the renderer. Every emissive hittable should be here,
+    // otherwise it will only be found by chance. Empty by default.
+    [[nodiscard]] virtual HittableList const& Lights() const noexcept { return lights_; }
+    // Color seen by rays that do not hit anything. Default is a sky
+    // gradient going from white (horizon) to light blue (zenith).
+    [[nodiscard]] virtual Vec3 Background(Ray const& r) const noexcept
+    {
+        Vec3 unit_direction = UnitVector(r.Direction());
+        RealNum t = Real(0.5) * (unit_direction.Y() + Real(1));
+        return (Real(1) - t) * Vec3(Real(1), Real(1), Real(1)) +
+               t * Vec3(Real(0.5), Real(0.7), Real(1));
+    }
+    // Materials of the world and the lights, compiled once when the scene
+    // is loaded. Renderers only read them, so a loaded scene can be shared
+    // by several renderers at once.
+    [[nodiscard]] MaterialTable const& Materials() const noexcept { return materials_; }
     virtual ~Scene() = default;
 
+  protected:
+    // Allocates the hittables, materials and textures of the scene in its
+    // arena, so that they are close in memory and freed all at once. Being
+    // a member of the base class, the arena outlives the members of the
+    // derived scenes holding the handles.
+    template <typename T, typename... Args>
+    [[nodiscard]] std::shared_ptr<T> Make(Args&&... args)
+    {
+        return arena_.Make<T>(std::forward<Args>(args)...);
+    }
+
+    // Interns the textures and materials of the scene by value, creating
+    // them in the arena of the scene
+    [[nodiscard]] SceneBuilder& Builder() noexcept { return builder_; }
+
+    // Gives back all the memory of the arena. Derived scenes must have
+    // dropped every handle returned by Make or Builder before calling it,
+    // e.g. when rebuilding their world from scratch.
+    void ReleaseArena() noexcept
+    {
+        builder_.Clear();
+        arena_.Release();
+    }
+
+    // Compiles the materials of World() and Lights() into Materials(),
+    // storing in each hittable the ids of its materials. Hittables are
+    // changed, so LoadWorld calls it once all of them are added, before
+    // the scene is handed to any renderer.
+    void BindMaterials()
+    {
+        materials_.Clear();
+        for (auto const& hittable : World()) {
+            if (hittable)
+                hittable->BindMaterials(materials_);
+        }
+        for (auto const& light : Lights()) {
+            if (light)
+                light->BindMaterials(materials_);
+        }
+    }
+
   private:
+    Arena arena_;
+    SceneBuilder builder_{arena_};
     HittableList world_;
+    HittableList lights_;
+    MaterialTable materials_;
 };
 
 }  // namespace plemma::glancy
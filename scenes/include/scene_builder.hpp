@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <utility>
+#include "arena.hpp"
+#include "checker_texture.hpp"
+#include "constant_texture.hpp"
+#include "dielectric.hpp"
+#include "diffuse_light.hpp"
+#include "lambertian.hpp"
+#include "material.hpp"
+#include "metal.hpp"
+#include "texture.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Creates the textures and materials of a scene in its arena, interning
+// them by value: asking twice for a material or texture with the same
+// parameters returns the same object. Scenes with many primitives end up
+// referring to a small set of shading records, which saves memory and
+// keeps them hot in cache while rendering.
+class SceneBuilder
+{
+  public:
+    // 'arena' must outlive the builder
+    explicit SceneBuilder(Arena& arena) : arena_(arena) {}
+
+    std::shared_ptr<Texture> MakeConstantTexture(Vec3 const& color)
+    {
+        return Intern(constant_textures_, Key(color), [&] {
+            return arena_.Make<ConstantTexture>(color);
+        });
+    }
+
+    std::shared_ptr<Texture> MakeCheckerTexture(std::shared_ptr<Texture> const& first,
+                                                std::shared_ptr<Texture> const& second)
+    {
+        return Intern(checker_textures_, std::make_pair(first.get(), second.get()), [&] {
+            return arena_.Make<CheckerTexture>(first, second);
+        });
+    }
+
+    std::shared_ptr<Material> MakeLambertian(std::shared_ptr<Texture> const& albedo)
+    {
+        return Intern(lambertians_, albedo.get(), [&] {
+            return arena_.Make<Lambertian>(albedo);
+        });
+    }
+
+    std::shared_ptr<Material> MakeLambertian(Vec3 const& albedo)
+    {
+        return MakeLambertian(MakeConstantTexture(albedo));
+    }
+
+    std::shared_ptr<Material> MakeMetal(Vec3 const& albedo, RealNum fuzz)
+    {
+        // Same clamping as Metal, so equivalent metals share the key
+        fuzz = std::min(fuzz, Real(1));
+        return Intern(metals_, Key(albedo, fuzz), [&] {
+            return arena_.Make<Metal>(albedo, fuzz);
+        });
+    }
+
+    std::shared_ptr<Material> MakeDielectric(RealNum refractive_index)
+    {
+        return Intern(dielectrics_, refractive_index, [&] {
+            return arena_.Make<RefractiveMaterial>(refractive_index);
+        });
+    }
+
+    // Same as MakeDielectric for any of the Dielectric aliases (e.g.
+    // WindowGlass), which are interned with the rest of dielectrics
+    template <typename DielectricType>
+    std::shared_ptr<Material> MakeDielectric()
+    {
+        RealNum const refractive_index = DielectricType().RefractiveIndex();
+        return Intern(dielectrics_, refractive_index, [&] {
+            return arena_.Make<DielectricType>();
+        });
+    }
+
+    std::shared_ptr<Material> MakeDiffuseLight(std::shared_ptr<Texture> const& emit)
+    {
+        return Intern(diffuse_lights_, emit.get(), [&] {
+            return arena_.Make<DiffuseLight>(emit);
+        });
+    }
+
+    std::shared_ptr<Material> MakeDiffuseLight(Vec3 const& emit)
+    {
+        return MakeDiffuseLight(MakeConstantTexture(emit));
+    }
+
+    // Number of different textures and materials created so far
+    [[nodiscard]] std::size_t NumberOfTextures() const noexcept
+    {
+        return constant_textures_.size() + checker_textures_.size();
+    }
+    [[nodiscard]] std::size_t NumberOfMaterials() const noexcept
+    {
+        return lambertians_.size() + metals_.size() + dielectrics_.size() +
+               diffuse_lights_.size();
+    }
+
+    // Forgets every interned object. Needed before releasing the arena.
+    void Clear() noexcept
+    {
+        constant_textures_.clear();
+        checker_textures_.clear();
+        lambertians_.clear();
+        metals_.clear();
+        dielectrics_.clear();
+        diffuse_lights_.clear();
+    }
+
+  private:
+    template <typename Table, typename Create>
+    static typename Table::mapped_type Intern(Table& table,
+                                              typename Table::key_type const& key,
+                                              Create create)
+    {
+        auto it = table.find(key);
+        if (it == table.end())
+            it = table.emplace(key, create()).first;
+        return it->second;
+    }
+
+    static std::array<RealNum, 3> Key(Vec3 const& v) noexcept { return {v.X(), v.Y(), v.Z()}; }
+    static std::array<RealNum, 4> Key(Vec3 const& v, RealNum w) noexcept
+    {
+        return {v.X(), v.Y(), v.Z(), w};
+    }
+
+    Arena& arena_;
+    // Textures and materials referring to other textures are keyed by the
+    // identity of the (already interned) textures they refer to
+    std::map<std::array<RealNum, 3>, std::shared_ptr<Texture> > constant_textures_;
+    std::map<std::pair<Texture const*, Texture const*>, std::shared_ptr<Texture> >
+        checker_textures_;
+    std::map<Texture const*, std::shared_ptr<Material> > lambertians_;
+    std::map<std::array<RealNum, 4>, std::shared_ptr<Material> > metals_;
+    std::map<RealNum, std::shared_ptr<Material> > dielectrics_;
+    std::map<Texture const*, std::shared_ptr<Material> > diffuse_lights_;
+};
+
+}  // namespace plemma::glancy
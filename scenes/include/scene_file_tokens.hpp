@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "scene_settings.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Tokenizer and number parsers shared by the text files describing
+// scenes and their assets. They work in place on views of the files.
+namespace scene_file_detail {
+
+constexpr bool IsBlank(char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+constexpr bool IsDigit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+// Parses the whole 'token' as an unsigned integer in base 10
+inline bool ParseUnsigned(std::string_view token, std::uint64_t& value) noexcept
+{
+    if (token.empty() || token.size() > 19U)
+        return false;
+    value = 0U;
+    for (char const c : token) {
+        if (!IsDigit(c))
+            return false;
+        value = value * 10U + static_cast<std::uint64_t>(c - '0');
+    }
+    return true;
+}
+
+// Parses the whole 'token' as a decimal number with optional sign,
+// fractional part and exponent (e.g. -1.5e-3). Only the first 19
+// significant digits are taken into account. Numbers too big for RealNum
+// are rejected, and those too small for it are rounded to zero.
+inline bool ParseReal(std::string_view token, RealNum& value) noexcept
+{
+    std::size_t i = 0U;
+    bool const negative = i < token.size() && token[i] == '-';
+    if (i < token.size() && (token[i] == '-' || token[i] == '+'))
+        ++i;
+
+    std::uint64_t mantissa = 0U;
+    int significant_digits = 0;
+    int exponent = 0;
+    bool any_digit = false;
+    for (; i < token.size() && IsDigit(token[i]); ++i, any_digit = true) {
+        if (significant_digits < 19) {
+            mantissa = mantissa * 10U + static_cast<std::uint64_t>(token[i] - '0');
+            significant_digits += mantissa > 0U ? 1 : 0;
+        }
+        else {
+            ++exponent;
+        }
+    }
+    if (i < token.size() && token[i] == '.') {
+        for (++i; i < token.size() && IsDigit(token[i]); ++i, any_digit = true) {
+            if (significant_digits < 19) {
+                mantissa = mantissa * 10U + static_cast<std::uint64_t>(token[i] - '0');
+                significant_digits += mantissa > 0U ? 1 : 0;
+                --exponent;
+            }
+        }
+    }
+    if (!any_digit)
+        return false;
+    if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+        ++i;
+        bool const negative_exponent = i < token.size() && token[i] == '-';
+        if (i < token.size() && (token[i] == '-' || token[i] == '+'))
+            ++i;
+        std::uint64_t explicit_exponent = 0U;
+        if (!ParseUnsigned(token.substr(i), explicit_exponent) || explicit_exponent > 400U)
+            return false;
+        exponent += negative_exponent ? -static_cast<int>(explicit_exponent)
+                                      : static_cast<int>(explicit_exponent);
+        i = token.size();
+    }
+    if (i != token.size())
+        return false;
+
+    // Powers of ten up to 1e22 are exact in double precision
+    static constexpr double kPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                              1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                              1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    auto result = static_cast<double>(mantissa);
+    int const abs_exponent = exponent < 0 ? -exponent : exponent;
+    double const scale =
+        abs_exponent <= 22 ? kPowersOfTen[abs_exponent] : std::pow(10.0, abs_exponent);
+    result = exponent < 0 ? result / scale : result * scale;
+    value = Real(negative ? -result : result);
+    return std::isfinite(value);
+}
+
+// Splits a line in tokens, in place
+class Tokens
+{
+  public:
+    explicit Tokens(std::string_view line) noexcept : rest_(line)
+    {
+        auto const comment = rest_.find('#');
+        if (comment != std::string_view::npos)
+            rest_ = rest_.substr(0U, comment);
+    }
+
+    bool Next(std::string_view& token) noexcept
+    {
+        std::size_t begin = 0U;
+        while (begin < rest_.size() && IsBlank(rest_[begin]))
+            ++begin;
+        std::size_t end = begin;
+        while (end < rest_.size() && !IsBlank(rest_[end]))
+            ++end;
+        token = rest_.substr(begin, end - begin);
+        rest_ = rest_.substr(end);
+        return !token.empty();
+    }
+
+    bool Next(RealNum& value) noexcept
+    {
+        std::string_view token;
+        return Next(token) && ParseReal(token, value);
+    }
+
+    bool Next(std::uint64_t& value) noexcept
+    {
+        std::string_view token;
+        return Next(token) && ParseUnsigned(token, value);
+    }
+
+    bool Next(Vec3& value) noexcept
+    {
+        RealNum x, y, z;
+        if (!Next(x) || !Next(y) || !Next(z))
+            return false;
+        value = Vec3(x, y, z);
+        return true;
+    }
+
+    // Whether the next token exists and is a number, without consuming it
+    [[nodiscard]] bool NextIsNumber() const noexcept
+    {
+        Tokens copy = *this;
+        RealNum value;
+        return copy.Next(value);
+    }
+
+    [[nodiscard]] bool AtEnd() const noexcept
+    {
+        Tokens copy = *this;
+        std::string_view token;
+        return !copy.Next(token);
+    }
+
+  private:
+    std::string_view rest_;
+};
+
+// Error of the cameras for which IsValidCamera fails
+constexpr char kInvalidCamera[] =
+    "invalid camera (look_at equal to look_from, up along the view or vfov out of (0, 180))";
+
+// Parses the rest of 'tokens' as options of a camera changing 'camera':
+//   [look_from x y z] [look_at x y z] [up x y z] [vfov degrees]
+//   [aperture a] [focus_distance d] [shutter t0 t1]
+// Returns false if any is invalid, or if it is the shutter and it is not
+// allowed.
+inline bool ParseCameraOptions(Tokens& tokens, CameraSettings& camera, bool allow_shutter)
+{
+    std::string_view option;
+    while (tokens.Next(option)) {
+        bool valid = false;
+        if (option == "look_from")
+            valid = tokens.Next(camera.look_from);
+        else if (option == "look_at")
+            valid = tokens.Next(camera.look_at);
+        else if (option == "up")
+            valid = tokens.Next(camera.up);
+        else if (option == "vfov")
+            valid = tokens.Next(camera.vertical_fov_deg);
+        else if (option == "aperture")
+            valid = tokens.Next(camera.aperture);
+        else if (option == "focus_distance")
+            valid = tokens.Next(camera.focus_distance);
+        else if (option == "shutter" && allow_shutter)
+            valid = tokens.Next(camera.time_from) && tokens.Next(camera.time_to) &&
+                    camera.time_from <= camera.time_to;
+        if (!valid)
+            return false;
+    }
+    return true;
+}
+
+}  // namespace scene_file_detail
+
+}  // namespace plemma::glancy
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "camera.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Settings of the renderer given by a scene file
+struct RenderSettings
+{
+    std::size_t width = 400U;
+    std::size_t height = 200U;
+    std::size_t samples_per_pixel = 100U;
+    std::uint16_t max_depth = 50U;
+};
+
+// Frames of an animation given by a scene file. Frames split the interval
+// [time_from, time_to] in equal parts, and the shutter of the camera is
+// open during the first 'shutter' fraction of each of them.
+struct AnimationSettings
+{
+    std::size_t frame_count = 1U;
+    RealNum time_from = Real(0);
+    RealNum time_to = Real(1);
+    RealNum shutter = Real(0.5);
+
+    // Times the shutter opens and closes in frame 'frame'
+    void FrameShutter(std::size_t frame, RealNum& opens, RealNum& closes) const noexcept
+    {
+        RealNum const frame_duration = (time_to - time_from) / Real(frame_count);
+        opens = time_from + Real(frame) * frame_duration;
+        closes = opens + shutter * frame_duration;
+    }
+};
+
+// Camera described by 'camera', for images of the size in 'settings'
+inline Camera MakeCamera(CameraSettings const& camera, RenderSettings const& settings) noexcept
+{
+    RealNum const focus_distance = camera.focus_distance > Real(0)
+                                       ? camera.focus_distance
+                                       : (camera.look_from - camera.look_at).Norm();
+    return Camera(camera.look_from,
+                  camera.look_at,
+                  camera.up,
+                  camera.vertical_fov_deg,
+                  Real(settings.width) / Real(settings.height),
+                  camera.aperture,
+                  focus_distance,
+                  camera.time_from,
+                  camera.time_to);
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "axes_aligned_bounding_box.hpp"
+#include "spatial_hash_grid.hpp"
+#include "sphere.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+// Keeps track of the room taken by the spheres of a scene being
+// generated, so that new spheres can be placed without overlapping the
+// previous ones. Checks are exact for spheres and only look at nearby
+// ones (see SpatialHashGrid), so placing n spheres takes O(n).
+class SpherePlacer
+{
+  public:
+    // 'cell_size' should be about the diameter of the typical sphere
+    explicit SpherePlacer(RealNum cell_size) : grid_(cell_size) {}
+
+    // Whether a sphere with center 'center' and radius 'radius' would not
+    // overlap any of the spheres reserved so far
+    [[nodiscard]] bool IsFree(Vec3 const& center, RealNum radius) const
+    {
+        return !grid_.AnyOverlapping(ComputeAABBForFixedSphere(center, radius),
+                                     [&](std::uint32_t index) {
+                                         RealNum const distance = radius + radii_[index];
+                                         return (center - centers_[index]).SquaredNorm() <
+                                                distance * distance;
+                                     });
+    }
+
+    // Takes the room of the sphere with center 'center' and radius 'radius'
+    void Reserve(Vec3 const& center, RealNum radius)
+    {
+        grid_.Insert(ComputeAABBForFixedSphere(center, radius));
+        centers_.push_back(center);
+        radii_.push_back(radius);
+    }
+
+    // Reserves the room of the sphere if it is free. Returns whether it was.
+    bool TryReserve(Vec3 const& center, RealNum radius)
+    {
+        if (!IsFree(center, radius))
+            return false;
+        Reserve(center, radius);
+        return true;
+    }
+
+    // Rejection sampling: calls 'propose(center, radius)' to get candidate
+    // spheres until one of them is free, up to 'max_attempts' times. The
+    // first free one is reserved and left in 'center' and 'radius'.
+    // Returns false if none was free.
+    template <typename Proposal>
+    bool PlaceByRejection(Proposal&& propose,
+                          std::size_t max_attempts,
+                          Vec3& center,
+                          RealNum& radius)
+    {
+        for (std::size_t attempt = 0; attempt < max_attempts; ++attempt) {
+            propose(center, radius);
+            if (TryReserve(center, radius))
+                return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] std::size_t Size() const noexcept { return centers_.size(); }
+
+  private:
+    SpatialHashGrid grid_;
+    std::vector<Vec3> centers_;
+    std::vector<RealNum> radii_;
+};
+
+}  // namespace plemma::glancy
@@ -25,22 +25,24 @@ class TwoSpheresScene : public Scene
 
 inline void TwoSpheresScene::LoadWorld() noexcept
 {
+    SceneBuilder& builder = Builder();
     Vec3 center_from(Real(0), Real(1), Real(1));
     Vec3 center_to(Real(0), Real(1.1), Real(1));
     auto center = [=](RealNum t) { return center_from + t * (center_to - center_from); };
     auto radius = []([[maybe_unused]] RealNum t) { return Real(1); };
-    world_.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+    world_.Add(Make<Sphere<Vec3, RealNum> >(
         Vec3(Real(0), Real(-1000), Real(0)),
         Real(1000),
-        std::make_shared<Lambertian>(std::make_shared<CheckerTexture>(
-            std::make_shared<ConstantTexture>(Vec3(Real(0.5), Real(0.5), Real(0.5))),
-            std::make_shared<ConstantTexture>(Vec3(Real(0.9), Real(0.9), Real(0.9)))))));
-    world_.Add(std::make_shared<Sphere<decltype(center), decltype(radius)> >(
+        builder.MakeLambertian(builder.MakeCheckerTexture(
+            builder.MakeConstantTexture(Vec3(Real(0.5), Real(0.5), Real(0.5))),
+            builder.MakeConstantTexture(Vec3(Real(0.9), Real(0.9), Real(0.9)))))));
+    world_.Add(Make<Sphere<decltype(center), decltype(radius)> >(
         center,
         radius,
-        std::make_shared<Lambertian>(std::make_shared<CheckerTexture>(
-            std::make_shared<ConstantTexture>(Vec3(Real(0.5), Real(0.5), Real(0.5))),
-            std::make_shared<ConstantTexture>(Vec3(Real(0.9), Real(0.9), Real(0.9)))))));
+        builder.MakeLambertian(builder.MakeCheckerTexture(
+            builder.MakeConstantTexture(Vec3(Real(0.5), Real(0.5), Real(0.5))),
+            builder.MakeConstantTexture(Vec3(Real(0.9), Real(0.9), Real(0.9)))))));
+    BindMaterials();
 }
 
 }  // namespace plemma::glancy
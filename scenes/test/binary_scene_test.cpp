@@ -0,0 +1,332 @@
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ray_random_generator.hpp"
+#include "temporary_files.hpp"
+
+#include "binary_scene.hpp"
+#include "constant_texture.hpp"
+#include "file_scene.hpp"
+#include "lambertian.hpp"
+#include "motion.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+// Material out of the closed set of the library
+class Absorbing : public Material
+{
+  public:
+    bool Sample([[maybe_unused]] Ray const& ray_in,
+                [[maybe_unused]] HitRecord const& rec,
+                [[maybe_unused]] ScatterSample& sample) const override
+    {
+        return false;
+    }
+};
+
+std::ptrdiff_t Count(HittableList const& list)
+{
+    return std::distance(list.begin(), list.end());
+}
+
+// Changes the record of type T at 'offset' of the file at 'path'
+template <typename T, typename Change>
+void ChangeRecord(std::string const& path, std::size_t offset, Change&& change)
+{
+    std::string contents = ReadFile(path);
+    T record;
+    std::memcpy(&record, contents.data() + offset, sizeof(record));
+    change(record);
+    std::memcpy(contents.data() + offset, &record, sizeof(record));
+    WriteFile(path, contents);
+}
+
+BinarySceneHeader ReadHeader(std::string const& path)
+{
+    BinarySceneHeader header;
+    std::memcpy(&header, ReadFile(path).data(), sizeof(header));
+    return header;
+}
+
+std::string const kScene = "image 64 32\n"
+                           "samples 4\n"
+                           "camera look_from 12 2 3 look_at 0 0.5 0 vfov 25\n"
+                           "background 0.02 0.02 0.04\n"
+                           "texture dark constant 0.2 0.3 0.1\n"
+                           "texture floor checker dark 0.9 0.9 0.9\n"
+                           "material ground lambertian floor\n"
+                           "material mirror metal 0.7 0.6 0.5 0.1\n"
+                           "material glass dielectric 1.52\n"
+                           "material lamp light 15 13 10\n"
+                           "sphere 0 -1000 0 1000 ground\n"
+                           "sphere 0 1 0 1 glass\n"
+                           "sphere 4 1 0 1 mirror\n"
+                           "sphere -2 3 2 0.3 lamp\n";
+
+}  // namespace
+
+TEST_CASE("BinaryScene : same scene as the one saved", "[BinaryScene]")
+{
+    TemporaryDirectory const directory("binary_scene_test");
+    std::string const text_path = directory.File("binary_scene_test.scene");
+    std::string const path = directory.File("binary_scene_test.glancy");
+    WriteFile(text_path, kScene);
+    FileScene text_scene(text_path);
+    text_scene.LoadWorld();
+    REQUIRE(text_scene.IsLoaded());
+    std::string error;
+    REQUIRE(SaveBinaryScene(path,
+                            text_scene.World(),
+                            text_scene.Settings(),
+                            text_scene.CameraSetup(),
+                            text_scene.BackgroundColor(),
+                            error));
+    CHECK(IsBinarySceneFile(path));
+    CHECK_FALSE(IsBinarySceneFile(text_path));
+
+    BinaryScene scene(path);
+    scene.LoadWorld();
+    REQUIRE(scene.IsLoaded());
+    CHECK(scene.Settings().width == 64U);
+    CHECK(scene.Settings().samples_per_pixel == 4U);
+    CHECK(scene.CameraSetup().look_from == text_scene.CameraSetup().look_from);
+    CHECK(scene.Background(Ray()) == *text_scene.BackgroundColor());
+    // Spheres are packed in a single hittable, and lights kept apart
+    CHECK(Count(scene.World()) == 1);
+    CHECK(Count(scene.Lights()) == 1);
+
+    SECTION("Spheres are hit as in the text scene")
+    {
+        Ray const r = GENERATE(take(200, RandomRayTowardsOrigin()));
+        HitRecord rec{};
+        HitRecord text_rec{};
+        bool const hit = text_scene.World().Hit(r, Real(0.001), Real(1e4), text_rec);
+        REQUIRE(scene.World().Hit(r, Real(0.001), Real(1e4), rec) == hit);
+        if (hit)
+            CHECK(rec.t == Approx(text_rec.t));
+    }
+
+    SECTION("Loading again starts from an empty scene")
+    {
+        scene.LoadWorld();
+        REQUIRE(scene.IsLoaded());
+        CHECK(Count(scene.World()) == 1);
+        CHECK(Count(scene.Lights()) == 1);
+    }
+}
+
+TEST_CASE("BinaryScene : procedural spheres are stored with the other spheres", "[BinaryScene]")
+{
+    TemporaryDirectory const directory("binary_scene_test");
+    std::string const text_path = directory.File("binary_scene_test.scene");
+    std::string const path = directory.File("binary_scene_test.glancy");
+    WriteFile(text_path,
+              kScene + "bvh_nodes quantized16\n"
+                       "procedural_spheres 300 material ground 2 material mirror 1 seed 5\n");
+    FileScene text_scene(text_path);
+    text_scene.LoadWorld();
+    REQUIRE(text_scene.IsLoaded());
+    std::string error;
+    REQUIRE(SaveBinaryScene(path,
+                            text_scene.World(),
+                            text_scene.Settings(),
+                            text_scene.CameraSetup(),
+                            text_scene.BackgroundColor(),
+                            error));
+
+    BinaryScene scene(path);
+    scene.LoadWorld();
+    REQUIRE(scene.IsLoaded());
+    REQUIRE(Count(scene.World()) == 1);
+    auto const& packed = dynamic_cast<PackedSpheres const&>(**scene.World().begin());
+    CHECK(packed.Size() == 304U);
+
+    Ray const r = GENERATE(take(200, RandomRayTowardsOrigin()));
+    HitRecord rec{};
+    HitRecord text_rec{};
+    bool const hit = text_scene.World().Hit(r, Real(0.001), Real(1e4), text_rec);
+    REQUIRE(scene.World().Hit(r, Real(0.001), Real(1e4), rec) == hit);
+    if (hit)
+        CHECK(rec.t == Approx(text_rec.t));
+}
+
+TEST_CASE("BinaryScene : malformed files", "[BinaryScene]")
+{
+    TemporaryDirectory const directory("binary_scene_test");
+    std::string const text_path = directory.File("binary_scene_test.scene");
+    std::string const path = directory.File("binary_scene_test.glancy");
+    WriteFile(text_path, kScene);
+    FileScene text_scene(text_path);
+    text_scene.LoadWorld();
+    REQUIRE(text_scene.IsLoaded());
+    std::string error;
+    REQUIRE(SaveBinaryScene(path,
+                            text_scene.World(),
+                            text_scene.Settings(),
+                            text_scene.CameraSetup(),
+                            text_scene.BackgroundColor(),
+                            error));
+    BinarySceneHeader const header = ReadHeader(path);
+    binary_scene_detail::Sections const sections(header);
+    std::string expected_error;
+
+    SECTION("Foreign and truncated files")
+    {
+        std::string const contents = ReadFile(path);
+        WriteFile(path, contents.substr(0U, 10U));
+        expected_error = "not a binary scene file";
+    }
+    SECTION("Truncated sections")
+    {
+        std::string const contents = ReadFile(path);
+        WriteFile(path, contents.substr(0U, contents.size() - 1U));
+        expected_error = "truncated binary scene file";
+    }
+    SECTION("Other magic and version")
+    {
+        bool const change_magic = GENERATE(true, false);
+        ChangeRecord<BinarySceneHeader>(path, 0U, [change_magic](BinarySceneHeader& changed) {
+            if (change_magic)
+                changed.magic[0] = 'X';
+            else
+                changed.format_version += 1U;
+        });
+        expected_error = "not a binary scene file of a supported version";
+    }
+    SECTION("Other precision")
+    {
+        ChangeRecord<BinarySceneHeader>(
+            path, 0U, [](BinarySceneHeader& changed) { changed.real_num_size += 1U; });
+        expected_error = "binary scene file written with a different floating point precision";
+    }
+    SECTION("Corrupted counts and settings")
+    {
+        int const field = GENERATE(0, 1, 2, 3, 4);
+        ChangeRecord<BinarySceneHeader>(path, 0U, [field](BinarySceneHeader& changed) {
+            if (field == 0)
+                changed.sphere_count = std::uint64_t(1U) << 40U;
+            else if (field == 1)
+                changed.node_count = 0U;
+            else if (field == 2)
+                changed.width = 0U;
+            else if (field == 3)
+                changed.samples_per_pixel = 0U;
+            else
+                changed.max_depth = 1U << 20U;
+        });
+        expected_error = "corrupted binary scene file header";
+    }
+    SECTION("Invalid cameras")
+    {
+        int const field = GENERATE(0, 1, 2);
+        ChangeRecord<BinarySceneHeader>(path, 0U, [field](BinarySceneHeader& changed) {
+            if (field == 0)
+                changed.camera.look_at = changed.camera.look_from;
+            else if (field == 1)
+                changed.camera.up = changed.camera.look_at - changed.camera.look_from;
+            else
+                changed.camera.vertical_fov_deg = Real(0);
+        });
+        expected_error = "invalid camera in binary scene file";
+    }
+    SECTION("Corrupted textures")
+    {
+        // Checkers refer to textures stored before them
+        ChangeRecord<BinaryTexture>(path, sections.textures, [](BinaryTexture& texture) {
+            texture.kind = BinaryTextureKind::kChecker;
+        });
+        expected_error = "corrupted texture in binary scene file";
+    }
+    SECTION("Corrupted materials")
+    {
+        ChangeRecord<BinaryMaterial>(path, sections.materials, [](BinaryMaterial& material) {
+            material.kind = static_cast<BinaryMaterialKind>(7U);
+        });
+        expected_error = "corrupted material in binary scene file";
+    }
+    SECTION("Corrupted trees")
+    {
+        ChangeRecord<FlatBVHNode>(path, sections.nodes, [](FlatBVHNode& node) {
+            node.count = 0U;
+            node.offset = 0U;
+        });
+        expected_error = "corrupted tree in binary scene file";
+    }
+    SECTION("Undefined materials of spheres")
+    {
+        ChangeRecord<std::uint32_t>(path, sections.sphere_material, [](std::uint32_t& material) {
+            material = 1000U;
+        });
+        expected_error = "sphere with undefined material in binary scene file";
+    }
+
+    BinaryScene scene(path);
+    scene.LoadWorld();
+    CHECK_FALSE(scene.IsLoaded());
+    CHECK(scene.Error() == path + ": " + expected_error);
+}
+
+TEST_CASE("BinaryScene : missing files and worlds that can not be saved", "[BinaryScene]")
+{
+    TemporaryDirectory const directory("binary_scene_test");
+    std::string const missing_path = directory.File("binary_scene_test_missing.glancy");
+    BinaryScene missing(missing_path);
+    missing.LoadWorld();
+    CHECK_FALSE(missing.IsLoaded());
+    CHECK(missing.Error() == "could not open " + missing_path);
+
+    std::string const path = directory.File("binary_scene_test.glancy");
+    Vec3 const gray(Real(0.5), Real(0.5), Real(0.5));
+    auto const clay = std::make_shared<Lambertian>(std::make_shared<ConstantTexture>(gray));
+    Vec3 const center(Real(0), Real(0), Real(-1));
+    HittableList world;
+    world.Add(std::make_shared<Sphere<Vec3, RealNum> >(center, Real(0.5), clay));
+    std::string expected_error;
+    SECTION("Moving spheres")
+    {
+        world.Add(std::make_shared<Sphere<LinearMotion, ConstantMagnitude> >(
+            LinearMotion{center, Vec3(Real(1), Real(0), Real(0)), Real(0)},
+            ConstantMagnitude{Real(0.5)},
+            clay));
+        expected_error = "only static spheres can be stored in binary scene files";
+    }
+    SECTION("Moving procedural spheres")
+    {
+        auto spheres = std::make_shared<PackedSpheresArrays>();
+        spheres->center_x = {Real(0)};
+        spheres->center_y = {Real(0)};
+        spheres->center_z = {Real(-3)};
+        spheres->radius = {Real(0.5)};
+        spheres->material = {0U};
+        spheres->velocity_x = {Real(1)};
+        spheres->velocity_y = {Real(0)};
+        spheres->velocity_z = {Real(0)};
+        PackSpheres(*spheres, Real(0), Real(1));
+        world.Add(std::make_shared<PackedSpheres>(
+            spheres->View(), std::vector<std::shared_ptr<Material> >{clay}, spheres));
+        expected_error = "moving procedural spheres can not be stored in binary scene files";
+    }
+    SECTION("Spheres without material")
+    {
+        world.Add(std::make_shared<Sphere<Vec3, RealNum> >(center, Real(0.5), nullptr));
+        expected_error = "spheres without material can not be stored in binary scene files";
+    }
+    SECTION("Materials out of the library")
+    {
+        world.Add(std::make_shared<Sphere<Vec3, RealNum> >(
+            center, Real(0.5), std::make_shared<Absorbing>()));
+        expected_error = "only materials of glancy can be stored in binary scene files";
+    }
+
+    std::string error;
+    CHECK_FALSE(
+        SaveBinaryScene(path, world, RenderSettings(), CameraSettings(), std::nullopt, error));
+    CHECK(error == expected_error);
+}
+
+}  // namespace plemma::glancy
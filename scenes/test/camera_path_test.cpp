@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+
+#include "catch.hpp"
+
+#include "camera_path.hpp"
+#include "constants.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+CameraSettings CameraFrom(Vec3 const& look_from)
+{
+    CameraSettings camera;
+    camera.look_from = look_from;
+    return camera;
+}
+
+}  // namespace
+
+TEST_CASE("CameraPath : keyframes", "[CameraPath]")
+{
+    CameraPath path;
+    CHECK(path.Empty());
+    CameraSettings first = CameraFrom(Vec3(Real(0), Real(0), Real(10)));
+    first.vertical_fov_deg = Real(40);
+    CameraSettings last = CameraFrom(Vec3(Real(10), Real(0), Real(0)));
+    last.vertical_fov_deg = Real(20);
+    last.aperture = Real(0.2);
+    // Keyframes are sorted by time, whatever the order they are added in
+    path.AddKeyframe(Real(2), last);
+    path.AddKeyframe(Real(0), first);
+    CHECK(path.Size() == 2U);
+
+    SECTION("Cameras out of the keyframes are the ones of the ends")
+    {
+        CHECK(path.At(Real(-1)).look_from == first.look_from);
+        CHECK(path.At(Real(0)).vertical_fov_deg == first.vertical_fov_deg);
+        CHECK(path.At(Real(2)).look_from == last.look_from);
+        CHECK(path.At(Real(5)).aperture == last.aperture);
+    }
+
+    SECTION("Parameters other than positions are interpolated linearly")
+    {
+        CameraSettings const camera = path.At(Real(0.5));
+        CHECK(camera.vertical_fov_deg == Approx(35.0));
+        CHECK(camera.aperture == Approx(0.05));
+    }
+
+    SECTION("Keyframes at the same time replace each other")
+    {
+        CameraSettings middle = CameraFrom(Vec3(Real(5), Real(5), Real(5)));
+        path.AddKeyframe(Real(1), middle);
+        middle.look_from = Vec3(Real(6), Real(6), Real(6));
+        path.AddKeyframe(Real(1), middle);
+        CHECK(path.Size() == 3U);
+        Vec3 const look_from = path.At(Real(1)).look_from;
+        for (int i = 0; i < 3; ++i)
+            CHECK(look_from[i] == Approx(6.0));
+    }
+}
+
+TEST_CASE("CameraPath : positions follow a centripetal Catmull-Rom spline", "[CameraPath]")
+{
+    CameraPath path;
+
+    SECTION("The path goes through every keyframe")
+    {
+        Vec3 const positions[] = {Vec3(Real(0), Real(1), Real(10)),
+                                  Vec3(Real(3), Real(2), Real(8)),
+                                  Vec3(Real(9), Real(1), Real(-2)),
+                                  Vec3(Real(2), Real(4), Real(-6))};
+        for (int i = 0; i < 4; ++i)
+            path.AddKeyframe(Real(i), CameraFrom(positions[i]));
+        for (int i = 0; i < 4; ++i) {
+            Vec3 const look_from = path.At(Real(i)).look_from;
+            for (int c = 0; c < 3; ++c)
+                CHECK(look_from[c] == Approx(positions[i][c]).margin(1e-5));
+        }
+    }
+
+    SECTION("Unevenly spaced keyframes along a line do not overshoot")
+    {
+        // With uniform knots, the far keyframe after the short segment
+        // pulls the path beyond its end
+        RealNum const xs[] = {Real(0), Real(1), Real(1.1), Real(10)};
+        for (int i = 0; i < 4; ++i)
+            path.AddKeyframe(Real(i), CameraFrom(Vec3(xs[i], Real(0), Real(5))));
+        for (int step = 0; step <= 30; ++step) {
+            RealNum const x = path.At(Real(step) / Real(10)).look_from.X();
+            int const segment = std::min(step / 10, 2);
+            CHECK(x >= xs[segment] - Real(1e-5));
+            CHECK(x <= xs[segment + 1] + Real(1e-5));
+        }
+    }
+
+    SECTION("Turntables stay close to their circle")
+    {
+        constexpr int kKeyframes = 9;
+        for (int i = 0; i < kKeyframes; ++i) {
+            RealNum const angle = Real(2) * constants::kPi * Real(i) / Real(kKeyframes - 1);
+            path.AddKeyframe(
+                Real(i),
+                CameraFrom(Vec3(Real(10) * std::cos(angle), Real(2), Real(10) * std::sin(angle))));
+        }
+        // Away from the ends, where the path has no keyframe to turn to
+        for (int step = 10; step <= 70; ++step) {
+            Vec3 const look_from = path.At(Real(step) / Real(10)).look_from;
+            Vec3 const horizontal(look_from.X(), Real(0), look_from.Z());
+            CHECK(horizontal.Norm() == Approx(10.0).epsilon(0.01));
+            CHECK(look_from.Y() == Approx(2.0));
+        }
+    }
+}
+
+TEST_CASE("CameraPath : up directions are unit and across the view", "[CameraPath]")
+{
+    CameraPath path;
+    CameraSettings from = CameraFrom(Vec3(Real(-1), Real(10), Real(0)));
+    CameraSettings to = CameraFrom(Vec3(Real(1), Real(10), Real(0)));
+
+    SECTION("Ups of different lengths")
+    {
+        from.look_from = Vec3(Real(0), Real(2), Real(10));
+        to.look_from = Vec3(Real(10), Real(2), Real(0));
+        to.up = Vec3(Real(0), Real(5), Real(0));
+    }
+    SECTION("Opposite ups")
+    {
+        to.up = Vec3(Real(0), Real(-1), Real(0));
+    }
+    SECTION("View along the up, flying over what the camera looks at")
+    {
+    }
+    path.AddKeyframe(Real(0), from);
+    path.AddKeyframe(Real(1), to);
+
+    for (int step = 0; step <= 10; ++step) {
+        CameraSettings const camera = path.At(Real(step) / Real(10));
+        Vec3 const view = UnitVector(camera.look_at - camera.look_from);
+        if (step > 0 && step < 10)
+            CHECK(camera.up.Norm() == Approx(1.0));
+        CHECK(Cross(view, camera.up).Norm() > Real(1e-3));
+        CHECK(IsValidCamera(camera));
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,278 @@
+#include <iterator>
+#include <string>
+
+#include "catch.hpp"
+#include "temporary_files.hpp"
+
+#include "file_scene.hpp"
+#include "scene_file_tokens.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+std::ptrdiff_t Count(HittableList const& list)
+{
+    return std::distance(list.begin(), list.end());
+}
+
+std::string const kTetrahedron = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0 0 1\n"
+                                 "f 1 3 2\nf 1 2 4\nf 1 4 3\nf 2 3 4\n";
+
+std::string const kValidScene =
+    "# Every statement, with and without its options\n"
+    "image 64 32\n"
+    "samples 4\n"
+    "max_depth 7\n"
+    "camera look_from 12 2 3 look_at 0 0.5 0 vfov 25 aperture 0.05 shutter 0 1\n"
+    "background 0.02 0.02 0.04\n"
+    "\n"
+    "texture dark constant 0.2 0.3 0.1\n"
+    "texture floor checker dark 0.9 0.9 0.9\n"
+    "material ground lambertian floor\n"
+    "material mirror metal 0.7 0.6 0.5 0\n"
+    "material glass dielectric 1.52\n"
+    "material lamp light 15 13 10  # glows\n"
+    "sphere 0 -1000 0 1000 ground\n"
+    "moving_sphere 2 0.3 2 2 0.6 2 0 1 0.3 mirror\n"
+    "sphere -2 3 2 0.3 lamp\n"
+    "mesh file_scene_test.obj glass scale 2 rotate 0 1 0 30 translate 0 1 0\n"
+    "procedural_spheres 100 material ground 1 material lamp 1 seed 3 radius 0.1 0.2\n"
+    "bvh_nodes quantized8\n"
+    "animation 10 0 2 shutter 0.25\n"
+    "keyframe 0\n"
+    "keyframe 2 look_from 10 2 -3\n";
+
+}  // namespace
+
+TEST_CASE("ParseReal : string_view x RealNum -> bool", "[FileScene]")
+{
+    SECTION("Decimal numbers")
+    {
+        auto const [token, expected] = GENERATE(table<char const*, double>({
+            {"0", 0.0},
+            {"-0.0", 0.0},
+            {"+2", 2.0},
+            {"-1.5e-3", -1.5e-3},
+            {".5", 0.5},
+            {"5.", 5.0},
+            {"1E2", 100.0},
+            {"2.5e+1", 25.0},
+            // Exponents beyond the powers of ten computed exactly
+            {"1e30", 1e30},
+            {"-3e-30", -3e-30},
+            // Numbers too small for RealNum
+            {"1e-400", 0.0},
+            // Digits beyond the 19th significant one only count for the exponent
+            {"12345678901234567890123", 1.2345678901234567e22},
+            {"0.0000012345678901234567890123", 1.2345678901234567e-6},
+            {"1234567890123456789.0123", 1234567890123456789.0},
+        }));
+        RealNum value = Real(-1);
+        REQUIRE(scene_file_detail::ParseReal(token, value));
+        CHECK(value == Approx(expected).margin(1e-38));
+    }
+
+    SECTION("Malformed numbers and numbers too big for RealNum")
+    {
+        char const* const token = GENERATE("",
+                                           "-",
+                                           ".",
+                                           "e5",
+                                           "1e",
+                                           "1e+-2",
+                                           "1.2.3",
+                                           "0x10",
+                                           "1 2",
+                                           "1e400",
+                                           "-1e400",
+                                           "1e401",
+                                           "1e100000000000000000000");
+        RealNum value;
+        CHECK_FALSE(scene_file_detail::ParseReal(token, value));
+    }
+}
+
+TEST_CASE("FileScene : statements of a valid file", "[FileScene]")
+{
+    TemporaryDirectory const directory("file_scene_test");
+    std::string const path = directory.File("file_scene_test.scene");
+    WriteFile(directory.File("file_scene_test.obj"), kTetrahedron);
+    WriteFile(path, kValidScene);
+    FileScene scene(path);
+    scene.LoadWorld();
+    REQUIRE(scene.IsLoaded());
+
+    CHECK(scene.Settings().width == 64U);
+    CHECK(scene.Settings().height == 32U);
+    CHECK(scene.Settings().samples_per_pixel == 4U);
+    CHECK(scene.Settings().max_depth == 7U);
+    CHECK(scene.CameraSetup().look_from == Vec3(Real(12), Real(2), Real(3)));
+    CHECK(scene.CameraSetup().look_at == Vec3(Real(0), Real(0.5), Real(0)));
+    CHECK(scene.CameraSetup().vertical_fov_deg == Approx(25.0));
+    CHECK(scene.CameraSetup().aperture == Approx(0.05));
+    CHECK(scene.CameraSetup().time_to == Approx(1.0));
+    REQUIRE(scene.BackgroundColor());
+    CHECK(*scene.BackgroundColor() == Vec3(Real(0.02), Real(0.02), Real(0.04)));
+    REQUIRE(scene.Animation());
+    CHECK(scene.Animation()->frame_count == 10U);
+    CHECK(scene.Animation()->time_to == Approx(2.0));
+    CHECK(scene.Animation()->shutter == Approx(0.25));
+    CHECK(scene.Path().Size() == 2U);
+
+    // Three spheres, an instance of the mesh and the procedural spheres,
+    // of which only the light sphere is sampled
+    CHECK(Count(scene.World()) == 5);
+    CHECK(Count(scene.Lights()) == 1);
+
+    SECTION("Loading again starts from an empty scene")
+    {
+        scene.LoadWorld();
+        REQUIRE(scene.IsLoaded());
+        CHECK(Count(scene.World()) == 5);
+        CHECK(Count(scene.Lights()) == 1);
+
+        WriteFile(path, "material clay lambertian 0.5 0.5 0.5\nsphere 0 0 -1 0.5 clay\n");
+        scene.LoadWorld();
+        REQUIRE(scene.IsLoaded());
+        CHECK(Count(scene.World()) == 1);
+        CHECK(scene.Lights().Empty());
+        CHECK(scene.Settings().width == RenderSettings().width);
+        CHECK(scene.CameraSetup().look_from == CameraSettings().look_from);
+        CHECK_FALSE(scene.BackgroundColor());
+        CHECK_FALSE(scene.Animation());
+        CHECK(scene.Path().Empty());
+    }
+}
+
+TEST_CASE("FileScene : keyframes", "[FileScene]")
+{
+    // Keyframes start from the camera, then from the keyframe before them
+    // in the file, of which they only change the options they give
+    TemporaryDirectory const directory("file_scene_test");
+    std::string const path = directory.File("file_scene_test.scene");
+    WriteFile(path,
+              "camera look_from 0 0 10 vfov 40 shutter 0 0.5\n"
+              "keyframe 0\n"
+              "keyframe 2 look_from 10 0 0 up 0 0 1\n"
+              "keyframe 4 vfov 20\n"
+              "keyframe 2 look_from 0 10 10\n");
+    FileScene scene(path);
+    scene.LoadWorld();
+    REQUIRE(scene.IsLoaded());
+    REQUIRE(scene.Path().Size() == 3U);
+
+    CameraSettings const first = scene.Path().At(Real(0));
+    CHECK(first.look_from == Vec3(Real(0), Real(0), Real(10)));
+    CHECK(first.up == Vec3(Real(0), Real(1), Real(0)));
+    CHECK(first.vertical_fov_deg == Approx(40.0));
+
+    CameraSettings const last = scene.Path().At(Real(4));
+    CHECK(last.look_from == Vec3(Real(10), Real(0), Real(0)));
+    CHECK(last.up == Vec3(Real(0), Real(0), Real(1)));
+    CHECK(last.vertical_fov_deg == Approx(20.0));
+
+    // Replaced by the last keyframe of the file, which follows the one at 4
+    CameraSettings const replaced = scene.Path().At(Real(2));
+    CHECK(replaced.look_from == Vec3(Real(0), Real(10), Real(10)));
+    CHECK(replaced.vertical_fov_deg == Approx(20.0));
+
+    // The shutter stays the one of the camera
+    CHECK(scene.Path().At(Real(1)).time_to == Approx(0.5));
+}
+
+TEST_CASE("FileScene : malformed files", "[FileScene]")
+{
+    auto const [statement, expected_error] = GENERATE(table<std::string, std::string>({
+        {"bvh_nodes", "expected format of the tree nodes"},
+        {"bvh_nodes quantized4", "unknown format of the tree nodes"},
+        {"camera vfov", "invalid camera option"},
+        {"camera zoom 2", "invalid camera option"},
+        {"camera shutter 1 0", "invalid camera option"},
+        {"image 0 100", "expected width and height of the image"},
+        {"samples 0", "expected number of rays per pixel"},
+        {"max_depth 65536", "expected maximum depth"},
+        {"background 1 1", "expected background color"},
+        {"background night", "expected 'sky' or a color as background"},
+        {"cube 0 0 0 1 clay", "unknown statement"},
+        {"samples 10 20", "unexpected tokens at the end of the statement"},
+        {"animation 0 0 1", "expected number of frames and time interval (t0 <= t1) of animation"},
+        {"animation 10 1 0", "expected number of frames and time interval (t0 <= t1) of animation"},
+        {"animation 10 0 1 shutter 2", "expected shutter (between 0 and 1) of animation"},
+        {"keyframe", "expected time of keyframe"},
+        {"keyframe 0 shutter 0 1", "invalid keyframe option"},
+        {"keyframe 0 look_at 0 0 1", scene_file_detail::kInvalidCamera},
+        {"texture wood", "expected name and kind of texture"},
+        {"texture wood constant 1 1", "expected color of constant texture"},
+        {"texture wood marble", "unknown kind of texture"},
+        {"material", "expected name and kind of material"},
+        {"material steel metal 1 1 1", "expected albedo and fuzziness of metal"},
+        {"material glass dielectric 0.5", "expected refractive index (>= 1) of dielectric"},
+        {"material gold plastic", "unknown kind of material"},
+        {"material tile lambertian", "expected texture"},
+        {"material tile lambertian 1 1", "expected color"},
+        {"material tile lambertian wood", "undefined texture"},
+        {"sphere 0 0", "expected center of sphere"},
+        {"moving_sphere 0 0 0 1 1 1 1 0 1 clay",
+         "expected final center and time interval (t0 < t1) of moving sphere"},
+        {"sphere 0 0 0 0 clay", "expected positive radius of sphere"},
+        {"sphere 0 0 0 1e400 clay", "expected positive radius of sphere"},
+        {"sphere 0 0 0 1", "expected material of sphere"},
+        {"sphere 0 0 0 1 wood", "undefined material"},
+        {"mesh file_scene_test.obj", "expected file and material of mesh"},
+        {"mesh file_scene_test.obj wood", "undefined material"},
+        {"mesh file_scene_test.obj clay rotate 0 0 0 30", "invalid mesh option"},
+        {"mesh file_scene_test.obj clay scale 0", "mesh transformation can not be inverted"},
+        {"procedural_spheres 0 material clay 1", "expected number of procedural spheres"},
+        {"procedural_spheres 5000000000 material clay 1", "too many procedural spheres"},
+        {"procedural_spheres 10 material clay 1 density 2", "invalid procedural spheres option"},
+        {"procedural_spheres 10 material wood 1", "undefined material"},
+        {"procedural_spheres 10 seed 3", "expected materials of procedural spheres"},
+    }));
+    TemporaryDirectory const directory("file_scene_test");
+    std::string const path = directory.File("file_scene_test.scene");
+    WriteFile(directory.File("file_scene_test.obj"), kTetrahedron);
+    WriteFile(path, "material clay lambertian 0.5 0.5 0.5\n" + statement + "\nsamples 1\n");
+    FileScene scene(path);
+    scene.LoadWorld();
+    CHECK_FALSE(scene.IsLoaded());
+    CHECK(scene.Error() == path + ":2: " + expected_error);
+}
+
+TEST_CASE("FileScene : missing files and invalid cameras", "[FileScene]")
+{
+    TemporaryDirectory const directory("file_scene_test");
+    std::string const missing_path = directory.File("file_scene_test_missing.scene");
+    FileScene missing(missing_path);
+    missing.LoadWorld();
+    CHECK_FALSE(missing.IsLoaded());
+    CHECK(missing.Error() == "could not open " + missing_path);
+
+    // Paths of meshes are relative to the directory of the scene file
+    std::string const path = directory.File("file_scene_test.scene");
+    WriteFile(path, "material clay lambertian 0.5 0.5 0.5\nmesh missing.obj clay\n");
+    FileScene missing_mesh(path);
+    missing_mesh.LoadWorld();
+    CHECK_FALSE(missing_mesh.IsLoaded());
+    CHECK(missing_mesh.Error() == path + ":2: could not open " + directory.File("missing.obj"));
+
+    // Options of the camera are only checked together, once the file is read
+    std::string const camera = GENERATE(std::string("camera look_from 0 0 0\ncamera look_at 0 0 1"),
+                                        std::string("camera look_at 0 0 1"),
+                                        std::string("camera look_from 0 5 0 look_at 0 0 0"),
+                                        std::string("camera vfov 0"),
+                                        std::string("camera vfov 180"),
+                                        std::string("camera aperture -1"));
+    WriteFile(path, camera + "\n");
+    FileScene scene(path);
+    scene.LoadWorld();
+    if (camera.find('\n') != std::string::npos) {
+        CHECK(scene.IsLoaded());
+    }
+    else {
+        CHECK_FALSE(scene.IsLoaded());
+        CHECK(scene.Error() == path + ": " + scene_file_detail::kInvalidCamera);
+    }
+}
+
+}  // namespace plemma::glancy
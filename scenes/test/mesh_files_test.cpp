@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "temporary_files.hpp"
+
+#include "mesh_files.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+// Bytes of 'value' in the given byte order
+template <typename T>
+std::string Bytes(T value, bool little_endian)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    std::uint16_t const probe = 1U;
+    bool const is_little_endian_host = *reinterpret_cast<unsigned char const*>(&probe) == 1U;
+    std::string result(reinterpret_cast<char const*>(bytes), sizeof(T));
+    if (little_endian != is_little_endian_host)
+        result.assign(result.rbegin(), result.rend());
+    return result;
+}
+
+// Square in the plane z = 1, as a single quad
+std::vector<Vec3> const kSquare{Vec3(Real(0), Real(0), Real(1)),
+                                Vec3(Real(1), Real(0), Real(1)),
+                                Vec3(Real(1), Real(1), Real(1)),
+                                Vec3(Real(0), Real(1), Real(1))};
+std::vector<std::uint32_t> const kSquareTriangles{0U, 1U, 2U, 0U, 2U, 3U};
+
+std::string PlyHeader(char const* format, std::size_t vertices, std::size_t faces)
+{
+    return std::string("ply\nformat ") + format + " 1.0\ncomment square\nelement vertex " +
+           std::to_string(vertices) +
+           "\nproperty float x\nproperty float y\nproperty float z\nelement face " +
+           std::to_string(faces) + "\nproperty list uchar int vertex_indices\nend_header\n";
+}
+
+std::string BinaryPlySquare(bool little_endian)
+{
+    std::string ply = PlyHeader(
+        little_endian ? "binary_little_endian" : "binary_big_endian", kSquare.size(), 1U);
+    for (Vec3 const& vertex : kSquare) {
+        for (int axis = 0; axis < 3; ++axis)
+            ply += Bytes(float(vertex[axis]), little_endian);
+    }
+    ply += Bytes(std::uint8_t{4}, little_endian);
+    for (std::int32_t index = 0; index < 4; ++index)
+        ply += Bytes(index, little_endian);
+    return ply;
+}
+
+}  // namespace
+
+TEST_CASE("LoadObjMesh : vertices and faces", "[MeshFiles]")
+{
+    TemporaryDirectory const directory("mesh_files_test");
+    std::string const path = directory.File("mesh_files_test.obj");
+    WriteFile(path,
+              "# square\n"
+              "o square\n"
+              "v 0 0 1\n"
+              "v 1 0 1\n"
+              "vn 0 0 1\n"
+              "v 1 1 1 1.0\n"
+              "v 0 1 1\n"
+              "f 1//1 2//1 3//1\n"
+              "f -4 -2 -1\n");
+    TriangleMeshBuffers buffers;
+    std::string error;
+    REQUIRE(LoadMesh(path, buffers, error));
+    CHECK(buffers.vertices == kSquare);
+    CHECK(buffers.indices == kSquareTriangles);
+
+    SECTION("Invalid faces")
+    {
+        auto const face = GENERATE("f 1 2", "f 1 2 5", "f 0 1 2", "f -5 1 2", "f 1 2 x");
+        WriteFile(path, "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n" + std::string(face) + "\n");
+        CHECK(!LoadMesh(path, buffers, error));
+        CHECK(error == path + ":5: invalid vertex or face");
+    }
+    SECTION("Invalid vertices")
+    {
+        WriteFile(path, "v 0 0\n");
+        CHECK(!LoadMesh(path, buffers, error));
+        CHECK(error == path + ":1: invalid vertex or face");
+    }
+}
+
+TEST_CASE("LoadPlyMesh : ascii and binary bodies", "[MeshFiles]")
+{
+    TemporaryDirectory const directory("mesh_files_test");
+    std::string const path = directory.File("mesh_files_test.ply");
+    SECTION("Ascii")
+    {
+        WriteFile(path,
+                  PlyHeader("ascii", kSquare.size(), 1U) +
+                      "0 0 1\n1 0 1\n1 1 1\n0 1 1\n4 0 1 2 3\n");
+    }
+    SECTION("Little endian")
+    {
+        WriteFile(path, BinaryPlySquare(true));
+    }
+    SECTION("Big endian")
+    {
+        WriteFile(path, BinaryPlySquare(false));
+    }
+    TriangleMeshBuffers buffers;
+    std::string error;
+    REQUIRE(LoadMesh(path, buffers, error));
+    CHECK(buffers.vertices == kSquare);
+    CHECK(buffers.indices == kSquareTriangles);
+}
+
+TEST_CASE("LoadPlyMesh : malformed files", "[MeshFiles]")
+{
+    std::string const body = "0 0 1\n1 0 1\n1 1 1\n0 1 1\n4 0 1 2 3\n";
+    std::string const binary = BinaryPlySquare(true);
+    auto const [contents, expected_error] = GENERATE_COPY(table<std::string, std::string>({
+        {"obj\n" + body, "not a PLY file"},
+        {"ply\nformat ascii 1.0\nelement vertex 4\n", "unterminated header"},
+        {"ply\nformat utf8 1.0\nend_header\n", "unknown format"},
+        {"ply\nformat ascii 1.0\nproperty float x\nend_header\n", "property out of any element"},
+        {"ply\nformat ascii 1.0\nelement vertex 1\nproperty quad x\nend_header\n0\n",
+         "invalid property"},
+        {"ply\nformat ascii 1.0\nelement face 1\nproperty list uchar\nend_header\n0\n",
+         "invalid list property"},
+        {"ply\nformat ascii 1.0\nelement vertex 1\nproperty float x\nsize 3\nend_header\n0\n",
+         "unknown header line"},
+        {PlyHeader("ascii", 4U, 1U) + "0 0 1\n1 0 1\n1 1 1\n0 1 1\n4 0 1 2 4\n",
+         "face with invalid vertex index"},
+        {PlyHeader("ascii", 4U, 1U) + "0 0 1\n1 0 1\n1 1 1\n0 1 1\n4 0 1 2\n", "truncated body"},
+        {PlyHeader("ascii", 4U, 1U) + "0 0 1\n1 0 1\n1 1 1\n0 1 x\n4 0 1 2 3\n",
+         "truncated body"},
+        {binary.substr(0U, binary.size() - 1U), "truncated body"},
+        // Counts are checked before allocating anything for them
+        {PlyHeader("binary_little_endian", std::size_t(1) << 60U, 1U) +
+             binary.substr(binary.find("end_header\n") + 11U),
+         "element count larger than the file"},
+        {PlyHeader("ascii", 40U, 1U) + body, "element count larger than the file"}}));
+    TemporaryDirectory const directory("mesh_files_test");
+    std::string const path = directory.File("mesh_files_test.ply");
+    WriteFile(path, contents);
+    TriangleMeshBuffers buffers;
+    std::string error;
+    CHECK(!LoadMesh(path, buffers, error));
+    CHECK(error == path + ": " + expected_error);
+}
+
+TEST_CASE("LoadMesh : missing and unknown files", "[MeshFiles]")
+{
+    TriangleMeshBuffers buffers;
+    std::string error;
+    TemporaryDirectory const directory("mesh_files_test");
+    std::string const missing_path = directory.File("mesh_files_test_missing.obj");
+    CHECK(!LoadMesh(missing_path, buffers, error));
+    CHECK(error == "could not open " + missing_path);
+    CHECK(!LoadMesh("mesh_files_test.stl", buffers, error));
+    CHECK(error == "mesh_files_test.stl: unknown mesh format (expected .obj or .ply)");
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,135 @@
+#include <string>
+
+#include "catch.hpp"
+#include "temporary_files.hpp"
+
+#include "file_scene.hpp"
+#include "procedural_spheres.hpp"
+
+namespace plemma::glancy {
+
+namespace {
+
+ProceduralSpheresSettings MakeSettings()
+{
+    ProceduralSpheresSettings settings;
+    settings.count = 500U;
+    settings.seed = 7U;
+    settings.center = Vec3(Real(10), Real(-5), Real(2));
+    settings.material_weights = {Real(1), Real(3)};
+    settings.motion_fraction = Real(0.5);
+    return settings;
+}
+
+bool SameSpheres(PackedSpheresArrays const& a, PackedSpheresArrays const& b)
+{
+    return a.center_x == b.center_x && a.center_y == b.center_y && a.center_z == b.center_z &&
+           a.radius == b.radius && a.material == b.material && a.velocity_x == b.velocity_x &&
+           a.velocity_y == b.velocity_y && a.velocity_z == b.velocity_z;
+}
+
+}  // namespace
+
+TEST_CASE("GenerateProceduralSpheres : same settings give the same spheres",
+          "[ProceduralSpheres]")
+{
+    ProceduralSpheresSettings settings = MakeSettings();
+    settings.clusters = GENERATE(0U, 1U, 16U);
+    PackedSpheresArrays first;
+    PackedSpheresArrays second;
+    GenerateProceduralSpheres(settings, first);
+    GenerateProceduralSpheres(settings, second);
+    CHECK(SameSpheres(first, second));
+
+    settings.seed = 8U;
+    PackedSpheresArrays other_seed;
+    GenerateProceduralSpheres(settings, other_seed);
+    CHECK(first.center_x != other_seed.center_x);
+}
+
+TEST_CASE("GenerateProceduralSpheres : spheres do not depend on the platform",
+          "[ProceduralSpheres]")
+{
+    // Drawn from the raw output of std::mt19937_64, whose sequence the
+    // standard fixes, so these hold for every standard library
+    ProceduralSpheresSettings settings;
+    settings.count = 3U;
+    settings.seed = 7U;
+    settings.material_weights = {Real(1), Real(3)};
+    settings.motion_fraction = Real(1);
+    PackedSpheresArrays spheres;
+    GenerateProceduralSpheres(settings, spheres);
+
+    double const expected[3][7] = {
+        {0.426486969, 0.753270984, -0.641419947, 0.189191326, 0.247808322, 0.290840268,
+         0.109388523},
+        {-0.321009099, 0.556893349, -0.328593016, 0.199526191, -0.0300567634, 0.0155932344,
+         -0.026861053},
+        {-0.78219223, -0.630913734, -0.555397034, 0.136710644, -0.658067524, 0.583233297,
+         -0.189740926}};
+    std::uint32_t const expected_materials[3] = {0U, 1U, 1U};
+    REQUIRE(spheres.radius.size() == 3U);
+    for (std::size_t i = 0; i < 3U; ++i) {
+        CHECK(spheres.center_x[i] == Approx(expected[i][0]).epsilon(1e-5));
+        CHECK(spheres.center_y[i] == Approx(expected[i][1]).epsilon(1e-5));
+        CHECK(spheres.center_z[i] == Approx(expected[i][2]).epsilon(1e-5));
+        CHECK(spheres.radius[i] == Approx(expected[i][3]).epsilon(1e-5));
+        CHECK(spheres.velocity_x[i] == Approx(expected[i][4]).epsilon(1e-5));
+        CHECK(spheres.velocity_y[i] == Approx(expected[i][5]).epsilon(1e-5));
+        CHECK(spheres.velocity_z[i] == Approx(expected[i][6]).epsilon(1e-5));
+        CHECK(spheres.material[i] == expected_materials[i]);
+    }
+}
+
+TEST_CASE("GenerateProceduralSpheres : spheres follow their settings", "[ProceduralSpheres]")
+{
+    ProceduralSpheresSettings const settings = MakeSettings();
+    PackedSpheresArrays spheres;
+    GenerateProceduralSpheres(settings, spheres);
+    REQUIRE(spheres.radius.size() == settings.count);
+    REQUIRE(spheres.velocity_x.size() == settings.count);
+
+    RealNum const half_side = Real(0.5) * ProceduralSpheresRegionSide(settings);
+    std::size_t moving = 0U;
+    std::size_t second_material = 0U;
+    for (std::size_t i = 0; i < settings.count; ++i) {
+        Vec3 const center(spheres.center_x[i], spheres.center_y[i], spheres.center_z[i]);
+        for (int axis = 0; axis < 3; ++axis)
+            CHECK(std::abs(center[axis] - settings.center[axis]) <= half_side * Real(1.0001));
+        CHECK(spheres.radius[i] >= settings.min_radius);
+        CHECK(spheres.radius[i] <= settings.max_radius);
+        REQUIRE(spheres.material[i] < 2U);
+        second_material += spheres.material[i];
+        Vec3 const velocity(spheres.velocity_x[i], spheres.velocity_y[i], spheres.velocity_z[i]);
+        CHECK(velocity.Norm() <= settings.max_speed * Real(1.0001));
+        moving += velocity.Norm() > Real(0) ? 1U : 0U;
+    }
+    // Loose bounds of binomial counts, far beyond their deviations
+    CHECK(moving > 180U);
+    CHECK(moving < 320U);
+    CHECK(second_material > 320U);
+    CHECK(second_material < 430U);
+}
+
+TEST_CASE("FileScene : procedural spheres need no more clusters than spheres",
+          "[ProceduralSpheres]")
+{
+    std::string const clusters = GENERATE(std::string("10"), std::string("11"));
+    TemporaryDirectory const directory("procedural_spheres_test");
+    std::string const path = directory.File("procedural_spheres_test.scene");
+    WriteFile(path,
+              "material clay lambertian 0.5 0.5 0.5\n"
+              "procedural_spheres 10 material clay 1 clusters " +
+                  clusters + " spread 0.1\n");
+    FileScene scene(path);
+    scene.LoadWorld();
+    if (clusters == "10") {
+        CHECK(scene.IsLoaded());
+    }
+    else {
+        CHECK_FALSE(scene.IsLoaded());
+        CHECK(scene.Error().find("more clusters than procedural spheres") != std::string::npos);
+    }
+}
+
+}  // namespace plemma::glancy
@@ -0,0 +1,73 @@
+#include <memory>
+
+#include "catch.hpp"
+
+#include "arena.hpp"
+#include "scene_builder.hpp"
+
+namespace plemma::glancy {
+
+TEST_CASE("SceneBuilder : equal textures and materials are created once", "[SceneBuilder]")
+{
+    Arena arena;
+    SceneBuilder builder(arena);
+    Vec3 const gray(Real(0.5), Real(0.5), Real(0.5));
+    Vec3 const red(Real(0.7), Real(0.1), Real(0.1));
+
+    SECTION("Textures")
+    {
+        auto const gray_texture = builder.MakeConstantTexture(gray);
+        auto const red_texture = builder.MakeConstantTexture(red);
+        CHECK(builder.MakeConstantTexture(gray) == gray_texture);
+        CHECK(red_texture != gray_texture);
+        auto const checker = builder.MakeCheckerTexture(gray_texture, red_texture);
+        CHECK(builder.MakeCheckerTexture(builder.MakeConstantTexture(gray), red_texture) ==
+              checker);
+        // The order of the textures of a checker matters
+        CHECK(builder.MakeCheckerTexture(red_texture, gray_texture) != checker);
+        CHECK(builder.NumberOfTextures() == 4U);
+        CHECK(builder.NumberOfMaterials() == 0U);
+    }
+
+    SECTION("Materials")
+    {
+        auto const clay = builder.MakeLambertian(gray);
+        CHECK(builder.MakeLambertian(gray) == clay);
+        CHECK(builder.MakeLambertian(builder.MakeConstantTexture(gray)) == clay);
+        CHECK(builder.MakeLambertian(red) != clay);
+
+        auto const steel = builder.MakeMetal(gray, Real(0.3));
+        CHECK(builder.MakeMetal(gray, Real(0.3)) == steel);
+        CHECK(builder.MakeMetal(gray, Real(0.4)) != steel);
+        CHECK(builder.MakeMetal(red, Real(0.3)) != steel);
+        // Fuzziness is clamped to one before interning
+        CHECK(builder.MakeMetal(gray, Real(2)) == builder.MakeMetal(gray, Real(1)));
+
+        auto const glass = builder.MakeDielectric(Real(1.52));
+        CHECK(builder.MakeDielectric(Real(1.52)) == glass);
+        CHECK(builder.MakeDielectric<WindowGlass>() == glass);
+        CHECK(builder.MakeDielectric<Water>() != glass);
+
+        auto const lamp = builder.MakeDiffuseLight(gray);
+        CHECK(builder.MakeDiffuseLight(gray) == lamp);
+        CHECK(builder.MakeDiffuseLight(red) != lamp);
+        // Materials of different kinds never share an object
+        CHECK(lamp != clay);
+
+        // Lambertians and lights: gray and red; metals: 0.3, 0.4, red and
+        // 1; dielectrics: 1.52 and water
+        CHECK(builder.NumberOfMaterials() == 10U);
+        CHECK(builder.NumberOfTextures() == 2U);
+    }
+
+    SECTION("Clearing forgets the interned objects")
+    {
+        auto const clay = builder.MakeLambertian(gray);
+        builder.Clear();
+        CHECK(builder.NumberOfTextures() == 0U);
+        CHECK(builder.NumberOfMaterials() == 0U);
+        CHECK(builder.MakeLambertian(gray) != clay);
+    }
+}
+
+}  // namespace plemma::glancy
@@ -67,6 +67,41 @@ inline Ray const& RayRandomGenerator::get() const
     return current_;
 }
 
+// Rays from a random point of [min, max]^3 to a random point of
+// [-target, target]^3, so that a fair amount of them hit what tests place
+// around the origin
+class RayTowardsOriginRandomGenerator : public Catch::Generators::IGenerator<Ray>
+{
+  public:
+    RayTowardsOriginRandomGenerator(
+        RealNum min, RealNum max, RealNum target, RealNum tmin, RealNum tmax)
+        : origin_gen_(min, max, tmin, tmax), target_gen_(-target, target)
+    {
+        static_cast<void>(next());
+    }
+
+    [[nodiscard]] Ray const& get() const override;
+    bool next() override
+    {
+        if (!origin_gen_.next() || !target_gen_.next())
+            return false;
+
+        Ray const& origin = origin_gen_.get();
+        current_ = Ray(origin.Origin(), target_gen_.get() - origin.Origin(), origin.Time());
+        return true;
+    }
+
+  private:
+    Ray current_;
+    RayRandomGenerator origin_gen_;
+    Vec3RandomGenerator target_gen_;
+};
+
+inline Ray const& RayTowardsOriginRandomGenerator::get() const
+{
+    return current_;
+}
+
 inline Catch::Generators::GeneratorWrapper<Ray> RandomRay()
 {
     return Catch::Generators::GeneratorWrapper<Ray>(std::make_unique<RayRandomGenerator>());
@@ -86,4 +121,16 @@ inline Catch::Generators::GeneratorWrapper<Ray> RandomRay(RealNum min,
         std::make_unique<RayRandomGenerator>(min, max, tmin, tmax));
 }
 
+inline Catch::Generators::GeneratorWrapper<Ray> RandomRayTowardsOrigin(RealNum tmin, RealNum tmax)
+{
+    return Catch::Generators::GeneratorWrapper<Ray>(
+        std::make_unique<RayTowardsOriginRandomGenerator>(
+            Real(-30.0), Real(30.0), Real(5.0), tmin, tmax));
+}
+
+inline Catch::Generators::GeneratorWrapper<Ray> RandomRayTowardsOrigin()
+{
+    return RandomRayTowardsOrigin(Real(0.0), Real(1.0));
+}
+
 }  // namespace plemma::glancy
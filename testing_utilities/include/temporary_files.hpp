@@ -0,0 +1,67 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include "catch.hpp"
+
+namespace plemma::glancy {
+
+// Directory of its own in the temporary directory of the system, removed
+// with everything in it when it goes out of scope. Tests write their files
+// there, so that executables running at the same time, or from the same
+// working directory, never write over each other's files.
+class TemporaryDirectory
+{
+  public:
+    explicit TemporaryDirectory(std::string const& prefix)
+    {
+        std::random_device random;
+        std::filesystem::path const parent = std::filesystem::temp_directory_path();
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            path_ = parent / (prefix + "_" + std::to_string(random()));
+            std::error_code error;
+            if (std::filesystem::create_directory(path_, error))
+                return;
+        }
+        FAIL("could not create a temporary directory in " << parent);
+    }
+    ~TemporaryDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+    TemporaryDirectory(TemporaryDirectory const&) = delete;
+    TemporaryDirectory& operator=(TemporaryDirectory const&) = delete;
+
+    [[nodiscard]] std::filesystem::path const& Path() const noexcept { return path_; }
+    // Path of the file called 'name' in the directory
+    [[nodiscard]] std::string File(std::string const& name) const
+    {
+        return (path_ / name).string();
+    }
+
+  private:
+    std::filesystem::path path_;
+};
+
+// Replaces the contents of the file at 'path' with 'contents'
+inline void WriteFile(std::filesystem::path const& path, std::string const& contents)
+{
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+// Contents of the file at 'path', empty if it can not be read
+inline std::string ReadFile(std::filesystem::path const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+}  // namespace plemma::glancy
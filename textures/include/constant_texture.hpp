@@ -15,6 +15,8 @@ class ConstantTexture : public Texture
         return color_;
     }
 
+    [[nodiscard]] Vec3 const& Color() const noexcept { return color_; }
+
   private:
     Vec3 color_;
 };
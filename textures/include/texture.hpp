@@ -8,6 +8,7 @@ class Texture
 {
   public:
     [[nodiscard]] virtual Vec3 GetValue(RealNum u, RealNum v, Vec3 const& p) const = 0;
+    virtual ~Texture() = default;
 };
 
 }  // namespace plemma::glancy
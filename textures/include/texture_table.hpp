@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <typeinfo>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "checker_texture.hpp"
+#include "constant_texture.hpp"
+#include "texture.hpp"
+#include "vec3.hpp"
+
+namespace plemma::glancy {
+
+using TextureId = std::uint32_t;
+constexpr TextureId kInvalidTextureId = std::numeric_limits<TextureId>::max();
+
+// Flat counterparts of the textures in this library. Instead of pointing
+// to other textures, they refer to them by their position in a TextureTable
+struct FlatConstantTexture
+{
+    Vec3 color;
+};
+
+struct FlatCheckerTexture
+{
+    TextureId first;
+    TextureId second;
+};
+
+using FlatTexture = std::variant<FlatConstantTexture, FlatCheckerTexture>;
+
+// Contiguous storage of the closed set of textures of this library. Looking
+// up a value does not go through any virtual call nor pointer chasing
+// apart from the indices of the table, so the compiler can inline it all.
+class TextureTable
+{
+  public:
+    // Returns the id of 'texture' in the table, flattening it (and the
+    // textures it refers to) the first time it is added. Returns
+    // kInvalidTextureId if it is not one of the textures of this library
+    // (subclasses of them included), or refers to one that is not.
+    TextureId Add(Texture const& texture);
+
+    // Same as texture.GetValue(u, v, p) for the texture with id 'id'
+    [[nodiscard]] Vec3 Value(TextureId id, RealNum u, RealNum v, Vec3 const& p) const noexcept;
+
+    [[nodiscard]] std::size_t Size() const noexcept { return textures_.size(); }
+
+    // Flattened textures, indexed by their id
+    [[nodiscard]] std::vector<FlatTexture> const& Textures() const noexcept
+    {
+        return textures_;
+    }
+
+  private:
+    std::vector<FlatTexture> textures_;
+    std::unordered_map<Texture const*, TextureId> ids_;
+};
+
+inline TextureId TextureTable::Add(Texture const& texture)
+{
+    auto const it = ids_.find(&texture);
+    if (it != ids_.end())
+        return it->second;
+
+    // Subclasses of the library textures may override GetValue, so only
+    // the exact classes are flattened
+    TextureId id = kInvalidTextureId;
+    std::type_info const& type = typeid(texture);
+    if (type == typeid(ConstantTexture)) {
+        id = static_cast<TextureId>(textures_.size());
+        textures_.emplace_back(FlatConstantTexture{
+            static_cast<ConstantTexture const&>(texture).Color()});
+    }
+    else if (type == typeid(CheckerTexture)) {
+        auto const& checker = static_cast<CheckerTexture const&>(texture);
+        TextureId const first = checker.FirstTexture() ? Add(*checker.FirstTexture())
+                                                       : kInvalidTextureId;
+        TextureId const second = checker.SecondTexture() ? Add(*checker.SecondTexture())
+                                                         : kInvalidTextureId;
+        if (first != kInvalidTextureId && second != kInvalidTextureId) {
+            id = static_cast<TextureId>(textures_.size());
+            textures_.emplace_back(FlatCheckerTexture{first, second});
+        }
+    }
+    ids_.emplace(&texture, id);
+    return id;
+}
+
+inline Vec3 TextureTable::Value(TextureId id,
+                                [[maybe_unused]] RealNum u,
+                                [[maybe_unused]] RealNum v,
+                                Vec3 const& p) const noexcept
+{
+    // Checkers are resolved iteratively, so nested ones don't recurse
+    while (true) {
+        FlatTexture const& texture = textures_[id];
+        if (auto const* constant = std::get_if<FlatConstantTexture>(&texture))
+            return constant->color;
+        auto const& checker = std::get<FlatCheckerTexture>(texture);
+        id = IsInFirstCheckerTexture(p) ? checker.first : checker.second;
+    }
+}
+
+}  // namespace plemma::glancy
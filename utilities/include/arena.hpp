@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace plemma::glancy {
+
+// Monotonic arena: objects are allocated one after the other in big
+// blocks of memory that are only given back all at once (in Release or
+// on destruction), which keeps objects created together close in memory
+// and makes freeing them almost free.
+//
+// Objects are handed out as std::shared_ptr whose control block lives in
+// the arena too, so they can be used wherever the rest of the library
+// expects shared ownership. Their destructors still run when the last
+// handle goes away, but their memory is not reused until Release. Every
+// handle must be destroyed before the arena is released or destroyed.
+class Arena
+{
+  public:
+    explicit Arena(std::size_t initial_size = kDefaultInitialSize) : resource_(initial_size) {}
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    template <typename T, typename... Args>
+    [[nodiscard]] std::shared_ptr<T> Make(Args&&... args)
+    {
+        return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(&resource_),
+                                       std::forward<Args>(args)...);
+    }
+
+    // Gives back all the memory of the arena at once
+    void Release() noexcept { resource_.release(); }
+
+    [[nodiscard]] std::pmr::memory_resource* Resource() noexcept { return &resource_; }
+
+  private:
+    static constexpr std::size_t kDefaultInitialSize = 64 * 1024;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+}  // namespace plemma::glancy
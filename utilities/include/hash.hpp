@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace plemma::glancy {
+
+// Incremental 64-bit FNV-1a hash. It is not meant to be cryptographically
+// secure, only to be a cheap and stable (across runs and platforms with
+// the same endianness) way of identifying contents.
+class Fnv1aHasher
+{
+  public:
+    void AddBytes(void const* data, std::size_t size) noexcept
+    {
+        auto const* bytes = static_cast<unsigned char const*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash_ ^= static_cast<std::uint64_t>(bytes[i]);
+            hash_ *= kPrime;
+        }
+    }
+
+    template <typename T>
+    void Add(T const& value) noexcept
+    {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "Only trivially copyable types can be hashed");
+        AddBytes(&value, sizeof(T));
+    }
+
+    [[nodiscard]] std::uint64_t Value() const noexcept { return hash_; }
+
+  private:
+    static constexpr std::uint64_t kOffsetBasis = 14695981039346656037ULL;
+    static constexpr std::uint64_t kPrime = 1099511628211ULL;
+    std::uint64_t hash_ = kOffsetBasis;
+};
+
+}  // namespace plemma::glancy
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GLANCY_HAS_MMAP 1
+#endif
+
+namespace plemma::glancy {
+
+// Read-only view of the whole contents of a file. On POSIX systems the
+// file is memory-mapped, so nothing is read from disk until it is
+// accessed; elsewhere it falls back to reading the file into a buffer.
+// Whether the file could be opened can be checked with IsOpen().
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    explicit MappedFile(std::string const& file_path) noexcept { Open(file_path); }
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile() { Close(); }
+
+    [[nodiscard]] bool IsOpen() const noexcept { return data_ != nullptr; }
+    [[nodiscard]] std::byte const* Data() const noexcept { return data_; }
+    [[nodiscard]] std::size_t Size() const noexcept { return size_; }
+
+  private:
+    void Open(std::string const& file_path) noexcept;
+    void Close() noexcept;
+
+    std::byte const* data_ = nullptr;
+    std::size_t size_ = 0U;
+    bool is_mapped_ = false;
+    std::vector<std::byte> buffer_;
+};
+
+inline MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0U);
+        is_mapped_ = std::exchange(other.is_mapped_, false);
+        buffer_ = std::move(other.buffer_);
+        // If the data was living in the buffer, it still is, but the
+        // pointer to it must be taken from the new owner of the buffer
+        if (!is_mapped_ && data_ != nullptr)
+            data_ = buffer_.data();
+    }
+    return *this;
+}
+
+inline void MappedFile::Open(std::string const& file_path) noexcept
+{
+#if defined(GLANCY_HAS_MMAP)
+    int const fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat file_status;
+    if (::fstat(fd, &file_status) == 0 && file_status.st_size > 0) {
+        void* mapping = ::mmap(nullptr,
+                               static_cast<std::size_t>(file_status.st_size),
+                               PROT_READ,
+                               MAP_PRIVATE,
+                               fd,
+                               0);
+        if (mapping != MAP_FAILED) {
+            data_ = static_cast<std::byte const*>(mapping);
+            size_ = static_cast<std::size_t>(file_status.st_size);
+            is_mapped_ = true;
+        }
+    }
+    ::close(fd);
+#else
+    std::FILE* file = std::fopen(file_path.c_str(), "rb");
+    if (file == nullptr)
+        return;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        long const file_size = std::ftell(file);
+        if (file_size > 0 && std::fseek(file, 0, SEEK_SET) == 0) {
+            buffer_.resize(static_cast<std::size_t>(file_size));
+            if (std::fread(buffer_.data(), 1U, buffer_.size(), file) == buffer_.size()) {
+                data_ = buffer_.data();
+                size_ = buffer_.size();
+            }
+            else {
+                buffer_.clear();
+            }
+        }
+    }
+    std::fclose(file);
+#endif
+}
+
+inline void MappedFile::Close() noexcept
+{
+#if defined(GLANCY_HAS_MMAP)
+    if (is_mapped_)
+        ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0U;
+    is_mapped_ = false;
+    buffer_.clear();
+}
+
+}  // namespace plemma::glancy
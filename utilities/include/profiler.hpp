@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Scoped zones of the profiler. They are compiled out unless the build
+// defines GLANCY_ENABLE_PROFILER (CMake option of the same name), so they
+// can be left in hot paths. 'name' must be a string literal.
+#if defined(GLANCY_ENABLE_PROFILER)
+#define GLANCY_PROFILE_CONCATENATE_IMPL(a, b) a##b
+#define GLANCY_PROFILE_CONCATENATE(a, b) GLANCY_PROFILE_CONCATENATE_IMPL(a, b)
+#define GLANCY_PROFILE_ZONE(name) \
+    ::plemma::profiler::Zone const GLANCY_PROFILE_CONCATENATE(glancy_profile_zone_, __LINE__)(name)
+#else
+#define GLANCY_PROFILE_ZONE(name) static_cast<void>(0)
+#endif
+
+namespace plemma::profiler {
+
+using Clock = std::chrono::steady_clock;
+
+namespace detail {
+
+// Zone of the call tree of a thread, i.e. a zone reached through a given
+// sequence of enclosing zones
+struct Node
+{
+    char const* name = nullptr;
+    std::uint32_t parent = 0U;
+    std::vector<std::uint32_t> children;
+    std::uint64_t calls = 0U;
+    std::uint64_t total_ns = 0U;
+};
+
+// Zone closed, kept for the trace
+struct TraceEvent
+{
+    char const* name;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+};
+
+// Everything a thread records. Only that thread writes it, so recording
+// takes no lock; it is read once the threads are done.
+struct ThreadProfile
+{
+    explicit ThreadProfile(std::uint32_t id) : thread_id(id) { nodes.emplace_back(); }
+
+    std::uint32_t Child(std::uint32_t parent, char const* name)
+    {
+        for (std::uint32_t const child : nodes[parent].children) {
+            if (nodes[child].name == name)
+                return child;
+        }
+        auto const child = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back().name = name;
+        nodes.back().parent = parent;
+        nodes[parent].children.push_back(child);
+        return child;
+    }
+
+    std::uint32_t thread_id;
+    // The first node is the root of the call tree, out of any zone
+    std::vector<Node> nodes;
+    std::uint32_t current = 0U;
+    std::vector<TraceEvent> trace;
+    std::uint64_t dropped_events = 0U;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadProfile> > threads;
+    std::atomic<bool> tracing{false};
+    Clock::time_point const epoch = Clock::now();
+};
+
+inline Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+inline ThreadProfile& ThisThread()
+{
+    // Registered once per thread. The registry keeps the profile of a
+    // thread after it ends, until it is reported.
+    thread_local ThreadProfile* const profile = [] {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto const id = static_cast<std::uint32_t>(registry.threads.size());
+        return registry.threads.emplace_back(std::make_shared<ThreadProfile>(id)).get();
+    }();
+    return *profile;
+}
+
+inline std::uint64_t NowNs()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          Clock::now() - GetRegistry().epoch)
+                                          .count());
+}
+
+// Zone of the call trees of all threads merged
+struct ReportNode
+{
+    std::string name;
+    std::uint64_t calls = 0U;
+    std::uint64_t total_ns = 0U;
+    std::vector<ReportNode> children;
+};
+
+inline void Merge(ThreadProfile const& profile, std::uint32_t node, ReportNode& merged)
+{
+    for (std::uint32_t const child : profile.nodes[node].children) {
+        Node const& source = profile.nodes[child];
+        auto it = std::find_if(merged.children.begin(),
+                               merged.children.end(),
+                               [&](ReportNode const& n) { return n.name == source.name; });
+        if (it == merged.children.end()) {
+            merged.children.emplace_back().name = source.name;
+            it = std::prev(merged.children.end());
+        }
+        it->calls += source.calls;
+        it->total_ns += source.total_ns;
+        Merge(profile, child, *it);
+    }
+}
+
+inline void WriteReportNode(std::ostream& out,
+                            ReportNode const& node,
+                            std::size_t depth,
+                            double root_ns)
+{
+    std::uint64_t children_ns = 0U;
+    for (ReportNode const& child : node.children)
+        children_ns += child.total_ns;
+    std::uint64_t const self_ns = node.total_ns - std::min(children_ns, node.total_ns);
+    std::string const label = std::string(2U * depth, ' ') + node.name;
+    out << std::left << std::setw(40) << label << std::right << std::setw(12) << node.calls
+        << std::setw(14) << std::fixed << std::setprecision(3) << double(node.total_ns) * 1e-6
+        << std::setw(14) << double(self_ns) * 1e-6 << std::setw(9) << std::setprecision(1)
+        << (root_ns > 0.0 ? 100.0 * double(node.total_ns) / root_ns : 0.0) << "%\n";
+
+    std::vector<ReportNode const*> sorted;
+    for (ReportNode const& child : node.children)
+        sorted.push_back(&child);
+    std::sort(sorted.begin(), sorted.end(), [](ReportNode const* a, ReportNode const* b) {
+        return a->total_ns > b->total_ns;
+    });
+    for (ReportNode const* child : sorted)
+        WriteReportNode(out, *child, depth + 1U, root_ns);
+}
+
+inline void WriteJsonString(std::ostream& out, char const* text)
+{
+    out << '"';
+    for (; *text != '\0'; ++text) {
+        if (*text == '"' || *text == '\\')
+            out << '\\';
+        out << *text;
+    }
+    out << '"';
+}
+
+}  // namespace detail
+
+// Maximum number of zones kept per thread for the trace. Later zones are
+// only counted in the report.
+constexpr std::size_t kMaxTraceEventsPerThread = std::size_t(1) << 22U;
+
+// Times the scope it lives in, as part of the zones enclosing it in the
+// same thread. Use it through GLANCY_PROFILE_ZONE.
+class Zone
+{
+  public:
+    explicit Zone(char const* name) : profile_(detail::ThisThread())
+    {
+        parent_ = profile_.current;
+        node_ = profile_.Child(parent_, name);
+        profile_.current = node_;
+        begin_ns_ = detail::NowNs();
+    }
+    ~Zone()
+    {
+        std::uint64_t const end_ns = detail::NowNs();
+        detail::Node& node = profile_.nodes[node_];
+        ++node.calls;
+        node.total_ns += end_ns - begin_ns_;
+        profile_.current = parent_;
+        if (detail::GetRegistry().tracing.load(std::memory_order_relaxed)) {
+            if (profile_.trace.size() < kMaxTraceEventsPerThread)
+                profile_.trace.push_back({node.name, begin_ns_, end_ns});
+            else
+                ++profile_.dropped_events;
+        }
+    }
+    Zone(Zone const&) = delete;
+    Zone& operator=(Zone const&) = delete;
+
+  private:
+    detail::ThreadProfile& profile_;
+    std::uint32_t parent_;
+    std::uint32_t node_;
+    std::uint64_t begin_ns_;
+};
+
+// Whether every zone is kept for WriteChromeTrace, besides being added to
+// the report. Off by default.
+inline void EnableTrace(bool enable)
+{
+    detail::GetRegistry().tracing.store(enable, std::memory_order_relaxed);
+}
+
+// Writes to 'out' the call tree of the zones of all threads, merged, with
+// the number of calls, the total and self (total minus the enclosed
+// zones) times in milliseconds and the share of the time of all the top
+// zones. Must not be called while other threads are in zones.
+inline void WriteReport(std::ostream& out)
+{
+    detail::Registry& registry = detail::GetRegistry();
+    detail::ReportNode root;
+    root.name = "all zones";
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto const& thread : registry.threads)
+            detail::Merge(*thread, 0U, root);
+    }
+    for (detail::ReportNode const& child : root.children) {
+        root.total_ns += child.total_ns;
+        root.calls += child.calls;
+    }
+
+    auto const flags = out.flags();
+    out << std::left << std::setw(40) << "zone" << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "total ms" << std::setw(14) << "self ms" << std::setw(10) << "share"
+        << "\n";
+    detail::WriteReportNode(out, root, 0U, double(root.total_ns));
+    out.flags(flags);
+
+    std::uint64_t dropped_events = 0U;
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto const& thread : registry.threads)
+        dropped_events += thread->dropped_events;
+    if (dropped_events > 0U)
+        out << dropped_events << " zones were left out of the trace\n";
+}
+
+// Writes the zones kept while tracing was enabled as a Chrome trace
+// (trace event format), which can be opened in chrome://tracing or
+// Perfetto. Returns false if the file can not be written. Must not be
+// called while other threads are in zones.
+inline bool WriteChromeTrace(std::string const& path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    detail::Registry& registry = detail::GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    out << std::fixed << std::setprecision(3);
+    for (auto const& thread : registry.threads) {
+        for (detail::TraceEvent const& event : thread->trace) {
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            detail::WriteJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->thread_id
+                << ",\"ts\":" << double(event.begin_ns) * 1e-3
+                << ",\"dur\":" << double(event.end_ns - event.begin_ns) * 1e-3 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+}  // namespace plemma::profiler
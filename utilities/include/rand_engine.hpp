@@ -1,17 +1,97 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <random>
+#include <thread>
 
 namespace plemma::glancy {
 
-inline std::default_random_engine& my_engine(
-    unsigned int seed =
-        static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()))
+// Seed mixing the current time with the thread calling it, so that
+// threads starting together get different sequences
+inline std::uint64_t DefaultEngineSeed() noexcept
 {
-    static std::default_random_engine eng(seed);
+    auto const time = std::chrono::system_clock::now().time_since_epoch().count();
+    auto const thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return static_cast<std::uint64_t>(time) ^ (std::uint64_t(thread) * 0x9E3779B97F4A7C15ULL);
+}
+
+// Scrambles 'x' (SplitMix64 finalizer), so that close values give
+// unrelated seeds
+constexpr std::uint64_t MixSeed(std::uint64_t x) noexcept
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27U)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31U);
+}
+
+// Permuted congruential generator with 64 bits of state and 32 of output
+// (PCG-XSH-RR, O'Neill, "PCG: A Family of Simple Fast Space-Efficient
+// Statistically Good Algorithms for Random Number Generation", 2014).
+// Seeding it takes two steps, so every sample of an image can start its
+// own sequence from a full 64-bit seed.
+class Pcg32
+{
+  public:
+    using result_type = std::uint32_t;
+
+    explicit Pcg32(std::uint64_t seed_value = 0x853C49E6748FEA9BULL,
+                   std::uint64_t stream = kDefaultStream) noexcept
+    {
+        seed(seed_value, stream);
+    }
+
+    // Sequences of different streams are unrelated even for the same seed
+    void seed(std::uint64_t seed_value, std::uint64_t stream = kDefaultStream) noexcept
+    {
+        state_ = 0U;
+        increment_ = (stream << 1U) | 1U;
+        (*this)();
+        state_ += seed_value;
+        (*this)();
+    }
+
+    result_type operator()() noexcept
+    {
+        std::uint64_t const old_state = state_;
+        state_ = old_state * 6364136223846793005ULL + increment_;
+        auto const xor_shifted =
+            static_cast<std::uint32_t>(((old_state >> 18U) ^ old_state) >> 27U);
+        auto const rotation = static_cast<std::uint32_t>(old_state >> 59U);
+        return (xor_shifted >> rotation) | (xor_shifted << ((32U - rotation) & 31U));
+    }
+
+    static constexpr result_type min() noexcept { return 0U; }
+    static constexpr result_type max() noexcept { return 0xFFFFFFFFU; }
+
+  private:
+    static constexpr std::uint64_t kDefaultStream = 0xDA3E39CB94B95BDBULL;
+
+    std::uint64_t state_ = 0U;
+    std::uint64_t increment_ = 1U;
+};
+
+using RandomEngine = Pcg32;
+
+// Engine of the calling thread, seeded with 'seed' by its first call in
+// each thread. Threads never share an engine, so they can render at the
+// same time.
+inline RandomEngine& my_engine(std::uint64_t seed = DefaultEngineSeed())
+{
+    thread_local RandomEngine eng(seed);
 
     return eng;
 }
 
+// 64 random bits drawn from the engine of the calling thread, e.g. to
+// seed other engines
+inline std::uint64_t RandomSeed()
+{
+    std::uint64_t const high = my_engine()();
+    return (high << 32U) | my_engine()();
+}
+
 }  // namespace plemma::glancy
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Counters of the work done per ray, to tell whether a render is slow
+// because of the BVH, long paths or the number of samples. They are
+// compiled out unless the build defines GLANCY_ENABLE_RAY_STATISTICS
+// (CMake option of the same name), so counting is free otherwise.
+#if defined(GLANCY_ENABLE_RAY_STATISTICS)
+#define GLANCY_COUNT_RAY_STATISTIC(counter, amount) \
+    static_cast<void>(::plemma::glancy::ThisThreadRayStatistics().counter += (amount))
+#define GLANCY_COUNT_PATH_END(depth) ::plemma::glancy::ThisThreadRayStatistics().AddPathEnd(depth)
+#else
+#define GLANCY_COUNT_RAY_STATISTIC(counter, amount) static_cast<void>(0)
+#define GLANCY_COUNT_PATH_END(depth) static_cast<void>(0)
+#endif
+
+namespace plemma::glancy {
+
+struct RayStatistics
+{
+    // Paths ending at a depth of kDepthBuckets - 1 or more share the last
+    // bucket of the histogram
+    static constexpr std::size_t kDepthBuckets = 17U;
+
+    void AddPathEnd(std::size_t depth) noexcept
+    {
+        ++path_depths[depth < kDepthBuckets ? depth : kDepthBuckets - 1U];
+    }
+
+    RayStatistics& operator+=(RayStatistics const& other) noexcept
+    {
+        camera_rays += other.camera_rays;
+        rays += other.rays;
+        node_visits += other.node_visits;
+        box_tests += other.box_tests;
+        primitive_tests += other.primitive_tests;
+        primitive_hits += other.primitive_hits;
+        escaped += other.escaped;
+        absorbed += other.absorbed;
+        max_depth_terminations += other.max_depth_terminations;
+        for (std::size_t i = 0; i < kDepthBuckets; ++i)
+            path_depths[i] += other.path_depths[i];
+        return *this;
+    }
+
+    std::uint64_t camera_rays = 0U;
+    // Rays traced through the world, whether from the camera or scattered
+    std::uint64_t rays = 0U;
+    // Interior nodes of BVHs entered
+    std::uint64_t node_visits = 0U;
+    // Ray-box intersection tests
+    std::uint64_t box_tests = 0U;
+    // Ray-primitive intersection tests (spheres and triangles), and how
+    // many of them hit
+    std::uint64_t primitive_tests = 0U;
+    std::uint64_t primitive_hits = 0U;
+    // How paths ended: hitting nothing, at a material that does not
+    // scatter, or cut at the maximum depth
+    std::uint64_t escaped = 0U;
+    std::uint64_t absorbed = 0U;
+    std::uint64_t max_depth_terminations = 0U;
+    // Number of paths ending at each number of bounces
+    std::array<std::uint64_t, kDepthBuckets> path_depths{};
+};
+
+namespace ray_statistics_detail {
+
+// Counters of every thread that counted. Only their thread writes them, so
+// counting takes no lock; they are read once the threads are done.
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<RayStatistics> > threads;
+};
+
+inline Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+}  // namespace ray_statistics_detail
+
+// Counters of the calling thread, registered by its first call. The
+// registry keeps them after the thread ends, so that TotalRayStatistics
+// adds the work of every thread.
+inline RayStatistics& ThisThreadRayStatistics()
+{
+    thread_local RayStatistics* const statistics = [] {
+        ray_statistics_detail::Registry& registry = ray_statistics_detail::GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return registry.threads.emplace_back(std::make_shared<RayStatistics>()).get();
+    }();
+    return *statistics;
+}
+
+// Counters of all threads merged. Must not be called while other threads
+// are counting.
+inline RayStatistics TotalRayStatistics()
+{
+    ray_statistics_detail::Registry& registry = ray_statistics_detail::GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    RayStatistics total;
+    for (auto const& thread : registry.threads)
+        total += *thread;
+    return total;
+}
+
+// Writes 'statistics' to 'out', with the averages per ray traced
+inline void WriteRayStatistics(std::ostream& out, RayStatistics const& statistics)
+{
+    auto const per_ray = [&](std::uint64_t count) {
+        return statistics.rays > 0U ? double(count) / double(statistics.rays) : 0.0;
+    };
+    auto const flags = out.flags();
+    auto const precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << "Camera rays:            " << statistics.camera_rays << "\n";
+    out << "Rays traced:            " << statistics.rays << "\n";
+    out << "BVH nodes visited:      " << statistics.node_visits << " ("
+        << per_ray(statistics.node_visits) << " per ray)\n";
+    out << "Box tests:              " << statistics.box_tests << " ("
+        << per_ray(statistics.box_tests) << " per ray)\n";
+    out << "Primitive tests:        " << statistics.primitive_tests << " ("
+        << per_ray(statistics.primitive_tests) << " per ray)\n";
+    out << "Primitive hits:         " << statistics.primitive_hits << " ("
+        << (statistics.primitive_tests > 0U
+                ? 100.0 * double(statistics.primitive_hits) / double(statistics.primitive_tests)
+                : 0.0)
+        << "% of tests)\n";
+    out << "Paths escaped:          " << statistics.escaped << "\n";
+    out << "Paths absorbed:         " << statistics.absorbed << "\n";
+    out << "Paths cut at max depth: " << statistics.max_depth_terminations << "\n";
+    out << "Paths by bounces:\n";
+    for (std::size_t depth = 0; depth < RayStatistics::kDepthBuckets; ++depth) {
+        if (statistics.path_depths[depth] == 0U)
+            continue;
+        bool const last = depth + 1U == RayStatistics::kDepthBuckets;
+        out << "  " << std::setw(3) << depth << (last ? "+" : " ") << "  "
+            << statistics.path_depths[depth] << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+}  // namespace plemma::glancy
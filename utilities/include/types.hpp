@@ -1,8 +1,30 @@
 #pragma once
 
+#include <limits>
+
 namespace plemma::glancy {
 
+// Precision of the numbers glancy computes with, chosen when building
+// (CMake option GLANCY_PRECISION). RealNum is used everywhere, while
+// PreciseRealNum is only used where float loses too much, i.e. for the
+// positions of ray origins, hit points and sphere centers (see Point3) and
+// to find where rays hit: with mixed precision, those are stored and
+// computed in double while everything else is stored and computed in
+// float, so that scenes with large coordinates don't get acne without
+// doubling the memory and bandwidth of the whole renderer.
+#if defined(GLANCY_DOUBLE_PRECISION)
+typedef double RealNum;
+typedef double PreciseRealNum;
+constexpr char const* kPrecisionName = "double";
+#elif defined(GLANCY_MIXED_PRECISION)
+typedef float RealNum;
+typedef double PreciseRealNum;
+constexpr char const* kPrecisionName = "mixed";
+#else
 typedef float RealNum;
+typedef float PreciseRealNum;
+constexpr char const* kPrecisionName = "float";
+#endif
 
 template <typename T>
 constexpr RealNum Real(T number) noexcept
@@ -10,4 +32,14 @@ constexpr RealNum Real(T number) noexcept
     return static_cast<RealNum>(number);
 }
 
-}  // namespace plemma::glancy
\ No newline at end of file
+// Bound of the relative error of a computation in T with 'n' operations
+// rounded to nearest (gamma_n in Pharr, Jakob and Humphreys, "Physically
+// Based Rendering", section 3.9)
+template <typename T>
+constexpr T RoundingErrorBound(int n) noexcept
+{
+    T const unit_roundoff = std::numeric_limits<T>::epsilon() / T(2);
+    return T(n) * unit_roundoff / (T(1) - T(n) * unit_roundoff);
+}
+
+}  // namespace plemma::glancy
@@ -14,4 +14,15 @@ inline RealNum Schlick(RealNum cosine, RealNum refraction_index)
     return r0 + (Real(1) - r0) * std::pow((Real(1) - cosine), Real(5));
 }
 
+// Weight given by the power heuristic (with exponent 2) to a sample taken
+// with density 'pdf_taken' when combined with a strategy that would have
+// taken it with density 'pdf_other'. See Veach, "Robust Monte Carlo
+// methods for light transport simulation", section 9.2.
+inline RealNum PowerHeuristic(RealNum pdf_taken, RealNum pdf_other)
+{
+    RealNum const squared_taken = pdf_taken * pdf_taken;
+    RealNum const squared_sum = squared_taken + pdf_other * pdf_other;
+    return squared_sum > Real(0) ? squared_taken / squared_sum : Real(0);
+}
+
 }  // namespace plemma::glancy::utilities